@@ -0,0 +1,110 @@
+#include "chunk_ring.h"
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static void futexWait(std::atomic<uint32_t>& word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+ChunkRing::ChunkRing()
+    : head(0), tail(0), dataSeq(0), spaceSeq(0), finished(false), closed(false) {}
+
+bool ChunkRing::push(std::string& chunk) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        // Read the sequence before checking, so a wakeup in between is not lost
+        uint32_t seq = spaceSeq.load(std::memory_order_acquire);
+        if (closed.load(std::memory_order_acquire)) return false;
+        if (t - head.load(std::memory_order_acquire) < SLOTS) break;
+        futexWait(spaceSeq, seq);
+    }
+    slots[t % SLOTS].swap(chunk);
+    chunk.clear();
+    tail.store(t + 1, std::memory_order_release);
+    dataSeq.fetch_add(1, std::memory_order_release);
+    futexWake(dataSeq);
+    return true;
+}
+
+void ChunkRing::finish() {
+    finished.store(true, std::memory_order_release);
+    dataSeq.fetch_add(1, std::memory_order_release);
+    futexWake(dataSeq);
+}
+
+bool ChunkRing::pop(std::string& chunk) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t seq = dataSeq.load(std::memory_order_acquire);
+        if (tail.load(std::memory_order_acquire) != h) break;
+        if (finished.load(std::memory_order_acquire)) return false;
+        futexWait(dataSeq, seq);
+    }
+    chunk.clear();
+    chunk.swap(slots[h % SLOTS]);
+    head.store(h + 1, std::memory_order_release);
+    spaceSeq.fetch_add(1, std::memory_order_release);
+    futexWake(spaceSeq);
+    return true;
+}
+
+void ChunkRing::close() {
+    closed.store(true, std::memory_order_release);
+    spaceSeq.fetch_add(1, std::memory_order_release);
+    futexWake(spaceSeq);
+}
+
+ChunkRingBuf::ChunkRingBuf(ChunkRing& target) : ring(target), broken(false), done(false) {
+    buffer.reserve(ChunkRing::CHUNK_SIZE);
+}
+
+ChunkRingBuf::~ChunkRingBuf() {
+    finish();
+}
+
+bool ChunkRingBuf::flushBuffer() {
+    if (buffer.empty() || broken) return !broken;
+    if (!ring.push(buffer)) broken = true;
+    buffer.reserve(ChunkRing::CHUNK_SIZE);
+    return !broken;
+}
+
+void ChunkRingBuf::finish() {
+    if (done) return;
+    flushBuffer();
+    ring.finish();
+    done = true;
+}
+
+ChunkRingBuf::int_type ChunkRingBuf::overflow(int_type ch) {
+    if (broken) return traits_type::eof();
+    if (ch != traits_type::eof()) {
+        buffer += static_cast<char>(ch);
+        if (buffer.size() >= ChunkRing::CHUNK_SIZE && !flushBuffer()) return traits_type::eof();
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize ChunkRingBuf::xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = 0;
+    while (written < n) {
+        if (broken) return written;
+        size_t room = ChunkRing::CHUNK_SIZE - buffer.size();
+        size_t take = std::min(room, static_cast<size_t>(n - written));
+        buffer.append(s + written, take);
+        written += take;
+        if (buffer.size() >= ChunkRing::CHUNK_SIZE) flushBuffer();
+    }
+    return written;
+}
+
+int ChunkRingBuf::sync() {
+    return flushBuffer() ? 0 : -1;
+}
@@ -0,0 +1,64 @@
+#ifndef CHUNK_RING_H
+#define CHUNK_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <streambuf>
+
+// Single-producer/single-consumer queue of byte chunks connecting two
+// stages of an in-process GNEL pipeline. Slots are handed over with
+// acquire/release counters only; a side that has to wait (ring full or
+// empty) sleeps on a futex instead of spinning.
+class ChunkRing {
+public:
+    static const uint32_t SLOTS = 16;
+    static const size_t CHUNK_SIZE = 1 << 16;
+
+    ChunkRing();
+
+    // Writer side. push blocks while the ring is full and returns false
+    // once the reader has closed; finish marks the end of the data.
+    bool push(std::string& chunk);
+    void finish();
+
+    // Reader side. pop blocks until a chunk arrives and returns false at
+    // the end of the data; close tells the writer nothing more is wanted.
+    bool pop(std::string& chunk);
+    void close();
+
+private:
+    std::string slots[SLOTS];
+    std::atomic<uint32_t> head;      // next slot to read
+    std::atomic<uint32_t> tail;      // next slot to write
+    std::atomic<uint32_t> dataSeq;   // bumped when data or the end arrives
+    std::atomic<uint32_t> spaceSeq;  // bumped when a slot frees up or on close
+    std::atomic<bool> finished;
+    std::atomic<bool> closed;
+};
+
+// streambuf that collects output into CHUNK_SIZE pieces and pushes them
+// into a ChunkRing, so builtins can keep writing to a plain std::ostream
+class ChunkRingBuf : public std::streambuf {
+public:
+    explicit ChunkRingBuf(ChunkRing& target);
+    ~ChunkRingBuf();
+
+    // Push what is buffered and mark the end of the stream
+    void finish();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    ChunkRing& ring;
+    std::string buffer;
+    bool broken;
+    bool done;
+
+    bool flushBuffer();
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "content_hash.h"
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+Sha256::Sha256() : bufferLen(0), totalLen(0) {
+    state[0] = 0x6a09e667; state[1] = 0xbb67ae85; state[2] = 0x3c6ef372; state[3] = 0xa54ff53a;
+    state[4] = 0x510e527f; state[5] = 0x9b05688c; state[6] = 0x1f83d9ab; state[7] = 0x5be0cd19;
+}
+
+static void sha256Block(uint32_t* state, const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+               (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + S1 + ch + SHA256_K[i] + w[i];
+        uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = S0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SHA extensions (SHA-NI): four rounds per sha256rnds2 pair, with the
+// message schedule computed by sha256msg1/msg2. The state is kept in the
+// ABEF/CDGH register layout those instructions expect.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256BlocksNi(uint32_t* state, const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);       // CDGH
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abefSave = state0, cdghSave = state1;
+        __m128i w[4];
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; g++) {
+            __m128i& cur = w[g % 4];
+            if (g < 4) {
+                cur = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + g * 16)), byteSwap);
+            }
+            __m128i msg = _mm_add_epi32(cur, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SHA256_K[g * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            if (g >= 3 && g <= 14) {
+                __m128i& next = w[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(cur, w[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+            if (g >= 1 && g <= 12) {
+                __m128i& prev = w[(g + 3) % 4];
+                prev = _mm_sha256msg1_epu32(prev, cur);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);     // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);  // DCHG
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));  // DCBA
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));     // HGFE
+}
+
+static bool haveShaNi() {
+    static const bool supported = [] {
+        unsigned a, b, c, d;
+        if (!__get_cpuid_count(7, 0, &a, &b, &c, &d) || !(b & (1u << 29))) return false;  // SHA
+        return __get_cpuid(1, &a, &b, &c, &d) && (c & (1u << 19)) && (c & (1u << 9));  // SSE4.1, SSSE3
+    }();
+    return supported;
+}
+#endif
+
+void Sha256::transform(const uint8_t* data, size_t blocks) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (haveShaNi()) {
+        sha256BlocksNi(state, data, blocks);
+        return;
+    }
+#endif
+    for (; blocks > 0; blocks--, data += 64) sha256Block(state, data);
+}
+
+void Sha256::update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    totalLen += len;
+
+    if (bufferLen > 0) {
+        size_t take = std::min(len, 64 - bufferLen);
+        memcpy(buffer + bufferLen, p, take);
+        bufferLen += take;
+        p += take;
+        len -= take;
+        if (bufferLen < 64) return;
+        transform(buffer, 1);
+        bufferLen = 0;
+    }
+    if (len >= 64) {
+        transform(p, len / 64);
+        p += len - len % 64;
+        len %= 64;
+    }
+    if (len > 0) {
+        memcpy(buffer, p, len);
+        bufferLen = len;
+    }
+}
+
+void Sha256::digest(uint8_t out[32]) {
+    uint64_t bits = totalLen * 8;
+    uint8_t pad[72] = {0x80};
+    size_t padLen = (bufferLen < 56 ? 56 : 120) - bufferLen;
+    for (int i = 0; i < 8; i++) pad[padLen + i] = uint8_t(bits >> (56 - i * 8));
+    update(pad, padLen + 8);
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 4; j++) out[i * 4 + j] = uint8_t(state[i] >> (24 - j * 8));
+    }
+}
+
+std::string Sha256::hexDigest() {
+    uint8_t raw[32];
+    digest(raw);
+    return hashHex(raw, sizeof(raw));
+}
+
+std::string hashHex(const uint8_t* digest, size_t len) {
+    static const char* hex = "0123456789abcdef";
+    std::string out;
+    out.reserve(len * 2);
+    for (size_t i = 0; i < len; i++) {
+        out += hex[digest[i] >> 4];
+        out += hex[digest[i] & 0xf];
+    }
+    return out;
+}
+
+// ------------------------------------------------------------
+// xxHash64
+// ------------------------------------------------------------
+
+static const uint64_t XXH_P1 = 11400714785074694791ULL;
+static const uint64_t XXH_P2 = 14029467366897019727ULL;
+static const uint64_t XXH_P3 = 1609587929392839161ULL;
+static const uint64_t XXH_P4 = 9650029242287828579ULL;
+static const uint64_t XXH_P5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl64(uint64_t x, int n) {
+    return (x << n) | (x >> (64 - n));
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;  // xxHash reads little-endian, as x86 does
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_P2;
+    return rotl64(acc, 31) * XXH_P1;
+}
+
+static inline uint64_t xxhMerge(uint64_t acc, uint64_t value) {
+    acc ^= xxhRound(0, value);
+    return acc * XXH_P1 + XXH_P4;
+}
+
+XxHash64::XxHash64(uint64_t seedValue) : seed(seedValue), bufferLen(0), totalLen(0) {
+    acc[0] = seed + XXH_P1 + XXH_P2;
+    acc[1] = seed + XXH_P2;
+    acc[2] = seed;
+    acc[3] = seed - XXH_P1;
+}
+
+void XxHash64::update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    totalLen += len;
+    if (bufferLen > 0) {
+        size_t take = std::min(len, 32 - bufferLen);
+        memcpy(buffer + bufferLen, p, take);
+        bufferLen += take;
+        p += take;
+        len -= take;
+        if (bufferLen < 32) return;
+        for (int i = 0; i < 4; i++) acc[i] = xxhRound(acc[i], read64(buffer + i * 8));
+        bufferLen = 0;
+    }
+    uint64_t v0 = acc[0], v1 = acc[1], v2 = acc[2], v3 = acc[3];
+    for (; len >= 32; p += 32, len -= 32) {
+        v0 = xxhRound(v0, read64(p));
+        v1 = xxhRound(v1, read64(p + 8));
+        v2 = xxhRound(v2, read64(p + 16));
+        v3 = xxhRound(v3, read64(p + 24));
+    }
+    acc[0] = v0; acc[1] = v1; acc[2] = v2; acc[3] = v3;
+    if (len > 0) {
+        memcpy(buffer, p, len);
+        bufferLen = len;
+    }
+}
+
+uint64_t XxHash64::digest() const {
+    uint64_t h;
+    if (totalLen >= 32) {
+        h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+        for (int i = 0; i < 4; i++) h = xxhMerge(h, acc[i]);
+    } else {
+        h = seed + XXH_P5;
+    }
+    h += totalLen;
+
+    const uint8_t* p = buffer;
+    size_t len = bufferLen;
+    for (; len >= 8; p += 8, len -= 8) {
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * XXH_P1 + XXH_P4;
+    }
+    if (len >= 4) {
+        h ^= uint64_t(read32(p)) * XXH_P1;
+        h = rotl64(h, 23) * XXH_P2 + XXH_P3;
+        p += 4;
+        len -= 4;
+    }
+    for (; len > 0; p++, len--) {
+        h ^= (*p) * XXH_P5;
+        h = rotl64(h, 11) * XXH_P1;
+    }
+    h ^= h >> 33;
+    h *= XXH_P2;
+    h ^= h >> 29;
+    h *= XXH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string XxHash64::hexDigest() const {
+    uint64_t h = digest();
+    uint8_t raw[8];
+    for (int i = 0; i < 8; i++) raw[i] = uint8_t(h >> (56 - i * 8));
+    return hashHex(raw, sizeof(raw));
+}
+
+std::string sha256Hex(const std::string& data) {
+    Sha256 h;
+    h.update(data);
+    return h.hexDigest();
+}
+
+std::string sha256File(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return "";
+
+    Sha256 h;
+    static const size_t bufSize = 1 << 20;
+    std::unique_ptr<char[]> buf(new char[bufSize]);
+    ssize_t n;
+    while ((n = read(fd, buf.get(), bufSize)) > 0) {
+        h.update(buf.get(), n);
+    }
+    close(fd);
+    if (n < 0) return "";
+    return h.hexDigest();
+}
@@ -0,0 +1,53 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Streaming SHA-256 used for content addressing (INT cache, file hashing).
+// Uses the x86 SHA extensions when the CPU has them.
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t bufferLen;
+    uint64_t totalLen;
+
+    void transform(const uint8_t* data, size_t blocks);
+
+public:
+    Sha256();
+    void update(const void* data, size_t len);
+    void update(const std::string& data) { update(data.data(), data.size()); }
+    // Finish the hash; call once
+    void digest(uint8_t out[32]);
+    std::string hexDigest();
+};
+
+// Streaming xxHash64: a fast non-cryptographic hash for change detection
+class XxHash64 {
+private:
+    uint64_t seed;
+    uint64_t acc[4];
+    uint8_t buffer[32];
+    size_t bufferLen;
+    uint64_t totalLen;
+
+public:
+    explicit XxHash64(uint64_t seed = 0);
+    void update(const void* data, size_t len);
+    uint64_t digest() const;
+    // Big-endian hex, as xxhsum prints it
+    std::string hexDigest() const;
+};
+
+// Lowercase hex of a raw digest
+std::string hashHex(const uint8_t* digest, size_t len);
+
+// One-shot helpers
+std::string sha256Hex(const std::string& data);
+// Hash a file's content; returns "" if the file cannot be read
+std::string sha256File(const std::string& path);
+
+#endif
@@ -0,0 +1,597 @@
+#include "external_sort.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t SINK_BUFFER = 1 << 20;
+const size_t STREAM_BLOCK = 8 << 20;
+const size_t MIN_SLICE = 16384;   // lines per parallel sort slice, at least
+const size_t MERGE_FAN_IN = 128;  // runs merged at once; more take extra passes
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// Compare the leading numbers of a and b the way sort -n does: optional
+// blanks and '-', digits, an optional fraction. Digit strings are compared
+// directly, so any length works and nothing is rounded.
+int compareNumbers(const char* a, size_t an, const char* b, size_t bn) {
+    struct Number {
+        bool negative = false;
+        const char* whole = nullptr;
+        size_t wholeLen = 0;
+        const char* fraction = nullptr;
+        size_t fractionLen = 0;
+    };
+    auto parse = [](const char* p, size_t n) {
+        Number num;
+        size_t i = 0;
+        while (i < n && isBlank(p[i])) i++;
+        if (i < n && p[i] == '-') {
+            num.negative = true;
+            i++;
+        }
+        while (i < n && p[i] == '0') i++;
+        num.whole = p + i;
+        while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+        num.wholeLen = (p + i) - num.whole;
+        if (i < n && p[i] == '.') {
+            num.fraction = p + ++i;
+            while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+            num.fractionLen = (p + i) - num.fraction;
+            while (num.fractionLen > 0 && num.fraction[num.fractionLen - 1] == '0') num.fractionLen--;
+        }
+        if (num.wholeLen == 0 && num.fractionLen == 0) num.negative = false;  // -0 is 0
+        return num;
+    };
+    Number x = parse(a, an), y = parse(b, bn);
+    if (x.negative != y.negative) return x.negative ? -1 : 1;
+
+    int c = 0;
+    if (x.wholeLen != y.wholeLen) {
+        c = x.wholeLen < y.wholeLen ? -1 : 1;
+    } else if (x.wholeLen > 0) {
+        c = memcmp(x.whole, y.whole, x.wholeLen);
+    }
+    if (c == 0) {
+        size_t common = std::min(x.fractionLen, y.fractionLen);
+        c = common > 0 ? memcmp(x.fraction, y.fraction, common) : 0;
+        // Trailing zeros are gone, so a longer fraction is the bigger one
+        if (c == 0 && x.fractionLen != y.fractionLen) c = x.fractionLen < y.fractionLen ? -1 : 1;
+    }
+    return x.negative ? -c : c;
+}
+
+// An order-preserving 64-bit image of a sort -n key: the number rounded
+// to a double (correct rounding never reverses an order) with its bits
+// arranged so that unsigned comparison follows the value. Different words
+// decide a comparison; equal ones need compareNumbers.
+uint64_t numberWord(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && isBlank(p[i])) i++;
+    size_t start = i;
+    if (i < n && p[i] == '-') i++;
+    while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+    if (i < n && p[i] == '.') {
+        i++;
+        while (i < n && p[i] >= '0' && p[i] <= '9') i++;
+    }
+    char buf[64];
+    double value = 0;
+    if (i - start < sizeof(buf)) {
+        memcpy(buf, p + start, i - start);
+        buf[i - start] = '\0';
+        value = strtod(buf, nullptr);
+    } else {
+        value = strtod(std::string(p + start, i - start).c_str(), nullptr);
+    }
+    if (value == 0) value = 0;  // -0 sorts as 0
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+int compareBytes(const char* a, size_t an, const char* b, size_t bn) {
+    int c = memcmp(a, b, std::min(an, bn));
+    if (c != 0) return c;
+    return an < bn ? -1 : (an > bn ? 1 : 0);
+}
+
+}
+
+// How lines are keyed and ordered
+class SortOrder {
+private:
+    const SortOptions& opt;
+    bool lastResort;  // break key ties on the whole line, as sort does
+
+    // Offset of field n (1-based) in line; fields split at the separator,
+    // or at each blank-to-nonblank change with leading blanks included
+    size_t fieldStart(const char* data, size_t size, size_t n) const {
+        size_t pos = 0;
+        for (size_t i = 1; i < n && pos < size; i++) {
+            if (opt.separator) {
+                const char* sep = static_cast<const char*>(memchr(data + pos, opt.separator, size - pos));
+                pos = sep ? (sep - data) + 1 : size;
+            } else {
+                while (pos < size && isBlank(data[pos])) pos++;
+                while (pos < size && !isBlank(data[pos])) pos++;
+            }
+        }
+        return pos;
+    }
+
+    size_t fieldEnd(const char* data, size_t size, size_t n) const {
+        size_t pos = fieldStart(data, size, n);
+        if (opt.separator) {
+            const char* sep = static_cast<const char*>(memchr(data + pos, opt.separator, size - pos));
+            return sep ? sep - data : size;
+        }
+        while (pos < size && isBlank(data[pos])) pos++;
+        while (pos < size && !isBlank(data[pos])) pos++;
+        return pos;
+    }
+
+    int compareKeys(const SortLine& a, const SortLine& b) const {
+        const char* ka = a.data + a.keyBegin;
+        const char* kb = b.data + b.keyBegin;
+        size_t la = a.keyEnd - a.keyBegin, lb = b.keyEnd - b.keyBegin;
+        if (a.prefix != b.prefix) return a.prefix < b.prefix ? -1 : 1;
+        if (opt.numeric) return compareNumbers(ka, la, kb, lb);
+        // Equal prefixes mean the first few bytes match already
+        size_t skip = std::min<size_t>(8, std::min(la, lb));
+        return compareBytes(ka + skip, la - skip, kb + skip, lb - skip);
+    }
+
+public:
+    explicit SortOrder(const SortOptions& options)
+        : opt(options),
+          lastResort(!options.unique && !options.stable && (options.keyStart > 0 || options.numeric)) {}
+
+    SortLine make(const char* data, size_t size) const {
+        SortLine line;
+        line.data = data;
+        line.size = static_cast<uint32_t>(size);
+        size_t begin = 0, end = size;
+        if (opt.keyStart > 0) {
+            begin = fieldStart(data, size, opt.keyStart);
+            if (opt.keyEnd > 0) end = std::max(begin, fieldEnd(data, size, opt.keyEnd));
+        }
+        line.keyBegin = static_cast<uint32_t>(begin);
+        line.keyEnd = static_cast<uint32_t>(end);
+        line.prefix = opt.numeric ? numberWord(data + begin, end - begin) : keyWord(line, 0);
+        return line;
+    }
+
+    int compare(const SortLine& a, const SortLine& b) const {
+        int c = compareKeys(a, b);
+        if (c == 0 && lastResort) c = compareBytes(a.data, a.size, b.data, b.size);
+        return opt.reverse ? -c : c;
+    }
+
+    bool sameKey(const SortLine& a, const SortLine& b) const {
+        return compareKeys(a, b) == 0;
+    }
+
+    // Sort a slice of lines; keepOrder keeps lines with equal keys in
+    // input order (needed for -u and -s)
+    void sort(SortLine* begin, SortLine* end, bool keepOrder) const {
+        if (opt.numeric) {
+            auto less = [this](const SortLine& a, const SortLine& b) { return compare(a, b) < 0; };
+            if (keepOrder) std::stable_sort(begin, end, less);
+            else std::sort(begin, end, less);
+            return;
+        }
+        sortWords(begin, end, 0, keepOrder);
+    }
+
+private:
+    static const size_t MAX_WORD_DEPTH = 256;  // deeper ties fall back to memcmp
+    static const ptrdiff_t MIN_WORD_GROUP = 16;
+
+    // Key bytes [depth, depth + 8) as a big-endian word, zero padded
+    static uint64_t keyWord(const SortLine& line, size_t depth) {
+        const char* key = line.data + line.keyBegin + depth;
+        size_t left = line.keyEnd - line.keyBegin - std::min<size_t>(depth, line.keyEnd - line.keyBegin);
+        uint64_t word = 0;
+        if (left >= 8) {
+            memcpy(&word, key, 8);
+            return __builtin_bswap64(word);
+        }
+        for (size_t i = 0; i < left; i++) {
+            word |= static_cast<uint64_t>(static_cast<unsigned char>(key[i])) << (56 - 8 * i);
+        }
+        return word;
+    }
+
+    // Plain comparison of lines whose keys agree on their first depth bytes
+    void sortCompared(SortLine* begin, SortLine* end, size_t depth, bool keepOrder) const {
+        auto less = [this, depth](const SortLine& a, const SortLine& b) {
+            int c = compareBytes(a.data + a.keyBegin + depth, a.keyEnd - a.keyBegin - depth,
+                                 b.data + b.keyBegin + depth, b.keyEnd - b.keyBegin - depth);
+            if (c == 0 && lastResort) c = compareBytes(a.data, a.size, b.data, b.size);
+            return opt.reverse ? c > 0 : c < 0;
+        };
+        if (keepOrder) std::stable_sort(begin, end, less);
+        else std::sort(begin, end, less);
+    }
+
+    // Byte keys are sorted a word at a time: order on the cached 8-byte
+    // prefixes (integer compares, no access to the line data), then load
+    // the next 8 key bytes for each run of ties and go one word deeper.
+    // Lines sharing long prefixes such as timestamps never reach memcmp.
+    // prefix holds the word at depth on entry and on return.
+    void sortWords(SortLine* begin, SortLine* end, size_t depth, bool keepOrder) const {
+        if (end - begin < MIN_WORD_GROUP || depth >= MAX_WORD_DEPTH) {
+            sortCompared(begin, end, depth, keepOrder);
+            return;
+        }
+        bool reverse = opt.reverse;
+        auto byWord = [reverse](const SortLine& a, const SortLine& b) {
+            return reverse ? a.prefix > b.prefix : a.prefix < b.prefix;
+        };
+        if (keepOrder) std::stable_sort(begin, end, byWord);
+        else std::sort(begin, end, byWord);
+
+        size_t next = depth + 8;
+        for (SortLine* group = begin; group < end; ) {
+            SortLine* stop = group + 1;
+            while (stop < end && stop->prefix == group->prefix) stop++;
+            if (stop - group > 1) {
+                // Keys ending in this word are prefixes of the longer ones
+                // and only differ in length; the rest go a word deeper
+                auto ended = [next](const SortLine& l) { return l.keyEnd - l.keyBegin <= next; };
+                auto more = [next](const SortLine& l) { return l.keyEnd - l.keyBegin > next; };
+                SortLine* split = keepOrder ? (reverse ? std::stable_partition(group, stop, more)
+                                                       : std::stable_partition(group, stop, ended))
+                                            : (reverse ? std::partition(group, stop, more)
+                                                       : std::partition(group, stop, ended));
+                SortLine* doneBegin = reverse ? split : group;
+                SortLine* doneEnd = reverse ? stop : split;
+                SortLine* moreBegin = reverse ? group : split;
+                SortLine* moreEnd = reverse ? split : stop;
+                if (doneEnd - doneBegin > 1) sortCompared(doneBegin, doneEnd, depth, keepOrder);
+                if (moreEnd - moreBegin > 1) {
+                    for (SortLine* l = moreBegin; l < moreEnd; l++) l->prefix = keyWord(*l, next);
+                    sortWords(moreBegin, moreEnd, next, keepOrder);
+                    for (SortLine* l = moreBegin; l < moreEnd; l++) l->prefix = keyWord(*l, depth);
+                }
+            }
+            group = stop;
+        }
+    }
+};
+
+// Buffered output of lines to a file descriptor or a stream
+class SortSink {
+private:
+    int fd;
+    std::ostream* out;
+    std::string buffer;
+    bool ok;
+
+public:
+    SortSink(int target, std::ostream* stream) : fd(target), out(stream), ok(true) {
+        buffer.reserve(SINK_BUFFER + 4096);
+    }
+
+    void put(const SortLine& line) {
+        buffer.append(line.data, line.size);
+        buffer += '\n';
+        if (buffer.size() >= SINK_BUFFER) flush();
+    }
+
+    bool flush() {
+        if (fd < 0) {
+            if (out) out->write(buffer.data(), buffer.size());
+            if (out && !*out) ok = false;
+        } else {
+            const char* p = buffer.data();
+            size_t left = buffer.size();
+            while (ok && left > 0) {
+                ssize_t n = write(fd, p, left);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) {
+                    ok = false;
+                    break;
+                }
+                p += n;
+                left -= n;
+            }
+        }
+        buffer.clear();
+        return ok;
+    }
+};
+
+// A spilled run: sorted lines in an already unlinked temp file
+struct SortRun {
+    int fd = -1;
+
+    ~SortRun() {
+        if (fd >= 0) close(fd);
+    }
+};
+
+namespace {
+
+class MergeSource {
+public:
+    virtual ~MergeSource() {}
+    // The line stays valid until the next call
+    virtual bool next(SortLine& line) = 0;
+};
+
+class SliceSource : public MergeSource {
+private:
+    const SortLine* it;
+    const SortLine* end;
+
+public:
+    SliceSource(const SortLine* begin, const SortLine* stop) : it(begin), end(stop) {}
+
+    bool next(SortLine& line) override {
+        if (it == end) return false;
+        line = *it++;
+        return true;
+    }
+};
+
+// Reads a run back through one large buffer with plain sequential reads
+class RunSource : public MergeSource {
+private:
+    const SortOrder& order;
+    int fd;
+    std::vector<char> buffer;
+    size_t pos, end;
+    bool eof;
+
+public:
+    RunSource(const SortOrder& lineOrder, int runFd, size_t bufferSize)
+        : order(lineOrder), fd(runFd), buffer(bufferSize), pos(0), end(0), eof(false) {
+        lseek(fd, 0, SEEK_SET);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    bool next(SortLine& line) override {
+        for (;;) {
+            char* data = buffer.data();
+            const char* nl = static_cast<const char*>(memchr(data + pos, '\n', end - pos));
+            if (nl) {
+                line = order.make(data + pos, nl - (data + pos));
+                pos = (nl - data) + 1;
+                return true;
+            }
+            if (eof) {
+                if (pos == end) return false;
+                line = order.make(data + pos, end - pos);
+                pos = end;
+                return true;
+            }
+            // Keep the partial line and refill behind it
+            memmove(data, data + pos, end - pos);
+            end -= pos;
+            pos = 0;
+            if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+            ssize_t n;
+            do {
+                n = read(fd, buffer.data() + end, buffer.size() - end);
+            } while (n < 0 && errno == EINTR);
+            if (n <= 0) eof = true;
+            else end += n;
+        }
+    }
+};
+
+// k-way merge through a loser tree: tree[0] holds the current winner and
+// every inner node the loser of the match played there, so replacing the
+// winner costs one comparison per level. Ties go to the earlier source,
+// which keeps the merge stable.
+void mergeSources(std::vector<std::unique_ptr<MergeSource>>& sources, const SortOrder& order,
+                  bool unique, SortSink& sink) {
+    size_t k = sources.size();
+    if (k == 0) return;
+    std::vector<SortLine> heads(k);
+    std::vector<char> live(k);
+    for (size_t i = 0; i < k; i++) live[i] = sources[i]->next(heads[i]);
+
+    auto beats = [&](size_t a, size_t b) {
+        if (!live[a] || !live[b]) return live[a] > live[b] || (live[a] == live[b] && a < b);
+        int c = order.compare(heads[a], heads[b]);
+        return c < 0 || (c == 0 && a < b);
+    };
+
+    std::vector<size_t> tree(k);
+    std::vector<size_t> winners(2 * k);
+    for (size_t i = 0; i < k; i++) winners[k + i] = i;
+    for (size_t node = k - 1; node >= 1; node--) {
+        size_t a = winners[2 * node], b = winners[2 * node + 1];
+        if (beats(a, b)) {
+            winners[node] = a;
+            tree[node] = b;
+        } else {
+            winners[node] = b;
+            tree[node] = a;
+        }
+    }
+    tree[0] = k > 1 ? winners[1] : 0;
+
+    std::string last;
+    SortLine lastLine{};
+    bool haveLast = false;
+    for (;;) {
+        size_t w = tree[0];
+        if (!live[w]) break;
+        if (!unique || !haveLast || !order.sameKey(lastLine, heads[w])) {
+            sink.put(heads[w]);
+            if (unique) {
+                last.assign(heads[w].data, heads[w].size);
+                lastLine = order.make(last.data(), last.size());
+                haveLast = true;
+            }
+        }
+        live[w] = sources[w]->next(heads[w]);
+        for (size_t node = (w + k) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], w)) std::swap(tree[node], w);
+        }
+        tree[0] = w;
+    }
+}
+
+}
+
+ExternalSorter::ExternalSorter(const SortOptions& options)
+    : opt(options), order(new SortOrder(opt)), runBytes(0), budget(options.memoryBudget) {
+    if (budget == 0) {
+        long pages = sysconf(_SC_PHYS_PAGES);
+        long pageSize = sysconf(_SC_PAGESIZE);
+        budget = (pages > 0 && pageSize > 0) ? static_cast<size_t>(pages) * pageSize / 4 : (size_t(1) << 30);
+    }
+    budget = std::max<size_t>(budget, 1 << 20);
+}
+
+ExternalSorter::~ExternalSorter() {}
+
+bool ExternalSorter::fail(const std::string& what) {
+    message = what + ": " + strerror(errno);
+    return false;
+}
+
+void ExternalSorter::addLine(const char* data, size_t size) {
+    lines.push_back(order->make(data, size));
+    runBytes += sizeof(SortLine);
+}
+
+bool ExternalSorter::add(const char* data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+        size_t end = nl ? nl - data : size;
+        addLine(data + pos, end - pos);
+        runBytes += end - pos + 1;
+        pos = end + 1;
+        if (runBytes >= budget && !spill()) return false;
+    }
+    return true;
+}
+
+bool ExternalSorter::add(const std::function<bool(const char*&, size_t&)>& next) {
+    std::string* block = nullptr;
+    size_t lineStart = 0;  // unfinished line in block
+    const char* data;
+    size_t size;
+    while (next(data, size)) {
+        if (!block || block->size() + size > block->capacity()) {
+            // Blocks never reallocate, so lines can point into them; start a
+            // new one holding the unfinished line and the new piece
+            size_t tail = block ? block->size() - lineStart : 0;
+            std::unique_ptr<std::string> fresh(new std::string);
+            fresh->reserve(std::max(STREAM_BLOCK, (tail + size) * 2));
+            if (block) fresh->append(*block, lineStart, tail);
+            // Every earlier line is complete, so this is a safe place to spill
+            if (runBytes >= budget && !spill()) return false;
+            block = fresh.get();
+            runBytes += block->capacity();
+            blocks.push_back(std::move(fresh));
+            lineStart = 0;
+        }
+        size_t pos = block->size();
+        block->append(data, size);
+        const char* base = block->data();
+        for (;;) {
+            const char* nl = static_cast<const char*>(memchr(base + pos, '\n', block->size() - pos));
+            if (!nl) break;
+            addLine(base + lineStart, nl - (base + lineStart));
+            lineStart = pos = (nl - base) + 1;
+        }
+    }
+    if (block && lineStart < block->size()) addLine(block->data() + lineStart, block->size() - lineStart);
+    return true;
+}
+
+// Sort the current run in slices on the pool, then merge the slices
+void ExternalSorter::sortRun(SortSink& sink) {
+    ThreadPool& pool = ThreadPool::shared();
+    size_t count = lines.size();
+    size_t parts = std::max<size_t>(1, std::min<size_t>(pool.size(), count / MIN_SLICE));
+    bool keepOrder = opt.unique || opt.stable;
+    const SortOrder* lineOrder = order.get();
+
+    std::vector<std::unique_ptr<MergeSource>> slices;
+    ThreadPool::Group group;
+    for (size_t i = 0; i < parts; i++) {
+        SortLine* begin = lines.data() + count * i / parts;
+        SortLine* end = lines.data() + count * (i + 1) / parts;
+        slices.emplace_back(new SliceSource(begin, end));
+        pool.submit(group, [begin, end, keepOrder, lineOrder] { lineOrder->sort(begin, end, keepOrder); });
+    }
+    pool.wait(group);
+    mergeSources(slices, *order, opt.unique, sink);
+}
+
+bool ExternalSorter::newRun(std::unique_ptr<SortRun>& run) {
+    std::string dir = opt.tempDir;
+    if (dir.empty()) {
+        const char* env = getenv("TMPDIR");
+        dir = (env && *env) ? env : "/tmp";
+    }
+    std::string path = dir + "/gnel-sortXXXXXX";
+    run.reset(new SortRun);
+    run->fd = mkostemp(&path[0], O_CLOEXEC);
+    if (run->fd < 0) return fail("cannot create temporary file in '" + dir + "'");
+    unlink(path.c_str());
+    return true;
+}
+
+bool ExternalSorter::spill() {
+    if (lines.empty()) return true;
+    std::unique_ptr<SortRun> run;
+    if (!newRun(run)) return false;
+    SortSink sink(run->fd, nullptr);
+    sortRun(sink);
+    if (!sink.flush()) return fail("write failed");
+    runs.push_back(std::move(run));
+    lines.clear();
+    blocks.clear();
+    runBytes = 0;
+    return true;
+}
+
+bool ExternalSorter::mergeRuns(std::vector<std::unique_ptr<SortRun>>& inputs, SortSink& sink) {
+    size_t bufferSize = std::min<size_t>(4 << 20, std::max<size_t>(64 << 10, budget / (inputs.size() + 1)));
+    std::vector<std::unique_ptr<MergeSource>> sources;
+    for (auto& run : inputs) sources.emplace_back(new RunSource(*order, run->fd, bufferSize));
+    mergeSources(sources, *order, opt.unique, sink);
+    return sink.flush() || fail("write failed");
+}
+
+bool ExternalSorter::finish(int fd, std::ostream* out) {
+    SortSink sink(fd, out);
+    if (runs.empty()) {
+        sortRun(sink);
+        return sink.flush() || fail("write failed");
+    }
+    if (!spill()) return false;
+
+    // Too many runs for one merge: combine them in groups first
+    while (runs.size() > MERGE_FAN_IN) {
+        std::vector<std::unique_ptr<SortRun>> merged;
+        for (size_t i = 0; i < runs.size(); i += MERGE_FAN_IN) {
+            std::vector<std::unique_ptr<SortRun>> group;
+            for (size_t j = i; j < std::min(runs.size(), i + MERGE_FAN_IN); j++) group.push_back(std::move(runs[j]));
+            std::unique_ptr<SortRun> run;
+            if (!newRun(run)) return false;
+            SortSink runSink(run->fd, nullptr);
+            if (!mergeRuns(group, runSink)) return false;
+            merged.push_back(std::move(run));
+        }
+        runs.swap(merged);
+    }
+    return mergeRuns(runs, sink);
+}
@@ -0,0 +1,81 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Options of an ExternalSorter, following POSIX sort in the C locale
+struct SortOptions {
+    bool numeric = false;     // -n: compare leading numbers
+    bool reverse = false;     // -r
+    bool unique = false;      // -u: keep the first of lines with equal keys
+    bool stable = false;      // -s: no whole-line comparison between equal keys
+    char separator = 0;       // -t; 0 means fields are split at blank runs
+    size_t keyStart = 0;      // -k start field (1-based); 0 = the whole line
+    size_t keyEnd = 0;        // -k ,end field; 0 = to the end of the line
+    size_t memoryBudget = 0;  // -S bytes; 0 = a quarter of RAM
+    std::string tempDir;      // -T; default $TMPDIR or /tmp
+};
+
+// One line and its sort key. Lines are limited to 4 GiB.
+struct SortLine {
+    const char* data;
+    uint32_t size;
+    uint32_t keyBegin;
+    uint32_t keyEnd;
+    uint64_t prefix;  // first 8 key bytes, big-endian; for -n the number as a word
+};
+
+class SortOrder;
+class SortSink;
+struct SortRun;
+
+// Sorts input that may be larger than memory. Lines are gathered into runs
+// that fit the memory budget; each run is sorted in parallel slices on the
+// shared thread pool and, unless everything fits, spilled to an unlinked
+// temp file. A k-way loser-tree merge over large sequential buffers then
+// produces the output, in several passes if there are very many runs.
+class ExternalSorter {
+public:
+    explicit ExternalSorter(const SortOptions& options);
+    ~ExternalSorter();
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    // Add a whole input held in memory (e.g. a mapping). The data is not
+    // copied and must stay valid until finish() returns.
+    bool add(const char* data, size_t size);
+    // Add a streamed input: next hands out pieces until it returns false.
+    // The pieces are copied.
+    bool add(const std::function<bool(const char*&, size_t&)>& next);
+
+    // Write the sorted lines to fd, or to out if fd is negative
+    bool finish(int fd, std::ostream* out);
+
+    // What went wrong after add/finish returned false
+    const std::string& error() const { return message; }
+
+private:
+    SortOptions opt;
+    std::unique_ptr<SortOrder> order;
+    std::vector<SortLine> lines;                     // current run
+    std::vector<std::unique_ptr<std::string>> blocks;  // copied stream data of the current run
+    size_t runBytes;
+    size_t budget;
+    std::vector<std::unique_ptr<SortRun>> runs;      // spilled runs, in input order
+    std::string message;
+
+    void addLine(const char* data, size_t size);
+    void sortRun(SortSink& sink);
+    bool spill();
+    bool mergeRuns(std::vector<std::unique_ptr<SortRun>>& inputs, SortSink& sink);
+    bool newRun(std::unique_ptr<SortRun>& run);
+    bool fail(const std::string& what);
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "file_watcher.h"
+#include <cerrno>
+#include <chrono>
+#include <unordered_set>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                   IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+FileWatcher::FileWatcher() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (inotifyFd >= 0 && epollFd >= 0) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = inotifyFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &ev);
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+bool FileWatcher::addOne(const std::string& path, bool recursive) {
+    int wd = inotify_add_watch(inotifyFd, path.c_str(), WATCH_MASK | IN_EXCL_UNLINK);
+    if (wd < 0) return false;
+    watches[wd] = Watch{path, recursive};
+    return true;
+}
+
+void FileWatcher::addTree(const std::string& dir, std::vector<std::string>* found) {
+    // Watch the directory before listing it, so nothing created in between is lost
+    if (!addOne(dir, true)) return;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string path = dir + "/" + name;
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (found) found->push_back(path);
+        if (isDir) addTree(path, found);
+    }
+    closedir(d);
+}
+
+bool FileWatcher::add(const std::string& path, bool recursive) {
+    if (inotifyFd < 0 || epollFd < 0) return false;
+    std::string root = path;
+    while (root.size() > 1 && root.back() == '/') root.pop_back();
+    struct stat st;
+    if (stat(root.c_str(), &st) != 0) return false;
+    if (recursive && S_ISDIR(st.st_mode)) {
+        size_t before = watches.size();
+        addTree(root, nullptr);
+        if (watches.size() == before) return false;
+        return true;
+    }
+    return addOne(root, false);
+}
+
+bool FileWatcher::drain(std::vector<std::string>& changed) {
+    alignas(struct inotify_event) char buf[64 * 1024];
+    while (true) {
+        ssize_t n = read(inotifyFd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN;
+        }
+        if (n == 0) return true;
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Events were dropped; all that can be said is that the roots changed
+                for (auto& w : watches) changed.push_back(w.second.path);
+                continue;
+            }
+            auto it = watches.find(ev->wd);
+            if (it == watches.end()) continue;
+            if (ev->mask & IN_IGNORED) {
+                watches.erase(it);
+                continue;
+            }
+            std::string path = it->second.path;
+            if (ev->len > 0) path += "/" + std::string(ev->name);
+            changed.push_back(path);
+
+            // A directory created or moved into a recursive watch gets its
+            // own watches; whatever landed in it before then counts as changed
+            if (it->second.recursive && (ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                addTree(path, &changed);
+        }
+    }
+}
+
+bool FileWatcher::wait(int debounceMs, std::vector<std::string>& changed) {
+    changed.clear();
+    std::vector<std::string> raw;
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point quietUntil;
+
+    while (true) {
+        if (watches.empty() && raw.empty()) return false;
+        // Idle in epoll with no timeout until the first event; after that
+        // only until the burst has gone quiet for the debounce window
+        int timeout = -1;
+        if (!raw.empty()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(quietUntil - Clock::now());
+            if (left.count() <= 0) break;
+            timeout = static_cast<int>(left.count());
+        }
+        struct epoll_event ev;
+        int ready = epoll_wait(epollFd, &ev, 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (ready == 0) break;
+        size_t before = raw.size();
+        if (!drain(raw)) return false;
+        if (raw.size() > before) quietUntil = Clock::now() + std::chrono::milliseconds(debounceMs);
+    }
+
+    std::unordered_set<std::string> seen;
+    for (auto& path : raw)
+        if (seen.insert(path).second) changed.push_back(path);
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// inotify watches on files and directory trees for .GNEL.watch. Waiting
+// blocks in epoll until something happens, then keeps collecting until
+// the burst has been quiet for the debounce window, so a save that
+// writes, renames and touches a file comes back as one change.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watch path; with recursive, every directory below it too, including
+    // ones created later. Returns false with errno set.
+    bool add(const std::string& path, bool recursive);
+
+    // Block until changes arrive and then settle for debounceMs. changed
+    // receives each affected path once, in the order first seen. Returns
+    // false if nothing is watched any more or the wait failed.
+    bool wait(int debounceMs, std::vector<std::string>& changed);
+
+    // Readable while changes are waiting, to poll alongside other events
+    int fd() const { return epollFd; }
+
+private:
+    int inotifyFd;
+    int epollFd;
+    struct Watch {
+        std::string path;
+        bool recursive;
+    };
+    std::map<int, Watch> watches;  // by watch descriptor
+
+    bool addOne(const std::string& path, bool recursive);
+    // Watch dir and the directories below it; with found, also report
+    // what is already inside (a tree that was just created or moved in)
+    void addTree(const std::string& dir, std::vector<std::string>* found);
+    // Read what is queued into changed; false if the descriptor failed
+    bool drain(std::vector<std::string>& changed);
+};
+
+#endif
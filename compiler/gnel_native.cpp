@@ -0,0 +1,2782 @@
+#include "gnel_native.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "chunk_ring.h"
+#include "external_sort.h"
+#include "content_hash.h"
+#include <iostream>
+#include <regex>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cctype>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <mutex>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+#include <memory>
+#include <map>
+#include <condition_variable>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <dirent.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/fs.h>
+
+extern char** environ;
+
+// ------------------------------------------------------------
+// Helpers
+// ------------------------------------------------------------
+
+static void toolError(const std::string& tool, const std::string& path) {
+    std::cerr << tool << ": " << path << ": " << strerror(errno) << std::endl;
+}
+
+GNELInput::GNELInput(const std::string& data) : text(&data), ring(nullptr), consumed(false) {}
+
+GNELInput::GNELInput(ChunkRing& source) : text(nullptr), ring(&source), consumed(false) {}
+
+bool GNELInput::next(const char*& data, size_t& size) {
+    if (text) {
+        if (consumed) return false;
+        consumed = true;
+        data = text->data();
+        size = text->size();
+        return true;
+    }
+    if (consumed || !ring->pop(chunk)) return false;
+    data = chunk.data();
+    size = chunk.size();
+    return true;
+}
+
+void GNELInput::readAll(std::string& data) {
+    const char* p;
+    size_t n;
+    while (next(p, n)) data.append(p, n);
+}
+
+void GNELInput::close() {
+    if (ring && !consumed) ring->close();
+    consumed = true;
+}
+
+static bool parseCount(const std::string& s, long& value) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    value = strtol(s.c_str(), &end, 10);
+    return end && *end == '\0';
+}
+
+// ------------------------------------------------------------
+// grep [-ivnclhHFErR] [-e pattern] pattern [file...]
+// ------------------------------------------------------------
+
+namespace {
+
+// Literal substring search. Short needles use memchr (vectorised in libc)
+// to jump between candidates for the first byte and memcmp to confirm;
+// long or case-folded needles use Boyer-Moore-Horspool, whose bad-character
+// shifts skip most of the text.
+struct LiteralFinder {
+    std::string needle;  // folded to lower case when ignoreCase
+    bool ignoreCase = false;
+    bool horspool = false;
+    size_t shift[256];
+
+    void prepare(const std::string& pattern, bool fold) {
+        ignoreCase = fold;
+        needle = pattern;
+        if (fold) {
+            for (auto& c : needle) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+        }
+        size_t m = needle.size();
+        horspool = m > 0 && (fold || m >= 8);
+        if (!horspool) return;
+        for (size_t c = 0; c < 256; c++) shift[c] = m;
+        for (size_t i = 0; i + 1 < m; i++) {
+            unsigned char c = needle[i];
+            shift[c] = m - 1 - i;
+            if (fold) shift[toupper(c)] = m - 1 - i;
+        }
+    }
+
+    bool equalAt(const char* p) const {
+        if (!ignoreCase) return memcmp(p, needle.data(), needle.size()) == 0;
+        for (size_t i = 0; i < needle.size(); i++) {
+            if (tolower(static_cast<unsigned char>(p[i])) != static_cast<unsigned char>(needle[i])) return false;
+        }
+        return true;
+    }
+
+    // First occurrence of the needle in [b, e), or nullptr
+    const char* find(const char* b, const char* e) const {
+        size_t m = needle.size();
+        if (m == 0) return b;
+        if (static_cast<size_t>(e - b) < m) return nullptr;
+        const char* last = e - m;  // last possible start
+        if (!horspool) {
+            const char* p = b;
+            while (p <= last) {
+                p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+                if (!p) return nullptr;
+                if (memcmp(p + 1, needle.data() + 1, m - 1) == 0) return p;
+                p++;
+            }
+            return nullptr;
+        }
+        for (const char* p = b; p <= last; ) {
+            unsigned char c = p[m - 1];
+            if (equalAt(p)) return p;
+            p += shift[c];
+        }
+        return nullptr;
+    }
+};
+
+struct LineMatcher {
+    LiteralFinder literal;
+    bool useRegex = false;
+    std::regex re;
+
+    bool matches(const char* b, const char* e) const {
+        if (useRegex) {
+            return std::regex_search(b, e, re);
+        }
+        return literal.find(b, e) != nullptr;
+    }
+};
+
+struct GrepOptions {
+    bool invert = false, lineNumbers = false, countOnly = false, filesOnly = false;
+    bool withName = false;
+};
+
+// Result of searching one input; filled by a pool worker, printed in order
+struct GrepResult {
+    std::string output;
+    std::string error;
+    size_t count = 0;        // matching lines so far
+    size_t lines = 0;        // lines scanned so far (numbers later chunks)
+    bool binary = false;
+    bool fromStdin = false;  // streamed when its turn to print comes
+    bool matched = false;
+    bool failed = false;
+    bool done = false;
+};
+
+// Scan the lines of [data, data + size) - a whole input or, when streaming,
+// a run of complete lines - and add the matches to res
+void grepLines(const LineMatcher& matcher, const GrepOptions& opt, const std::string& name,
+               const char* data, size_t size, GrepResult& res) {
+    if (opt.filesOnly && res.count > 0) return;
+    const char* end = data + size;
+    // GNU grep suppresses lines from files containing NUL bytes
+    if (!res.binary && memchr(data, '\0', size) != nullptr) res.binary = true;
+    bool printLines = !opt.countOnly && !opt.filesOnly && !res.binary;
+
+    auto emit = [&](size_t lineNo, const char* b, const char* e) {
+        if (opt.withName) res.output += name + ":";
+        if (opt.lineNumbers) res.output += std::to_string(lineNo) + ":";
+        res.output.append(b, e - b);
+        res.output += '\n';
+    };
+
+    if (!matcher.useRegex && !opt.invert && matcher.literal.needle.find('\n') == std::string::npos) {
+        // Search the whole buffer, then widen each hit to its line
+        const char* p = data;
+        size_t lineNo = res.lines;  // lines before p
+        while (p < end) {
+            const char* hit = matcher.literal.find(p, end);
+            if (!hit) break;
+            const char* lineStart = p;
+            if (hit > p) {
+                const char* nl = static_cast<const char*>(memrchr(p, '\n', hit - p));
+                if (nl) lineStart = nl + 1;
+            }
+            const char* nl = static_cast<const char*>(memchr(hit, '\n', end - hit));
+            const char* lineEnd = nl ? nl : end;
+            if (opt.lineNumbers) lineNo += std::count(p, lineStart, '\n');
+            res.count++;
+            if (printLines) emit(lineNo + 1, lineStart, lineEnd);
+            if (opt.filesOnly) break;
+            lineNo++;
+            p = nl ? nl + 1 : end;
+        }
+        if (opt.lineNumbers) res.lines = lineNo + std::count(p, end, '\n');
+    } else {
+        const char* p = data;
+        while (p < end) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* lineEnd = nl ? nl : end;
+            res.lines++;
+            if (matcher.matches(p, lineEnd) != opt.invert) {
+                res.count++;
+                if (opt.filesOnly) break;
+                if (printLines) emit(res.lines, p, lineEnd);
+            }
+            p = nl ? nl + 1 : end;
+        }
+    }
+}
+
+// Per-input summary lines once all of it has been scanned
+void grepFinish(const GrepOptions& opt, const std::string& name, GrepResult& res) {
+    if (opt.countOnly) {
+        if (opt.withName) res.output += name + ":";
+        res.output += std::to_string(res.count) + "\n";
+    } else if (opt.filesOnly && res.count > 0) {
+        res.output += name + "\n";
+    } else if (res.binary && res.count > 0) {
+        res.error += "grep: " + name + ": binary file matches\n";
+    }
+    res.matched = res.count > 0;
+}
+
+// Search piped input chunk by chunk, printing as it goes. Partial lines at
+// chunk ends are carried over into the next chunk.
+void grepStream(const LineMatcher& matcher, const GrepOptions& opt, GNELInput& input,
+                std::ostream& out, GrepResult& res) {
+    const std::string name = "(standard input)";
+    std::string carry;
+    const char* data;
+    size_t size;
+    while (input.next(data, size)) {
+        const char* nl = static_cast<const char*>(memrchr(data, '\n', size));
+        if (!nl) {
+            carry.append(data, size);
+            continue;
+        }
+        size_t whole = nl + 1 - data;
+        if (carry.empty()) {
+            grepLines(matcher, opt, name, data, whole, res);
+        } else {
+            carry.append(data, whole);
+            grepLines(matcher, opt, name, carry.data(), carry.size(), res);
+        }
+        carry.assign(nl + 1, size - whole);
+        out.write(res.output.data(), res.output.size());
+        res.output.clear();
+        if ((opt.filesOnly && res.count > 0) || !out.good()) {
+            input.close();
+            break;
+        }
+    }
+    if (!carry.empty()) grepLines(matcher, opt, name, carry.data(), carry.size(), res);
+    grepFinish(opt, name, res);
+}
+
+void grepFile(const LineMatcher& matcher, const GrepOptions& opt, const std::string& path, GrepResult& res) {
+    MappedFile file;
+    if (!file.open(path)) {
+        res.error = "grep: " + path + ": " + strerror(errno) + "\n";
+        res.failed = true;
+        return;
+    }
+    grepLines(matcher, opt, path, file.data(), file.size(), res);
+    grepFinish(opt, path, res);
+}
+
+// One grep operand after -r expansion; a non-empty error is reported in
+// its place in the output order
+struct GrepInput {
+    std::string path;
+    std::string error;
+};
+
+// Expand directory operands of grep -r into their files, sorted per directory
+// so the output order does not depend on readdir order
+void grepCollect(const std::string& path, bool follow, bool top, std::vector<GrepInput>& inputs) {
+    struct stat st;
+    int rc = (follow || top) ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+    if (rc != 0) {
+        inputs.push_back({path, "grep: " + path + ": " + strerror(errno) + "\n"});
+        return;
+    }
+    if (S_ISLNK(st.st_mode)) return;  // -r skips links below the operands
+    if (!S_ISDIR(st.st_mode)) {
+        if (top || S_ISREG(st.st_mode)) inputs.push_back({path, ""});
+        return;
+    }
+    DIR* d = opendir(path.c_str());
+    if (!d) {
+        inputs.push_back({path, "grep: " + path + ": " + strerror(errno) + "\n"});
+        return;
+    }
+    std::vector<std::string> names;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        names.push_back(ent->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    std::string prefix = (path == "." && top) ? std::string() : path;
+    if (!prefix.empty() && prefix.back() != '/') prefix += '/';
+    for (auto& n : names) {
+        grepCollect(prefix + n, follow, false, inputs);
+    }
+}
+
+}
+
+int GNELNative::grep(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    bool ignoreCase = false, fixed = false, extended = false;
+    bool recursive = false, follow = false;
+    int withName = -1;  // -1: only when several files
+    bool havePattern = false;
+    std::string pattern;
+    std::vector<std::string> operands;
+    GrepOptions opt;
+
+    bool options = true;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if (options && a == "--") {
+            options = false;
+        } else if (options && a.size() > 1 && a[0] == '-') {
+            for (size_t j = 1; j < a.size(); j++) {
+                switch (a[j]) {
+                    case 'i': ignoreCase = true; break;
+                    case 'v': opt.invert = true; break;
+                    case 'n': opt.lineNumbers = true; break;
+                    case 'c': opt.countOnly = true; break;
+                    case 'l': opt.filesOnly = true; break;
+                    case 'h': withName = 0; break;
+                    case 'H': withName = 1; break;
+                    case 'F': fixed = true; break;
+                    case 'E': extended = true; break;
+                    case 'r': recursive = true; break;
+                    case 'R': recursive = follow = true; break;
+                    case 'e':
+                        if (i + 1 < argv.size()) {
+                            pattern = argv[++i];
+                            havePattern = true;
+                        }
+                        j = a.size();
+                        break;
+                    default:
+                        std::cerr << "grep: invalid option -- '" << a[j] << "'" << std::endl;
+                        return 2;
+                }
+            }
+        } else if (!havePattern) {
+            pattern = a;
+            havePattern = true;
+        } else {
+            operands.push_back(a);
+        }
+    }
+    if (!havePattern) {
+        std::cerr << "Usage: grep [OPTION]... PATTERNS [FILE]..." << std::endl;
+        return 2;
+    }
+
+    LineMatcher matcher;
+    const char* meta = extended ? "\\.[]*^$+?|(){}" : "\\.[]*^$";
+    if (!fixed && pattern.find_first_of(meta) != std::string::npos) {
+        auto flags = (extended ? std::regex::extended : std::regex::basic) | std::regex::nosubs;
+        if (ignoreCase) flags |= std::regex::icase;
+        try {
+            matcher.re = std::regex(pattern, flags);
+            matcher.useRegex = true;
+        } catch (const std::regex_error&) {
+            std::cerr << "grep: Invalid regular expression" << std::endl;
+            return 2;
+        }
+    } else {
+        matcher.literal.prepare(pattern, ignoreCase);
+    }
+
+    // Work list in output order; "-" is the piped input
+    std::vector<GrepInput> inputs;
+    bool sawDirectory = false;
+    if (operands.empty()) operands.push_back(recursive ? "." : "-");
+    for (auto& operand : operands) {
+        struct stat st;
+        if (recursive && operand != "-") {
+            if (stat(operand.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) sawDirectory = true;
+            grepCollect(operand, follow, true, inputs);
+        } else {
+            inputs.push_back({operand, ""});
+        }
+    }
+    if (withName < 0) withName = (inputs.size() > 1 || sawDirectory) ? 1 : 0;
+    opt.withName = withName == 1;
+
+    // Files are searched on the shared pool; results are printed in order
+    std::vector<GrepResult> results(inputs.size());
+    std::mutex resultLock;
+    std::condition_variable resultReady;
+    ThreadPool::Group group;
+    ThreadPool& pool = ThreadPool::shared();
+
+    for (size_t k = 0; k < inputs.size(); k++) {
+        GrepResult& res = results[k];
+        const std::string& path = inputs[k].path;
+        if (!inputs[k].error.empty()) {
+            res.error = inputs[k].error;
+            res.failed = true;
+            res.done = true;
+        } else if (path == "-") {
+            res.fromStdin = true;
+            res.done = true;
+        } else if (inputs.size() == 1) {
+            grepFile(matcher, opt, path, res);
+            res.done = true;
+        } else {
+            pool.submit(group, [&matcher, &opt, &res, &resultLock, &resultReady, &path] {
+                GrepResult local;
+                grepFile(matcher, opt, path, local);
+                std::lock_guard<std::mutex> lock(resultLock);
+                res = std::move(local);
+                res.done = true;
+                resultReady.notify_all();
+            });
+        }
+    }
+
+    // Print each result once it and everything before it are done
+    bool anyMatch = false, anyError = false;
+    for (auto& res : results) {
+        {
+            std::unique_lock<std::mutex> lock(resultLock);
+            resultReady.wait(lock, [&res] { return res.done; });
+        }
+        if (res.fromStdin && input) grepStream(matcher, opt, *input, out, res);
+        if (!res.error.empty()) std::cerr << res.error << std::flush;
+        out.write(res.output.data(), res.output.size());
+        std::string().swap(res.output);
+        if (res.matched) anyMatch = true;
+        if (res.failed) anyError = true;
+    }
+    pool.wait(group);
+
+    if (anyError) return 2;
+    return anyMatch ? 0 : 1;
+}
+
+// ------------------------------------------------------------
+// find [-s] [path...] [-name pat] [-iname pat] [-type f|d|l] [-maxdepth N]
+// ------------------------------------------------------------
+
+namespace {
+
+// Shell glob ('*', '?', '[...]', '\' escapes) compiled once per find.
+// The common shapes - '*', plain names, '*.ext', 'prefix*' - skip the
+// general matcher entirely.
+class GlobMatcher {
+private:
+    enum Shape { ANY, EXACT, SUFFIX, PREFIX, GENERAL };
+    struct Token {
+        enum Kind { CHAR, ONE, STAR, SET } kind;
+        unsigned char c;
+        std::bitset<256> set;
+    };
+    Shape shape = ANY;
+    bool fold = false;
+    std::string literal;  // EXACT/SUFFIX/PREFIX text, folded when fold
+    std::vector<Token> tokens;
+
+    unsigned char norm(unsigned char c) const {
+        return fold ? static_cast<unsigned char>(tolower(c)) : c;
+    }
+
+    bool equalFolded(const char* s, size_t n) const {
+        for (size_t i = 0; i < n; i++) {
+            if (norm(s[i]) != static_cast<unsigned char>(literal[i])) return false;
+        }
+        return true;
+    }
+
+public:
+    void compile(const std::string& pattern, bool caseFold) {
+        fold = caseFold;
+        tokens.clear();
+        for (size_t i = 0; i < pattern.size(); i++) {
+            Token t{Token::CHAR, 0, {}};
+            char c = pattern[i];
+            if (c == '*') {
+                if (!tokens.empty() && tokens.back().kind == Token::STAR) continue;
+                t.kind = Token::STAR;
+            } else if (c == '?') {
+                t.kind = Token::ONE;
+            } else if (c == '[' && pattern.find(']', i + 2) != std::string::npos) {
+                size_t j = i + 1;
+                bool negate = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+                if (negate) j++;
+                size_t first = j;
+                for (; j < pattern.size() && (pattern[j] != ']' || j == first); j++) {
+                    unsigned char lo = pattern[j], hi = lo;
+                    if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                        hi = pattern[j + 2];
+                        j += 2;
+                    }
+                    for (unsigned v = lo; v <= hi; v++) t.set.set(norm(static_cast<unsigned char>(v)));
+                }
+                if (negate) t.set.flip();
+                t.kind = Token::SET;
+                i = j;
+            } else {
+                if (c == '\\' && i + 1 < pattern.size()) c = pattern[++i];
+                t.c = norm(static_cast<unsigned char>(c));
+            }
+            tokens.push_back(t);
+        }
+
+        // Classify: literal characters with at most one '*' at either end
+        size_t stars = 0, others = 0;
+        for (auto& t : tokens) {
+            if (t.kind == Token::STAR) stars++;
+            else if (t.kind != Token::CHAR) others++;
+        }
+        literal.clear();
+        for (auto& t : tokens) {
+            if (t.kind == Token::CHAR) literal += static_cast<char>(t.c);
+        }
+        bool leading = !tokens.empty() && tokens.front().kind == Token::STAR;
+        bool trailing = !tokens.empty() && tokens.back().kind == Token::STAR;
+        if (others > 0 || stars > 1) shape = GENERAL;
+        else if (stars == 0) shape = EXACT;
+        else if (tokens.size() == 1) shape = ANY;
+        else if (leading) shape = SUFFIX;
+        else if (trailing) shape = PREFIX;
+        else shape = GENERAL;
+    }
+
+    bool match(const char* name, size_t len) const {
+        switch (shape) {
+            case ANY: return true;
+            case EXACT: return len == literal.size() && equalFolded(name, len);
+            case SUFFIX: return len >= literal.size() && equalFolded(name + len - literal.size(), literal.size());
+            case PREFIX: return len >= literal.size() && equalFolded(name, literal.size());
+            default: break;
+        }
+        // Iterative matcher: on mismatch, let the last '*' absorb one more char
+        size_t t = 0, n = 0, starT = std::string::npos, starN = 0;
+        while (n < len) {
+            if (t < tokens.size()) {
+                const Token& tok = tokens[t];
+                unsigned char c = norm(name[n]);
+                if (tok.kind == Token::STAR) {
+                    starT = t++;
+                    starN = n;
+                    continue;
+                }
+                if ((tok.kind == Token::CHAR && tok.c == c) || tok.kind == Token::ONE ||
+                    (tok.kind == Token::SET && tok.set.test(c))) {
+                    t++;
+                    n++;
+                    continue;
+                }
+            }
+            if (starT == std::string::npos) return false;
+            t = starT + 1;
+            n = ++starN;
+        }
+        while (t < tokens.size() && tokens[t].kind == Token::STAR) t++;
+        return t == tokens.size();
+    }
+};
+
+struct FindOptions {
+    GlobMatcher glob;
+    bool hasName = false;
+    char type = 0;
+    long maxDepth = -1;
+};
+
+bool findMatches(const FindOptions& opt, const char* base, size_t len, char type) {
+    if (opt.type && opt.type != type) return false;
+    if (opt.hasName && !opt.glob.match(base, len)) return false;
+    return true;
+}
+
+char modeType(mode_t mode) {
+    if (S_ISDIR(mode)) return 'd';
+    if (S_ISLNK(mode)) return 'l';
+    if (S_ISREG(mode)) return 'f';
+    return '?';
+}
+
+// Record layout returned by the getdents64 system call
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Walks one starting point with a task per directory on the shared pool.
+// Each task reads its directory with getdents64, takes entry types from
+// d_type (stat only when the filesystem reports DT_UNKNOWN), queues the
+// subdirectories and hands its matches over in one batch.
+class FindWalker {
+private:
+    const FindOptions& opt;
+    std::ostream& out;
+    bool stream;
+    bool collect;
+    ThreadPool& pool;
+    ThreadPool::Group group;
+    std::mutex lock;
+    std::atomic<bool> failedFlag;
+
+    void visit(const std::string& dir, long depth) {
+        int fd = openat(AT_FDCWD, dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            report(dir);
+            return;
+        }
+        std::string prefix = dir;
+        if (prefix.back() != '/') prefix += '/';
+        bool descend = opt.maxDepth < 0 || depth < opt.maxDepth;
+
+        std::string batch;
+        std::vector<std::string> matched;
+        char buf[1 << 15];
+        long n;
+        while ((n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+            for (long off = 0; off < n; ) {
+                auto* ent = reinterpret_cast<LinuxDirent64*>(buf + off);
+                off += ent->d_reclen;
+                const char* name = ent->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+                char type = '?';
+                switch (ent->d_type) {
+                    case DT_DIR: type = 'd'; break;
+                    case DT_REG: type = 'f'; break;
+                    case DT_LNK: type = 'l'; break;
+                    case DT_UNKNOWN: {
+                        struct stat st;
+                        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) type = modeType(st.st_mode);
+                        break;
+                    }
+                    default: break;
+                }
+                size_t len = strlen(name);
+                bool isMatch = findMatches(opt, name, len, type);
+                if (!isMatch && !(type == 'd' && descend)) continue;
+                std::string path = prefix;
+                path.append(name, len);
+                if (isMatch) {
+                    if (stream) {
+                        batch += path;
+                        batch += '\n';
+                    }
+                    if (collect) matched.push_back(path);
+                }
+                if (type == 'd' && descend) {
+                    pool.submit(group, [this, path, depth] { visit(path, depth + 1); });
+                }
+            }
+        }
+        if (n < 0) report(dir);
+        close(fd);
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (stream) out.write(batch.data(), batch.size());
+        for (auto& p : matched) results.push_back(std::move(p));
+    }
+
+    void report(const std::string& dir) {
+        int err = errno;
+        std::lock_guard<std::mutex> guard(lock);
+        std::cerr << "find: '" << dir << "': " << strerror(err) << std::endl;
+        failedFlag = true;
+    }
+
+public:
+    std::vector<std::string> results;
+
+    // stream: write matches as directories finish; collect: keep them in results
+    FindWalker(const FindOptions& options, std::ostream& output, bool streamOutput, bool collectResults)
+        : opt(options), out(output), stream(streamOutput), collect(collectResults),
+          pool(ThreadPool::shared()), failedFlag(false) {}
+
+    void walk(const std::string& root) {
+        pool.submit(group, [this, root] { visit(root, 1); });
+        pool.wait(group);
+    }
+
+    bool failed() const { return failedFlag; }
+};
+
+// Order of find -s: a directory's entries sort by name and come right
+// after the directory itself, i.e. '/' sorts before every other byte
+bool findPathLess(const std::string& a, const std::string& b) {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] == b[i]) continue;
+        if (a[i] == '/') return true;
+        if (b[i] == '/') return false;
+        return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]);
+    }
+    return a.size() < b.size();
+}
+
+}
+
+int GNELNative::find(const std::vector<std::string>& argv, std::ostream& out, std::vector<std::string>* paths) {
+    FindOptions opt;
+    bool sorted = false;
+    std::vector<std::string> roots;
+    size_t i = 1;
+    if (i < argv.size() && argv[i] == "-s") {
+        sorted = true;
+        i++;
+    }
+    for (; i < argv.size() && !(argv[i].size() > 1 && argv[i][0] == '-'); i++) {
+        roots.push_back(argv[i]);
+    }
+    for (; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        bool hasArg = i + 1 < argv.size();
+        if ((a == "-name" || a == "-iname") && hasArg) {
+            opt.glob.compile(argv[++i], a == "-iname");
+            opt.hasName = true;
+        } else if (a == "-type" && hasArg) {
+            opt.type = argv[++i][0];
+        } else if (a == "-maxdepth" && hasArg) {
+            if (!parseCount(argv[++i], opt.maxDepth)) opt.maxDepth = -1;
+        } else {
+            std::cerr << "find: unknown predicate '" << a << "'" << std::endl;
+            return 1;
+        }
+    }
+    if (roots.empty()) roots.push_back(".");
+
+    bool failed = false;
+    for (auto& root : roots) {
+        struct stat st;
+        if (lstat(root.c_str(), &st) != 0) {
+            std::cerr << "find: '" << root << "': " << strerror(errno) << std::endl;
+            failed = true;
+            continue;
+        }
+        // Test the starting point against its last path component
+        std::string base = root;
+        while (base.size() > 1 && base.back() == '/') base.pop_back();
+        size_t slash = base.find_last_of('/');
+        if (slash != std::string::npos && base.size() > 1) base = base.substr(slash + 1);
+        char type = modeType(st.st_mode);
+        std::vector<std::string> found;
+        if (findMatches(opt, base.data(), base.size(), type)) {
+            if (!sorted) out << root << '\n';
+            found.push_back(root);
+        }
+        if (type == 'd' && opt.maxDepth != 0) {
+            FindWalker walker(opt, out, !sorted, sorted || paths != nullptr);
+            walker.walk(root);
+            if (walker.failed()) failed = true;
+            found.insert(found.end(), std::make_move_iterator(walker.results.begin()),
+                         std::make_move_iterator(walker.results.end()));
+        }
+        if (sorted) {
+            std::sort(found.begin(), found.end(), findPathLess);
+            for (auto& p : found) {
+                out.write(p.data(), p.size());
+                out.put('\n');
+            }
+        }
+        if (paths) paths->insert(paths->end(), found.begin(), found.end());
+    }
+    out.flush();
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// wc [-lwcm] [file...]   (-m counts UTF-8 characters only in a UTF-8 locale)
+// ------------------------------------------------------------
+
+namespace {
+
+struct WcState {
+    size_t lines = 0, words = 0, chars = 0, bytes = 0;
+    bool inWord = false;  // the input so far ended inside a word
+};
+
+inline bool wcSpace(unsigned char ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+inline bool wcPrintable(unsigned char ch) {
+    return ch > ' ' && ch < 0x7f;
+}
+
+// C-locale word rule, as GNU wc: whitespace ends a word, a printable byte
+// starts one, other bytes (e.g. UTF-8 sequences) change nothing
+void wcScalar(const unsigned char* p, size_t size, WcState& st) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char ch = p[i];
+        if (ch == '\n') st.lines++;
+        if ((ch & 0xC0) != 0x80) st.chars++;
+        if (wcSpace(ch)) {
+            st.inWord = false;
+        } else if (wcPrintable(ch) && !st.inWord) {
+            st.words++;
+            st.inWord = true;
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The same rule on 64-byte blocks of bit masks. Neutral bytes continue
+// whatever state came before them, so runs of neutral bytes right after
+// whitespace are first filled in as whitespace: adding the run starts to
+// the neutral mask ripples a carry through each such run and clears it.
+// A word then starts at every printable byte whose predecessor is
+// (filled) whitespace. outside carries the state between blocks.
+inline uint64_t wcWordStarts(uint64_t space, uint64_t printable, uint64_t& outside) {
+    uint64_t neutral = ~(space | printable);
+    uint64_t runStarts = ((space << 1) | outside) & neutral;
+    uint64_t filled = space | (neutral & ~(neutral + runStarts));
+    uint64_t starts = printable & ((filled << 1) | outside);
+    outside = filled >> 63;
+    return starts;
+}
+
+__attribute__((target("avx2,popcnt")))
+void wcAvx2(const unsigned char* p, size_t size, WcState& st) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i blank = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    const __m256i bang = _mm256_set1_epi8('!');
+    const __m256i printSpan = _mm256_set1_epi8(0x7e - '!');
+    const __m256i contLimit = _mm256_set1_epi8(-64);  // 0x80..0xbf as signed bytes
+
+    uint64_t outside = st.inWord ? 0 : 1;
+    size_t blocks = size / 64;
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        uint64_t nl = 0, space = 0, printable = 0, cont = 0;
+        for (int half = 0; half < 2; half++) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + half * 32));
+            // Unsigned range checks: (x - lo) <= span  <=>  min(x - lo, span) == x - lo
+            __m256i fromTab = _mm256_sub_epi8(x, tab);
+            __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(x, blank),
+                                         _mm256_cmpeq_epi8(_mm256_min_epu8(fromTab, four), fromTab));
+            __m256i fromBang = _mm256_sub_epi8(x, bang);
+            __m256i pr = _mm256_cmpeq_epi8(_mm256_min_epu8(fromBang, printSpan), fromBang);
+            int shift = half * 32;
+            nl |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline)))) << shift;
+            space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+            printable |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(pr))) << shift;
+            cont |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(contLimit, x)))) << shift;
+        }
+        st.lines += __builtin_popcountll(nl);
+        st.chars += 64 - __builtin_popcountll(cont);
+        st.words += __builtin_popcountll(wcWordStarts(space, printable, outside));
+    }
+    st.inWord = outside == 0;
+    wcScalar(p, size % 64, st);
+}
+
+bool haveAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    return supported;
+}
+#endif
+
+void wcCount(const char* data, size_t size, WcState& st) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+#if defined(__x86_64__) || defined(__i386__)
+    if (haveAvx2()) {
+        wcAvx2(p, size, st);
+        st.bytes += size;
+        return;
+    }
+#endif
+    wcScalar(p, size, st);
+    st.bytes += size;
+}
+
+// Large mapped files are counted in chunks on the shared pool. A chunk
+// finds its starting word state from the last non-neutral byte before it.
+void wcCountParallel(const char* data, size_t size, WcState& st) {
+    const size_t minChunk = 16 << 20;
+    ThreadPool& pool = ThreadPool::shared();
+    size_t chunks = std::min(size / minChunk, static_cast<size_t>(pool.size()) * 4);
+    if (pool.size() < 2 || chunks < 2) {
+        wcCount(data, size, st);
+        return;
+    }
+
+    std::vector<WcState> parts(chunks);
+    size_t step = size / chunks;
+    bool initial = st.inWord;
+    ThreadPool::Group group;
+    for (size_t k = 0; k < chunks; k++) {
+        size_t begin = k * step;
+        size_t end = (k + 1 == chunks) ? size : begin + step;
+        WcState* part = &parts[k];
+        pool.submit(group, [data, begin, end, initial, part] {
+            part->inWord = initial;
+            for (size_t pos = begin; pos > 0; pos--) {
+                unsigned char ch = data[pos - 1];
+                if (wcSpace(ch)) { part->inWord = false; break; }
+                if (wcPrintable(ch)) { part->inWord = true; break; }
+            }
+            wcCount(data + begin, end - begin, *part);
+        });
+    }
+    pool.wait(group);
+    for (auto& part : parts) {
+        st.lines += part.lines;
+        st.words += part.words;
+        st.chars += part.chars;
+        st.bytes += part.bytes;
+    }
+    st.inWord = parts.back().inWord;
+}
+
+// Characters are bytes in the C locale, as in GNU wc; only a UTF-8
+// LC_ALL/LC_CTYPE/LANG (the first one set) makes -m count sequences
+bool wcUtf8Locale() {
+    const char* locale = nullptr;
+    for (const char* name : {"LC_ALL", "LC_CTYPE", "LANG"}) {
+        const char* value = getenv(name);
+        if (value && *value) {
+            locale = value;
+            break;
+        }
+    }
+    if (!locale) return false;
+    std::string lowered;
+    for (const char* p = locale; *p; p++) lowered += static_cast<char>(tolower(static_cast<unsigned char>(*p)));
+    return lowered.find("utf-8") != std::string::npos || lowered.find("utf8") != std::string::npos;
+}
+
+}
+
+int GNELNative::wc(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out, GNELCounts* totals) {
+    bool lines = false, words = false, bytes = false, chars = false;
+    std::vector<std::string> files;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if (a.size() > 1 && a[0] == '-') {
+            for (size_t j = 1; j < a.size(); j++) {
+                switch (a[j]) {
+                    case 'l': lines = true; break;
+                    case 'w': words = true; break;
+                    case 'c': bytes = true; break;
+                    case 'm': chars = true; break;
+                    default:
+                        std::cerr << "wc: invalid option -- '" << a[j] << "'" << std::endl;
+                        return 1;
+                }
+            }
+        } else {
+            files.push_back(a);
+        }
+    }
+    if (!lines && !words && !bytes && !chars) lines = words = bytes = true;
+    bool utf8 = chars && wcUtf8Locale();
+    bool named = !files.empty();
+    if (!named) files.push_back("-");
+
+    struct Counts : WcState {
+        bool ok = false;
+    };
+    std::vector<Counts> counts(files.size());
+    Counts total;
+    bool allRegular = true, failed = false;
+    size_t regularTotal = 0;
+
+    for (size_t f = 0; f < files.size(); f++) {
+        Counts& c = counts[f];
+        bool regular = false;
+        if (files[f] == "-") {
+            const char* data;
+            size_t size;
+            while (input && input->next(data, size)) wcCount(data, size, c);
+        } else {
+            MappedFile mapped;
+            if (!mapped.open(files[f])) {
+                toolError("wc", files[f]);
+                failed = true;
+                continue;
+            }
+            regular = mapped.regular();
+            wcCountParallel(mapped.data(), mapped.size(), c);
+        }
+        c.ok = true;
+        total.lines += c.lines;
+        total.words += c.words;
+        total.chars += c.chars;
+        total.bytes += c.bytes;
+        if (regular) regularTotal += c.bytes;
+        else allRegular = false;
+    }
+
+    // Column width follows GNU wc: digits of the total size of regular
+    // files, 7 when reading pipes, none for a single count of one input
+    int width = 1;
+    for (size_t t = regularTotal; t >= 10; t /= 10) width++;
+    if (!allRegular && width < 7) width = 7;
+    int selected = lines + words + chars + bytes;
+    if (selected == 1 && files.size() == 1) width = 1;
+
+    std::string result;
+    auto emit = [&](const Counts& c, const std::string& name) {
+        bool first = true;
+        auto col = [&](size_t v) {
+            std::string num = std::to_string(v);
+            if (!first) result += ' ';
+            if (static_cast<int>(num.size()) < width) result.append(width - num.size(), ' ');
+            result += num;
+            first = false;
+        };
+        if (lines) col(c.lines);
+        if (words) col(c.words);
+        if (chars) col(utf8 ? c.chars : c.bytes);
+        if (bytes) col(c.bytes);
+        if (!name.empty()) result += " " + name;
+        result += '\n';
+    };
+    for (size_t f = 0; f < files.size(); f++) {
+        if (counts[f].ok) emit(counts[f], named ? files[f] : "");
+    }
+    if (files.size() > 1) emit(total, "total");
+    out.write(result.data(), result.size());
+    if (totals) {
+        totals->lines = total.lines;
+        totals->words = total.words;
+        totals->chars = utf8 ? total.chars : total.bytes;
+        totals->bytes = total.bytes;
+    }
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// head/tail [-n N | -N | -c N] [file...]   (tail also takes -n +N)
+// ------------------------------------------------------------
+
+namespace {
+
+struct SliceOptions {
+    long count = 10;
+    bool bytes = false;
+    bool fromStart = false;  // tail -n +N
+    bool follow = false;     // tail -f
+    int headers = -1;        // -1: only when several files
+    std::vector<std::string> files;
+};
+
+bool parseSliceArgs(const char* tool, const std::vector<std::string>& argv, SliceOptions& opt) {
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if ((a == "-n" || a == "-c") && i + 1 < argv.size()) {
+            opt.bytes = (a == "-c");
+            std::string v = argv[++i];
+            if (!v.empty() && v[0] == '+') {
+                opt.fromStart = true;
+                v = v.substr(1);
+            }
+            if (!parseCount(v, opt.count) || opt.count < 0) {
+                std::cerr << tool << ": invalid number: '" << argv[i] << "'" << std::endl;
+                return false;
+            }
+        } else if (a == "-f") {
+            opt.follow = true;
+        } else if (a == "-q") {
+            opt.headers = 0;
+        } else if (a == "-v") {
+            opt.headers = 1;
+        } else if (a.size() > 1 && a[0] == '-' && isdigit(static_cast<unsigned char>(a[1]))) {
+            parseCount(a.substr(1), opt.count);
+        } else {
+            opt.files.push_back(a);
+        }
+    }
+    if (opt.files.empty()) opt.files.push_back("-");
+    if (opt.headers < 0) opt.headers = opt.files.size() > 1 ? 1 : 0;
+    return true;
+}
+
+}
+
+// Bytes [begin, end) of data making up its first or last count lines/bytes.
+// Only the part that is kept gets touched, so a mapped multi-GB log costs
+// a few pages for head and a backwards memrchr scan over the tail for tail.
+static void sliceRange(const char* data, size_t size, const SliceOptions& opt, bool head, size_t& begin, size_t& end) {
+    size_t n = static_cast<size_t>(opt.count);
+    begin = 0;
+    end = size;
+    if (opt.bytes) {
+        if (head) end = std::min(n, size);
+        else if (opt.fromStart) begin = std::min(n > 0 ? n - 1 : 0, size);
+        else begin = size - std::min(n, size);
+        return;
+    }
+    if (head) {
+        size_t pos = 0;
+        for (size_t k = 0; k < n && pos < size; k++) {
+            const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+            pos = nl ? (nl - data) + 1 : size;
+        }
+        end = (n == 0) ? 0 : pos;
+    } else if (opt.fromStart) {
+        size_t pos = 0;
+        for (size_t k = 1; k < n && pos < size; k++) {
+            const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+            pos = nl ? (nl - data) + 1 : size;
+        }
+        begin = pos;
+    } else if (n == 0) {
+        begin = size;
+    } else {
+        // Walk back over n line ends; a missing final newline still ends a line
+        size_t pos = size;
+        if (pos > 0 && data[pos - 1] == '\n') pos--;
+        size_t found = 0;
+        while (pos > 0) {
+            const char* nl = static_cast<const char*>(memrchr(data, '\n', pos));
+            if (!nl) {
+                pos = 0;
+                break;
+            }
+            pos = nl - data;
+            if (++found == n) {
+                pos++;
+                break;
+            }
+        }
+        begin = pos;
+    }
+}
+
+// How much of the next piece of a streamed input head keeps; seen counts
+// the lines (or bytes) taken so far and reaching opt.count ends the stream
+static size_t headTake(const char* data, size_t size, const SliceOptions& opt, size_t& seen) {
+    size_t n = static_cast<size_t>(opt.count);
+    if (opt.bytes) {
+        size_t keep = std::min(size, n - seen);
+        seen += keep;
+        return keep;
+    }
+    const char* p = data;
+    const char* end = data + size;
+    while (seen < n && p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!nl) return size;
+        p = nl + 1;
+        seen++;
+    }
+    return p - data;
+}
+
+// head of a pipe or device: read only until enough lines/bytes have arrived
+static bool headStream(int fd, const SliceOptions& opt, std::string& result) {
+    size_t seen = 0;
+    char buf[1 << 16];
+    while (seen < static_cast<size_t>(opt.count)) {
+        ssize_t got = read(fd, buf, sizeof(buf));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return got == 0;
+        result.append(buf, headTake(buf, got, opt, seen));
+    }
+    return true;
+}
+
+// tail -f: after the initial output, print whatever gets appended to the
+// files. Waits in inotify instead of polling; runs until interrupted.
+// Follows until Ctrl+C, which is the normal way out (status 0 unless a file
+// failed earlier), or until no followed file is left (status 1, as GNU tail)
+static int tailFollow(const SliceOptions& opt, std::ostream& out, const std::string& lastShown, bool failed) {
+    int ino = inotify_init1(IN_CLOEXEC);
+    if (ino < 0) {
+        std::cerr << "tail: inotify cannot be used: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    struct Followed {
+        std::string path;
+        int fd;
+        off_t offset;
+    };
+    std::map<int, Followed> watches;
+    for (auto& file : opt.files) {
+        if (file == "-") continue;
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        struct stat st;
+        fstat(fd, &st);
+        int wd = inotify_add_watch(ino, file.c_str(), IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+        if (wd < 0) {
+            close(fd);
+            continue;
+        }
+        watches[wd] = Followed{file, fd, st.st_size};
+    }
+    bool followed = !watches.empty();
+    if (!followed && std::any_of(opt.files.begin(), opt.files.end(), [](const std::string& f) { return f != "-"; })) {
+        std::cerr << "tail: no files remaining" << std::endl;
+        close(ino);
+        return 1;
+    }
+
+    // SIGINT as a descriptor, so Ctrl+C ends the loop instead of the process
+    sigset_t interrupt, saved;
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &interrupt, &saved);
+    int sigFd = signalfd(-1, &interrupt, SFD_CLOEXEC);
+
+    std::string current = lastShown;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool stopped = false, broken = false;
+    while (!watches.empty()) {
+        struct pollfd fds[2] = {{sigFd, POLLIN, 0}, {ino, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            broken = true;
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            ssize_t ignored = read(sigFd, &info, sizeof(info));
+            (void)ignored;
+            stopped = true;
+            break;
+        }
+        ssize_t len = read(ino, events, sizeof(events));
+        if (len < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            std::cerr << "tail: error reading inotify events: " << strerror(errno) << std::endl;
+            broken = true;
+            break;
+        }
+        for (char* p = events; p < events + len; ) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            auto it = watches.find(ev->wd);
+            if (it == watches.end()) continue;
+            Followed& f = it->second;
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                std::cerr << "tail: '" << f.path << "' has become inaccessible" << std::endl;
+                close(f.fd);
+                watches.erase(it);
+                continue;
+            }
+            struct stat st;
+            if (fstat(f.fd, &st) != 0) continue;
+            if (st.st_size < f.offset) {
+                std::cerr << "tail: " << f.path << ": file truncated" << std::endl;
+                f.offset = 0;
+            }
+            if (st.st_size == f.offset) continue;
+            std::string chunk(static_cast<size_t>(st.st_size - f.offset), '\0');
+            ssize_t got = pread(f.fd, &chunk[0], chunk.size(), f.offset);
+            if (got <= 0) continue;
+            f.offset += got;
+            if (opt.headers && current != f.path) {
+                out << "\n==> " << f.path << " <==\n";
+                current = f.path;
+            }
+            out.write(chunk.data(), got);
+            out.flush();
+        }
+    }
+    if (sigFd >= 0) close(sigFd);
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    for (auto& w : watches) close(w.second.fd);
+    close(ino);
+    if (broken) return 1;
+    if (!stopped && followed) {
+        std::cerr << "tail: no files remaining" << std::endl;
+        return 1;
+    }
+    return failed ? 1 : 0;
+}
+
+static int sliceTool(const char* tool, bool head, const std::vector<std::string>& argv,
+                     GNELInput* input, std::ostream& out) {
+    SliceOptions opt;
+    if (!parseSliceArgs(tool, argv, opt)) return 1;
+
+    bool failed = false, first = true;
+    std::string lastShown;
+    for (auto& file : opt.files) {
+        std::string result;
+        if (opt.headers) {
+            if (!first) result += '\n';
+            result += "==> " + (file == "-" ? std::string("standard input") : file) + " <==\n";
+        }
+        bool isStdin = file == "-" && input;
+        struct stat st;
+        if (head && !isStdin && stat(file.c_str(), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISDIR(st.st_mode)) {
+            int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd >= 0 && headStream(fd, opt, result)) {
+                close(fd);
+                out.write(result.data(), result.size());
+                first = false;
+                lastShown = file;
+                continue;
+            }
+            if (fd >= 0) close(fd);
+        }
+
+        if (isStdin && head) {
+            // Take what is needed, then let the writer stop
+            out.write(result.data(), result.size());
+            size_t seen = 0;
+            const char* data;
+            size_t size;
+            while (seen < static_cast<size_t>(opt.count) && input->next(data, size)) {
+                out.write(data, headTake(data, size, opt, seen));
+            }
+            input->close();
+            first = false;
+            lastShown = file;
+            continue;
+        }
+
+        MappedFile mapped;
+        std::string piped;
+        const char* data = "";
+        size_t size = 0;
+        if (isStdin) {
+            input->readAll(piped);
+            data = piped.data();
+            size = piped.size();
+        } else if (mapped.open(file)) {
+            data = mapped.data();
+            size = mapped.size();
+        } else if (!(file == "-" && !input)) {
+            std::cerr << tool << ": cannot open '" << file << "' for reading: " << strerror(errno) << std::endl;
+            failed = true;
+            continue;
+        }
+        first = false;
+        lastShown = file;
+        size_t begin, end;
+        sliceRange(data, size, opt, head, begin, end);
+        out.write(result.data(), result.size());
+        out.write(data + begin, end - begin);
+    }
+    if (!head && opt.follow) {
+        out.flush();
+        return tailFollow(opt, out, lastShown, failed);
+    }
+    return failed ? 1 : 0;
+}
+
+int GNELNative::head(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    return sliceTool("head", true, argv, input, out);
+}
+
+int GNELNative::tail(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    return sliceTool("tail", false, argv, input, out);
+}
+
+// ------------------------------------------------------------
+// cat [-n] [file...]
+// ------------------------------------------------------------
+
+// Copy a whole file to fd 1 inside the kernel: splice when stdout is a
+// pipe, sendfile when it is a regular file. False if neither applies.
+static bool catToStdout(const MappedFile& file) {
+    struct stat st;
+    if (!file.regular() || fstat(STDOUT_FILENO, &st) != 0) return false;
+    bool toPipe = S_ISFIFO(st.st_mode);
+    if (!toPipe && !S_ISREG(st.st_mode)) return false;
+
+    int fd = file.descriptor();
+    loff_t offset = 0;
+    off_t sendOffset = 0;
+    size_t left = file.size();
+    while (left > 0) {
+        ssize_t n = toPipe ? splice(fd, &offset, STDOUT_FILENO, nullptr, left, SPLICE_F_MORE)
+                           : sendfile(STDOUT_FILENO, fd, &sendOffset, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (left == file.size()) return false;  // nothing written yet: use write()
+            // Part went out already; finish from the mapping
+            const char* rest = file.data() + (file.size() - left);
+            while (left > 0) {
+                ssize_t w = write(STDOUT_FILENO, rest, left);
+                if (w < 0 && errno == EINTR) continue;
+                if (w <= 0) return true;
+                rest += w;
+                left -= w;
+            }
+            return true;
+        }
+        left -= n;
+    }
+    return true;
+}
+
+int GNELNative::cat(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    bool number = false;
+    std::vector<std::string> files;
+    for (size_t i = 1; i < argv.size(); i++) {
+        if (argv[i] == "-n") number = true;
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) files.push_back("-");
+
+    bool failed = false;
+    size_t lineNo = 0;
+    bool lineStart = true;  // -n numbering continues across inputs, like cat
+    auto write = [&](const char* data, size_t size) {
+        if (!number) {
+            out.write(data, size);
+            return;
+        }
+        std::string result;
+        const char* p = data;
+        const char* end = data + size;
+        while (p < end) {
+            if (lineStart) {
+                char prefix[32];
+                snprintf(prefix, sizeof(prefix), "%6zu\t", ++lineNo);
+                result += prefix;
+            }
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* stop = nl ? nl + 1 : end;
+            result.append(p, stop - p);
+            lineStart = nl != nullptr;
+            p = stop;
+        }
+        out.write(result.data(), result.size());
+    };
+
+    for (auto& file : files) {
+        if (file == "-") {
+            const char* data;
+            size_t size;
+            while (input && input->next(data, size)) {
+                write(data, size);
+                if (!out.good()) {
+                    input->close();
+                    break;
+                }
+            }
+            continue;
+        }
+        MappedFile mapped;
+        if (!mapped.open(file)) {
+            toolError("cat", file);
+            failed = true;
+            continue;
+        }
+        if (!number && &out == &std::cout && mapped.regular()) {
+            out.flush();
+            if (catToStdout(mapped)) continue;
+        }
+        write(mapped.data(), mapped.size());
+    }
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// cp [-r] src... dst  /  mv src... dst
+// ------------------------------------------------------------
+
+namespace {
+
+const size_t COPY_BUFFER_SIZE = 1 << 20;
+
+// Copy the data of in to out, cheapest mechanism first: a reflink shares
+// the extents outright, copy_file_range stays in the kernel (and lets
+// NFS/CIFS copy server-side), sendfile covers older kernels, and a large
+// page-aligned buffer is the portable last resort
+bool copyData(int in, int out, off_t size) {
+    if (size > 0 && ioctl(out, FICLONE, in) == 0) return true;
+
+    off_t done = 0;
+    while (done < size) {
+        ssize_t n = copy_file_range(in, nullptr, out, nullptr, size - done, 0);
+        if (n <= 0) break;
+        done += n;
+    }
+    if (done >= size) return true;
+
+    while (done < size) {
+        ssize_t n = sendfile(out, in, nullptr, size - done);
+        if (n <= 0) break;
+        done += n;
+    }
+    if (done >= size) return true;
+
+    void* mem = nullptr;
+    if (posix_memalign(&mem, 4096, COPY_BUFFER_SIZE) != 0) return false;
+    std::unique_ptr<char, decltype(&free)> buf(static_cast<char*>(mem), &free);
+    if (lseek(in, done, SEEK_SET) < 0 || lseek(out, done, SEEK_SET) < 0) return false;
+    ssize_t n;
+    while ((n = read(in, buf.get(), COPY_BUFFER_SIZE)) > 0) {
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(out, buf.get() + off, n - off);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            off += w;
+        }
+    }
+    return n == 0;
+}
+
+// Copies files and trees preserving mode and mtime. Directory trees are
+// copied with a task per entry on the shared pool; directory metadata is
+// applied last, once nothing more gets written into them.
+class TreeCopier {
+private:
+    ThreadPool& pool;
+    ThreadPool::Group group;
+    std::mutex lock;
+    std::vector<std::pair<std::string, struct stat>> dirs;
+    std::atomic<bool> failedFlag;
+    const char* tool;
+
+    void error(const std::string& message) {
+        int err = errno;
+        std::lock_guard<std::mutex> guard(lock);
+        std::cerr << tool << ": " << message << ": " << strerror(err) << std::endl;
+        failedFlag = true;
+    }
+
+    void refuse(const std::string& message) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::cerr << tool << ": " << message << std::endl;
+        failedFlag = true;
+    }
+
+    // Whether path, or the directory it would be created in, lies inside
+    // the directory dir describes
+    static bool within(const std::string& path, const struct stat& dir) {
+        char* real = realpath(path.c_str(), nullptr);
+        if (!real) {
+            std::string parent = path;
+            while (parent.size() > 1 && parent.back() == '/') parent.pop_back();
+            size_t slash = parent.find_last_of('/');
+            parent = slash == std::string::npos ? "." : slash == 0 ? "/" : parent.substr(0, slash);
+            real = realpath(parent.c_str(), nullptr);
+            if (!real) return false;
+        }
+        std::string p = real;
+        free(real);
+        while (true) {
+            struct stat st;
+            if (stat(p.c_str(), &st) == 0 && st.st_dev == dir.st_dev && st.st_ino == dir.st_ino) return true;
+            if (p == "/") return false;
+            size_t slash = p.find_last_of('/');
+            p = slash == 0 ? "/" : p.substr(0, slash);
+        }
+    }
+
+    void copyFile(const std::string& src, const std::string& dst, const struct stat& st) {
+        int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            error("cannot open '" + src + "' for reading");
+            return;
+        }
+        int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 0777);
+        if (out < 0) {
+            error("cannot create regular file '" + dst + "'");
+            close(in);
+            return;
+        }
+        if (!copyData(in, out, st.st_size)) {
+            error("error copying '" + src + "' to '" + dst + "'");
+        }
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        fchmod(out, st.st_mode & 07777);
+        futimens(out, times);
+        close(in);
+        if (close(out) != 0) error("error writing '" + dst + "'");
+    }
+
+    void copyDir(const std::string& src, const std::string& dst, const struct stat& st) {
+        if (mkdir(dst.c_str(), 0700) != 0 && errno != EEXIST) {
+            error("cannot create directory '" + dst + "'");
+            return;
+        }
+        DIR* d = opendir(src.c_str());
+        if (!d) {
+            error("cannot access '" + src + "'");
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            dirs.push_back({dst, st});
+        }
+        struct dirent* ent;
+        while ((ent = readdir(d)) != nullptr) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+            std::string from = src + "/" + ent->d_name;
+            std::string to = dst + "/" + ent->d_name;
+            pool.submit(group, [this, from, to] { copyEntry(from, to, true); });
+        }
+        closedir(d);
+    }
+
+public:
+    explicit TreeCopier(const char* toolName)
+        : pool(ThreadPool::shared()), failedFlag(false), tool(toolName) {}
+
+    // Copy one operand. Refuses what would destroy the source: a file
+    // copied onto itself (O_TRUNC would empty it before reading) and a
+    // directory copied into itself (the copy would never end).
+    void copy(const std::string& src, const std::string& dst, bool recursive) {
+        struct stat st, target;
+        if (lstat(src.c_str(), &st) != 0) {
+            error("cannot stat '" + src + "'");
+            return;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (recursive && within(dst, st)) {
+                refuse("cannot copy a directory, '" + src + "', into itself, '" + dst + "'");
+                return;
+            }
+        } else if ((S_ISLNK(st.st_mode) ? lstat(dst.c_str(), &target) : stat(dst.c_str(), &target)) == 0 &&
+                   target.st_dev == st.st_dev && target.st_ino == st.st_ino) {
+            refuse("'" + src + "' and '" + dst + "' are the same file");
+            return;
+        }
+        copyEntry(src, dst, recursive);
+    }
+
+private:
+    void copyEntry(const std::string& src, const std::string& dst, bool recursive) {
+        struct stat st;
+        if (lstat(src.c_str(), &st) != 0) {
+            error("cannot stat '" + src + "'");
+            return;
+        }
+        if (S_ISREG(st.st_mode)) {
+            copyFile(src, dst, st);
+        } else if (S_ISDIR(st.st_mode)) {
+            if (!recursive) {
+                std::lock_guard<std::mutex> guard(lock);
+                std::cerr << tool << ": -r not specified; omitting directory '" << src << "'" << std::endl;
+                failedFlag = true;
+                return;
+            }
+            copyDir(src, dst, st);
+        } else if (S_ISLNK(st.st_mode)) {
+            std::vector<char> target(st.st_size + 1 > 1 ? st.st_size + 1 : PATH_MAX);
+            ssize_t n = readlink(src.c_str(), target.data(), target.size());
+            if (n < 0) {
+                error("cannot read symbolic link '" + src + "'");
+                return;
+            }
+            unlink(dst.c_str());
+            if (symlink(std::string(target.data(), n).c_str(), dst.c_str()) != 0) {
+                error("cannot create symbolic link '" + dst + "'");
+                return;
+            }
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+            utimensat(AT_FDCWD, dst.c_str(), times, AT_SYMLINK_NOFOLLOW);
+        } else if (S_ISFIFO(st.st_mode)) {
+            if (mkfifo(dst.c_str(), st.st_mode & 07777) != 0) error("cannot create fifo '" + dst + "'");
+        } else {
+            std::lock_guard<std::mutex> guard(lock);
+            std::cerr << tool << ": cannot copy special file '" << src << "'" << std::endl;
+            failedFlag = true;
+        }
+    }
+
+public:
+    // Wait for queued entries, then fix up directory modes and times
+    // deepest first so setting them never disturbs a parent's mtime
+    bool finish() {
+        pool.wait(group);
+        for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+            struct timespec times[2] = {it->second.st_atim, it->second.st_mtim};
+            chmod(it->first.c_str(), it->second.st_mode & 07777);
+            utimensat(AT_FDCWD, it->first.c_str(), times, 0);
+        }
+        dirs.clear();
+        return !failedFlag;
+    }
+};
+
+// Remove a file or a whole tree (the source of a cross-device mv)
+bool removeTree(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) return false;
+    if (!S_ISDIR(st.st_mode)) return unlink(path.c_str()) == 0;
+    DIR* d = opendir(path.c_str());
+    if (!d) return false;
+    bool ok = true;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        if (!removeTree(path + "/" + ent->d_name)) ok = false;
+    }
+    closedir(d);
+    return rmdir(path.c_str()) == 0 && ok;
+}
+
+// Where src lands for 'cp/mv src dst': inside dst when dst is a directory
+std::string copyTarget(const std::string& src, const std::string& dst, bool dstIsDir) {
+    if (!dstIsDir) return dst;
+    std::string base = src;
+    while (base.size() > 1 && base.back() == '/') base.pop_back();
+    size_t slash = base.find_last_of('/');
+    if (slash != std::string::npos) base = base.substr(slash + 1);
+    return dst + (dst.back() == '/' ? "" : "/") + base;
+}
+
+// Split argv into sources and destination; false after printing usage
+bool copyOperands(const char* tool, const std::vector<std::string>& operands,
+                  std::vector<std::string>& sources, std::string& dst, bool& dstIsDir) {
+    if (operands.size() < 2) {
+        std::cerr << tool << ": missing destination file operand" << std::endl;
+        return false;
+    }
+    sources.assign(operands.begin(), operands.end() - 1);
+    dst = operands.back();
+    struct stat st;
+    dstIsDir = stat(dst.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    if (sources.size() > 1 && !dstIsDir) {
+        std::cerr << tool << ": target '" << dst << "' is not a directory" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+int GNELNative::cp(const std::vector<std::string>& argv) {
+    bool recursive = false;
+    std::vector<std::string> operands;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if (a == "-r" || a == "-R" || a == "-a") recursive = true;
+        else operands.push_back(a);
+    }
+    std::vector<std::string> sources;
+    std::string dst;
+    bool dstIsDir = false;
+    if (!copyOperands("cp", operands, sources, dst, dstIsDir)) return 1;
+
+    TreeCopier copier("cp");
+    for (auto& src : sources) {
+        copier.copy(src, copyTarget(src, dst, dstIsDir), recursive);
+    }
+    return copier.finish() ? 0 : 1;
+}
+
+int GNELNative::mv(const std::vector<std::string>& argv) {
+    std::vector<std::string> operands(argv.begin() + 1, argv.end());
+    std::vector<std::string> sources;
+    std::string dst;
+    bool dstIsDir = false;
+    if (!copyOperands("mv", operands, sources, dst, dstIsDir)) return 1;
+
+    bool failed = false;
+    for (auto& src : sources) {
+        std::string target = copyTarget(src, dst, dstIsDir);
+        if (rename(src.c_str(), target.c_str()) == 0) continue;
+        if (errno != EXDEV) {
+            std::cerr << "mv: cannot move '" << src << "' to '" << target << "': " << strerror(errno) << std::endl;
+            failed = true;
+            continue;
+        }
+        // Different filesystem: copy everything over, then drop the source
+        TreeCopier copier("mv");
+        copier.copy(src, target, true);
+        if (!copier.finish()) {
+            failed = true;
+            continue;
+        }
+        if (!removeTree(src)) {
+            std::cerr << "mv: cannot remove '" << src << "': " << strerror(errno) << std::endl;
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// sort [-nrus] [-t c] [-k n[,m]] [-o out] [-S size] [-T dir] [file...]
+// ------------------------------------------------------------
+
+namespace {
+
+// -S argument: a number with an optional K/M/G/T suffix; plain numbers
+// are KiB like in GNU sort
+bool parseSortSize(const std::string& text, size_t& bytes) {
+    char* end = nullptr;
+    unsigned long long n = strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str()) return false;
+    std::string unit(end);
+    int shift = 10;
+    if (unit == "b" || unit == "B") shift = 0;
+    else if (unit.empty() || unit == "k" || unit == "K") shift = 10;
+    else if (unit == "m" || unit == "M") shift = 20;
+    else if (unit == "g" || unit == "G") shift = 30;
+    else if (unit == "t" || unit == "T") shift = 40;
+    else return false;
+    bytes = static_cast<size_t>(n) << shift;
+    return true;
+}
+
+// -k argument: start[,end] fields, optionally followed by n or r
+bool parseSortKey(const std::string& text, SortOptions& opt) {
+    const char* p = text.c_str();
+    char* end = nullptr;
+    opt.keyStart = strtoul(p, &end, 10);
+    if (end == p || opt.keyStart == 0) return false;
+    p = end;
+    if (*p == ',') {
+        opt.keyEnd = strtoul(p + 1, &end, 10);
+        if (end == p + 1 || opt.keyEnd == 0) return false;
+        p = end;
+    }
+    for (; *p; p++) {
+        if (*p == 'n') opt.numeric = true;
+        else if (*p == 'r') opt.reverse = true;
+        else return false;
+    }
+    return true;
+}
+
+}
+
+int GNELNative::sort(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    SortOptions opt;
+    std::string output;
+    std::vector<std::string> files;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if (a.size() < 2 || a[0] != '-') {
+            files.push_back(a);
+            continue;
+        }
+        for (size_t j = 1; j < a.size(); j++) {
+            char flag = a[j];
+            if (flag == 'n') opt.numeric = true;
+            else if (flag == 'r') opt.reverse = true;
+            else if (flag == 'u') opt.unique = true;
+            else if (flag == 's') opt.stable = true;
+            else if (flag == 't' || flag == 'k' || flag == 'o' || flag == 'S' || flag == 'T') {
+                // Value attached (-k2) or in the next argument (-k 2)
+                std::string value = a.substr(j + 1);
+                if (value.empty()) {
+                    if (i + 1 >= argv.size()) {
+                        std::cerr << "sort: option requires an argument -- '" << flag << "'" << std::endl;
+                        return 2;
+                    }
+                    value = argv[++i];
+                }
+                bool ok = true;
+                if (flag == 't') {
+                    ok = value.size() == 1;
+                    opt.separator = value[0];
+                } else if (flag == 'k') {
+                    ok = parseSortKey(value, opt);
+                } else if (flag == 'S') {
+                    ok = parseSortSize(value, opt.memoryBudget);
+                } else if (flag == 'T') {
+                    opt.tempDir = value;
+                } else {
+                    output = value;
+                }
+                if (!ok) {
+                    std::cerr << "sort: invalid argument '" << value << "' for -" << flag << std::endl;
+                    return 2;
+                }
+                break;
+            } else {
+                std::cerr << "sort: invalid option -- '" << flag << "'" << std::endl;
+                return 2;
+            }
+        }
+    }
+    if (files.empty()) files.push_back("-");
+
+    // Mapped inputs are sorted in place and must outlive the sorter
+    ExternalSorter sorter(opt);
+    std::vector<std::unique_ptr<MappedFile>> mapped;
+    for (auto& file : files) {
+        bool added;
+        if (file == "-") {
+            if (!input) continue;
+            added = sorter.add([input](const char*& data, size_t& size) { return input->next(data, size); });
+        } else {
+            mapped.emplace_back(new MappedFile);
+            if (!mapped.back()->open(file)) {
+                std::cerr << "sort: cannot read: " << file << ": " << strerror(errno) << std::endl;
+                return 2;
+            }
+            added = sorter.add(mapped.back()->data(), mapped.back()->size());
+        }
+        if (!added) {
+            std::cerr << "sort: " << sorter.error() << std::endl;
+            return 2;
+        }
+    }
+
+    if (output.empty()) {
+        if (!sorter.finish(-1, &out)) {
+            std::cerr << "sort: " << sorter.error() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    // -o: write next to the target and rename over it, so sorting a file
+    // onto itself never truncates the mapping still being read
+    std::string temp = output + ".XXXXXX";
+    int fd = mkostemp(&temp[0], O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "sort: open failed: " << output << ": " << strerror(errno) << std::endl;
+        return 2;
+    }
+    struct stat st;
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, stat(output.c_str(), &st) == 0 ? (st.st_mode & 07777) : (0666 & ~mask));
+    bool ok = sorter.finish(fd, nullptr);
+    if (close(fd) != 0 && ok) ok = false;
+    if (!ok || rename(temp.c_str(), output.c_str()) != 0) {
+        std::cerr << "sort: " << (sorter.error().empty() ? output + ": " + strerror(errno) : sorter.error()) << std::endl;
+        unlink(temp.c_str());
+        return 2;
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------
+// count [-f N] [-d c] [-n top] [file...]   (cut | sort | uniq -c | sort -rn)
+// ------------------------------------------------------------
+
+namespace {
+
+struct CountOptions {
+    size_t field = 0;  // 1-based; 0 counts whole lines
+    char separator = 0;  // 0 splits fields at blank runs, like awk
+    size_t top = 0;      // 0 prints every key
+};
+
+uint64_t countHash(const char* p, size_t n) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 31;
+        p += 8;
+        n -= 8;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, n);
+    h = (h ^ w) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 29);
+}
+
+// Open-addressing (linear probing) table from key to count. Keys point
+// into the counted data, which must outlive the table, unless the table
+// was told to copy them; then only distinct keys take memory.
+class KeyCounter {
+public:
+    struct Slot {
+        const char* key = nullptr;  // nullptr marks an empty slot
+        size_t size = 0;
+        uint64_t hash = 0;
+        uint64_t count = 0;
+    };
+
+private:
+    std::vector<Slot> slots;
+    size_t used;
+    bool copyKeys;
+    std::vector<std::unique_ptr<char[]>> arena;
+    size_t arenaLeft;
+    char* arenaNext;
+
+    // Empty keys keep add()'s static byte: an unallocated arena would hand
+    // back nullptr, the empty-slot marker
+    const char* keep(const char* key, size_t size) {
+        if (!copyKeys || size == 0) return key;
+        if (size > arenaLeft) {
+            size_t block = std::max<size_t>(size, 1 << 20);
+            arena.emplace_back(new char[block]);
+            arenaNext = arena.back().get();
+            arenaLeft = block;
+        }
+        memcpy(arenaNext, key, size);
+        const char* kept = arenaNext;
+        arenaNext += size;
+        arenaLeft -= size;
+        return kept;
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (auto& slot : old) {
+            if (!slot.key) continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].key) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+public:
+    explicit KeyCounter(bool copy = false)
+        : slots(1024), used(0), copyKeys(copy), arenaLeft(0), arenaNext(nullptr) {}
+
+    void add(const char* key, size_t size, uint64_t hash, uint64_t n = 1) {
+        static const char empty = 0;
+        if (size == 0) key = &empty;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (!slot.key) {
+                slot.key = keep(key, size);
+                slot.size = size;
+                slot.hash = hash;
+                slot.count = n;
+                if (++used * 2 > slots.size()) grow();
+                return;
+            }
+            if (slot.hash == hash && slot.size == size && memcmp(slot.key, key, size) == 0) {
+                slot.count += n;
+                return;
+            }
+        }
+    }
+
+    void merge(const KeyCounter& other) {
+        for (auto& slot : other.slots) {
+            if (slot.key) add(slot.key, slot.size, slot.hash, slot.count);
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (auto& slot : slots) {
+            if (slot.key) fn(slot);
+        }
+    }
+};
+
+// The key of one line, or false if the line has no such field
+bool countKey(const char* line, size_t size, const CountOptions& opt, const char*& key, size_t& keySize) {
+    if (opt.field == 0) {
+        key = line;
+        keySize = size;
+        return true;
+    }
+    size_t pos = 0;
+    if (opt.separator) {
+        for (size_t f = 1; f < opt.field; f++) {
+            const char* sep = static_cast<const char*>(memchr(line + pos, opt.separator, size - pos));
+            if (!sep) return false;
+            pos = (sep - line) + 1;
+        }
+        const char* sep = static_cast<const char*>(memchr(line + pos, opt.separator, size - pos));
+        key = line + pos;
+        keySize = (sep ? sep - line : size) - pos;
+        return true;
+    }
+    auto blank = [](char c) { return c == ' ' || c == '\t'; };
+    for (size_t f = 1; ; f++) {
+        while (pos < size && blank(line[pos])) pos++;
+        if (pos == size) return false;
+        size_t start = pos;
+        while (pos < size && !blank(line[pos])) pos++;
+        if (f == opt.field) {
+            key = line + start;
+            keySize = pos - start;
+            return true;
+        }
+    }
+}
+
+// Count the lines of [data, data + size); a last line without '\n' counts
+void countLines(const char* data, size_t size, const CountOptions& opt, KeyCounter& table) {
+    size_t pos = 0;
+    while (pos < size) {
+        const char* nl = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+        size_t end = nl ? nl - data : size;
+        const char* key;
+        size_t keySize;
+        if (countKey(data + pos, end - pos, opt, key, keySize)) {
+            table.add(key, keySize, countHash(key, keySize));
+        }
+        pos = end + 1;
+    }
+}
+
+// A mapped file counted in newline-aligned chunks, one table per chunk
+// on the shared pool, merged into table at the end
+void countParallel(const char* data, size_t size, const CountOptions& opt, KeyCounter& table) {
+    const size_t minChunk = 4 << 20;
+    ThreadPool& pool = ThreadPool::shared();
+    size_t chunks = std::min(size / minChunk, static_cast<size_t>(pool.size()) * 4);
+    if (pool.size() < 2 || chunks < 2) {
+        countLines(data, size, opt, table);
+        return;
+    }
+    std::vector<std::unique_ptr<KeyCounter>> partial;
+    ThreadPool::Group group;
+    size_t begin = 0;
+    for (size_t k = 0; k < chunks && begin < size; k++) {
+        size_t end = (k + 1 == chunks) ? size : std::max(begin, size * (k + 1) / chunks);
+        const char* nl = end < size ? static_cast<const char*>(memchr(data + end, '\n', size - end)) : nullptr;
+        end = nl ? (nl - data) + 1 : size;
+        partial.emplace_back(new KeyCounter);
+        KeyCounter* part = partial.back().get();
+        pool.submit(group, [data, begin, end, &opt, part] { countLines(data + begin, end - begin, opt, *part); });
+        begin = end;
+    }
+    pool.wait(group);
+    for (auto& part : partial) table.merge(*part);
+}
+
+}
+
+int GNELNative::count(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    CountOptions opt;
+    std::vector<std::string> files;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if ((a == "-f" || a == "-d" || a == "-n") && i + 1 < argv.size()) {
+            const std::string& value = argv[++i];
+            if (a == "-d") {
+                // "\t" spelled out is a tab; " " or "" mean blank runs
+                opt.separator = value == "\\t" ? '\t' : (value.empty() || value == " " ? 0 : value[0]);
+            } else {
+                char* end = nullptr;
+                size_t n = strtoul(value.c_str(), &end, 10);
+                if (value.empty() || *end) {
+                    std::cerr << "count: invalid number '" << value << "'" << std::endl;
+                    return 1;
+                }
+                if (a == "-f") opt.field = n;
+                else opt.top = n;
+            }
+        } else {
+            files.push_back(a);
+        }
+    }
+    if (files.empty()) files.push_back("-");
+
+    // Streamed keys get copied, mapped ones stay views into the mapping
+    KeyCounter table(true);
+    std::vector<std::unique_ptr<MappedFile>> mapped;
+    bool failed = false;
+    for (auto& file : files) {
+        if (file == "-") {
+            std::string carry;
+            const char* data;
+            size_t size;
+            while (input && input->next(data, size)) {
+                const char* nl = static_cast<const char*>(memrchr(data, '\n', size));
+                if (!nl) {
+                    carry.append(data, size);
+                    continue;
+                }
+                size_t whole = (nl - data) + 1;
+                if (!carry.empty()) {
+                    // Finish the line split across pieces
+                    const char* first = static_cast<const char*>(memchr(data, '\n', size));
+                    carry.append(data, (first - data) + 1);
+                    countLines(carry.data(), carry.size(), opt, table);
+                    carry.clear();
+                    countLines(first + 1, whole - ((first - data) + 1), opt, table);
+                } else {
+                    countLines(data, whole, opt, table);
+                }
+                carry.assign(data + whole, size - whole);
+            }
+            if (!carry.empty()) countLines(carry.data(), carry.size(), opt, table);
+            continue;
+        }
+        mapped.emplace_back(new MappedFile);
+        if (!mapped.back()->open(file)) {
+            toolError("count", file);
+            failed = true;
+            continue;
+        }
+        KeyCounter views;
+        countParallel(mapped.back()->data(), mapped.back()->size(), opt, views);
+        table.merge(views);
+    }
+
+    // Highest counts first, ties by key; with a top K only a K-sized heap
+    // of the best entries is kept
+    typedef const KeyCounter::Slot* Entry;
+    auto better = [](Entry a, Entry b) {
+        if (a->count != b->count) return a->count > b->count;
+        int c = memcmp(a->key, b->key, std::min(a->size, b->size));
+        return c != 0 ? c < 0 : a->size < b->size;
+    };
+    std::vector<Entry> entries;
+    table.forEach([&](const KeyCounter::Slot& slot) {
+        if (opt.top == 0) {
+            entries.push_back(&slot);
+            return;
+        }
+        if (entries.size() < opt.top) {
+            entries.push_back(&slot);
+            std::push_heap(entries.begin(), entries.end(), better);
+        } else if (better(&slot, entries.front())) {
+            std::pop_heap(entries.begin(), entries.end(), better);
+            entries.back() = &slot;
+            std::push_heap(entries.begin(), entries.end(), better);
+        }
+    });
+    std::sort(entries.begin(), entries.end(), better);
+
+    std::string result;
+    for (Entry e : entries) {
+        char num[32];
+        snprintf(num, sizeof(num), "%7llu ", static_cast<unsigned long long>(e->count));
+        result += num;
+        result.append(e->key, e->size);
+        result += '\n';
+    }
+    out.write(result.data(), result.size());
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// hash [-a sha256|xxh64] [-t] [-c] [file|dir...]   (also as sha256sum, xxh64sum)
+// ------------------------------------------------------------
+
+namespace {
+
+const size_t HASH_TREE_CHUNK = 4 << 20;
+
+enum class HashAlgo { Sha256, Xxh64 };
+
+// Raw digest of a buffer
+std::string hashRaw(HashAlgo algo, const char* data, size_t size) {
+    if (algo == HashAlgo::Sha256) {
+        Sha256 h;
+        h.update(data, size);
+        uint8_t raw[32];
+        h.digest(raw);
+        return std::string(reinterpret_cast<char*>(raw), sizeof(raw));
+    }
+    XxHash64 h;
+    h.update(data, size);
+    uint64_t v = h.digest();
+    std::string raw(8, '\0');
+    for (int i = 0; i < 8; i++) raw[i] = static_cast<char>(v >> (56 - i * 8));
+    return raw;
+}
+
+std::string hashRawToHex(const std::string& raw) {
+    return hashHex(reinterpret_cast<const uint8_t*>(raw.data()), raw.size());
+}
+
+// Tree digest: the hash of the concatenated raw digests of consecutive
+// HASH_TREE_CHUNK pieces, which are hashed in parallel on the pool. Not
+// comparable with a plain digest, but a large file no longer hashes at
+// the speed of a single core.
+std::string hashTree(HashAlgo algo, const char* data, size_t size) {
+    size_t chunks = std::max<size_t>(1, (size + HASH_TREE_CHUNK - 1) / HASH_TREE_CHUNK);
+    std::vector<std::string> leaves(chunks);
+    ThreadPool& pool = ThreadPool::shared();
+    ThreadPool::Group group;
+    for (size_t i = 0; i < chunks; i++) {
+        size_t begin = i * HASH_TREE_CHUNK;
+        size_t len = std::min(HASH_TREE_CHUNK, size - std::min(size, begin));
+        std::string* leaf = &leaves[i];
+        pool.submit(group, [algo, data, begin, len, leaf] { *leaf = hashRaw(algo, data + begin, len); });
+    }
+    pool.wait(group);
+    std::string joined;
+    for (auto& leaf : leaves) joined += leaf;
+    return hashRaw(algo, joined.data(), joined.size());
+}
+
+// Hex digest of a file, or "" with errno set
+std::string hashFile(HashAlgo algo, bool tree, const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) return "";
+    if (tree) return hashRawToHex(hashTree(algo, file.data(), file.size()));
+    return hashRawToHex(hashRaw(algo, file.data(), file.size()));
+}
+
+// Regular files below dir, sorted, for hashing a whole tree
+void hashCollect(const std::string& dir, std::vector<std::string>& files) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    std::vector<std::string> names;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) names.push_back(ent->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (auto& name : names) {
+        std::string path = dir + (dir.back() == '/' ? "" : "/") + name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) hashCollect(path, files);
+        else if (S_ISREG(st.st_mode)) files.push_back(path);
+    }
+}
+
+// sha256sum escapes names holding '\' or newlines and marks the line with '\'
+std::string hashLine(const std::string& digest, const std::string& name) {
+    if (name.find_first_of("\\\n") == std::string::npos) return digest + "  " + name + "\n";
+    std::string escaped;
+    for (char c : name) {
+        if (c == '\\') escaped += "\\\\";
+        else if (c == '\n') escaped += "\\n";
+        else escaped += c;
+    }
+    return "\\" + digest + "  " + escaped + "\n";
+}
+
+// One "digest  name" line of a manifest; false if malformed
+bool hashParseLine(std::string line, std::string& digest, std::string& name) {
+    bool escaped = !line.empty() && line[0] == '\\';
+    if (escaped) line.erase(0, 1);
+    size_t space = line.find(' ');
+    if (space == std::string::npos || space == 0 || space + 2 > line.size()) return false;
+    if (line[space + 1] != ' ' && line[space + 1] != '*') return false;
+    digest = line.substr(0, space);
+    for (char& c : digest) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    if (digest.find_first_not_of("0123456789abcdef") != std::string::npos) return false;
+    name.clear();
+    for (size_t i = space + 2; i < line.size(); i++) {
+        if (escaped && line[i] == '\\' && i + 1 < line.size()) {
+            name += line[i + 1] == 'n' ? '\n' : line[i + 1];
+            i++;
+        } else {
+            name += line[i];
+        }
+    }
+    return !name.empty();
+}
+
+}
+
+int GNELNative::hash(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    const std::string tool = argv[0];
+    HashAlgo algo = tool == "xxh64sum" ? HashAlgo::Xxh64 : HashAlgo::Sha256;
+    bool algoGiven = tool != "hash";
+    bool tree = false, check = false;
+    std::vector<std::string> operands;
+    for (size_t i = 1; i < argv.size(); i++) {
+        const std::string& a = argv[i];
+        if (a == "-a" && i + 1 < argv.size()) {
+            std::string name = argv[++i];
+            if (name == "sha256") algo = HashAlgo::Sha256;
+            else if (name == "xxh64" || name == "xxhash64" || name == "xxhash") algo = HashAlgo::Xxh64;
+            else {
+                std::cerr << tool << ": unknown algorithm '" << name << "' (use sha256 or xxh64)" << std::endl;
+                return 1;
+            }
+            algoGiven = true;
+        } else if (a == "-t") {
+            tree = true;
+        } else if (a == "-c") {
+            check = true;
+        } else {
+            operands.push_back(a);
+        }
+    }
+    if (operands.empty()) operands.push_back("-");
+
+    // Work out every (digest, name) job first, then hash them in parallel
+    struct Job {
+        std::string path;
+        std::string expected;  // -c
+        std::string digest;
+        int err = 0;
+        HashAlgo algo;  // per job: a -c manifest may mix digest lengths
+    };
+    std::vector<Job> jobs;
+    size_t malformed = 0;
+    bool failed = false;
+    for (auto& operand : operands) {
+        if (!check) {
+            struct stat st;
+            if (operand != "-" && stat(operand.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                std::vector<std::string> files;
+                hashCollect(operand, files);
+                for (auto& f : files) jobs.push_back(Job{f, "", "", 0, algo});
+            } else {
+                jobs.push_back(Job{operand, "", "", 0, algo});
+            }
+            continue;
+        }
+        std::string manifest;
+        if (operand == "-") {
+            if (input) input->readAll(manifest);
+        } else {
+            MappedFile file;
+            if (!file.open(operand)) {
+                toolError(tool, operand);
+                failed = true;
+                continue;
+            }
+            manifest.assign(file.data(), file.size());
+        }
+        size_t pos = 0;
+        while (pos < manifest.size()) {
+            size_t nl = manifest.find('\n', pos);
+            if (nl == std::string::npos) nl = manifest.size();
+            std::string line = manifest.substr(pos, nl - pos);
+            pos = nl + 1;
+            if (line.empty() || line[0] == '#') continue;
+            Job job;
+            job.algo = algo;
+            // The digest length tells the algorithm unless one was named
+            size_t want = algo == HashAlgo::Sha256 ? 64 : 16;
+            if (!hashParseLine(line, job.expected, job.path) ||
+                (algoGiven ? job.expected.size() != want
+                           : job.expected.size() != 64 && job.expected.size() != 16)) {
+                malformed++;
+                continue;
+            }
+            if (!algoGiven) job.algo = job.expected.size() == 16 ? HashAlgo::Xxh64 : HashAlgo::Sha256;
+            jobs.push_back(job);
+        }
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    ThreadPool::Group group;
+    for (auto& job : jobs) {
+        if (job.path == "-") {
+            // stdin streams through on this thread
+            if (job.algo == HashAlgo::Sha256) {
+                Sha256 h;
+                const char* data;
+                size_t size;
+                while (input && input->next(data, size)) h.update(data, size);
+                job.digest = h.hexDigest();
+            } else {
+                XxHash64 h;
+                const char* data;
+                size_t size;
+                while (input && input->next(data, size)) h.update(data, size);
+                job.digest = h.hexDigest();
+            }
+            continue;
+        }
+        Job* j = &job;
+        pool.submit(group, [tree, j] {
+            j->digest = hashFile(j->algo, tree, j->path);
+            if (j->digest.empty()) j->err = errno;
+        });
+    }
+    pool.wait(group);
+
+    std::string result;
+    size_t mismatched = 0, unreadable = 0;
+    for (auto& job : jobs) {
+        if (job.err != 0) {
+            std::cerr << tool << ": " << job.path << ": " << strerror(job.err) << std::endl;
+            if (check) {
+                result += job.path + ": FAILED open or read\n";
+                unreadable++;
+            }
+            failed = true;
+            continue;
+        }
+        if (!check) {
+            result += hashLine(job.digest, job.path);
+        } else if (job.digest == job.expected) {
+            result += job.path + ": OK\n";
+        } else {
+            result += job.path + ": FAILED\n";
+            mismatched++;
+            failed = true;
+        }
+    }
+    out.write(result.data(), result.size());
+    out.flush();
+
+    auto warn = [&](size_t n, const char* one, const char* many) {
+        if (n > 0) std::cerr << tool << ": WARNING: " << n << " " << (n == 1 ? one : many) << std::endl;
+    };
+    warn(malformed, "line is improperly formatted", "lines are improperly formatted");
+    warn(unreadable, "listed file could not be read", "listed files could not be read");
+    warn(mismatched, "computed checksum did NOT match", "computed checksums did NOT match");
+    if (check && jobs.empty() && malformed > 0) failed = true;
+    return failed ? 1 : 0;
+}
+
+// ------------------------------------------------------------
+// Dispatch, pipelines and process spawning
+// ------------------------------------------------------------
+
+bool GNELNative::isBuiltin(const std::string& name) {
+    return name == "grep" || name == "find" || name == "wc" || name == "head" ||
+           name == "tail" || name == "cat" || name == "cp" || name == "mv" || name == "sort" ||
+           name == "count" || name == "hash" || name == "sha256sum" || name == "xxh64sum";
+}
+
+int GNELNative::run(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out) {
+    const std::string& tool = argv[0];
+    if (tool == "grep") return grep(argv, input, out);
+    if (tool == "find") return find(argv, out);
+    if (tool == "wc") return wc(argv, input, out);
+    if (tool == "head") return head(argv, input, out);
+    if (tool == "tail") return tail(argv, input, out);
+    if (tool == "cat") return cat(argv, input, out);
+    if (tool == "cp") return cp(argv);
+    if (tool == "mv") return mv(argv);
+    if (tool == "sort") return sort(argv, input, out);
+    if (tool == "count") return count(argv, input, out);
+    if (tool == "hash" || tool == "sha256sum" || tool == "xxh64sum") return hash(argv, input, out);
+    return 127;
+}
+
+std::vector<std::string> GNELNative::splitCommand(const std::string& cmd) {
+    std::vector<std::string> argv;
+    std::string cur;
+    bool inWord = false;
+    char quote = 0;
+    for (size_t i = 0; i < cmd.size(); i++) {
+        char c = cmd[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+            else if (c == '\\' && quote == '"' && i + 1 < cmd.size()) cur += cmd[++i];
+            else cur += c;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            inWord = true;
+        } else if (c == '\\' && i + 1 < cmd.size()) {
+            cur += cmd[++i];
+            inWord = true;
+        } else if (isspace(static_cast<unsigned char>(c))) {
+            if (inWord) argv.push_back(cur);
+            cur.clear();
+            inWord = false;
+        } else {
+            cur += c;
+            inWord = true;
+        }
+    }
+    if (inWord) argv.push_back(cur);
+    return argv;
+}
+
+// Characters that need a real shell (redirection, globbing, variables, ...)
+static bool needsShell(const std::string& cmd) {
+    return cmd.find_first_of("<>;&|`$*?[~(){}") != std::string::npos;
+}
+
+namespace {
+
+// One stage of a pipeline: a builtin on its own thread, or a spawned process
+struct PipeStage {
+    std::vector<std::string> argv;
+    bool builtin = false;
+    pid_t pid = -1;
+    int status = 0;
+};
+
+// Start argv with stdin/stdout redirected (-1 keeps ours); 127 if it fails
+int spawnWithFds(const std::vector<std::string>& argv, int inFd, int outFd, pid_t& pid) {
+    std::vector<char*> args;
+    for (auto& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (inFd >= 0) posix_spawn_file_actions_adddup2(&actions, inFd, STDIN_FILENO);
+    if (outFd >= 0) posix_spawn_file_actions_adddup2(&actions, outFd, STDOUT_FILENO);
+    int err = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
+        std::cerr << argv[0] << ": " << strerror(err) << std::endl;
+        pid = -1;
+        return 127;
+    }
+    return 0;
+}
+
+int waitStatus(pid_t pid) {
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+}
+
+// Copy a ring into a process's stdin. SIGPIPE is blocked on this thread,
+// so a process that exits early shows up as EPIPE instead of killing us.
+void feedProcess(ChunkRing& ring, int fd) {
+    sigset_t pipeSignal;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+
+    std::string chunk;
+    bool broken = false;
+    while (!broken && ring.pop(chunk)) {
+        const char* p = chunk.data();
+        size_t left = chunk.size();
+        while (left > 0) {
+            ssize_t n = write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                broken = true;
+                break;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+    if (broken) {
+        ring.close();
+        struct timespec none = {0, 0};
+        sigtimedwait(&pipeSignal, nullptr, &none);  // drop the SIGPIPE we raised
+    }
+    close(fd);
+}
+
+// Copy a process's stdout into a ring, or into the final output stream
+void drainProcess(int fd, ChunkRing* ring, std::ostream* out) {
+    std::string chunk;
+    for (;;) {
+        chunk.resize(ChunkRing::CHUNK_SIZE);
+        ssize_t n = read(fd, &chunk[0], chunk.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        chunk.resize(n);
+        if (ring) {
+            if (!ring->push(chunk)) break;
+        } else {
+            out->write(chunk.data(), n);
+        }
+    }
+    close(fd);
+    if (ring) ring->finish();
+}
+
+}
+
+bool GNELNative::pipe(const std::vector<std::string>& stages, std::ostream& out, int& status) {
+    size_t count = stages.size();
+    std::vector<PipeStage> plan(count);
+    for (size_t i = 0; i < count; i++) {
+        // Quoted patterns may contain shell characters; only unquoted ones matter
+        std::string unquoted;
+        char quote = 0;
+        for (char c : stages[i]) {
+            if (quote) { if (c == quote) quote = 0; }
+            else if (c == '\'' || c == '"') quote = c;
+            else unquoted += c;
+        }
+        plan[i].argv = splitCommand(stages[i]);
+        if (plan[i].argv.empty()) return false;
+        if (needsShell(unquoted)) {
+            plan[i].argv = {"sh", "-c", stages[i]};
+        } else {
+            plan[i].builtin = isBuiltin(plan[i].argv[0]);
+        }
+    }
+
+    // A ring joins two stages when either of them is a builtin; two
+    // processes next to each other share a plain kernel pipe
+    std::vector<std::unique_ptr<ChunkRing>> rings(count > 0 ? count - 1 : 0);
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (plan[i].builtin || plan[i + 1].builtin) rings[i].reset(new ChunkRing());
+    }
+
+    std::cout << std::flush;
+    std::vector<std::thread> threads;
+    int nextIn = -1;  // read end of a kernel pipe from the previous process
+    for (size_t i = 0; i < count; i++) {
+        PipeStage& stage = plan[i];
+        bool last = i + 1 == count;
+        if (stage.builtin) {
+            if (last) continue;  // runs on this thread below
+            ChunkRing* in = i > 0 ? rings[i - 1].get() : nullptr;
+            ChunkRing* to = rings[i].get();
+            threads.emplace_back([&stage, in, to] {
+                ChunkRingBuf buf(*to);
+                std::ostream os(&buf);
+                if (in) {
+                    GNELInput input(*in);
+                    stage.status = run(stage.argv, &input, os);
+                    input.close();
+                } else {
+                    stage.status = run(stage.argv, nullptr, os);
+                }
+                buf.finish();
+            });
+            continue;
+        }
+
+        int fds[2];
+        int inFd = -1, outFd = -1;
+        if (i > 0 && rings[i - 1]) {
+            if (pipe2(fds, O_CLOEXEC) == 0) {
+                inFd = fds[0];
+                ChunkRing* from = rings[i - 1].get();
+                int writeEnd = fds[1];
+                threads.emplace_back([from, writeEnd] { feedProcess(*from, writeEnd); });
+            }
+        } else if (i > 0) {
+            inFd = nextIn;
+        }
+        nextIn = -1;
+        if (!last || &out != &std::cout) {
+            if (pipe2(fds, O_CLOEXEC) == 0) {
+                outFd = fds[1];
+                if (!last && !rings[i]) {
+                    nextIn = fds[0];
+                } else {
+                    ChunkRing* to = last ? nullptr : rings[i].get();
+                    std::ostream* sink = last ? &out : nullptr;
+                    int readEnd = fds[0];
+                    threads.emplace_back([readEnd, to, sink] { drainProcess(readEnd, to, sink); });
+                }
+            }
+        }
+        stage.status = spawnWithFds(stage.argv, inFd, outFd, stage.pid);
+        if (inFd >= 0) close(inFd);
+        if (outFd >= 0) close(outFd);
+    }
+
+    PipeStage& lastStage = plan[count - 1];
+    if (lastStage.builtin) {
+        if (count > 1) {
+            GNELInput input(*rings[count - 2]);
+            lastStage.status = run(lastStage.argv, &input, out);
+            input.close();
+        } else {
+            lastStage.status = run(lastStage.argv, nullptr, out);
+        }
+    }
+    for (auto& t : threads) t.join();
+    for (auto& stage : plan) {
+        if (stage.pid > 0) stage.status = waitStatus(stage.pid);
+    }
+    out.flush();
+    status = lastStage.status;
+    return true;
+}
+
+int GNELNative::spawn(const std::vector<std::string>& argv) {
+    std::cout << std::flush;
+    pid_t pid;
+    if (spawnWithFds(argv, -1, -1, pid) != 0) return 127;
+    return waitStatus(pid);
+}
@@ -0,0 +1,83 @@
+#ifndef GNEL_NATIVE_H
+#define GNEL_NATIVE_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+class ChunkRing;
+
+// Standard input of a builtin: either a whole buffer or the chunks coming
+// from the previous stage of an in-process pipeline
+class GNELInput {
+private:
+    const std::string* text;
+    ChunkRing* ring;
+    std::string chunk;
+    bool consumed;
+
+public:
+    explicit GNELInput(const std::string& data);
+    explicit GNELInput(ChunkRing& source);
+
+    // Next piece of input; false at the end
+    bool next(const char*& data, size_t& size);
+    // Append everything still unread to data
+    void readAll(std::string& data);
+    // The reader wants no more (e.g. head is done); lets the writer stop
+    void close();
+};
+
+// Totals of a wc run, for callers that want the numbers as well as the text
+struct GNELCounts {
+    size_t lines = 0, words = 0, chars = 0, bytes = 0;
+};
+
+// OpenGNEL native builtins - in-process versions of the coreutils tools
+// GNEL used to reach through system(). Each tool takes a coreutils-style
+// argv (argv[0] is the tool name), reads files or the given stdin,
+// writes to out, and returns the exit status the real tool would.
+class GNELNative {
+public:
+    static int grep(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    // paths, if given, also receives every path printed
+    static int find(const std::vector<std::string>& argv, std::ostream& out,
+                    std::vector<std::string>* paths = nullptr);
+    // Counting is vectorised (AVX2 where available); large files are split
+    // across the thread pool. totals, if given, receives the summed counts.
+    static int wc(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out,
+                  GNELCounts* totals = nullptr);
+    static int head(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    static int tail(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    static int cat(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    // Copies preserve mode and mtime; -r copies directory trees in parallel
+    static int cp(const std::vector<std::string>& argv);
+    static int mv(const std::vector<std::string>& argv);
+    // External-memory sort: runs sized to -S spill to temp files and are
+    // merged back; -o writes through a temp file renamed over the target
+    static int sort(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    // Occurrences per line or field (-f N, -d sep), most frequent first,
+    // as 'cut | sort | uniq -c | sort -rn' would print them; -n keeps the top N
+    static int count(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+    // sha256sum-compatible digests (-a sha256|xxh64), files hashed in
+    // parallel and directories recursively; -t tree-hashes 4 MiB chunks,
+    // -c verifies a manifest. Also runs as sha256sum and xxh64sum.
+    static int hash(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+
+    // True if name is a tool the functions above implement
+    static bool isBuiltin(const std::string& name);
+    // Run one builtin by argv[0]
+    static int run(const std::vector<std::string>& argv, GNELInput* input, std::ostream& out);
+
+    // Split a command string into argv, honouring '...' and "..." quoting
+    static std::vector<std::string> splitCommand(const std::string& cmd);
+    // Run 'cmd1 | cmd2 | ...' with a thread per builtin stage, connected by
+    // ChunkRings; other commands are spawned and joined with real pipes.
+    // Returns false (and does nothing) if a stage cannot be started.
+    static bool pipe(const std::vector<std::string>& stages, std::ostream& out, int& status);
+
+    // fork+exec argv directly (no /bin/sh in between) and wait for it
+    static int spawn(const std::vector<std::string>& argv);
+};
+
+#endif
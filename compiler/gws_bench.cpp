@@ -0,0 +1,498 @@
+#include "gws_bench.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+static int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+namespace {
+
+// Log-linear histogram of nanosecond values: 128 linear sub-buckets per
+// power of two, so any recorded value is reported within 1%
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 7;
+    static const uint64_t SUB = 1u << SUB_BITS;
+
+    LatencyHistogram() : counts(SUB + 57 * SUB, 0) {}
+
+    void record(uint64_t value, uint64_t count = 1) {
+        counts[index(value)] += count;
+        total += count;
+        sum += static_cast<double>(value) * count;
+        maxValue = std::max(maxValue, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    // A copy with the samples a closed-loop client never sent while it
+    // waited: every value above expected also implies value - expected,
+    // value - 2 * expected, ... (HdrHistogram's corrected recording)
+    LatencyHistogram corrected(uint64_t expected) const {
+        LatencyHistogram out;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (!counts[i]) continue;
+            uint64_t value = std::min(highest(i), maxValue);
+            out.record(value, counts[i]);
+            if (expected == 0) continue;
+            for (uint64_t missing = value > expected ? value - expected : 0; missing >= expected; missing -= expected)
+                out.record(missing, counts[i]);
+        }
+        return out;
+    }
+
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * total));
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target) return std::min(highest(i), maxValue);
+        }
+        return maxValue;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? sum / total : 0; }
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    double sum = 0;
+    uint64_t maxValue = 0;
+
+    static size_t index(uint64_t v) {
+        if (v < SUB) return static_cast<size_t>(v);
+        int shift = 63 - __builtin_clzll(v) - SUB_BITS;
+        return static_cast<size_t>(SUB + shift * SUB + ((v >> shift) - SUB));
+    }
+    // Largest value that lands in bucket i
+    static uint64_t highest(size_t i) {
+        if (i < SUB) return i;
+        int shift = static_cast<int>((i - SUB) / SUB);
+        uint64_t mantissa = SUB + (i - SUB) % SUB;
+        return ((mantissa + 1) << shift) - 1;
+    }
+};
+
+struct BenchOptions {
+    std::string host = "127.0.0.1";
+    std::string port = "80";
+    std::string path = "/";
+    std::vector<std::string> headers;
+    int connections = 64;
+    int threads = 0;
+    double seconds = 10;
+    double rate = 0;       // requests per second over all connections; 0 = closed loop
+    double minRps = 0;     // fail below this throughput
+    double maxP99Ms = 0;   // fail above this corrected p99
+    double waitSeconds = 10;  // for the server to start accepting
+};
+
+struct BenchTotals {
+    LatencyHistogram latency;
+    uint64_t ok = 0;       // 2xx and 3xx
+    uint64_t failed = 0;   // 4xx and 5xx
+    uint64_t errors = 0;   // connect, read or parse errors
+    uint64_t reconnects = 0;
+    uint64_t bytes = 0;
+};
+
+struct BenchConn {
+    int fd = -1;
+    bool busy = false;     // a request is in flight
+    size_t written = 0;    // of the request
+    int64_t due = 0;       // open loop: when the next request is scheduled
+    int64_t sentAt = 0;
+    std::string in;
+    bool inBody = false;
+    size_t bodyLeft = 0;
+    int status = 0;
+    bool closeAfter = false;
+    unsigned generation = 0;  // bumped on every close, as fds are reused
+};
+
+}  // namespace
+
+static int connectTo(const struct addrinfo* addr) {
+    int fd = socket(addr->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, addr->ai_addr, addr->ai_addrlen) != 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// One thread's share of the connections until end
+static void benchThread(const BenchOptions& opt, const struct addrinfo* addr, const std::string& request,
+                        int first, int count, int64_t start, int64_t end, BenchTotals& totals) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<BenchConn> conns(count);
+    bool openLoop = opt.rate > 0;
+    int64_t interval = openLoop ? static_cast<int64_t>(1e9 * opt.connections / opt.rate) : 0;
+
+    auto attach = [&](BenchConn& c, size_t index) {
+        c.fd = connectTo(addr);
+        if (c.fd < 0) return false;
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &ev);
+        return true;
+    };
+    auto detach = [&](BenchConn& c) {
+        if (c.fd >= 0) close(c.fd);
+        c.fd = -1;
+        c.generation++;
+        c.busy = false;
+        c.in.clear();
+        c.inBody = false;
+        c.closeAfter = false;
+    };
+    auto write = [&](BenchConn& c) {
+        while (c.written < request.size()) {
+            ssize_t n = ::send(c.fd, request.data() + c.written, request.size() - c.written, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.written += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            return n < 0 && errno == EAGAIN;
+        }
+        return true;
+    };
+    auto issue = [&](BenchConn& c, size_t index, int64_t now) {
+        if (c.fd < 0) {
+            totals.reconnects++;
+            if (!attach(c, index)) {
+                totals.errors++;
+                return;
+            }
+        }
+        c.busy = true;
+        c.written = 0;
+        c.sentAt = now;
+        if (!write(c)) {
+            totals.errors++;
+            detach(c);
+        }
+    };
+
+    for (int i = 0; i < count; i++) {
+        if (!attach(conns[i], i)) totals.errors++;
+        // Spread the open-loop schedules evenly over one interval
+        conns[i].due = start + interval * (first + i) / opt.connections;
+    }
+    if (!openLoop) {
+        for (int i = 0; i < count; i++) issue(conns[i], i, nowNs());
+    }
+
+    // Parse what arrived on c; false if the connection is unusable
+    auto receive = [&](BenchConn& c, int64_t now, size_t index) -> bool {
+        while (true) {
+            if (!c.inBody) {
+                size_t headEnd = c.in.find("\r\n\r\n");
+                if (headEnd == std::string::npos) return c.in.size() < 64 * 1024;
+                if (c.in.compare(0, 5, "HTTP/") != 0 || c.in.size() < 12) return false;
+                c.status = atoi(c.in.c_str() + 9);
+                c.bodyLeft = 0;
+                c.closeAfter = c.in.compare(0, 8, "HTTP/1.0") == 0;
+                // Header names compared case-insensitively, line by line
+                size_t line = c.in.find("\r\n") + 2;
+                while (line < headEnd) {
+                    size_t next = c.in.find("\r\n", line);
+                    size_t colon = c.in.find(':', line);
+                    if (colon != std::string::npos && colon < next) {
+                        std::string name = c.in.substr(line, colon - line);
+                        for (auto& ch : name) ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+                        size_t value = c.in.find_first_not_of(" \t", colon + 1);
+                        std::string v = c.in.substr(value, next - value);
+                        for (auto& ch : v) ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+                        if (name == "content-length") c.bodyLeft = strtoull(v.c_str(), nullptr, 10);
+                        else if (name == "connection") c.closeAfter = v.find("close") != std::string::npos;
+                        else if (name == "transfer-encoding") return false;  // chunked is not supported
+                    }
+                    line = next + 2;
+                }
+                totals.bytes += headEnd + 4;
+                c.in.erase(0, headEnd + 4);
+                c.inBody = true;
+            }
+            size_t take = std::min(c.bodyLeft, c.in.size());
+            c.bodyLeft -= take;
+            c.in.erase(0, take);
+            totals.bytes += take;
+            if (c.bodyLeft > 0) return true;
+
+            // Complete: measure from when it was due, not when it went out
+            c.inBody = false;
+            c.busy = false;
+            if (now < end) {
+                totals.latency.record(static_cast<uint64_t>(now - (openLoop ? c.due : c.sentAt)));
+                if (c.status >= 200 && c.status < 400) totals.ok++;
+                else totals.failed++;
+            }
+            if (c.closeAfter) {
+                detach(c);
+                c.in.clear();
+            }
+            if (openLoop) {
+                c.due += interval;
+            } else if (now < end) {
+                issue(c, index, now);
+            }
+            if (c.in.empty() || c.fd < 0) return true;
+        }
+    };
+
+    std::vector<struct epoll_event> events(256);
+    std::vector<char> buffer(64 * 1024);
+    while (true) {
+        int64_t now = nowNs();
+        if (now >= end) break;
+        int64_t wake = end;
+        if (openLoop) {
+            for (int i = 0; i < count; i++) {
+                BenchConn& c = conns[i];
+                if (c.busy) continue;
+                if (c.due <= now) issue(c, i, now);
+                else wake = std::min(wake, c.due);
+            }
+        }
+        struct timespec timeout;
+        int64_t wait = std::max<int64_t>(0, wake - now);
+        timeout.tv_sec = wait / 1000000000;
+        timeout.tv_nsec = wait % 1000000000;
+        int n = epoll_pwait2(epollFd, events.data(), static_cast<int>(events.size()), &timeout, nullptr);
+        if (n < 0 && errno == ENOSYS)
+            n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), static_cast<int>((wait + 999999) / 1000000));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        now = nowNs();
+        for (int i = 0; i < n; i++) {
+            size_t index = events[i].data.u64;
+            BenchConn& c = conns[index];
+            if (c.fd < 0) continue;
+            bool alive = true;
+            if (c.busy && (events[i].events & EPOLLOUT)) alive = write(c);
+            if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                bool ended = false;
+                while (true) {
+                    ssize_t got = read(c.fd, buffer.data(), buffer.size());
+                    if (got > 0) {
+                        c.in.append(buffer.data(), got);
+                        continue;
+                    }
+                    if (got < 0 && errno == EINTR) continue;
+                    if (got == 0 || errno != EAGAIN) ended = true;
+                    break;
+                }
+                unsigned generation = c.generation;
+                alive = receive(c, now, index);
+                // A Connection: close response already reconnected
+                if (c.generation != generation) continue;
+                alive = alive && !ended;
+                // The server closing an idle connection is not an error
+                if (ended && !c.busy && c.in.empty()) {
+                    detach(c);
+                    if (!openLoop && now < end) issue(c, index, now);
+                    continue;
+                }
+            }
+            if (!alive && c.fd >= 0) {
+                totals.errors++;
+                detach(c);
+                if (!openLoop && now < end) issue(c, index, now);
+            }
+        }
+    }
+    for (auto& c : conns) {
+        if (c.fd >= 0) close(c.fd);
+    }
+    close(epollFd);
+}
+
+static std::string formatNs(double ns) {
+    char buf[32];
+    if (ns < 1e3) snprintf(buf, sizeof(buf), "%.0fns", ns);
+    else if (ns < 1e6) snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+    else if (ns < 1e9) snprintf(buf, sizeof(buf), "%.2fms", ns / 1e6);
+    else snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+    return buf;
+}
+
+static void printLatency(const char* label, const LatencyHistogram& h) {
+    printf("  %-10s %9s %9s %9s %9s %9s %9s\n", label, formatNs(h.mean()).c_str(),
+           formatNs(static_cast<double>(h.percentile(50))).c_str(),
+           formatNs(static_cast<double>(h.percentile(90))).c_str(),
+           formatNs(static_cast<double>(h.percentile(99))).c_str(),
+           formatNs(static_cast<double>(h.percentile(99.9))).c_str(),
+           formatNs(static_cast<double>(h.max())).c_str());
+}
+
+static int usage() {
+    std::cerr << "Usage: geneia --bench-http [options] http://host[:port]/path\n"
+                 "  -c N          connections (default 64)\n"
+                 "  -t N          threads (default: one per core, at most one per connection)\n"
+                 "  -d SECONDS    duration (default 10)\n"
+                 "  -R RATE       requests/s over all connections, open loop (default: as fast as possible)\n"
+                 "  -H 'Name: v'  extra request header (repeatable)\n"
+                 "  --wait S      wait up to S seconds for the server to accept (default 10)\n"
+                 "  --min-rps N   exit 1 if throughput is below N\n"
+                 "  --max-p99 MS  exit 1 if the corrected p99 latency is above MS milliseconds\n";
+    return 2;
+}
+
+static bool parseUrl(const std::string& url, BenchOptions& opt) {
+    std::string rest = url;
+    if (rest.compare(0, 7, "http://") == 0) rest.erase(0, 7);
+    else if (rest.find("://") != std::string::npos) return false;
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    opt.path = slash == std::string::npos ? "/" : rest.substr(slash);
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        opt.host = authority.substr(0, colon);
+        opt.port = authority.substr(colon + 1);
+    } else {
+        opt.host = authority;
+    }
+    return !opt.host.empty() && !opt.port.empty();
+}
+
+int gwsBenchMain(int argc, char** argv) {
+    BenchOptions opt;
+    std::string url;
+    for (int i = 0; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "-c" && hasValue) opt.connections = atoi(argv[++i]);
+        else if (a == "-t" && hasValue) opt.threads = atoi(argv[++i]);
+        else if (a == "-d" && hasValue) opt.seconds = atof(argv[++i]);
+        else if (a == "-R" && hasValue) opt.rate = atof(argv[++i]);
+        else if (a == "-H" && hasValue) opt.headers.push_back(argv[++i]);
+        else if (a == "--wait" && hasValue) opt.waitSeconds = atof(argv[++i]);
+        else if (a == "--min-rps" && hasValue) opt.minRps = atof(argv[++i]);
+        else if (a == "--max-p99" && hasValue) opt.maxP99Ms = atof(argv[++i]);
+        else if (a[0] != '-' && url.empty()) url = a;
+        else return usage();
+    }
+    if (url.empty() || !parseUrl(url, opt) || opt.connections <= 0 || opt.seconds <= 0) return usage();
+    if (opt.threads <= 0) opt.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    opt.threads = std::min(opt.threads, opt.connections);
+
+    struct addrinfo hints = {}, *addr = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(opt.host.c_str(), opt.port.c_str(), &hints, &addr) != 0 || !addr) {
+        std::cerr << "[bench] Cannot resolve " << opt.host << std::endl;
+        return 1;
+    }
+    // The server may still be starting (make bench launches it alongside)
+    int64_t giveUp = nowNs() + static_cast<int64_t>(opt.waitSeconds * 1e9);
+    while (true) {
+        int fd = connectTo(addr);
+        if (fd >= 0) {
+            close(fd);
+            break;
+        }
+        if (nowNs() >= giveUp) {
+            std::cerr << "[bench] Cannot connect to " << opt.host << ":" << opt.port << ": " << strerror(errno) << std::endl;
+            freeaddrinfo(addr);
+            return 1;
+        }
+        usleep(50000);
+    }
+
+    std::string request = "GET " + opt.path + " HTTP/1.1\r\nHost: " + opt.host + ":" + opt.port + "\r\n";
+    for (auto& h : opt.headers) request += h + "\r\n";
+    request += "\r\n";
+
+    signal(SIGPIPE, SIG_IGN);
+    printf("[bench] %s  %d connections, %d threads, %.1fs, ", url.c_str(), opt.connections, opt.threads, opt.seconds);
+    if (opt.rate > 0) printf("open loop at %.0f req/s\n", opt.rate);
+    else printf("closed loop (max throughput)\n");
+    fflush(stdout);
+
+    std::vector<BenchTotals> totals(opt.threads);
+    std::vector<std::thread> threads;
+    int64_t start = nowNs();
+    int64_t end = start + static_cast<int64_t>(opt.seconds * 1e9);
+    for (int t = 0; t < opt.threads; t++) {
+        int first = opt.connections * t / opt.threads;
+        int last = opt.connections * (t + 1) / opt.threads;
+        threads.emplace_back(benchThread, std::cref(opt), addr, std::cref(request), first, last - first, start, end,
+                             std::ref(totals[t]));
+    }
+    for (auto& t : threads) t.join();
+    freeaddrinfo(addr);
+
+    BenchTotals all;
+    for (auto& t : totals) {
+        all.latency.merge(t.latency);
+        all.ok += t.ok;
+        all.failed += t.failed;
+        all.errors += t.errors;
+        all.reconnects += t.reconnects;
+        all.bytes += t.bytes;
+    }
+    double elapsed = (nowNs() - start) / 1e9;
+    double rps = all.latency.count() / opt.seconds;
+    printf("  Requests:  %llu in %.2fs, %.0f req/s, %.2f MB/s\n", static_cast<unsigned long long>(all.latency.count()),
+           elapsed, rps, all.bytes / opt.seconds / 1e6);
+    printf("  Responses: %llu 2xx/3xx, %llu 4xx/5xx; %llu errors, %llu reconnects\n",
+           static_cast<unsigned long long>(all.ok), static_cast<unsigned long long>(all.failed),
+           static_cast<unsigned long long>(all.errors), static_cast<unsigned long long>(all.reconnects));
+    printf("  %-10s %9s %9s %9s %9s %9s %9s\n", "Latency", "mean", "p50", "p90", "p99", "p99.9", "max");
+    // Open-loop samples already count from the schedule. Closed loop
+    // assumes each connection meant to send once per mean latency.
+    LatencyHistogram corrected = opt.rate > 0 ? all.latency
+                                              : all.latency.corrected(static_cast<uint64_t>(all.latency.mean()));
+    if (opt.rate <= 0) printLatency("measured", all.latency);
+    printLatency("corrected", corrected);
+
+    int status = all.latency.count() == 0 ? 1 : 0;
+    if (opt.minRps > 0 && rps < opt.minRps) {
+        printf("[bench] FAIL: %.0f req/s is below --min-rps %.0f\n", rps, opt.minRps);
+        status = 1;
+    }
+    double p99Ms = corrected.percentile(99) / 1e6;
+    if (opt.maxP99Ms > 0 && p99Ms > opt.maxP99Ms) {
+        printf("[bench] FAIL: p99 %.2fms is above --max-p99 %.2fms\n", p99Ms, opt.maxP99Ms);
+        status = 1;
+    }
+    return status;
+}
@@ -0,0 +1,16 @@
+#ifndef GWS_BENCH_H
+#define GWS_BENCH_H
+
+// geneia --bench-http [options] URL
+//
+// HTTP/1.1 load generator for OpenGWS servers. N keep-alive connections
+// are spread over M threads, each with its own epoll loop. Without -R the
+// connections run closed-loop at full speed; with -R the requests follow
+// a fixed schedule (open loop) and latency is measured from when each
+// request was due, so a stalled server cannot hide its queueing delay.
+// Latencies go into a log-linear (HDR-style) histogram with about 1%
+// precision. Returns the process exit code, which is non-zero if the
+// --min-rps or --max-p99 thresholds are missed.
+int gwsBenchMain(int argc, char** argv);
+
+#endif
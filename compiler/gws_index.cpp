@@ -0,0 +1,242 @@
+#include "gws_index.h"
+#include "content_hash.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+static const char INDEX_MAGIC[8] = {'G', 'W', 'S', 'L', 'I', 'D', 'X', '1'};
+
+static char lower(char c) {
+    return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+
+static uint32_t trigramKey(const char* p) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(lower(p[0]))) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(lower(p[1]))) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(lower(p[2])));
+}
+
+template <typename T>
+static void appendTable(std::string& out, const std::vector<T>& table) {
+    out.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(T));
+}
+
+std::string GWSIndex::build(const std::vector<std::vector<GWSPackage>>& packages) {
+    std::vector<size_t> order(packages.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&packages](size_t a, size_t b) {
+        return packages[a].front().name < packages[b].front().name;
+    });
+
+    // Versions and dependency specs repeat across packages: store each once
+    std::string blob;
+    std::unordered_map<std::string, uint32_t> interned;
+    auto intern = [&blob, &interned](const std::string& s) {
+        auto it = interned.emplace(s, static_cast<uint32_t>(blob.size()));
+        if (it.second) blob += s;
+        return Text{it.first->second, static_cast<uint32_t>(s.size())};
+    };
+
+    std::vector<Package> packageTable;
+    std::vector<Version> versionTable;
+    std::vector<Text> dependTable;
+    std::vector<uint64_t> keys;  // trigram << 32 | package
+    packageTable.reserve(packages.size());
+    for (size_t i : order) {
+        const std::vector<GWSPackage>& versions = packages[i];
+        const GWSPackage& newest = versions.back();
+        uint32_t number = static_cast<uint32_t>(packageTable.size());
+        packageTable.push_back({intern(newest.name), intern(newest.description),
+                                static_cast<uint32_t>(versionTable.size()), static_cast<uint32_t>(versions.size())});
+        for (auto& v : versions) {
+            Version row = {intern(v.version), intern(v.tarball), static_cast<uint32_t>(dependTable.size()),
+                           static_cast<uint32_t>(v.depends.size()), {}};
+            for (size_t b = 0; b < sizeof(row.sha256) && 2 * b + 1 < v.sha256.size(); b++) {
+                row.sha256[b] = static_cast<uint8_t>(std::stoi(v.sha256.substr(2 * b, 2), nullptr, 16));
+            }
+            versionTable.push_back(row);
+            for (auto& d : v.depends) dependTable.push_back(intern(d));
+        }
+        for (const std::string* s : {&newest.name, &newest.description}) {
+            for (size_t k = 0; k + 3 <= s->size(); k++) {
+                keys.push_back(static_cast<uint64_t>(trigramKey(s->data() + k)) << 32 | number);
+            }
+        }
+    }
+
+    // Sorted, the keys group by trigram with each posting list ascending
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<Trigram> trigramTable;
+    std::vector<uint32_t> postingTable;
+    postingTable.reserve(keys.size());
+    for (uint64_t key : keys) {
+        uint32_t trigram = static_cast<uint32_t>(key >> 32);
+        if (trigramTable.empty() || trigramTable.back().key != trigram) {
+            trigramTable.push_back({trigram, static_cast<uint32_t>(postingTable.size()), 0});
+        }
+        trigramTable.back().postingCount++;
+        postingTable.push_back(static_cast<uint32_t>(key));
+    }
+
+    Header header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.packages = static_cast<uint32_t>(packageTable.size());
+    header.versions = static_cast<uint32_t>(versionTable.size());
+    header.depends = static_cast<uint32_t>(dependTable.size());
+    header.trigrams = static_cast<uint32_t>(trigramTable.size());
+    header.postings = static_cast<uint32_t>(postingTable.size());
+    header.strings = static_cast<uint32_t>(blob.size());
+    std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+    appendTable(out, packageTable);
+    appendTable(out, versionTable);
+    appendTable(out, dependTable);
+    appendTable(out, trigramTable);
+    appendTable(out, postingTable);
+    out += blob;
+    return out;
+}
+
+bool GWSIndex::open(const std::string& path) {
+    header = nullptr;
+    if (!file.open(path)) {
+        message = strerror(errno);
+        return false;
+    }
+    const char* data = file.data();
+    const Header* h = reinterpret_cast<const Header*>(data);
+    if (file.size() < sizeof(Header) || memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) != 0) {
+        message = "not a registry index";
+        file.close();
+        return false;
+    }
+    uint64_t expected = sizeof(Header) + static_cast<uint64_t>(h->packages) * sizeof(Package) +
+                        static_cast<uint64_t>(h->versions) * sizeof(Version) +
+                        static_cast<uint64_t>(h->depends) * sizeof(Text) +
+                        static_cast<uint64_t>(h->trigrams) * sizeof(Trigram) +
+                        static_cast<uint64_t>(h->postings) * sizeof(uint32_t) + h->strings;
+    if (expected != file.size()) {
+        message = "registry index is truncated";
+        file.close();
+        return false;
+    }
+    const char* p = data + sizeof(Header);
+    packageTable = reinterpret_cast<const Package*>(p);
+    p += h->packages * sizeof(Package);
+    versionTable = reinterpret_cast<const Version*>(p);
+    p += h->versions * sizeof(Version);
+    dependTable = reinterpret_cast<const Text*>(p);
+    p += h->depends * sizeof(Text);
+    trigramTable = reinterpret_cast<const Trigram*>(p);
+    p += h->trigrams * sizeof(Trigram);
+    postingTable = reinterpret_cast<const uint32_t*>(p);
+    p += h->postings * sizeof(uint32_t);
+    strings = p;
+    struct stat st;
+    builtAt = fstat(file.descriptor(), &st) == 0 ? st.st_mtim : timespec{};
+    header = h;
+    return true;
+}
+
+std::string GWSIndex::text(const Text& t) const {
+    if (static_cast<uint64_t>(t.offset) + t.size > header->strings) return std::string();
+    return std::string(strings + t.offset, t.size);
+}
+
+bool GWSIndex::contains(const Text& t, const std::string& lowered) const {
+    if (static_cast<uint64_t>(t.offset) + t.size > header->strings) return false;
+    const char* begin = strings + t.offset;
+    const char* end = begin + t.size;
+    return std::search(begin, end, lowered.begin(), lowered.end(),
+                       [](char a, char b) { return lower(a) == b; }) != end;
+}
+
+void GWSIndex::fill(const Package& p, uint32_t version, GWSPackage& package) const {
+    const Version& v = versionTable[version];
+    package.name = text(p.name);
+    package.description = text(p.description);
+    package.version = text(v.version);
+    package.tarball = text(v.tarball);
+    package.sha256 = hashHex(v.sha256, sizeof(v.sha256));
+    package.depends.clear();
+    if (static_cast<uint64_t>(v.firstDepend) + v.dependCount > header->depends) return;
+    for (uint32_t d = 0; d < v.dependCount; d++) package.depends.push_back(text(dependTable[v.firstDepend + d]));
+}
+
+bool GWSIndex::find(const std::string& name, const std::string& version, GWSPackage& package) const {
+    if (!header) return false;
+    const Package* end = packageTable + header->packages;
+    const Package* p = std::lower_bound(packageTable, end, name, [this](const Package& a, const std::string& b) {
+        if (static_cast<uint64_t>(a.name.offset) + a.name.size > header->strings) return true;
+        return b.compare(0, std::string::npos, strings + a.name.offset, a.name.size) > 0;
+    });
+    if (p == end || text(p->name) != name) return false;
+    if (p->versionCount == 0 || static_cast<uint64_t>(p->firstVersion) + p->versionCount > header->versions) {
+        return false;
+    }
+    for (uint32_t v = p->firstVersion + p->versionCount; v-- > p->firstVersion;) {
+        if (version.empty() || text(versionTable[v].version) == version) {
+            fill(*p, v, package);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t GWSIndex::search(const std::string& query, size_t limit, std::vector<GWSPackage>& matches) const {
+    matches.clear();
+    if (!header) return 0;
+    std::string lowered;
+    for (char c : query) lowered += lower(c);
+
+    size_t total = 0;
+    auto consider = [&](uint32_t number) {
+        const Package& p = packageTable[number];
+        if (!contains(p.name, lowered) && !contains(p.description, lowered)) return;
+        if (p.versionCount == 0 || static_cast<uint64_t>(p.firstVersion) + p.versionCount > header->versions) return;
+        total++;
+        if (matches.size() < limit) {
+            matches.emplace_back();
+            fill(p, p.firstVersion + p.versionCount - 1, matches.back());
+        }
+    };
+    // Too short for a trigram: check every package
+    if (lowered.size() < 3) {
+        for (uint32_t i = 0; i < header->packages; i++) consider(i);
+        return total;
+    }
+
+    // Every trigram of the query occurs in a match, so intersecting their
+    // posting lists (rarest first) leaves few candidates to check
+    const Trigram* trigramEnd = trigramTable + header->trigrams;
+    std::vector<const Trigram*> lists;
+    for (size_t k = 0; k + 3 <= lowered.size(); k++) {
+        uint32_t key = trigramKey(lowered.data() + k);
+        const Trigram* t = std::lower_bound(trigramTable, trigramEnd, key,
+                                            [](const Trigram& a, uint32_t b) { return a.key < b; });
+        if (t == trigramEnd || t->key != key) return 0;
+        if (static_cast<uint64_t>(t->firstPosting) + t->postingCount > header->postings) return 0;
+        lists.push_back(t);
+    }
+    std::sort(lists.begin(), lists.end());
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    std::sort(lists.begin(), lists.end(),
+              [](const Trigram* a, const Trigram* b) { return a->postingCount < b->postingCount; });
+
+    const uint32_t* first = postingTable + lists[0]->firstPosting;
+    std::vector<uint32_t> candidates(first, first + lists[0]->postingCount);
+    for (size_t l = 1; l < lists.size() && !candidates.empty(); l++) {
+        const uint32_t* begin = postingTable + lists[l]->firstPosting;
+        const uint32_t* end = begin + lists[l]->postingCount;
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [begin, end](uint32_t c) { return !std::binary_search(begin, end, c); }),
+                         candidates.end());
+    }
+    for (uint32_t c : candidates) {
+        if (c < header->packages) consider(c);
+    }
+    return total;
+}
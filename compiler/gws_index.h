@@ -0,0 +1,90 @@
+#ifndef GWS_INDEX_H
+#define GWS_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "mapped_file.h"
+
+// One version of a package, as the registry lists it
+struct GWSPackage {
+    std::string name;
+    std::string version;
+    std::string sha256;   // of the tarball
+    std::string tarball;  // file name in the package's registry directory
+    std::vector<std::string> depends;  // "name" (newest) or "name@version"
+    std::string description;
+};
+
+// A registry's packages in one file that is mapped and read in place, so
+// looking a package up or searching 100k of them parses nothing.
+//
+// After the header come fixed-size tables, each 4-byte aligned: packages
+// sorted by name, their versions oldest first, the versions' dependencies,
+// trigrams of the lowercased names and descriptions sorted by key, the
+// trigrams' posting lists (package numbers, ascending) and the strings the
+// tables point into. Integers are in host byte order: the index is a cache
+// in the store and never leaves the machine.
+class GWSIndex {
+public:
+    // The index file's bytes; each element is one package's versions, oldest
+    // first, in any package order
+    static std::string build(const std::vector<std::vector<GWSPackage>>& packages);
+
+    // False with error() set if path is missing or not an index
+    bool open(const std::string& path);
+    bool isOpen() const { return header != nullptr; }
+    // The index file's mtime: when the registry was read for it
+    const struct timespec& built() const { return builtAt; }
+    size_t size() const { return header ? header->packages : 0; }
+    const std::string& error() const { return message; }
+
+    // name's newest version, or the one given
+    bool find(const std::string& name, const std::string& version, GWSPackage& package) const;
+    // Packages whose name or description contains query, ignoring case, in
+    // name order with their newest version; fills at most limit of them
+    // and returns how many there are
+    size_t search(const std::string& query, size_t limit, std::vector<GWSPackage>& matches) const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t packages, versions, depends, trigrams, postings, strings;
+    };
+    struct Text {
+        uint32_t offset, size;
+    };
+    struct Package {
+        Text name, description;
+        uint32_t firstVersion, versionCount;
+    };
+    struct Version {
+        Text version, tarball;
+        uint32_t firstDepend, dependCount;
+        uint8_t sha256[32];
+    };
+    struct Trigram {
+        uint32_t key;  // three lowercased bytes
+        uint32_t firstPosting, postingCount;
+    };
+
+    MappedFile file;
+    const Header* header = nullptr;
+    const Package* packageTable = nullptr;
+    const Version* versionTable = nullptr;
+    const Text* dependTable = nullptr;
+    const Trigram* trigramTable = nullptr;
+    const uint32_t* postingTable = nullptr;
+    const char* strings = nullptr;
+    struct timespec builtAt = {};
+    std::string message;
+
+    // Empty if t points outside the strings
+    std::string text(const Text& t) const;
+    bool contains(const Text& t, const std::string& lowered) const;
+    void fill(const Package& p, uint32_t version, GWSPackage& package) const;
+};
+
+#endif
@@ -0,0 +1,754 @@
+#include "gws_packages.h"
+#include "content_hash.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef GWS_ZLIB
+#include <zlib.h>
+#endif
+
+static bool readWholeFile(const std::string& path, std::string& data) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+// Through a temp file and rename, so nothing ever sees half a file
+static bool writeWholeFile(const std::string& path, const std::string& data, mode_t mode = 0644) {
+    std::string tmp = path + ".tmp" + std::to_string(getpid()) + "_" +
+                      std::to_string(reinterpret_cast<uintptr_t>(&data));
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd < 0) return false;
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<size_t>(n);
+    }
+    bool ok = close(fd) == 0 && done == data.size();
+    if (ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+    if (!ok) unlink(tmp.c_str());
+    return ok;
+}
+
+static bool makeDirs(const std::string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string part = path.substr(0, slash);
+        if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == std::string::npos) return true;
+    }
+}
+
+static bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Whether no file under dir (but the .gwsl-package marker) was modified
+// after stamp
+static bool unchangedSince(const std::string& dir, const struct timespec& stamp) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    bool ok = true;
+    struct dirent* ent;
+    while (ok && (ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0 || strcmp(ent->d_name, ".gwsl-package") == 0) {
+            continue;
+        }
+        std::string path = dir + "/" + ent->d_name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0) ok = false;
+        else if (S_ISDIR(st.st_mode)) ok = unchangedSince(path, stamp);
+        else ok = st.st_mtim.tv_sec < stamp.tv_sec ||
+                  (st.st_mtim.tv_sec == stamp.tv_sec && st.st_mtim.tv_nsec <= stamp.tv_nsec);
+    }
+    closedir(d);
+    return ok;
+}
+
+static bool removeTree(const std::string& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) return errno == ENOENT;
+    if (!S_ISDIR(st.st_mode)) return unlink(path.c_str()) == 0;
+    DIR* d = opendir(path.c_str());
+    if (!d) return false;
+    bool ok = true;
+    struct dirent* ent;
+    while ((ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        if (!removeTree(path + "/" + ent->d_name)) ok = false;
+    }
+    closedir(d);
+    return rmdir(path.c_str()) == 0 && ok;
+}
+
+// Package names become directory names
+static bool validName(const std::string& name) {
+    if (name.empty() || name[0] == '.' || name.size() > 214) return false;
+    for (char c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') return false;
+    }
+    return true;
+}
+
+static bool validHash(const std::string& hash) {
+    if (hash.size() != 64) return false;
+    for (char c : hash) {
+        if (!isxdigit(static_cast<unsigned char>(c)) || isupper(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+// Dotted versions compare part by part, numerically where both are numbers
+static int compareVersions(const std::string& a, const std::string& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        size_t ie = a.find_first_of(".-", i), je = b.find_first_of(".-", j);
+        if (ie == std::string::npos) ie = a.size();
+        if (je == std::string::npos) je = b.size();
+        std::string x = i < a.size() ? a.substr(i, ie - i) : "0";
+        std::string y = j < b.size() ? b.substr(j, je - j) : "0";
+        bool numbers = !x.empty() && !y.empty() && std::all_of(x.begin(), x.end(), ::isdigit) &&
+                       std::all_of(y.begin(), y.end(), ::isdigit);
+        int c;
+        if (numbers) {
+            x.erase(0, std::min(x.find_first_not_of('0'), x.size() - 1));
+            y.erase(0, std::min(y.find_first_not_of('0'), y.size() - 1));
+            c = x.size() != y.size() ? (x.size() < y.size() ? -1 : 1) : x.compare(y);
+        } else {
+            c = x.compare(y);
+        }
+        if (c != 0) return c < 0 ? -1 : 1;
+        i = ie + 1;
+        j = je + 1;
+    }
+    return 0;
+}
+
+static void splitSpec(const std::string& spec, std::string& name, std::string& version) {
+    size_t at = spec.find('@', 1);
+    name = spec.substr(0, at);
+    version = at == std::string::npos ? "" : spec.substr(at + 1);
+}
+
+#ifdef GWS_ZLIB
+static bool gunzip(const std::string& in, std::string& out) {
+    z_stream zs = {};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return false;
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    char buffer[64 * 1024];
+    int result;
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buffer);
+        zs.avail_out = sizeof(buffer);
+        result = inflate(&zs, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END) break;
+        out.append(buffer, sizeof(buffer) - zs.avail_out);
+    } while (result != Z_STREAM_END);
+    inflateEnd(&zs);
+    return result == Z_STREAM_END;
+}
+#endif
+
+static size_t tarNumber(const char* field, size_t size) {
+    size_t value = 0;
+    for (size_t i = 0; i < size && field[i]; i++) {
+        if (field[i] == ' ') continue;
+        if (field[i] < '0' || field[i] > '7') break;
+        value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+// A member path that stays inside the tree, without a leading "./"; ""
+// for the top directory itself
+static bool safeMemberPath(std::string& path) {
+    while (path.compare(0, 2, "./") == 0) path.erase(0, 2);
+    if (path == ".") path.clear();
+    while (!path.empty() && path.back() == '/') path.pop_back();
+    if (path.empty()) return true;
+    if (path[0] == '/') return false;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+        if (path.compare(start, end - start, "..") == 0 && end - start == 2) return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+// Unpack a tar archive (ustar, with GNU long names and pax paths) below
+// dir. Only directories and regular files are created; links are skipped.
+// Files keep their mtimes, but none is made later than newest.
+static bool untar(const std::string& data, const std::string& dir, time_t newest, std::string& error) {
+    size_t pos = 0;
+    std::string longName;
+    while (pos + 512 <= data.size()) {
+        const char* h = data.data() + pos;
+        if (std::all_of(h, h + 512, [](char c) { return c == 0; })) return true;
+        unsigned sum = 0;
+        for (int i = 0; i < 512; i++) sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(h[i]);
+        if (sum != tarNumber(h + 148, 8)) {
+            error = "corrupt tar header";
+            return false;
+        }
+        size_t size = tarNumber(h + 124, 12);
+        char type = h[156];
+        size_t dataPos = pos + 512;
+        pos = dataPos + (size + 511) / 512 * 512;
+        if (dataPos + size > data.size()) {
+            error = "truncated tarball";
+            return false;
+        }
+        if (type == 'L' || type == 'x') {
+            if (type == 'L') {
+                longName.assign(data, dataPos, size);
+                longName.resize(strnlen(longName.c_str(), longName.size()));
+            } else {
+                // pax records: "<length> <key>=<value>\n"
+                size_t r = dataPos, end = dataPos + size;
+                while (r < end) {
+                    size_t length = 0, p = r;
+                    while (p < end && isdigit(static_cast<unsigned char>(data[p]))) length = length * 10 + (data[p++] - '0');
+                    if (length == 0 || r + length > end) break;
+                    std::string record = data.substr(p + 1, r + length - p - 2);
+                    if (record.compare(0, 5, "path=") == 0) longName = record.substr(5);
+                    r += length;
+                }
+            }
+            continue;
+        }
+        std::string name;
+        if (!longName.empty()) {
+            name.swap(longName);
+        } else {
+            name.assign(h, strnlen(h, 100));
+            if (memcmp(h + 257, "ustar", 5) == 0 && h[345]) name = std::string(h + 345, strnlen(h + 345, 155)) + "/" + name;
+        }
+        if (type == 'g') continue;
+        if (!safeMemberPath(name)) {
+            error = "unsafe path in tarball: " + name;
+            return false;
+        }
+        if (name.empty()) continue;
+        std::string path = dir + "/" + name;
+        // Read-only: project files are hard links to these, and an edit
+        // through one would change the package for every project
+        mode_t mode = static_cast<mode_t>(tarNumber(h + 100, 8) & 0555) | 0444;
+        if (type == '5') {
+            if (!makeDirs(path)) {
+                error = "cannot create " + path + ": " + strerror(errno);
+                return false;
+            }
+        } else if (type == '0' || type == '\0' || type == '7') {
+            size_t slash = path.rfind('/');
+            if (!makeDirs(path.substr(0, slash)) || !writeWholeFile(path, data.substr(dataPos, size), mode)) {
+                error = "cannot write " + path + ": " + strerror(errno);
+                return false;
+            }
+            struct timespec times[2] = {};
+            times[0].tv_sec = times[1].tv_sec = std::min<time_t>(static_cast<time_t>(tarNumber(h + 136, 12)), newest);
+            utimensat(AT_FDCWD, path.c_str(), times, 0);
+        }
+    }
+    error = "truncated tarball";
+    return false;
+}
+
+// Hard-link every file of tree into dir, copying where links fail (the
+// store on another file system)
+static bool linkTree(const std::string& tree, const std::string& dir, std::string& error) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        error = "cannot create " + dir + ": " + strerror(errno);
+        return false;
+    }
+    DIR* d = opendir(tree.c_str());
+    if (!d) {
+        error = "cannot read " + tree + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = true;
+    struct dirent* ent;
+    while (ok && (ent = readdir(d)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        std::string from = tree + "/" + ent->d_name, to = dir + "/" + ent->d_name;
+        if (isDirectory(from)) {
+            ok = linkTree(from, to, error);
+        } else if (link(from.c_str(), to.c_str()) != 0) {
+            std::string data;
+            struct stat st;
+            ok = stat(from.c_str(), &st) == 0 && readWholeFile(from, data) && writeWholeFile(to, data, st.st_mode & 0777);
+            if (!ok) error = "cannot install " + to + ": " + strerror(errno);
+            struct timespec times[2] = {st.st_atim, st.st_mtim};
+            if (ok) utimensat(AT_FDCWD, to.c_str(), times, 0);
+        }
+    }
+    closedir(d);
+    return ok;
+}
+
+GWSPackages::GWSPackages(const std::string& registry, const std::string& store, const std::string& root)
+    : storeDir(store), rootDir(root) {
+    if (registry.compare(0, 7, "file://") == 0) registryDir = registry.substr(7);
+    else if (registry.find("://") == std::string::npos) registryDir = registry;
+    while (registryDir.size() > 1 && registryDir.back() == '/') registryDir.pop_back();
+    if (registry.empty()) {
+        message = "no registry set (.GWS.registry or GWSL_REGISTRY)";
+    } else if (registryDir.empty()) {
+        message = "registry " + registry + " is not local; use a directory or file:// mirror "
+                  "(.GWS.registry or GWSL_REGISTRY)";
+    }
+    if (!registryDir.empty()) registryIndex.open(indexPath());  // none until the first update
+}
+
+// One index per registry directory, named by its canonical path
+std::string GWSPackages::indexPath() const {
+    char* real = realpath(registryDir.c_str(), nullptr);
+    std::string key = real ? real : registryDir;
+    free(real);
+    return storeDir + "/indexes/" + sha256Hex(key).substr(0, 16);
+}
+
+std::string GWSPackages::defaultStore() {
+    if (const char* store = getenv("GWSL_STORE")) return store;
+    const char* home = getenv("HOME");
+    return std::string(home ? home : ".") + "/.gwsl/store";
+}
+
+// Every version of name the registry lists, oldest first, with the
+// description; false if it has no meta file
+static bool readMeta(const std::string& registry, const std::string& name, std::vector<GWSPackage>& versions) {
+    versions.clear();
+    std::ifstream meta(registry + "/" + name + "/meta");
+    if (!meta.is_open()) return false;
+    std::string description, line;
+    while (std::getline(meta, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "description") {
+            std::getline(fields >> std::ws, description);
+        } else if (key == "version") {
+            GWSPackage p;
+            p.name = name;
+            fields >> p.version >> p.sha256 >> p.tarball;
+            if (!validHash(p.sha256) || p.tarball.empty() || p.tarball.find('/') != std::string::npos) continue;
+            std::string dep;
+            while (fields >> dep) p.depends.push_back(dep);
+            versions.push_back(p);
+        }
+    }
+    for (auto& p : versions) p.description = description;
+    std::stable_sort(versions.begin(), versions.end(), [](const GWSPackage& a, const GWSPackage& b) {
+        return compareVersions(a.version, b.version) < 0;
+    });
+    return true;
+}
+
+// The index answers for name unless its meta file changed since the index
+// was built (new versions, or a package added since the last update)
+bool GWSPackages::indexCurrent(const std::string& name) const {
+    struct stat st;
+    if (!registryIndex.isOpen() || stat((registryDir + "/" + name + "/meta").c_str(), &st) != 0) return false;
+    const struct timespec& built = registryIndex.built();
+    return st.st_mtim.tv_sec < built.tv_sec || (st.st_mtim.tv_sec == built.tv_sec && st.st_mtim.tv_nsec < built.tv_nsec);
+}
+
+bool GWSPackages::find(const std::string& spec, GWSPackage& package) {
+    std::string name, version;
+    splitSpec(spec, name, version);
+    if (registryDir.empty()) return false;  // message says why
+    if (!validName(name)) {
+        message = "invalid package name '" + name + "'";
+        return false;
+    }
+    if (indexCurrent(name) && registryIndex.find(name, version, package)) return true;
+    std::vector<GWSPackage> versions;
+    if (!readMeta(registryDir, name, versions)) {
+        message = "package '" + name + "' is not in the registry";
+        return false;
+    }
+    auto it = versions.end();
+    if (version.empty()) {
+        if (!versions.empty()) it = versions.end() - 1;
+    } else {
+        it = std::find_if(versions.begin(), versions.end(), [&version](const GWSPackage& p) { return p.version == version; });
+    }
+    if (it == versions.end()) {
+        message = "package '" + name + "' has no " + (version.empty() ? "versions" : "version " + version);
+        return false;
+    }
+    package = *it;
+    return true;
+}
+
+bool GWSPackages::update(std::ostream& log) {
+    auto started = std::chrono::steady_clock::now();
+    if (registryDir.empty()) return false;
+    // The index gets this as its mtime, so a meta file edited while it is
+    // being built still counts as newer
+    struct timespec scanned;
+    clock_gettime(CLOCK_REALTIME, &scanned);
+    std::vector<std::string> names;
+    DIR* dir = opendir(registryDir.c_str());
+    if (!dir) {
+        message = "cannot read the registry " + registryDir + ": " + strerror(errno);
+        return false;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (validName(entry->d_name)) names.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    // Meta files are parsed in chunks on the pool; entries without one
+    // (stray files) come back empty and are left out
+    std::vector<std::vector<GWSPackage>> packages(names.size());
+    ThreadPool& pool = ThreadPool::shared();
+    ThreadPool::Group group;
+    const size_t chunk = 256;
+    for (size_t first = 0; first < names.size(); first += chunk) {
+        pool.submit(group, [this, &names, &packages, first, chunk] {
+            size_t last = std::min(names.size(), first + chunk);
+            for (size_t i = first; i < last; i++) readMeta(registryDir, names[i], packages[i]);
+        });
+    }
+    pool.wait(group);
+    packages.erase(std::remove_if(packages.begin(), packages.end(),
+                                  [](const std::vector<GWSPackage>& v) { return v.empty(); }),
+                   packages.end());
+
+    std::string path = indexPath();
+    if (!makeDirs(storeDir + "/indexes") || !writeWholeFile(path, GWSIndex::build(packages))) {
+        message = "cannot write " + path + ": " + strerror(errno);
+        return false;
+    }
+    struct timespec times[2] = {scanned, scanned};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+    if (!registryIndex.open(path)) {
+        message = "cannot read " + path + ": " + registryIndex.error();
+        return false;
+    }
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log << "[gwsl-get] Indexed " << registryIndex.size() << " packages from " << registryDir << " in "
+        << took.count() << "ms" << std::endl;
+    return true;
+}
+
+bool GWSPackages::search(const std::string& query, std::ostream& log) {
+    if (registryDir.empty()) return false;
+    if (!registryIndex.isOpen() && !update(log)) return false;
+    const size_t shown = 50;
+    std::vector<GWSPackage> matches;
+    auto started = std::chrono::steady_clock::now();
+    size_t total = registryIndex.search(query, shown, matches);
+    auto took = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    std::vector<GWSPackage> versions;
+    for (auto& p : matches) {
+        if (!indexCurrent(p.name) && readMeta(registryDir, p.name, versions) && !versions.empty()) p = versions.back();
+        log << "  - " << p.name << " " << p.version << (p.description.empty() ? "" : " : " + p.description) << "\n";
+    }
+    if (total > matches.size()) log << "  ... " << total - matches.size() << " more\n";
+    log << "[gwsl-get] " << total << " of " << registryIndex.size() << " packages match '" << query << "' ("
+        << took.count() << "us)" << std::endl;
+    return true;
+}
+
+std::vector<GWSLocked> GWSPackages::installed() const {
+    std::vector<GWSLocked> entries;
+    std::ifstream lock(lockPath());
+    std::string line;
+    while (std::getline(lock, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        GWSLocked e;
+        if (fields >> e.name >> e.version >> e.sha256 && validName(e.name) && validHash(e.sha256)) entries.push_back(e);
+    }
+    std::sort(entries.begin(), entries.end(), [](const GWSLocked& a, const GWSLocked& b) { return a.name < b.name; });
+    return entries;
+}
+
+bool GWSPackages::writeLock(const std::vector<GWSLocked>& entries) {
+    std::string text = "# gwsl.lock - written by gwsl-get: name version sha256\n";
+    for (auto& e : entries) text += e.name + " " + e.version + " " + e.sha256 + "\n";
+    if (!writeWholeFile(lockPath(), text)) {
+        message = "cannot write " + lockPath() + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool GWSPackages::fetch(const GWSPackage& package, bool& fetched, std::string& error) const {
+    std::string object = storeDir + "/tarballs/" + package.sha256;
+    std::string tree = storeDir + "/trees/" + package.sha256;
+    std::string data;
+    fetched = false;
+    if (sha256File(object) != package.sha256) {
+        std::string source = registryDir + "/" + package.name + "/" + package.tarball;
+        if (!readWholeFile(source, data)) {
+            error = "cannot read " + source;
+            return false;
+        }
+        if (sha256Hex(data) != package.sha256) {
+            error = "checksum mismatch for " + package.tarball;
+            return false;
+        }
+        if (!writeWholeFile(object, data, 0444)) {
+            error = "cannot write " + object + ": " + strerror(errno);
+            return false;
+        }
+        fetched = true;
+    }
+    // Tree files are never newer than the tarball, unless edited through
+    // a project's hard link; such a tree is extracted again
+    struct stat st;
+    if (stat(object.c_str(), &st) != 0) {
+        error = "cannot read " + object + ": " + strerror(errno);
+        return false;
+    }
+    if (isDirectory(tree)) {
+        if (unchangedSince(tree, st.st_mtim)) return true;
+        if (!removeTree(tree)) {
+            error = "cannot replace modified " + tree + ": " + strerror(errno);
+            return false;
+        }
+    }
+
+    if (data.empty() && !readWholeFile(object, data)) {
+        error = "cannot read " + object;
+        return false;
+    }
+    if (data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b) {
+#ifdef GWS_ZLIB
+        std::string unpacked;
+        if (!gunzip(data, unpacked)) {
+            error = "corrupt gzip data in " + package.tarball;
+            return false;
+        }
+        data.swap(unpacked);
+#else
+        error = package.tarball + " is gzipped, and this build has no zlib";
+        return false;
+#endif
+    }
+    // Extract beside the tree and rename, so a tree that exists is complete
+    std::string temp = tree + ".tmp" + std::to_string(getpid()) + "_" +
+                       std::to_string(reinterpret_cast<uintptr_t>(&package));
+    if (!makeDirs(temp) || !untar(data, temp, st.st_mtim.tv_sec, error)) {
+        if (error.empty()) error = "cannot create " + temp + ": " + strerror(errno);
+        removeTree(temp);
+        return false;
+    }
+    if (rename(temp.c_str(), tree.c_str()) != 0) {
+        removeTree(temp);  // another install finished it first
+        if (!isDirectory(tree)) {
+            error = "cannot create " + tree + ": " + strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GWSPackages::link(const GWSPackage& package, std::string& error) const {
+    std::string dir = modulePath(package.name);
+    if (!removeTree(dir)) {
+        error = "cannot replace " + dir + ": " + strerror(errno);
+        return false;
+    }
+    if (!linkTree(storeDir + "/trees/" + package.sha256, dir, error)) return false;
+    // Written last: its presence says the install is whole
+    if (!writeWholeFile(dir + "/.gwsl-package", package.name + " " + package.version + " " + package.sha256 + "\n")) {
+        error = "cannot write " + dir + "/.gwsl-package: " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool GWSPackages::intact(const GWSLocked& entry) const {
+    std::string marker, object = storeDir + "/tarballs/" + entry.sha256;
+    struct stat st;
+    return readWholeFile(modulePath(entry.name) + "/.gwsl-package", marker) &&
+           marker == entry.name + " " + entry.version + " " + entry.sha256 + "\n" &&
+           sha256File(object) == entry.sha256 && stat(object.c_str(), &st) == 0 &&
+           unchangedSince(modulePath(entry.name), st.st_mtim);
+}
+
+bool GWSPackages::install(const std::vector<std::string>& specs, std::ostream& log) {
+    auto started = std::chrono::steady_clock::now();
+    if (registryDir.empty()) return false;
+    ThreadPool& pool = ThreadPool::shared();
+    std::vector<GWSLocked> lock = installed();
+    std::map<std::string, GWSLocked> locked;
+    for (auto& e : lock) locked[e.name] = e;
+
+    std::vector<std::string> wanted = specs;
+    if (wanted.empty()) {
+        for (auto& e : lock) wanted.push_back(e.name + "@" + e.version);
+        if (wanted.empty()) {
+            log << "[gwsl-get] Nothing to install: gwsl.lock lists no packages" << std::endl;
+            return true;
+        }
+    }
+
+    // Everything asked for is locked already: only check the hashes
+    bool covered = true;
+    for (auto& spec : wanted) {
+        std::string name, version;
+        splitSpec(spec, name, version);
+        auto it = locked.find(name);
+        if (it == locked.end() || (!version.empty() && it->second.version != version)) covered = false;
+    }
+    if (covered) {
+        std::unique_ptr<bool[]> good(new bool[lock.size()]);
+        ThreadPool::Group group;
+        for (size_t i = 0; i < lock.size(); i++) {
+            pool.submit(group, [this, &lock, &good, i] { good[i] = intact(lock[i]); });
+        }
+        pool.wait(group);
+        if (std::all_of(good.get(), good.get() + lock.size(), [](bool b) { return b; })) {
+            log << "[gwsl-get] Up to date: " << lock.size() << " packages match gwsl.lock" << std::endl;
+            return true;
+        }
+    }
+
+    // Resolve breadth first; a locked package keeps its version unless
+    // a spec names another one
+    std::vector<GWSPackage> chosen;
+    std::map<std::string, size_t> index;
+    std::vector<std::string> queue = wanted;
+    for (size_t q = 0; q < queue.size(); q++) {
+        std::string name, version;
+        splitSpec(queue[q], name, version);
+        auto seen = index.find(name);
+        if (seen != index.end()) {
+            if (!version.empty() && chosen[seen->second].version != version) {
+                message = "conflicting versions of " + name + ": " + chosen[seen->second].version + " and " + version;
+                return false;
+            }
+            continue;
+        }
+        auto pin = locked.find(name);
+        bool pinned = version.empty() && pin != locked.end();
+        GWSPackage package;
+        if (!find(pinned ? name + "@" + pin->second.version : queue[q], package)) return false;
+        if (pinned && package.sha256 != pin->second.sha256) {
+            message = name + " " + package.version + " differs from gwsl.lock (the registry's tarball changed)";
+            return false;
+        }
+        index[name] = chosen.size();
+        chosen.push_back(package);
+        for (auto& dep : package.depends) queue.push_back(dep);
+    }
+
+    if (!makeDirs(storeDir + "/tarballs") || !makeDirs(storeDir + "/trees") || !makeDirs(rootDir + "/gwsl_modules")) {
+        message = std::string("cannot create the store or gwsl_modules: ") + strerror(errno);
+        return false;
+    }
+    // Packages are independent of each other: fetch, verify, extract and
+    // link each one as its own task
+    std::vector<std::string> errors(chosen.size());
+    std::unique_ptr<bool[]> fetched(new bool[chosen.size()]());
+    ThreadPool::Group group;
+    for (size_t i = 0; i < chosen.size(); i++) {
+        pool.submit(group, [this, &chosen, &errors, &fetched, i] {
+            if (fetch(chosen[i], fetched[i], errors[i])) link(chosen[i], errors[i]);
+        });
+    }
+    pool.wait(group);
+
+    size_t fromRegistry = 0;
+    bool ok = true;
+    for (size_t i = 0; i < chosen.size(); i++) {
+        const GWSPackage& p = chosen[i];
+        if (!errors[i].empty()) {
+            log << "[gwsl-get] Failed: " << p.name << " " << p.version << ": " << errors[i] << std::endl;
+            if (ok) message = p.name + ": " + errors[i];
+            ok = false;
+            continue;
+        }
+        if (fetched[i]) fromRegistry++;
+        locked[p.name] = {p.name, p.version, p.sha256};
+        log << "[gwsl-get] Installed " << p.name << " " << p.version << (fetched[i] ? "" : " (from the store)")
+            << std::endl;
+    }
+    lock.clear();
+    for (auto& e : locked) lock.push_back(e.second);
+    if (!writeLock(lock)) return false;
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log << "[gwsl-get] " << chosen.size() << " packages, " << fromRegistry << " fetched, in " << took.count() << "ms"
+        << std::endl;
+    return ok;
+}
+
+bool GWSPackages::remove(const std::string& name, std::ostream& log) {
+    std::vector<GWSLocked> lock = installed();
+    auto it = std::find_if(lock.begin(), lock.end(), [&name](const GWSLocked& e) { return e.name == name; });
+    if (it == lock.end() || !validName(name)) {
+        message = "package '" + name + "' is not installed";
+        return false;
+    }
+    if (!removeTree(modulePath(name))) {
+        message = "cannot remove " + modulePath(name) + ": " + strerror(errno);
+        return false;
+    }
+    lock.erase(it);
+    if (!writeLock(lock)) return false;
+    log << "[gwsl-get] Removed: " << name << std::endl;
+    return true;
+}
+
+static int usage() {
+    std::cerr << "Usage: geneia --gwsl-get install [package[@version]...]\n"
+                 "       geneia --gwsl-get remove <package>\n"
+                 "       geneia --gwsl-get list\n"
+                 "       geneia --gwsl-get update\n"
+                 "       geneia --gwsl-get search <text>\n"
+                 "The registry is $GWSL_REGISTRY (a directory or file:// URL), the store\n"
+                 "$GWSL_STORE or ~/.gwsl/store; packages go to ./gwsl_modules." << std::endl;
+    return 2;
+}
+
+int gwslGetMain(int argc, char** argv) {
+    if (argc < 1) return usage();
+    std::string command = argv[0];
+    std::vector<std::string> operands(argv + 1, argv + argc);
+    const char* registry = getenv("GWSL_REGISTRY");
+    GWSPackages packages(registry ? registry : "", GWSPackages::defaultStore());
+    bool ok;
+    if (command == "install") {
+        ok = packages.install(operands, std::cout);
+    } else if (command == "remove" && operands.size() == 1) {
+        ok = packages.remove(operands[0], std::cout);
+    } else if (command == "update" && operands.empty()) {
+        ok = packages.update(std::cout);
+    } else if (command == "search" && operands.size() == 1) {
+        ok = packages.search(operands[0], std::cout);
+    } else if (command == "list" && operands.empty()) {
+        for (auto& e : packages.installed()) std::cout << e.name << " " << e.version << std::endl;
+        return 0;
+    } else {
+        return usage();
+    }
+    if (!ok) std::cerr << "[gwsl-get] " << packages.error() << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#ifndef GWS_PACKAGES_H
+#define GWS_PACKAGES_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "gws_index.h"
+
+// An installed package, as gwsl.lock records it
+struct GWSLocked {
+    std::string name;
+    std::string version;
+    std::string sha256;
+};
+
+// gwsl-get, the OpenGWS package manager (.GWS.install, geneia --gwsl-get).
+//
+// A registry is a directory, or a file:// URL naming one, with a directory
+// per package holding its tarballs (.tar, or .tar.gz with zlib) and a meta
+// file of lines
+//     description <text>
+//     version <version> <sha256 of the tarball> <tarball> [<dependency>...]
+//
+// Tarballs are kept in a store shared by every project and addressed by
+// their SHA-256: <store>/tarballs/<sha256>, extracted once to
+// <store>/trees/<sha256>/. A project gets hard links to the tree files in
+// gwsl_modules/<name>/, and gwsl.lock pins the versions and hashes, so
+// installing again only checks that the store and gwsl_modules still hold
+// what the lock says. Fetching, verifying and extracting independent
+// packages runs on the thread pool. .GWS.update indexes the registry into
+// the store (see GWSIndex) for search and dependency resolution.
+class GWSPackages {
+public:
+    // root is the project directory (gwsl.lock, gwsl_modules/)
+    GWSPackages(const std::string& registry, const std::string& store, const std::string& root = ".");
+
+    // The registry entry for "name" (its newest version) or "name@version";
+    // false with error() set
+    bool find(const std::string& spec, GWSPackage& package);
+
+    // Rebuild the registry's index
+    bool update(std::ostream& log);
+    // List the packages whose name or description contains query, indexing
+    // the registry first if it never was
+    bool search(const std::string& query, std::ostream& log);
+
+    // Install specs and what they depend on; with none, everything
+    // gwsl.lock lists. Progress goes to log; false with error() set.
+    bool install(const std::vector<std::string>& specs, std::ostream& log);
+    // Remove an installed package (the store keeps its tarball)
+    bool remove(const std::string& name, std::ostream& log);
+    // What gwsl.lock lists, by name
+    std::vector<GWSLocked> installed() const;
+
+    const std::string& error() const { return message; }
+
+    // $GWSL_STORE, else ~/.gwsl/store
+    static std::string defaultStore();
+
+private:
+    std::string registryDir;  // "" if the registry is not local
+    std::string storeDir;
+    std::string rootDir;
+    std::string message;
+    GWSIndex registryIndex;
+
+    std::string indexPath() const;
+    bool indexCurrent(const std::string& name) const;
+    std::string lockPath() const { return rootDir + "/gwsl.lock"; }
+    std::string modulePath(const std::string& name) const { return rootDir + "/gwsl_modules/" + name; }
+    bool writeLock(const std::vector<GWSLocked>& entries);
+    // The package's tarball in the store and its extracted tree; fetched
+    // is set if it came from the registry. False with error set.
+    bool fetch(const GWSPackage& package, bool& fetched, std::string& error) const;
+    bool link(const GWSPackage& package, std::string& error) const;
+    // Whether the store and gwsl_modules still hold entry, unedited
+    bool intact(const GWSLocked& entry) const;
+};
+
+// geneia --gwsl-get install|remove|list|update|search [package...]
+int gwslGetMain(int argc, char** argv);
+
+#endif
@@ -0,0 +1,249 @@
+#include "gws_router.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+static const uint32_t NONE = UINT32_MAX;
+static const int HANDLER_SLOTS = GWS_METHODS + 1;  // one per method, then GWS_ANY
+
+static const char* const METHOD_NAMES[GWS_METHODS] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "OTHER"};
+
+int gwsMethod(const char* name, size_t size) {
+    if ((size == 1 && name[0] == '*') || (size == 3 && memcmp(name, "ANY", 3) == 0)) return GWS_ANY;
+    for (int m = 0; m < GWS_OTHER; m++) {
+        if (strlen(METHOD_NAMES[m]) == size && memcmp(METHOD_NAMES[m], name, size) == 0) return m;
+    }
+    return GWS_OTHER;
+}
+
+const char* gwsMethodName(int method) {
+    if (method < 0 || method >= GWS_METHODS) return "*";
+    return METHOD_NAMES[method];
+}
+
+struct GWSRouter::BuildNode {
+    std::string label;  // literal text; the name for parameter and wildcard nodes
+    std::vector<std::unique_ptr<BuildNode>> children;
+    std::unique_ptr<BuildNode> param;
+    std::unique_ptr<BuildNode> wildcard;
+    bool routed = false;
+    uint32_t ids[HANDLER_SLOTS];
+
+    BuildNode() { std::fill(ids, ids + HANDLER_SLOTS, NONE); }
+};
+
+GWSRouter::GWSRouter() : root(new BuildNode()), routeCount(0) {}
+GWSRouter::~GWSRouter() = default;
+GWSRouter::GWSRouter(GWSRouter&&) noexcept = default;
+GWSRouter& GWSRouter::operator=(GWSRouter&&) noexcept = default;
+
+bool GWSRouter::add(int method, const std::string& pattern, uint32_t id, std::string& error) {
+    if (!root) {
+        error = "routes are already built";
+        return false;
+    }
+    BuildNode* node = root.get();
+    size_t i = 0;
+    while (i < pattern.size()) {
+        bool segmentStart = i == 0 || pattern[i - 1] == '/';
+        if (segmentStart && pattern[i] == ':') {
+            size_t end = pattern.find('/', i);
+            if (end == std::string::npos) end = pattern.size();
+            std::string name = pattern.substr(i + 1, end - i - 1);
+            if (name.empty()) {
+                error = "parameter without a name in '" + pattern + "'";
+                return false;
+            }
+            if (!node->param) {
+                node->param.reset(new BuildNode());
+                node->param->label = name;
+            } else if (node->param->label != name) {
+                error = "':" + name + "' in '" + pattern + "' is ':" + node->param->label + "' in another route";
+                return false;
+            }
+            node = node->param.get();
+            i = end;
+        } else if (segmentStart && pattern[i] == '*') {
+            std::string name = pattern.substr(i + 1);
+            if (name.find('/') != std::string::npos) {
+                error = "'*' must end the pattern '" + pattern + "'";
+                return false;
+            }
+            if (!node->wildcard) {
+                node->wildcard.reset(new BuildNode());
+                node->wildcard->label = name;
+            } else if (node->wildcard->label != name) {
+                error = "'*" + name + "' in '" + pattern + "' is '*" + node->wildcard->label + "' in another route";
+                return false;
+            }
+            node = node->wildcard.get();
+            i = pattern.size();
+        } else {
+            size_t end = i;
+            while (end < pattern.size() &&
+                   !((pattern[end] == ':' || pattern[end] == '*') && pattern[end - 1] == '/'))
+                end++;
+            node = insertLiteral(node, pattern.substr(i, end - i));
+            i = end;
+        }
+    }
+
+    uint32_t& slot = node->ids[method == GWS_ANY ? GWS_METHODS : method];
+    if (slot == NONE) routeCount++;
+    slot = id;
+    node->routed = true;
+    return true;
+}
+
+// The node for text below node, splitting a child where text leaves it
+GWSRouter::BuildNode* GWSRouter::insertLiteral(BuildNode* node, std::string text) {
+    while (true) {
+        std::unique_ptr<BuildNode>* child = nullptr;
+        for (auto& c : node->children) {
+            if (c->label[0] == text[0]) child = &c;
+        }
+        if (!child) {
+            node->children.emplace_back(new BuildNode());
+            node->children.back()->label = text;
+            return node->children.back().get();
+        }
+
+        std::string& label = (*child)->label;
+        size_t common = 0;
+        while (common < label.size() && common < text.size() && label[common] == text[common]) common++;
+        if (common < label.size()) {
+            // Split: the shared part becomes a node above the old child
+            std::unique_ptr<BuildNode> upper(new BuildNode());
+            upper->label = label.substr(0, common);
+            label.erase(0, common);
+            upper->children.push_back(std::move(*child));
+            *child = std::move(upper);
+        }
+        if (common == text.size()) return child->get();
+        node = child->get();
+        text.erase(0, common);
+    }
+}
+
+void GWSRouter::build() {
+    if (!root) return;
+    nodes.clear();
+    labels.clear();
+    handlers.clear();
+
+    // Breadth first, so the literal children of a node sit side by side
+    std::deque<std::pair<BuildNode*, uint32_t>> queue;
+    nodes.push_back(Node());
+    queue.push_back({root.get(), 0});
+    while (!queue.empty()) {
+        BuildNode* b = queue.front().first;
+        uint32_t index = queue.front().second;
+        queue.pop_front();
+
+        Node n;
+        n.label = static_cast<uint32_t>(labels.size());
+        n.labelSize = static_cast<uint32_t>(b->label.size());
+        labels += b->label;
+
+        std::sort(b->children.begin(), b->children.end(),
+                  [](const std::unique_ptr<BuildNode>& x, const std::unique_ptr<BuildNode>& y) {
+                      return static_cast<unsigned char>(x->label[0]) < static_cast<unsigned char>(y->label[0]);
+                  });
+        n.children = static_cast<uint32_t>(nodes.size());
+        n.childCount = static_cast<uint32_t>(b->children.size());
+        for (auto& c : b->children) {
+            queue.push_back({c.get(), static_cast<uint32_t>(nodes.size())});
+            nodes.push_back(Node());
+        }
+        n.param = n.wildcard = NONE;
+        if (b->param) {
+            n.param = static_cast<uint32_t>(nodes.size());
+            queue.push_back({b->param.get(), n.param});
+            nodes.push_back(Node());
+        }
+        if (b->wildcard) {
+            n.wildcard = static_cast<uint32_t>(nodes.size());
+            queue.push_back({b->wildcard.get(), n.wildcard});
+            nodes.push_back(Node());
+        }
+        n.handlers = NONE;
+        if (b->routed) {
+            n.handlers = static_cast<uint32_t>(handlers.size());
+            handlers.insert(handlers.end(), b->ids, b->ids + HANDLER_SLOTS);
+        }
+        nodes[index] = n;
+    }
+    root.reset();
+}
+
+bool GWSRouter::accept(const Node& node, int method, GWSMatch& m, uint32_t& id) const {
+    if (node.handlers == NONE) return false;
+    const uint32_t* ids = &handlers[node.handlers];
+    uint32_t found = ids[method];
+    if (found == NONE && method == GWS_HEAD) found = ids[GWS_GET];
+    if (found == NONE) found = ids[GWS_METHODS];
+    if (found != NONE) {
+        id = found;
+        return true;
+    }
+    for (int i = 0; i < GWS_METHODS; i++) {
+        if (ids[i] != NONE) m.allowed |= 1u << i;
+    }
+    if (ids[GWS_GET] != NONE) m.allowed |= 1u << GWS_HEAD;
+    return false;
+}
+
+bool GWSRouter::match(uint32_t index, int method, const char* path, size_t pos, size_t size,
+                      GWSMatch& m, uint32_t& id) const {
+    const Node& node = nodes[index];
+    if (pos < size && node.childCount > 0) {
+        // Literal children are ordered by their first byte
+        unsigned char c = static_cast<unsigned char>(path[pos]);
+        uint32_t lo = node.children, hi = node.children + node.childCount;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (static_cast<unsigned char>(labels[nodes[mid].label]) < c) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < node.children + node.childCount) {
+            const Node& child = nodes[lo];
+            if (static_cast<unsigned char>(labels[child.label]) == c && size - pos >= child.labelSize &&
+                memcmp(path + pos, labels.data() + child.label, child.labelSize) == 0 &&
+                match(lo, method, path, pos + child.labelSize, size, m, id))
+                return true;
+        }
+    } else if (pos == size && accept(node, method, m, id)) {
+        return true;
+    }
+
+    auto capture = [&](const Node& param, size_t end) {
+        if (m.paramCount < GWSMatch::MAX_PARAMS) {
+            m.params[m.paramCount++] = {labels.data() + param.label, param.labelSize, path + pos, end - pos};
+        }
+    };
+    int saved = m.paramCount;
+    if (node.param != NONE && pos < size) {
+        const char* slash = static_cast<const char*>(memchr(path + pos, '/', size - pos));
+        size_t end = slash ? static_cast<size_t>(slash - path) : size;
+        if (end > pos) {
+            capture(nodes[node.param], end);
+            if (match(node.param, method, path, end, size, m, id)) return true;
+            m.paramCount = saved;
+        }
+    }
+    if (node.wildcard != NONE) {
+        capture(nodes[node.wildcard], size);
+        if (accept(nodes[node.wildcard], method, m, id)) return true;
+        m.paramCount = saved;
+    }
+    return false;
+}
+
+bool GWSRouter::find(int method, const char* path, size_t size, GWSMatch& m, uint32_t& id) const {
+    m.paramCount = 0;
+    m.allowed = 0;
+    if (nodes.empty()) return false;
+    if (method < 0 || method >= GWS_METHODS) method = GWS_OTHER;
+    return match(0, method, path, 0, size, m, id);
+}
@@ -0,0 +1,91 @@
+#ifndef GWS_ROUTER_H
+#define GWS_ROUTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Request methods a route can be bound to; GWS_ANY matches all of them
+enum GWSMethod {
+    GWS_GET, GWS_HEAD, GWS_POST, GWS_PUT, GWS_DELETE, GWS_PATCH, GWS_OPTIONS,
+    GWS_OTHER,  // any method not listed above
+    GWS_METHODS
+};
+static const int GWS_ANY = -1;
+
+// GWS_GET etc. for a method name (case-sensitive, as in HTTP), GWS_ANY for
+// "*" or "ANY", GWS_OTHER for anything else
+int gwsMethod(const char* name, size_t size);
+const char* gwsMethodName(int method);
+
+// Parameters captured by a match. They point into the router and the
+// matched path, so a lookup never allocates.
+struct GWSMatch {
+    static const int MAX_PARAMS = 16;
+    struct Param {
+        const char* name;
+        size_t nameSize;
+        const char* value;
+        size_t valueSize;
+    };
+    Param params[MAX_PARAMS];
+    int paramCount;
+    unsigned allowed;  // if the path matched but not the method: bit per GWSMethod routed there
+};
+
+// Compressed radix tree over route patterns. Patterns are literal paths
+// with ':name' segments, which match one non-empty path segment, and a
+// final '*' or '*name', which matches the rest of the path. Where routes
+// overlap, literal text is preferred to a parameter and a parameter to a
+// wildcard, falling back if the preferred branch does not lead to a
+// route. The tree is built once into flat arrays and is then read-only;
+// a lookup walks it in time proportional to the path length.
+class GWSRouter {
+public:
+    GWSRouter();
+    ~GWSRouter();
+    GWSRouter(GWSRouter&&) noexcept;
+    GWSRouter& operator=(GWSRouter&&) noexcept;
+
+    // Route method (a GWSMethod or GWS_ANY) at pattern to id. A later
+    // route for the same method and pattern replaces the earlier one.
+    // False if the pattern is malformed or names a parameter differently
+    // from a route already in the same place.
+    bool add(int method, const std::string& pattern, uint32_t id, std::string& error);
+
+    // Flatten the tree; add() may not be called afterwards
+    void build();
+
+    // id of the route for method at path; false if there is none, in
+    // which case match.allowed tells a wrong method from a missing path
+    bool find(int method, const char* path, size_t size, GWSMatch& match, uint32_t& id) const;
+
+    size_t size() const { return routeCount; }
+
+private:
+    struct BuildNode;
+    struct Node {
+        uint32_t label;       // offset of the literal text in labels
+        uint32_t labelSize;
+        uint32_t children;    // first literal child; they are contiguous
+        uint32_t childCount;
+        uint32_t param;       // ':name' child or NONE
+        uint32_t wildcard;    // '*name' child or NONE
+        uint32_t handlers;    // first of HANDLER_SLOTS ids in handlers, or NONE
+    };
+
+    std::unique_ptr<BuildNode> root;
+    std::vector<Node> nodes;
+    std::string labels;       // node text and parameter names
+    std::vector<uint32_t> handlers;
+    size_t routeCount;
+
+    static BuildNode* insertLiteral(BuildNode* node, std::string text);
+    bool match(uint32_t node, int method, const char* path, size_t pos, size_t size,
+               GWSMatch& m, uint32_t& id) const;
+    bool accept(const Node& node, int method, GWSMatch& m, uint32_t& id) const;
+};
+
+#endif
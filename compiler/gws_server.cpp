@@ -0,0 +1,1359 @@
+#include "gws_server.h"
+#include "content_hash.h"
+#include "gws_static.h"
+#include "gws_uring.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <unordered_set>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef GWS_ZLIB
+#include <zlib.h>
+#endif
+
+static const size_t MAX_HEADER = 64 * 1024;       // larger request heads get 400
+static const size_t MAX_BODY = 1024 * 1024;        // request bodies are read and dropped
+static const size_t OUTPUT_BACKLOG = 1024 * 1024;  // stop answering a pipeline past this
+static const size_t MAX_IOV = 512;
+static const uint32_t MOUNT_ID = 0x80000000u;  // router ids from here on are .GWS.static mounts
+
+// io_uring engine, per worker
+static const unsigned URING_ENTRIES = 4096;
+static const unsigned URING_FILES = 32768;        // registered sockets, capped by RLIMIT_NOFILE
+static const unsigned URING_BUFFERS = 1024;       // provided receive buffers
+static const unsigned URING_BUFFER_SIZE = 4096;
+static const size_t FILE_CHUNK = 256 * 1024;      // large files are read and sent in these
+
+// What follows the headers of head, chosen per request
+static const char KEEP_ALIVE_11[] = "\r\n";
+static const char KEEP_ALIVE_10[] = "Connection: keep-alive\r\n\r\n";
+static const char CLOSE[] = "Connection: close\r\n\r\n";
+
+namespace {
+
+// Output waiting for the socket: bytes, then a range of a file
+struct OutPiece {
+    std::string bytes;
+    std::shared_ptr<GWSStaticFile> file;
+    off_t offset = 0;
+    size_t length = 0;
+};
+
+struct Connection {
+    int fd;
+    std::string in;
+    size_t inPos = 0;
+    std::deque<OutPiece> out;  // unsent responses
+    size_t outPos = 0;         // into out.front().bytes
+    size_t outBytes = 0;       // still to send, file ranges included
+    bool closing = false;      // close once out is sent
+
+    // io_uring engine: fd is a registered file index, and out stays put
+    // until the kernel has sent it
+    size_t sending = 0;         // 1 while the front of out is in flight
+    unsigned chainOps = 0;      // operations of the send chain still pending
+    unsigned ops = 0;           // submitted operations still pending
+    std::unique_ptr<char[]> chunk;  // file data read for the send chain
+    size_t chunkSize = 0;
+    bool receiving = false;     // multishot receive armed
+    bool ended = false;         // the peer closed its side
+    bool failed = false;
+    bool closeQueued = false;
+    bool retired = false;       // being closed; deleted once ops is 0
+};
+
+}  // namespace
+
+// Reason phrase for a status a handler chose
+static const char* statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 410: return "Gone";
+        case 422: return "Unprocessable Content";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return status < 300 ? "OK" : status < 400 ? "Redirect" : status < 500 ? "Client Error" : "Server Error";
+    }
+}
+
+static GWSResponse makeResponse(const std::string& status, const std::string& type, const std::string& body) {
+    GWSResponse r;
+    r.head = "HTTP/1.1 " + status + "\r\nServer: OpenGWS\r\nContent-Type: " + type +
+             "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    r.body = body;
+    return r;
+}
+
+// Everything a request is matched against; immutable once published
+struct GWSServer::Table {
+    GWSRouter router;
+    std::vector<GWSResource> resources;  // by route id
+    std::vector<GWSMount> mounts;
+};
+
+GWSServer::GWSServer(int port)
+    : listenPort(port), engineInUse(GWS_ENGINE_EPOLL), servedCount(0), table(nullptr), epoch(1), stopping(false) {
+    notFound = makeResponse("404 Not Found", "text/html",
+                            "<h1>404 - Not Found</h1><p>Route not defined in OpenGWS</p>");
+    for (unsigned mask = 1; mask < (1u << GWS_METHODS); mask++) {
+        std::string allow;
+        for (int m = 0; m < GWS_OTHER; m++) {
+            if (mask & (1u << m)) allow += std::string(allow.empty() ? "" : ", ") + gwsMethodName(m);
+        }
+        notAllowed[mask] = makeResponse("405 Method Not Allowed", "text/html", "<h1>405 - Method Not Allowed</h1>");
+        notAllowed[mask].head += "Allow: " + allow + "\r\n";
+    }
+    notImplemented = makeResponse("501 Not Implemented", "text/html", "<h1>501 - Not Implemented</h1>");
+    badRequest = makeResponse("400 Bad Request", "text/html", "<h1>400 - Bad Request</h1>");
+    internalError = makeResponse("500 Internal Server Error", "text/html", "<h1>500 - Internal Server Error</h1>");
+}
+
+GWSServer::~GWSServer() {
+    stop();
+    delete table.load();
+}
+
+void GWSServer::reset() {
+    routes.clear();
+    mounts.clear();
+    checked = GWSRouter();
+}
+
+bool GWSServer::mount(const std::string& prefix, const std::string& dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        message = dir + ": not a directory";
+        return false;
+    }
+    std::string base = prefix;
+    while (!base.empty() && base.back() == '/') base.pop_back();
+    if ((!base.empty() && !checked.add(GWS_GET, base, 0, message)) || !checked.add(GWS_GET, base + "/*", 0, message))
+        return false;
+    mounts.push_back({base, dir});
+    return true;
+}
+
+bool GWSServer::route(const GWSRoute& route) {
+    if (!checked.add(route.method, route.path, 0, message)) return false;
+    routes.push_back(route);
+    return true;
+}
+
+#ifdef GWS_ZLIB
+// body in the gzip or zlib ("deflate") format at the best compression
+static bool compressBody(const std::string& body, bool gzip, std::string& out) {
+    z_stream zs = {};
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, gzip ? 15 + 16 : 15, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out.resize(deflateBound(&zs, body.size()));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    zs.avail_in = static_cast<uInt>(body.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int result = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return result == Z_STREAM_END;
+}
+#endif
+
+static GWSResource makeResource(const std::string& html) {
+    static const char* const names[GWS_ENCODINGS] = {"", "gzip", "deflate"};
+    std::string bodies[GWS_ENCODINGS];
+    bodies[GWS_IDENTITY] = html;
+#ifdef GWS_ZLIB
+    for (int e = GWS_GZIP; e < GWS_ENCODINGS; e++) {
+        std::string packed;
+        if (compressBody(html, e == GWS_GZIP, packed) && packed.size() < html.size()) bodies[e] = packed;
+    }
+#endif
+
+    GWSResource r;
+    std::string hash = sha256Hex(html).substr(0, 32);
+    for (int e = GWS_IDENTITY; e < GWS_ENCODINGS; e++) {
+        if (e != GWS_IDENTITY && bodies[e].empty()) continue;
+        // Strong tags differ per coding, since the bytes do
+        r.etag[e] = "\"" + hash + (e == GWS_IDENTITY ? "" : std::string("-") + names[e]) + "\"";
+        std::string headers = "ETag: " + r.etag[e] + "\r\n";
+#ifdef GWS_ZLIB
+        headers += "Vary: Accept-Encoding\r\n";
+#endif
+        r.full[e] = makeResponse("200 OK", "text/html; charset=utf-8", bodies[e]);
+        if (e != GWS_IDENTITY) r.full[e].head += "Content-Encoding: " + std::string(names[e]) + "\r\n";
+        r.full[e].head += headers;
+        r.notModified[e].head = "HTTP/1.1 304 Not Modified\r\nServer: OpenGWS\r\n" + headers;
+    }
+    return r;
+}
+
+GWSServer::Table* GWSServer::build() const {
+    auto* t = new Table();
+    std::string ignored;  // every pattern was vetted by route()
+    for (auto& r : routes) {
+        t->router.add(r.method, r.path, static_cast<uint32_t>(t->resources.size()), ignored);
+        if (r.handler) {
+            t->resources.emplace_back();
+            t->resources.back().handler = r.handler;
+        } else {
+            t->resources.push_back(makeResource(r.html));
+        }
+    }
+    t->mounts = mounts;
+    for (size_t i = 0; i < mounts.size(); i++) {
+        uint32_t id = MOUNT_ID + static_cast<uint32_t>(i);
+        if (!mounts[i].prefix.empty()) t->router.add(GWS_GET, mounts[i].prefix, id, ignored);
+        t->router.add(GWS_GET, mounts[i].prefix + "/*", id, ignored);
+    }
+    t->router.build();
+    return t;
+}
+
+const GWSResource* GWSServer::lookup(const Table& table, int method, const char* path, size_t size,
+                                     GWSMatch& match, const GWSMount*& mount) {
+    uint32_t id;
+    mount = nullptr;
+    if (!table.router.find(method, path, size, match, id)) return nullptr;
+    if (id >= MOUNT_ID) {
+        mount = &table.mounts[id - MOUNT_ID];
+        return nullptr;
+    }
+    return &table.resources[id];
+}
+
+// Case-insensitive comparison of a header name or token
+static bool sameWord(const char* s, size_t n, const char* word) {
+    size_t len = strlen(word);
+    if (n != len) return false;
+    for (size_t i = 0; i < n; i++)
+        if (tolower(static_cast<unsigned char>(s[i])) != word[i]) return false;
+    return true;
+}
+
+// Whether a comma-separated header value lists token
+static bool hasToken(const char* s, size_t n, const char* token) {
+    size_t i = 0;
+    while (i < n) {
+        while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == ',')) i++;
+        size_t start = i;
+        while (i < n && s[i] != ',') i++;
+        size_t end = i;
+        while (end > start && (s[end - 1] == ' ' || s[end - 1] == '\t')) end--;
+        if (sameWord(s + start, end - start, token)) return true;
+    }
+    return false;
+}
+
+namespace {
+
+// One parsed request; pointers refer into the connection's input
+struct Request {
+    const char* method;
+    size_t methodSize;
+    const char* path;  // target up to '?'
+    size_t pathSize;
+    const char* query;  // after '?', empty if there is none
+    size_t querySize;
+    const char* headers;  // the header lines
+    size_t headersSize;
+    const char* body;
+    size_t bodySize;
+    bool keepAlive;
+    bool http10;
+    const char* acceptEncoding;  // nullptr if absent
+    size_t acceptEncodingSize;
+    const char* ifNoneMatch;  // nullptr if absent
+    size_t ifNoneMatchSize;
+    const char* ifModifiedSince;  // nullptr if absent
+    size_t ifModifiedSinceSize;
+    const char* range;  // nullptr if absent
+    size_t rangeSize;
+    const char* ifRange;  // nullptr if absent
+    size_t ifRangeSize;
+    size_t consumed;  // bytes of input the request used, body included
+};
+
+enum ParseResult { PARSE_OK, PARSE_INCOMPLETE, PARSE_BAD };
+
+}  // namespace
+
+static ParseResult parseRequest(const char* data, size_t size, Request& req) {
+    // Stray blank lines between pipelined requests are allowed (RFC 9112 2.2)
+    size_t skip = 0;
+    while (skip + 1 < size && data[skip] == '\r' && data[skip + 1] == '\n') skip += 2;
+    data += skip;
+    size -= skip;
+
+    const char* end = static_cast<const char*>(memmem(data, size, "\r\n\r\n", 4));
+    if (!end) return size > MAX_HEADER ? PARSE_BAD : PARSE_INCOMPLETE;
+    size_t headSize = end - data;
+    if (headSize > MAX_HEADER) return PARSE_BAD;
+
+    // Request line: method SP target SP HTTP/1.x
+    const char* lineEnd = static_cast<const char*>(memchr(data, '\r', headSize + 1));
+    const char* sp1 = static_cast<const char*>(memchr(data, ' ', lineEnd - data));
+    if (!sp1 || sp1 == data) return PARSE_BAD;
+    const char* target = sp1 + 1;
+    const char* sp2 = static_cast<const char*>(memchr(target, ' ', lineEnd - target));
+    if (!sp2 || sp2 == target) return PARSE_BAD;
+    const char* version = sp2 + 1;
+    size_t versionSize = lineEnd - version;
+    if (versionSize != 8 || memcmp(version, "HTTP/1.", 7) != 0 || (version[7] != '0' && version[7] != '1'))
+        return PARSE_BAD;
+
+    req.method = data;
+    req.methodSize = sp1 - data;
+    req.path = target;
+    const char* query = static_cast<const char*>(memchr(target, '?', sp2 - target));
+    req.pathSize = (query ? query : sp2) - target;
+    req.query = query ? query + 1 : sp2;
+    req.querySize = query ? sp2 - query - 1 : 0;
+    req.headers = lineEnd + 2;
+    req.headersSize = end + 2 - req.headers;
+    req.http10 = version[7] == '0';
+    req.keepAlive = !req.http10;
+    req.acceptEncoding = req.ifNoneMatch = nullptr;
+    req.acceptEncodingSize = req.ifNoneMatchSize = 0;
+    req.ifModifiedSince = req.range = req.ifRange = nullptr;
+    req.ifModifiedSinceSize = req.rangeSize = req.ifRangeSize = 0;
+
+    size_t contentLength = 0;
+    const char* line = lineEnd + 2;
+    while (line < end) {
+        const char* next = static_cast<const char*>(memchr(line, '\r', end - line + 1));
+        const char* colon = static_cast<const char*>(memchr(line, ':', next - line));
+        if (!colon) return PARSE_BAD;
+        const char* value = colon + 1;
+        while (value < next && (*value == ' ' || *value == '\t')) value++;
+        size_t nameSize = colon - line;
+        size_t valueSize = next - value;
+        if (sameWord(line, nameSize, "connection")) {
+            if (hasToken(value, valueSize, "close")) req.keepAlive = false;
+            else if (hasToken(value, valueSize, "keep-alive")) req.keepAlive = true;
+        } else if (sameWord(line, nameSize, "content-length")) {
+            contentLength = 0;
+            for (size_t i = 0; i < valueSize; i++) {
+                char c = value[i];
+                if (c == ' ' || c == '\t') break;
+                if (c < '0' || c > '9' || contentLength > MAX_BODY) return PARSE_BAD;
+                contentLength = contentLength * 10 + (c - '0');
+            }
+            if (contentLength > MAX_BODY) return PARSE_BAD;
+        } else if (sameWord(line, nameSize, "accept-encoding")) {
+            req.acceptEncoding = value;
+            req.acceptEncodingSize = valueSize;
+        } else if (sameWord(line, nameSize, "if-none-match")) {
+            req.ifNoneMatch = value;
+            req.ifNoneMatchSize = valueSize;
+        } else if (sameWord(line, nameSize, "if-modified-since")) {
+            req.ifModifiedSince = value;
+            req.ifModifiedSinceSize = valueSize;
+        } else if (sameWord(line, nameSize, "range")) {
+            req.range = value;
+            req.rangeSize = valueSize;
+        } else if (sameWord(line, nameSize, "if-range")) {
+            req.ifRange = value;
+            req.ifRangeSize = valueSize;
+        } else if (sameWord(line, nameSize, "transfer-encoding")) {
+            return PARSE_BAD;  // chunked uploads are not supported
+        }
+        line = next + 2;
+    }
+
+    size_t total = headSize + 4 + contentLength;
+    if (total > size) return PARSE_INCOMPLETE;
+    req.body = end + 4;
+    req.bodySize = contentLength;
+    req.consumed = skip + total;
+    return PARSE_OK;
+}
+
+// The q-value of a "name;q=0.5" list element, in thousandths
+static int qValue(const char* s, size_t n) {
+    const char* q = nullptr;
+    for (size_t i = 0; i + 1 < n; i++) {
+        if (s[i] == ';') {
+            size_t j = i + 1;
+            while (j < n && (s[j] == ' ' || s[j] == '\t')) j++;
+            if (j + 1 < n && (s[j] == 'q' || s[j] == 'Q') && s[j + 1] == '=') q = s + j + 2;
+        }
+    }
+    if (!q) return 1000;
+    const char* end = s + n;
+    int value = 0;
+    if (q < end && *q == '1') return 1000;
+    if (q < end && *q == '0') q++;
+    if (q < end && *q == '.') {
+        q++;
+        for (int scale = 100; scale > 0 && q < end && *q >= '0' && *q <= '9'; scale /= 10) value += (*q++ - '0') * scale;
+    }
+    return value;
+}
+
+// Pick the coding of r to send for an Accept-Encoding value. A listed
+// coding wins over identity unless it has a lower q; gzip before deflate.
+static GWSEncoding negotiate(const char* s, size_t n, const GWSResource& r) {
+    int q[GWS_ENCODINGS] = {-1, -1, -1};
+    int star = -1;
+    size_t i = 0;
+    while (i < n) {
+        while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == ',')) i++;
+        size_t start = i;
+        while (i < n && s[i] != ',') i++;
+        size_t nameEnd = start;
+        while (nameEnd < i && s[nameEnd] != ';' && s[nameEnd] != ' ' && s[nameEnd] != '\t') nameEnd++;
+        int value = qValue(s + start, i - start);
+        const char* name = s + start;
+        size_t nameSize = nameEnd - start;
+        if (sameWord(name, nameSize, "gzip") || sameWord(name, nameSize, "x-gzip")) q[GWS_GZIP] = value;
+        else if (sameWord(name, nameSize, "deflate")) q[GWS_DEFLATE] = value;
+        else if (sameWord(name, nameSize, "identity")) q[GWS_IDENTITY] = value;
+        else if (sameWord(name, nameSize, "*")) star = value;
+    }
+    for (int e = GWS_IDENTITY; e < GWS_ENCODINGS; e++)
+        if (q[e] < 0) q[e] = star >= 0 ? star : (e == GWS_IDENTITY ? 1000 : 0);
+
+    GWSEncoding best = GWS_IDENTITY;
+    for (int e = GWS_GZIP; e < GWS_ENCODINGS; e++) {
+        if (r.full[e].head.empty() || q[e] <= 0) continue;
+        if (best == GWS_IDENTITY ? q[e] >= q[GWS_IDENTITY] : q[e] > q[best]) best = static_cast<GWSEncoding>(e);
+    }
+    return best;
+}
+
+// Whether an If-None-Match value names one of r's tags (weak comparison)
+static bool etagMatches(const char* s, size_t n, const GWSResource& r) {
+    size_t i = 0;
+    while (i < n) {
+        while (i < n && (s[i] == ' ' || s[i] == '\t' || s[i] == ',')) i++;
+        if (i < n && s[i] == '*') return true;
+        if (i + 1 < n && s[i] == 'W' && s[i + 1] == '/') i += 2;
+        if (i >= n || s[i] != '"') return false;
+        const char* end = static_cast<const char*>(memchr(s + i + 1, '"', n - i - 1));
+        if (!end) return false;
+        size_t size = end + 1 - (s + i);
+        for (auto& tag : r.etag)
+            if (tag.size() == size && memcmp(tag.data(), s + i, size) == 0) return true;
+        i += size;
+    }
+    return false;
+}
+
+static void queueBytes(Connection& c, const char* data, size_t size) {
+    if (c.out.empty() || c.out.back().file || c.out.size() <= c.sending) c.out.emplace_back();
+    c.out.back().bytes.append(data, size);
+    c.outBytes += size;
+}
+
+static void queueFile(Connection& c, const std::shared_ptr<GWSStaticFile>& file, off_t offset, size_t length) {
+    if (c.out.empty() || c.out.back().file || c.out.size() <= c.sending) c.out.emplace_back();
+    OutPiece& piece = c.out.back();
+    piece.file = file;
+    piece.offset = offset;
+    piece.length = length;
+    c.outBytes += length;
+}
+
+// Send what is queued in out; false if the connection failed. File
+// ranges go straight from the page cache to the socket with sendfile.
+static bool flush(Connection& c) {
+    while (!c.out.empty()) {
+        OutPiece& piece = c.out.front();
+        while (c.outPos < piece.bytes.size()) {
+            ssize_t n = send(c.fd, piece.bytes.data() + c.outPos, piece.bytes.size() - c.outPos, MSG_NOSIGNAL);
+            if (n > 0) {
+                c.outPos += n;
+                c.outBytes -= n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) return true;
+            return false;
+        }
+        while (piece.length > 0) {
+            ssize_t n = sendfile(c.fd, piece.file->fd, &piece.offset, std::min(piece.length, size_t(1) << 30));
+            if (n > 0) {
+                piece.length -= n;
+                c.outBytes -= n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && errno == EAGAIN) return true;
+            return false;  // the file shrank: the promised length cannot be sent
+        }
+        c.out.pop_front();
+        c.outPos = 0;
+    }
+    return true;
+}
+
+// Write the gathered responses, keeping whatever the socket did not take
+static bool emit(Connection& c, std::vector<struct iovec>& iov) {
+    if (iov.empty()) return true;
+    size_t first = 0;
+    if (c.out.empty()) {
+        ssize_t n;
+        do {
+            n = writev(c.fd, iov.data(), static_cast<int>(iov.size()));
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && errno != EAGAIN) return false;
+        size_t sent = n < 0 ? 0 : static_cast<size_t>(n);
+        while (first < iov.size() && sent >= iov[first].iov_len) sent -= iov[first++].iov_len;
+        if (first < iov.size()) {
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + sent;
+            iov[first].iov_len -= sent;
+        }
+    }
+    for (size_t i = first; i < iov.size(); i++) queueBytes(c, static_cast<char*>(iov[i].iov_base), iov[i].iov_len);
+    iov.clear();
+    return true;
+}
+
+namespace {
+
+// What a completion belongs to: worker operations carry just the kind,
+// connection operations the Connection with the kind in its low bits
+enum WorkerOp { OP_ACCEPT = 1, OP_WAKE, OP_WATCH, OP_CANCEL };
+enum ConnectionOp { OP_RECV = 1, OP_SEND, OP_READ, OP_SEND_CHUNK, OP_CLOSE };
+const uint64_t OP_MASK = 7;
+
+}  // namespace
+
+// One worker thread: its listening socket, connections and event loop,
+// with scratch space reused for every batch of responses
+struct GWSServer::Worker {
+    const GWSServer& server;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::unordered_set<Connection*> connections;
+    GWSStaticCache files;
+    char date[64];
+    size_t dateSize = 0;
+    time_t dateTime = 0;
+    uint64_t requests = 0;
+    std::unique_ptr<GWSHandler> handler;  // for dynamic routes
+    GWSReply reply;
+    // The routes of the current batch, and the publication it was loaded
+    // at; 0 while blocked, when the worker holds nothing from any table
+    const Table* table = nullptr;
+    std::atomic<uint64_t> seen{0};
+
+    std::vector<struct iovec> iov;
+    std::deque<std::string> heads;  // per-request headers of the batch in iov
+    std::vector<std::shared_ptr<GWSStaticFile>> held;  // mapped bodies in iov
+    GWSMatch match;
+    std::string relative, path;
+
+    // io_uring engine
+    bool uring = false;
+    GWSUring* ring = nullptr;
+    uint64_t pending = 0;  // operations whose last completion has not come
+    bool acceptPaused = false;
+    bool draining = false;
+
+    explicit Worker(const GWSServer& server) : server(server) { iov.reserve(MAX_IOV); }
+
+    // Blocking hands the table back; waking picks up the current one
+    void idle() { seen.store(0); }
+    void resume() {
+        seen.store(server.epoch.load());
+        table = server.table.load();
+    }
+
+    void updateDate() {
+        time_t now = time(nullptr);
+        if (now == dateTime) return;
+        dateTime = now;
+        memcpy(date, "Date: ", 6);
+        dateSize = 6 + gwsHttpDate(now, date + 6);
+        memcpy(date + dateSize, "\r\n", 2);
+        dateSize += 2;
+    }
+
+    void run();
+    bool send(Connection& c);
+    bool serveFile(Connection& c, const Request& req, const GWSMount& mount, bool head, const char* tail);
+    void serveDynamic(const Request& req, int method, const GWSResource& resource, bool head, const char* tail);
+    bool process(Connection& c);
+    void runEpoll();
+
+    bool runUring();
+    struct io_uring_sqe* prepare(Connection* c, unsigned op);
+    void armAccept();
+    void armRecv(Connection& c);
+    void pump(Connection& c);
+    void retire(Connection& c);
+    void closeSlot(Connection& c);
+    void complete(const struct io_uring_cqe& e);
+    void settle(Connection& c);
+};
+
+// Write the batch; whatever it pointed to has been sent or copied after.
+// With io_uring it is copied into out, and pump() hands it to the kernel.
+bool GWSServer::Worker::send(Connection& c) {
+    bool ok = true;
+    if (uring) {
+        for (auto& v : iov) queueBytes(c, static_cast<char*>(v.iov_base), v.iov_len);
+        iov.clear();
+    } else {
+        ok = emit(c, iov);
+    }
+    heads.clear();
+    held.clear();
+    return ok;
+}
+
+// Answer a request under a .GWS.static mount; false if c failed
+bool GWSServer::Worker::serveFile(Connection& c, const Request& req, const GWSMount& mount, bool head,
+                                  const char* tail) {
+    // The part after the mount prefix, if the wildcard route matched
+    const char* rest = match.paramCount ? match.params[match.paramCount - 1].value : req.path;
+    size_t restSize = match.paramCount ? match.params[match.paramCount - 1].valueSize : 0;
+    std::shared_ptr<GWSStaticFile> file;
+    if (gwsDecodePath(rest, restSize, relative)) {
+        path.assign(mount.dir).append("/").append(relative);
+        file = files.open(path);
+    }
+    const GWSResponse& notFound = server.notFound;
+    if (!file) {
+        iov.push_back({const_cast<char*>(notFound.head.data()), notFound.head.size()});
+        iov.push_back({date, dateSize});
+        iov.push_back({const_cast<char*>(tail), strlen(tail)});
+        if (!head) iov.push_back({const_cast<char*>(notFound.body.data()), notFound.body.size()});
+        return true;
+    }
+
+    char line[160];
+    std::string& h = *heads.emplace(heads.end());
+    time_t since;
+    if (!req.ifNoneMatch && req.ifModifiedSince &&
+        gwsParseHttpDate(req.ifModifiedSince, req.ifModifiedSinceSize, since) && file->mtime <= since) {
+        snprintf(line, sizeof(line), "HTTP/1.1 304 Not Modified\r\nServer: OpenGWS\r\nLast-Modified: %s\r\n",
+                 file->lastModified);
+        h = line;
+        iov.push_back({&h[0], h.size()});
+        iov.push_back({date, dateSize});
+        iov.push_back({const_cast<char*>(tail), strlen(tail)});
+        return true;
+    }
+
+    size_t first = 0, last = file->size ? file->size - 1 : 0;
+    int range = 0;
+    // If-Range only honours the date this file was served with
+    if (req.range && (!req.ifRange || (req.ifRangeSize == strlen(file->lastModified) &&
+                                       memcmp(req.ifRange, file->lastModified, req.ifRangeSize) == 0)))
+        range = gwsParseRange(req.range, req.rangeSize, file->size, first, last);
+    if (range < 0) {
+        snprintf(line, sizeof(line),
+                 "HTTP/1.1 416 Range Not Satisfiable\r\nServer: OpenGWS\r\nContent-Range: bytes */%zu\r\n"
+                 "Content-Length: 0\r\n", file->size);
+        h = line;
+        iov.push_back({&h[0], h.size()});
+        iov.push_back({date, dateSize});
+        iov.push_back({const_cast<char*>(tail), strlen(tail)});
+        return true;
+    }
+    size_t length = file->size ? last - first + 1 : 0;
+    h = range > 0 ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    h += "Server: OpenGWS\r\nContent-Type: ";
+    h += file->mime;
+    snprintf(line, sizeof(line), "\r\nContent-Length: %zu\r\nLast-Modified: %s\r\nAccept-Ranges: bytes\r\n",
+             length, file->lastModified);
+    h += line;
+    if (range > 0) {
+        snprintf(line, sizeof(line), "Content-Range: bytes %zu-%zu/%zu\r\n", first, last, file->size);
+        h += line;
+    }
+    iov.push_back({&h[0], h.size()});
+    iov.push_back({date, dateSize});
+    iov.push_back({const_cast<char*>(tail), strlen(tail)});
+    if (head || length == 0) return true;
+    if (file->data) {
+        iov.push_back({const_cast<char*>(file->data + first), length});
+        held.push_back(file);
+        return true;
+    }
+    // Large files: headers first, then sendfile with no userspace copy
+    // (io_uring sends them in chunks, see pump())
+    if (!send(c)) return false;
+    queueFile(c, file, static_cast<off_t>(first), length);
+    return uring || flush(c);
+}
+
+// Answer a request on a dynamic route with this worker's handler
+void GWSServer::Worker::serveDynamic(const Request& req, int method, const GWSResource& resource, bool head,
+                                     const char* tail) {
+    GWSRequest request = {method, req.method, req.methodSize, req.path, req.pathSize, req.query, req.querySize,
+                          req.headers, req.headersSize, req.body, req.bodySize, &match};
+    reply.status = 200;
+    reply.type = "text/html; charset=utf-8";
+    reply.body.clear();
+    bool ok = handler && handler->handle(resource.handler.get(), request, reply) && reply.status >= 200 &&
+              reply.status <= 599 && reply.type.find_first_of("\r\n") == std::string::npos;
+    if (!ok) {
+        const GWSResponse& failed = server.internalError;
+        iov.push_back({const_cast<char*>(failed.head.data()), failed.head.size()});
+        iov.push_back({date, dateSize});
+        iov.push_back({const_cast<char*>(tail), strlen(tail)});
+        if (!head) iov.push_back({const_cast<char*>(failed.body.data()), failed.body.size()});
+        return;
+    }
+    if (reply.status == 204 || reply.status == 304) reply.body.clear();  // never have one
+    char line[96];
+    std::string& h = *heads.emplace(heads.end());
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nServer: OpenGWS\r\nContent-Type: ", reply.status,
+             statusText(reply.status));
+    h = line;
+    h += reply.type;
+    snprintf(line, sizeof(line), "\r\nContent-Length: %zu\r\nCache-Control: no-cache\r\n", reply.body.size());
+    h += line;
+    iov.push_back({&h[0], h.size()});
+    iov.push_back({date, dateSize});
+    iov.push_back({const_cast<char*>(tail), strlen(tail)});
+    if (head || reply.body.empty()) return;
+    std::string& body = *heads.emplace(heads.end());
+    body.swap(reply.body);
+    iov.push_back({&body[0], body.size()});
+}
+
+// Answer every complete request buffered on c; false if c must close now
+bool GWSServer::Worker::process(Connection& c) {
+    while (!c.closing && c.outBytes < OUTPUT_BACKLOG) {
+        Request req{};
+        ParseResult result = parseRequest(c.in.data() + c.inPos, c.in.size() - c.inPos, req);
+        if (result == PARSE_INCOMPLETE) break;
+        requests++;
+        const GWSResponse* response = nullptr;
+        const GWSMount* mount = nullptr;
+        const GWSResource* dynamic = nullptr;
+        int method = GWS_OTHER;
+        bool head = false;
+        if (result == PARSE_BAD) {
+            response = &server.badRequest;
+            req.keepAlive = false;
+            req.http10 = false;
+            req.consumed = c.in.size() - c.inPos;
+        } else {
+            method = gwsMethod(req.method, req.methodSize);
+            head = method == GWS_HEAD;
+            const GWSResource* resource = lookup(*table, method, req.path, req.pathSize, match, mount);
+            if (resource && resource->handler) {
+                dynamic = resource;
+            } else if (resource) {
+                GWSEncoding e = req.acceptEncoding
+                    ? negotiate(req.acceptEncoding, req.acceptEncodingSize, *resource) : GWS_IDENTITY;
+                bool fresh = (method == GWS_GET || head) && req.ifNoneMatch &&
+                             etagMatches(req.ifNoneMatch, req.ifNoneMatchSize, *resource);
+                response = fresh ? &resource->notModified[e] : &resource->full[e];
+            } else if (mount) {
+                // served below
+            } else if (match.allowed) {
+                response = &server.notAllowed[match.allowed];
+            } else if (method == GWS_OTHER) {
+                response = &server.notImplemented;
+            } else {
+                response = &server.notFound;
+            }
+        }
+        c.inPos += req.consumed;
+
+        const char* tail = !req.keepAlive ? CLOSE : req.http10 ? KEEP_ALIVE_10 : KEEP_ALIVE_11;
+        if (mount) {
+            if (!serveFile(c, req, *mount, head, tail)) return false;
+        } else if (dynamic) {
+            serveDynamic(req, method, *dynamic, head, tail);
+        } else {
+            iov.push_back({const_cast<char*>(response->head.data()), response->head.size()});
+            iov.push_back({date, dateSize});
+            iov.push_back({const_cast<char*>(tail), strlen(tail)});
+            if (!head && !response->body.empty())
+                iov.push_back({const_cast<char*>(response->body.data()), response->body.size()});
+        }
+        if (!req.keepAlive) c.closing = true;
+        if (iov.size() + 4 > MAX_IOV && !send(c)) return false;
+    }
+    if (!send(c)) return false;
+    if (c.inPos == c.in.size()) {
+        c.in.clear();
+        c.inPos = 0;
+    } else if (c.inPos > 0 && c.outBytes < OUTPUT_BACKLOG) {
+        c.in.erase(0, c.inPos);
+        c.inPos = 0;
+    }
+    return !c.closing || !c.out.empty();
+}
+
+bool GWSServer::start(unsigned count, GWSEngine engine) {
+    stop();
+    delete table.exchange(build());
+    if (count == 0) count = std::thread::hardware_concurrency();
+    if (count == 0) count = 1;
+    servedCount = 0;
+    engineInUse = GWS_ENGINE_EPOLL;
+    message.clear();
+    if (engine == GWS_ENGINE_URING) {
+        // A throwaway ring tells whether the kernel has what the engine needs
+        GWSUring probe;
+        std::string reason;
+        if (probe.init(8, 1, 1, URING_BUFFER_SIZE, reason)) engineInUse = GWS_ENGINE_URING;
+        else message = "io_uring " + reason;
+    }
+
+    // Keep-alive connections hold descriptors; use all the process may have
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int port = listenPort;
+    for (unsigned i = 0; i < count; i++) {
+        auto* w = new Worker(*this);
+        workers.push_back(w);
+        w->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (w->listenFd < 0 ||
+            setsockopt(w->listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+            setsockopt(w->listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+            bind(w->listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(w->listenFd, 4096) != 0) {
+            message = "port " + std::to_string(port) + ": " + strerror(errno);
+            stop();
+            return false;
+        }
+        // Accepted sockets inherit it, which the io_uring engine relies on
+        setsockopt(w->listenFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (port == 0) {
+            // Ephemeral port: the other workers join the one the first got
+            socklen_t len = sizeof(addr);
+            getsockname(w->listenFd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+            port = ntohs(addr.sin_port);
+        }
+
+        w->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        w->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->epollFd < 0 || w->wakeFd < 0) {
+            message = strerror(errno);
+            stop();
+            return false;
+        }
+        // The listening socket stays level-triggered, so connections left
+        // in the backlog after running out of descriptors are retried
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->listenFd, &ev);
+        ev.data.ptr = w;
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->wakeFd, &ev);
+        if (w->files.watchFd() >= 0) {
+            ev.data.ptr = &w->files;
+            epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->files.watchFd(), &ev);
+        }
+    }
+    listenPort = port;
+
+    // Workers never take SIGINT; it is left to wait() in the caller
+    sigset_t interrupt, saved;
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &interrupt, &saved);
+    stopping = false;
+    for (auto* w : workers) threads.emplace_back([w] { w->run(); });
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    return true;
+}
+
+void GWSServer::stop() {
+    stopping = true;
+    for (auto* w : workers) {
+        if (w->wakeFd >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(w->wakeFd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+    for (auto& t : threads) t.join();
+    threads.clear();
+    for (auto* w : workers) {
+        servedCount += w->requests;
+        for (auto* c : w->connections) {
+            if (!w->uring) close(c->fd);  // registered files closed with the ring
+            delete c;
+        }
+        if (w->listenFd >= 0) close(w->listenFd);
+        if (w->epollFd >= 0) close(w->epollFd);
+        if (w->wakeFd >= 0) close(w->wakeFd);
+        delete w;
+    }
+    workers.clear();
+}
+
+void GWSServer::publish() {
+    const Table* old = table.exchange(build());
+    uint64_t target = epoch.fetch_add(1) + 1;
+    // Grace period: a worker past this point has either blocked or
+    // reloaded its table since the exchange, so none can still hold old
+    for (auto* w : workers) {
+        while (true) {
+            uint64_t seen = w->seen.load();
+            if (seen == 0 || seen >= target) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    delete old;
+}
+
+bool GWSServer::wait(int fd) {
+    sigset_t interrupt, saved;
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &interrupt, &saved);
+    bool ready = false;
+    if (fd < 0) {
+        int sig;
+        while (sigwait(&interrupt, &sig) != 0) {}
+    } else {
+        // SIGINT as a descriptor, so both can be waited for at once
+        int sigFd = signalfd(-1, &interrupt, SFD_CLOEXEC);
+        struct pollfd fds[2] = {{sigFd, POLLIN, 0}, {fd, POLLIN, 0}};
+        while (poll(fds, 2, -1) < 0 && errno == EINTR) {}
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            ssize_t ignored = read(sigFd, &info, sizeof(info));
+            (void)ignored;
+        } else {
+            ready = true;
+        }
+        close(sigFd);
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+    return ready;
+}
+
+void GWSServer::Worker::run() {
+    // A ring that cannot be set up here (memory limits) leaves this worker on epoll
+    // Made here, so that it lives and dies on this thread
+    if (server.makeHandler) handler = server.makeHandler();
+    if (server.engineInUse != GWS_ENGINE_URING || !runUring()) runEpoll();
+    idle();  // an exited worker must not hold up publish()
+    handler.reset();
+}
+
+void GWSServer::Worker::runEpoll() {
+    std::vector<struct epoll_event> events(256);
+    std::vector<char> buffer(64 * 1024);
+
+    auto closeConnection = [this](Connection* c) {
+        close(c->fd);  // also removes it from the epoll set
+        connections.erase(c);
+        delete c;
+    };
+
+    while (!server.stopping) {
+        idle();
+        int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), -1);
+        resume();
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        updateDate();
+        for (int i = 0; i < n; i++) {
+            void* ptr = events[i].data.ptr;
+            if (ptr == this) continue;  // woken by stop()
+            if (ptr == &files) {
+                files.refresh();
+                continue;
+            }
+            if (ptr == nullptr) {
+                while (true) {
+                    int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0) {
+                        if (errno == EINTR || errno == ECONNABORTED) continue;
+                        break;
+                    }
+                    int one = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    auto* c = new Connection();
+                    c->fd = fd;
+                    struct epoll_event ev = {};
+                    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    ev.data.ptr = c;
+                    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                        close(fd);
+                        delete c;
+                        continue;
+                    }
+                    connections.insert(c);
+                }
+                continue;
+            }
+
+            auto* c = static_cast<Connection*>(ptr);
+            uint32_t what = events[i].events;
+            bool alive = true;
+            if (what & EPOLLOUT) {
+                alive = flush(*c);
+                // A drained backlog may let a stalled pipeline continue
+                if (alive && c->out.empty() && c->inPos < c->in.size()) alive = process(*c);
+            }
+            if (alive && (what & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                // Edge-triggered: read until the socket is empty
+                bool ended = false;
+                while (true) {
+                    ssize_t got = read(c->fd, buffer.data(), buffer.size());
+                    if (got > 0) {
+                        c->in.append(buffer.data(), got);
+                        continue;
+                    }
+                    if (got < 0 && errno == EINTR) continue;
+                    if (got == 0 || errno != EAGAIN) ended = true;
+                    break;
+                }
+                alive = process(*c);
+                if (ended) {
+                    c->closing = true;
+                    alive = alive && !c->out.empty();
+                }
+            }
+            if (!alive || (c->closing && c->out.empty())) closeConnection(c);
+        }
+    }
+}
+
+// The io_uring loop: every accept, receive, send and close is a ring
+// operation, and the worker only enters the kernel to submit a batch and
+// wait for the next completions. False if the ring could not be set up.
+bool GWSServer::Worker::runUring() {
+    unsigned slots = URING_FILES;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < slots) slots = static_cast<unsigned>(limit.rlim_cur);
+    GWSUring r;
+    std::string ignored;
+    if (!r.init(URING_ENTRIES, slots, URING_BUFFERS, URING_BUFFER_SIZE, ignored)) return false;
+    ring = &r;
+    uring = true;
+    // Blocking mode: the ring polls the socket itself instead of failing with EAGAIN
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) & ~O_NONBLOCK);
+
+    armAccept();
+    if (struct io_uring_sqe* s = prepare(nullptr, OP_WAKE)) {
+        s->opcode = IORING_OP_POLL_ADD;
+        s->fd = wakeFd;
+        s->poll32_events = POLLIN;
+    }
+    if (files.watchFd() >= 0) {
+        if (struct io_uring_sqe* s = prepare(nullptr, OP_WATCH)) {
+            s->opcode = IORING_OP_POLL_ADD;
+            s->fd = files.watchFd();
+            s->poll32_events = POLLIN;
+            s->len = IORING_POLL_ADD_MULTI;
+        }
+    }
+
+    while (!server.stopping) {
+        idle();
+        int n = r.submit(true);
+        resume();
+        if (n < 0 && n != -EINTR && n != -EAGAIN && n != -EBUSY) break;
+        updateDate();
+        unsigned count = r.ready();
+        for (unsigned i = 0; i < count; i++) complete(r.at(i));
+        r.consume(count);
+    }
+
+    // Nothing may still write into a connection once it is deleted:
+    // cancel every operation and wait for the last completions
+    draining = true;
+    resume();
+    while (pending > 0) {
+        if (struct io_uring_sqe* s = prepare(nullptr, OP_CANCEL)) {
+            s->opcode = IORING_OP_ASYNC_CANCEL;
+            s->fd = -1;
+            s->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        }
+        int n = r.submit(true);
+        if (n < 0 && n != -EINTR && n != -EAGAIN && n != -EBUSY) break;
+        unsigned count = r.ready();
+        for (unsigned i = 0; i < count; i++) complete(r.at(i));
+        r.consume(count);
+    }
+    ring = nullptr;
+    return true;
+}
+
+// A submission entry tagged for c (or the worker) and op; nullptr if the
+// ring is unusable
+struct io_uring_sqe* GWSServer::Worker::prepare(Connection* c, unsigned op) {
+    struct io_uring_sqe* s = ring->sqe();
+    if (!s) return nullptr;
+    s->user_data = reinterpret_cast<uint64_t>(c) | op;
+    pending++;
+    if (c) c->ops++;
+    return s;
+}
+
+void GWSServer::Worker::armAccept() {
+    acceptPaused = false;
+    if (struct io_uring_sqe* s = prepare(nullptr, OP_ACCEPT)) {
+        s->opcode = IORING_OP_ACCEPT;
+        s->fd = listenFd;
+        s->ioprio = IORING_ACCEPT_MULTISHOT;
+        s->file_index = IORING_FILE_INDEX_ALLOC;  // straight into the registered table
+    }
+}
+
+void GWSServer::Worker::armRecv(Connection& c) {
+    struct io_uring_sqe* s = prepare(&c, OP_RECV);
+    if (!s) {
+        c.failed = true;
+        return;
+    }
+    s->opcode = IORING_OP_RECV;
+    s->fd = c.fd;
+    s->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    s->buf_group = GWSUring::BUFFER_GROUP;
+    s->ioprio = IORING_RECV_MULTISHOT;
+    c.receiving = true;
+}
+
+// Hand the front piece of c's output to the kernel as one linked chain:
+// its bytes, then the next chunk of its file (read, then sent), then a
+// close if that is the last of it and the connection is closing. Sends
+// use MSG_WAITALL, so each either completes or fails and breaks the chain.
+void GWSServer::Worker::pump(Connection& c) {
+    if (c.sending || c.out.empty() || c.failed || c.retired) return;
+    OutPiece& piece = c.out.front();
+    struct io_uring_sqe* last = nullptr;
+    auto add = [&](unsigned op) {
+        struct io_uring_sqe* s = prepare(&c, op);
+        if (!s) {
+            c.failed = true;
+            return s;
+        }
+        if (last) last->flags |= IOSQE_IO_LINK;
+        last = s;
+        return s;
+    };
+    bool whole = true;
+    if (c.outPos < piece.bytes.size()) {
+        struct io_uring_sqe* s = add(OP_SEND);
+        if (!s) return;
+        s->opcode = IORING_OP_SEND;
+        s->fd = c.fd;
+        s->flags = IOSQE_FIXED_FILE;
+        s->addr = reinterpret_cast<uint64_t>(piece.bytes.data() + c.outPos);
+        s->len = static_cast<uint32_t>(piece.bytes.size() - c.outPos);
+        s->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        c.chainOps++;
+    }
+    if (piece.length > 0) {
+        if (!c.chunk) c.chunk.reset(new char[FILE_CHUNK]);
+        c.chunkSize = std::min(piece.length, FILE_CHUNK);
+        whole = c.chunkSize == piece.length;
+        struct io_uring_sqe* s = add(OP_READ);
+        if (!s) return;
+        s->opcode = IORING_OP_READ;
+        s->fd = piece.file->fd;
+        s->addr = reinterpret_cast<uint64_t>(c.chunk.get());
+        s->len = static_cast<uint32_t>(c.chunkSize);
+        s->off = static_cast<uint64_t>(piece.offset);
+        c.chainOps++;
+        s = add(OP_SEND_CHUNK);
+        if (!s) return;
+        s->opcode = IORING_OP_SEND;
+        s->fd = c.fd;
+        s->flags = IOSQE_FIXED_FILE;
+        s->addr = reinterpret_cast<uint64_t>(c.chunk.get());
+        s->len = static_cast<uint32_t>(c.chunkSize);
+        s->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        c.chainOps++;
+    }
+    c.sending = 1;
+    if (c.closing && whole && c.out.size() == 1 && !c.closeQueued) {
+        if (add(OP_CLOSE)) {
+            last->opcode = IORING_OP_CLOSE;
+            last->file_index = static_cast<uint32_t>(c.fd) + 1;
+            c.closeQueued = true;
+        }
+    }
+}
+
+void GWSServer::Worker::closeSlot(Connection& c) {
+    if (struct io_uring_sqe* s = prepare(&c, OP_CLOSE)) {
+        s->opcode = IORING_OP_CLOSE;
+        s->file_index = static_cast<uint32_t>(c.fd) + 1;
+        c.closeQueued = true;
+    }
+}
+
+// Stop receiving and close c; it is deleted when its last completion is in
+void GWSServer::Worker::retire(Connection& c) {
+    if (c.retired) return;
+    c.retired = true;
+    if (c.receiving) {
+        if (struct io_uring_sqe* s = prepare(nullptr, OP_CANCEL)) {
+            s->opcode = IORING_OP_ASYNC_CANCEL;
+            s->addr = reinterpret_cast<uint64_t>(&c) | OP_RECV;
+        }
+    }
+    if (!c.closeQueued) closeSlot(c);
+}
+
+// Decide what c does next after a completion
+void GWSServer::Worker::settle(Connection& c) {
+    if (c.retired) {
+        if (c.ops == 0) {
+            connections.erase(&c);
+            delete &c;
+            if (acceptPaused) armAccept();
+        }
+        return;
+    }
+    if (c.failed) {
+        retire(c);
+        return;
+    }
+    if (!c.sending) {
+        // A drained backlog may let a stalled pipeline continue
+        if (c.out.empty() && c.inPos < c.in.size() && !c.closing) process(c);
+        pump(c);
+        if (c.failed) {
+            retire(c);
+            return;
+        }
+    }
+    if ((c.closing || c.ended) && c.out.empty() && !c.sending) {
+        retire(c);
+        return;
+    }
+    if (!c.receiving && !c.ended) armRecv(c);
+}
+
+void GWSServer::Worker::complete(const struct io_uring_cqe& e) {
+    bool last = !(e.flags & IORING_CQE_F_MORE);
+    if (last) pending--;
+    auto* c = reinterpret_cast<Connection*>(e.user_data & ~OP_MASK);
+    unsigned op = static_cast<unsigned>(e.user_data & OP_MASK);
+    if (e.flags & IORING_CQE_F_BUFFER) {
+        uint16_t id = static_cast<uint16_t>(e.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (c && e.res > 0 && !c->retired && !draining) c->in.append(ring->buffer(id), e.res);
+        ring->recycle(id);
+    }
+
+    if (!c) {
+        if (draining) return;
+        if (op == OP_ACCEPT) {
+            if (e.res >= 0) {
+                auto* accepted = new Connection();
+                accepted->fd = e.res;
+                connections.insert(accepted);
+                armRecv(*accepted);
+            }
+            // A full file table waits for a connection to close
+            if (last && e.res == -ENFILE) acceptPaused = true;
+            else if (last) armAccept();
+        } else if (op == OP_WATCH) {
+            files.refresh();
+        }
+        return;
+    }
+
+    if (last) c->ops--;
+    if (draining) return;
+    switch (op) {
+    case OP_RECV:
+        if (last) c->receiving = false;
+        if (c->retired) break;
+        if (e.res > 0) {
+            process(*c);
+        } else if (e.res == 0) {
+            c->ended = true;
+            c->closing = true;
+        } else if (e.res != -ENOBUFS && e.res != -ECANCELED) {
+            c->failed = true;  // ENOBUFS only ends the multishot; it is rearmed
+        }
+        break;
+    case OP_SEND:
+        c->chainOps--;
+        if (e.res < 0 || static_cast<size_t>(e.res) != c->out.front().bytes.size() - c->outPos) {
+            c->failed = true;
+        } else {
+            c->outBytes -= e.res;
+            c->outPos += e.res;
+        }
+        break;
+    case OP_READ:
+        // A file that shrank cannot fill the length already promised
+        c->chainOps--;
+        if (e.res != static_cast<int>(c->chunkSize)) c->failed = true;
+        break;
+    case OP_SEND_CHUNK:
+        c->chainOps--;
+        if (e.res != static_cast<int>(c->chunkSize)) {
+            c->failed = true;
+        } else {
+            OutPiece& piece = c->out.front();
+            piece.offset += e.res;
+            piece.length -= e.res;
+            c->outBytes -= e.res;
+        }
+        break;
+    case OP_CLOSE:
+        // Linked behind a send that failed: close it on its own
+        if (e.res == -ECANCELED) {
+            c->closeQueued = false;
+            if (c->retired) closeSlot(*c);
+        }
+        break;
+    }
+    if (c->chainOps == 0 && c->sending) {
+        c->sending = 0;
+        OutPiece& piece = c->out.front();
+        if (!c->failed && c->outPos == piece.bytes.size() && piece.length == 0) {
+            c->out.pop_front();
+            c->outPos = 0;
+            c->chunk.reset();
+        }
+    }
+    settle(*c);
+}
@@ -0,0 +1,178 @@
+#ifndef GWS_SERVER_H
+#define GWS_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gws_router.h"
+
+// A complete response prepared before serving starts. head holds the
+// status line and every header except Date and Connection, which depend
+// on the moment and on the request; a hit is then written as head, date,
+// connection and body in one writev.
+struct GWSResponse {
+    std::string head;
+    std::string body;
+};
+
+// Content codings a route can be prepared in
+enum GWSEncoding { GWS_IDENTITY, GWS_GZIP, GWS_DEFLATE, GWS_ENCODINGS };
+
+// Every prepared form of one route. Bodies are compressed once at start
+// (builds with zlib only) and a coding is offered only if it came out
+// smaller; its head is empty otherwise. Each coding has its own strong
+// ETag and a ready 304 for If-None-Match.
+struct GWSResource {
+    GWSResponse full[GWS_ENCODINGS];
+    GWSResponse notModified[GWS_ENCODINGS];
+    std::string etag[GWS_ENCODINGS];  // quoted
+    std::shared_ptr<const void> handler;  // a dynamic route: nothing is prepared
+};
+
+// A page defined with .GWS.route ... .GWS.endroute, or with handler set a
+// .GWS.handler block, answered per request by the workers' GWSHandler
+struct GWSRoute {
+    int method;  // GWSMethod or GWS_ANY
+    std::string path;
+    std::string html;
+    std::shared_ptr<const void> handler;
+};
+
+// A request as a dynamic route sees it. Everything points into the
+// connection's input or the route table and is valid until the handler
+// returns.
+struct GWSRequest {
+    int method;  // GWSMethod
+    const char* methodName;
+    size_t methodNameSize;
+    const char* path;  // as sent, not decoded
+    size_t pathSize;
+    const char* query;  // after '?', empty if there is none
+    size_t querySize;
+    const char* headers;  // the header lines, each ending in CRLF
+    size_t headersSize;
+    const char* body;
+    size_t bodySize;
+    const GWSMatch* match;  // the route's parameters
+};
+
+// What a dynamic route answers with
+struct GWSReply {
+    int status = 200;
+    std::string type = "text/html; charset=utf-8";
+    std::string body;
+};
+
+// Answers dynamic routes. The server makes one per worker, on that
+// worker's thread, and only that thread ever calls it: handlers run
+// concurrently with nothing shared and no locks.
+class GWSHandler {
+public:
+    virtual ~GWSHandler() = default;
+    // Answer request with handler (a GWSRoute::handler); false gives a 500
+    virtual bool handle(const void* handler, const GWSRequest& request, GWSReply& reply) = 0;
+};
+
+// A directory served under a URL prefix with .GWS.static
+struct GWSMount {
+    std::string prefix;  // without a trailing '/'
+    std::string dir;
+};
+
+// Event loop the workers run (.GWS.engine)
+enum GWSEngine { GWS_ENGINE_EPOLL, GWS_ENGINE_URING };
+
+// The in-process HTTP/1.1 server behind .GWS.serve. One worker per core
+// owns its own SO_REUSEPORT listening socket and event loop, so the
+// kernel spreads connections and workers share nothing but the read-only
+// route table. Connections are kept alive and pipelined requests are
+// answered in a single write. The loop is edge-triggered epoll, or with
+// GWS_ENGINE_URING an io_uring ring per worker: multishot accept into
+// registered files, multishot receive into provided buffers and linked
+// sends, so a busy worker makes one system call per batch of completions.
+// Dynamic routes are answered on the worker that received the request, by
+// a GWSHandler of its own.
+class GWSServer {
+public:
+    explicit GWSServer(int port);
+    ~GWSServer();
+    GWSServer(const GWSServer&) = delete;
+    GWSServer& operator=(const GWSServer&) = delete;
+
+    // Serve route.html for requests whose path (the target up to '?')
+    // matches the route's pattern (see GWSRouter); a later route for the
+    // same method and pattern replaces the earlier one. False with error()
+    // set if the pattern is malformed or conflicts with an earlier one.
+    bool route(const GWSRoute& route);
+
+    // Serve the files below dir at prefix/...; a directory gives its
+    // index.html. False with error() set if dir is not a directory or the
+    // prefix conflicts with a route.
+    bool mount(const std::string& prefix, const std::string& dir);
+
+    // How workers make their GWSHandler, needed if any route is dynamic;
+    // set before start()
+    void handlers(std::function<std::unique_ptr<GWSHandler>()> make) { makeHandler = std::move(make); }
+
+    // Forget the routes and mounts added so far, to stage a new set
+    void reset();
+    // Swap the staged routes and mounts in while serving. The new table is
+    // built on the calling thread, bodies compressed and all, then
+    // published with one atomic store: requests already being answered
+    // finish on the old table, which is freed after a grace period in
+    // which every worker has gone idle or started a new batch. The
+    // listeners stay open throughout.
+    void publish();
+
+    // Bind and start the workers; false with error() set. If io_uring is
+    // asked for but unavailable, the workers run epoll instead and error()
+    // says why.
+    bool start(unsigned workers = 0, GWSEngine engine = GWS_ENGINE_EPOLL);
+    // Stop the workers and close every socket
+    void stop();
+    // Block until SIGINT (Ctrl+C), which is consumed so the script goes on
+    // and gives false, or until fd (if not -1) is readable, giving true
+    bool wait(int fd = -1);
+
+    int port() const { return listenPort; }
+    GWSEngine engine() const { return engineInUse; }
+    // Requests answered between the last start() and stop()
+    uint64_t served() const { return servedCount; }
+    const std::string& error() const { return message; }
+
+private:
+    struct Worker;
+    struct Table;
+
+    int listenPort;
+    GWSEngine engineInUse;
+    uint64_t servedCount;
+    // Staged by route() and mount()
+    std::vector<GWSRoute> routes;
+    GWSRouter checked;  // never built; vets patterns as they are added
+    std::vector<GWSMount> mounts;
+    // What workers match against, replaced whole by publish()
+    std::atomic<const Table*> table;
+    std::atomic<uint64_t> epoch;  // counts publications, for the grace period
+    std::function<std::unique_ptr<GWSHandler>()> makeHandler;
+    GWSResponse notFound;
+    GWSResponse notAllowed[1 << GWS_METHODS];  // by GWSMatch::allowed
+    GWSResponse notImplemented;
+    GWSResponse internalError;
+    GWSResponse badRequest;
+    std::vector<Worker*> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::string message;
+
+    Table* build() const;
+    // The prepared route for a request, or nullptr and the mount serving it
+    static const GWSResource* lookup(const Table& table, int method, const char* path, size_t size,
+                                     GWSMatch& match, const GWSMount*& mount);
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "gws_static.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Files up to this size are mapped and written together with their headers
+static const size_t MAP_LIMIT = 256 * 1024;
+
+GWSStaticFile::~GWSStaticFile() {
+    if (data) munmap(const_cast<char*>(data), size);
+    if (fd >= 0) close(fd);
+}
+
+GWSStaticCache::GWSStaticCache(size_t capacity) : capacity(capacity) {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+GWSStaticCache::~GWSStaticCache() {
+    if (inotifyFd >= 0) close(inotifyFd);
+}
+
+std::shared_ptr<GWSStaticFile> GWSStaticCache::load(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return nullptr;
+    }
+    auto file = std::make_shared<GWSStaticFile>();
+    file->fd = fd;
+    file->size = static_cast<size_t>(st.st_size);
+    file->mtime = st.st_mtime;
+    file->mime = gwsMimeType(path);
+    gwsHttpDate(st.st_mtime, file->lastModified);
+    if (file->size > 0 && file->size <= MAP_LIMIT) {
+        void* map = mmap(nullptr, file->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) file->data = static_cast<const char*>(map);
+    }
+    return file;
+}
+
+std::shared_ptr<GWSStaticFile> GWSStaticCache::open(const std::string& path) {
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        uses.splice(uses.begin(), uses, it->second.use);
+        return it->second.file;
+    }
+
+    std::string real = path;
+    struct stat st;
+    if (stat(real.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (real.empty() || real.back() != '/') real += '/';
+        real += "index.html";
+    }
+    // Watch before opening, so a change in between is not missed
+    watch(real);
+    auto file = load(real);
+    if (!file) return nullptr;
+
+    if (entries.size() >= capacity && !uses.empty()) {
+        entries.erase(uses.back());
+        uses.pop_back();
+    }
+    uses.push_front(path);
+    entries[path] = Entry{file, uses.begin()};
+    return file;
+}
+
+void GWSStaticCache::watch(const std::string& path) {
+    if (inotifyFd < 0) return;
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    if (dirWatches.count(dir)) return;
+    int wd = inotify_add_watch(inotifyFd, dir.c_str(),
+                               IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                               IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    if (wd < 0) return;
+    watchedDirs[wd] = dir;
+    dirWatches[dir] = wd;
+}
+
+void GWSStaticCache::drop(const std::string& path) {
+    auto it = entries.find(path);
+    if (it == entries.end()) return;
+    uses.erase(it->second.use);
+    entries.erase(it);
+}
+
+void GWSStaticCache::refresh() {
+    alignas(struct inotify_event) char buf[16 * 1024];
+    while (true) {
+        ssize_t n = read(inotifyFd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        for (char* p = buf; p < buf + n;) {
+            auto* ev = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                entries.clear();
+                uses.clear();
+                continue;
+            }
+            auto dir = watchedDirs.find(ev->wd);
+            if (dir == watchedDirs.end()) continue;
+            if (ev->mask & IN_IGNORED) {
+                dirWatches.erase(dir->second);
+                watchedDirs.erase(dir);
+                continue;
+            }
+            if (ev->len == 0) continue;
+            // Entries are keyed by the requested path, which for a
+            // directory differs from the file served; drop both forms
+            std::string path = (dir->second == "/" ? "" : dir->second) + "/" + ev->name;
+            drop(path);
+            if (strcmp(ev->name, "index.html") == 0) {
+                drop(dir->second);
+                drop(dir->second + "/");
+            }
+        }
+    }
+}
+
+const char* gwsMimeType(const std::string& path) {
+    static const struct {
+        const char* ext;
+        const char* type;
+    } types[] = {
+        {"html", "text/html; charset=utf-8"}, {"htm", "text/html; charset=utf-8"},
+        {"css", "text/css; charset=utf-8"}, {"js", "text/javascript; charset=utf-8"},
+        {"mjs", "text/javascript; charset=utf-8"}, {"json", "application/json"},
+        {"map", "application/json"}, {"txt", "text/plain; charset=utf-8"},
+        {"md", "text/markdown; charset=utf-8"}, {"csv", "text/csv; charset=utf-8"},
+        {"xml", "application/xml"}, {"gn", "text/plain; charset=utf-8"},
+        {"svg", "image/svg+xml"}, {"png", "image/png"}, {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"}, {"gif", "image/gif"}, {"webp", "image/webp"},
+        {"avif", "image/avif"}, {"ico", "image/x-icon"}, {"bmp", "image/bmp"},
+        {"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"}, {"otf", "font/otf"},
+        {"mp4", "video/mp4"}, {"webm", "video/webm"}, {"ogv", "video/ogg"}, {"mov", "video/quicktime"},
+        {"mp3", "audio/mpeg"}, {"ogg", "audio/ogg"}, {"wav", "audio/wav"}, {"flac", "audio/flac"},
+        {"m4a", "audio/mp4"}, {"pdf", "application/pdf"}, {"zip", "application/zip"},
+        {"gz", "application/gzip"}, {"tar", "application/x-tar"}, {"wasm", "application/wasm"},
+    };
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return "application/octet-stream";
+    std::string ext = path.substr(dot + 1);
+    for (auto& c : ext) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    for (auto& t : types) {
+        if (ext == t.ext) return t.type;
+    }
+    return "application/octet-stream";
+}
+
+static const char* const DAYS[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+static const char* const MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+size_t gwsHttpDate(time_t t, char* out) {
+    // Formatted by hand: strftime's names would follow the locale
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return static_cast<size_t>(snprintf(out, 30, "%s, %02d %s %04d %02d:%02d:%02d GMT", DAYS[tm.tm_wday],
+                                        tm.tm_mday, MONTHS[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour,
+                                        tm.tm_min, tm.tm_sec));
+}
+
+bool gwsParseHttpDate(const char* s, size_t size, time_t& t) {
+    // IMF-fixdate only; the obsolete formats are rare enough to ignore
+    if (size != 29 || s[3] != ',' || memcmp(s + 25, " GMT", 4) != 0) return false;
+    char buf[30];
+    memcpy(buf, s, 29);
+    buf[29] = '\0';
+    int day, year, hour, minute, second;
+    char month[4];
+    if (sscanf(buf + 5, "%2d %3s %4d %2d:%2d:%2d", &day, month, &year, &hour, &minute, &second) != 6)
+        return false;
+    struct tm tm = {};
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++) {
+        if (strcmp(month, MONTHS[i]) == 0) tm.tm_mon = i;
+    }
+    if (tm.tm_mon < 0) return false;
+    tm.tm_mday = day;
+    tm.tm_year = year - 1900;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    t = timegm(&tm);
+    return true;
+}
+
+// Digits at s[i..n) as a number; false if there are none or too many
+static bool rangeNumber(const char* s, size_t n, size_t& i, size_t& value) {
+    size_t start = i;
+    value = 0;
+    while (i < n && s[i] >= '0' && s[i] <= '9') {
+        if (value > (SIZE_MAX - 9) / 10) return false;
+        value = value * 10 + (s[i++] - '0');
+    }
+    return i > start;
+}
+
+int gwsParseRange(const char* s, size_t n, size_t size, size_t& first, size_t& last) {
+    if (n < 6 || memcmp(s, "bytes=", 6) != 0) return 0;
+    // Only a single range is served; lists fall back to the whole file
+    if (memchr(s, ',', n)) return 0;
+    size_t i = 6;
+    while (i < n && s[i] == ' ') i++;
+    size_t a = 0, b = 0;
+    if (i < n && s[i] == '-') {
+        // Suffix: the last b bytes
+        i++;
+        if (!rangeNumber(s, n, i, b) || i != n) return 0;
+        if (b == 0 || size == 0) return -1;
+        first = b >= size ? 0 : size - b;
+        last = size - 1;
+        return 1;
+    }
+    if (!rangeNumber(s, n, i, a) || i >= n || s[i] != '-') return 0;
+    i++;
+    bool open = i == n;
+    if (!open && (!rangeNumber(s, n, i, b) || i != n || b < a)) return 0;
+    if (a >= size) return -1;
+    first = a;
+    last = open || b >= size ? size - 1 : b;
+    return 1;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool gwsDecodePath(const char* s, size_t n, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < n; i++) {
+        char c = s[i];
+        if (c == '%' && i + 2 < n) {
+            int hi = hexValue(s[i + 1]);
+            int lo = hexValue(s[i + 2]);
+            if (hi >= 0 && lo >= 0) {
+                c = static_cast<char>(hi * 16 + lo);
+                i += 2;
+            }
+        }
+        if (c == '\0') return false;
+        out += c;
+    }
+    // No segment may climb out of the served directory
+    size_t start = 0;
+    while (start <= out.size()) {
+        size_t end = out.find('/', start);
+        if (end == std::string::npos) end = out.size();
+        if (end - start == 2 && out.compare(start, 2, "..") == 0) return false;
+        start = end + 1;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef GWS_STATIC_H
+#define GWS_STATIC_H
+
+#include <cstddef>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// An open file served by .GWS.static. Small files are also mapped, so
+// they go out in the same writev as their headers; larger ones are sent
+// from fd with sendfile. Closed when the last response using it is done.
+struct GWSStaticFile {
+    int fd = -1;
+    size_t size = 0;
+    time_t mtime = 0;
+    const char* mime = "";
+    char lastModified[32] = "";  // IMF-fixdate
+    const char* data = nullptr;  // the whole file, if mapped
+
+    GWSStaticFile() = default;
+    ~GWSStaticFile();
+    GWSStaticFile(const GWSStaticFile&) = delete;
+    GWSStaticFile& operator=(const GWSStaticFile&) = delete;
+};
+
+// Per-worker LRU cache of open files and their stat results. Directories
+// holding cached files are watched with inotify; when one reports a
+// change, the affected entries are dropped so the next request reopens
+// the file. Nothing is shared between workers, so no locks are taken.
+class GWSStaticCache {
+public:
+    explicit GWSStaticCache(size_t capacity = 1024);
+    ~GWSStaticCache();
+    GWSStaticCache(const GWSStaticCache&) = delete;
+    GWSStaticCache& operator=(const GWSStaticCache&) = delete;
+
+    // The regular file at path, or the index.html of a directory;
+    // nullptr if there is none that can be read
+    std::shared_ptr<GWSStaticFile> open(const std::string& path);
+
+    // inotify descriptor; when it is readable, call refresh()
+    int watchFd() const { return inotifyFd; }
+    void refresh();
+
+private:
+    struct Entry {
+        std::shared_ptr<GWSStaticFile> file;
+        std::list<std::string>::iterator use;
+    };
+    size_t capacity;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> uses;  // most recently used first
+    int inotifyFd;
+    std::unordered_map<int, std::string> watchedDirs;  // by watch descriptor
+    std::unordered_map<std::string, int> dirWatches;
+
+    std::shared_ptr<GWSStaticFile> load(const std::string& path);
+    void watch(const std::string& path);
+    void drop(const std::string& path);
+};
+
+// Content-Type for a file name, by extension
+const char* gwsMimeType(const std::string& path);
+
+// t as an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"); out needs 30 bytes
+size_t gwsHttpDate(time_t t, char* out);
+// Parse an HTTP date; false if it is not one
+bool gwsParseHttpDate(const char* s, size_t size, time_t& t);
+
+// A Range header against a file of size bytes: 1 and the inclusive span
+// if it asks for one satisfiable range, -1 if nothing in it can be
+// satisfied (416), 0 if it should be ignored and the whole file sent
+int gwsParseRange(const char* s, size_t n, size_t size, size_t& first, size_t& last);
+
+// Percent-decode a request path into out; false if it contains a NUL or
+// a ".." segment and must not be mapped onto the file system
+bool gwsDecodePath(const char* s, size_t n, std::string& out);
+
+#endif
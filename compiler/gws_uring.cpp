@@ -0,0 +1,165 @@
+#include "gws_uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+static int uringSetup(unsigned entries, struct io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+static void* mapRing(int fd, size_t size, off_t offset) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+GWSUring::~GWSUring() {
+    if (sqes) munmap(sqes, sqesSize);
+    if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing) munmap(sqRing, sqRingSize);
+    if (ringFd >= 0) close(ringFd);
+    if (bufferRing) munmap(bufferRing, bufferRingSize);
+    if (buffers) munmap(buffers, buffersSize);
+}
+
+bool GWSUring::init(unsigned entries, unsigned files, unsigned bufferCount, unsigned size, std::string& error) {
+    // Deferred task running needs 6.1; single issuer alone is the 6.0
+    // baseline that multishot receive and provided buffer rings need
+    const unsigned attempts[] = {IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN, IORING_SETUP_SINGLE_ISSUER};
+    struct io_uring_params p;
+    for (unsigned flags : attempts) {
+        memset(&p, 0, sizeof(p));
+        p.flags = flags | IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;  // multishot requests complete many times
+        ringFd = uringSetup(entries, &p);
+        if (ringFd >= 0 || errno != EINVAL) break;
+    }
+    if (ringFd < 0) {
+        if (errno == ENOSYS) error = "not supported by this kernel";
+        else if (errno == EPERM) error = "disabled (kernel.io_uring_disabled)";
+        else if (errno == EINVAL) error = "needs Linux 6.0 or later";
+        else error = strerror(errno);
+        return false;
+    }
+
+    sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = cqRing = mapRing(ringFd, sqRingSize, IORING_OFF_SQ_RING);
+    } else {
+        sqRing = mapRing(ringFd, sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = mapRing(ringFd, cqRingSize, IORING_OFF_CQ_RING);
+    }
+    sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(mapRing(ringFd, sqesSize, IORING_OFF_SQES));
+    if (!sqRing || !cqRing || !sqes) {
+        error = std::string("cannot map the ring: ") + strerror(errno);
+        return false;
+    }
+    char* sq = static_cast<char*>(sqRing);
+    char* cq = static_cast<char*>(cqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries = p.sq_entries;
+    // Slot i always holds entry i, so only the tail moves
+    unsigned* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < sqEntries; i++) array[i] = i;
+    sqeTail = submitted = *sqTail;
+    cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    // Entering through a registered ring index skips a descriptor lookup
+    enterFd = ringFd;
+    struct io_uring_rsrc_update ringUpdate = {};
+    ringUpdate.offset = ~0u;
+    ringUpdate.data = static_cast<uint64_t>(ringFd);
+    if (uringRegister(ringFd, IORING_REGISTER_RING_FDS, &ringUpdate, 1) == 1) {
+        enterFd = static_cast<int>(ringUpdate.offset);
+        enterFlags = IORING_ENTER_REGISTERED_RING;
+    }
+
+    std::vector<int> sparse(files, -1);
+    if (uringRegister(ringFd, IORING_REGISTER_FILES, sparse.data(), files) != 0) {
+        error = std::string("cannot register files: ") + strerror(errno);
+        return false;
+    }
+
+    bufferMask = bufferCount - 1;
+    bufferSize = size;
+    bufferRingSize = bufferCount * sizeof(struct io_uring_buf);
+    buffersSize = static_cast<size_t>(bufferCount) * size;
+    void* ring = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* data = mmap(nullptr, buffersSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring != MAP_FAILED) bufferRing = static_cast<struct io_uring_buf_ring*>(ring);
+    if (data != MAP_FAILED) buffers = static_cast<char*>(data);
+    if (!bufferRing || !buffers) {
+        error = std::string("cannot allocate receive buffers: ") + strerror(errno);
+        return false;
+    }
+    struct io_uring_buf_reg reg = {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+    reg.ring_entries = bufferCount;
+    reg.bgid = BUFFER_GROUP;
+    if (uringRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        error = std::string("cannot register a buffer ring: ") + strerror(errno);
+        return false;
+    }
+    for (unsigned i = 0; i < bufferCount; i++) recycle(static_cast<uint16_t>(i));
+    return true;
+}
+
+struct io_uring_sqe* GWSUring::sqe() {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+        if (sqeTail - head < sqEntries) {
+            struct io_uring_sqe* e = &sqes[sqeTail & sqMask];
+            sqeTail++;
+            memset(e, 0, sizeof(*e));
+            return e;
+        }
+        if (submit(false) < 0) break;
+    }
+    return nullptr;
+}
+
+int GWSUring::submit(bool wait) {
+    __atomic_store_n(sqTail, sqeTail, __ATOMIC_RELEASE);
+    unsigned flags = enterFlags | (wait ? IORING_ENTER_GETEVENTS : 0);
+    int n = static_cast<int>(syscall(__NR_io_uring_enter, enterFd, sqeTail - submitted, wait ? 1 : 0, flags, nullptr, 0));
+    if (n < 0) return -errno;
+    submitted += static_cast<unsigned>(n);
+    return n;
+}
+
+unsigned GWSUring::ready() const {
+    return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) - *cqHead;
+}
+
+const struct io_uring_cqe& GWSUring::at(unsigned i) const {
+    return cqes[(*cqHead + i) & cqMask];
+}
+
+void GWSUring::consume(unsigned count) {
+    __atomic_store_n(cqHead, *cqHead + count, __ATOMIC_RELEASE);
+}
+
+void GWSUring::recycle(uint16_t id) {
+    unsigned short tail = bufferRing->tail;
+    // Indexed by hand: in C++ the header's flexible bufs member does not start at offset 0
+    struct io_uring_buf* b = reinterpret_cast<struct io_uring_buf*>(bufferRing) + (tail & bufferMask);
+    b->addr = reinterpret_cast<uint64_t>(buffer(id));
+    b->len = static_cast<uint32_t>(bufferSize);
+    b->bid = id;
+    __atomic_store_n(&bufferRing->tail, static_cast<unsigned short>(tail + 1), __ATOMIC_RELEASE);
+}
@@ -0,0 +1,70 @@
+#ifndef GWS_URING_H
+#define GWS_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <linux/io_uring.h>
+
+// A small io_uring on the raw system calls, for the OpenGWS io_uring
+// engine. The ring is single-issuer (Linux 6.0 and later), so it must be
+// set up, submitted to and reaped from by one thread. It also owns a
+// sparse table of registered files and one ring of provided buffers for
+// multishot receives.
+class GWSUring {
+public:
+    GWSUring() = default;
+    ~GWSUring();
+    GWSUring(const GWSUring&) = delete;
+    GWSUring& operator=(const GWSUring&) = delete;
+
+    // Set up a ring with entries submission slots, a sparse table of
+    // files registered files and bufferCount provided buffers of
+    // bufferSize bytes (both powers of two); false with error set
+    bool init(unsigned entries, unsigned files, unsigned bufferCount, unsigned bufferSize, std::string& error);
+
+    // A cleared submission entry; submits what is queued if the ring is full
+    struct io_uring_sqe* sqe();
+    // Submit the queued entries and, if wait, block for a completion;
+    // the negated errno on failure
+    int submit(bool wait);
+
+    // Completions are read in place: for (i < ready()) at(i), then consume(n)
+    unsigned ready() const;
+    const struct io_uring_cqe& at(unsigned i) const;
+    void consume(unsigned count);
+
+    // Provided buffers, by the id a completion reports
+    char* buffer(uint16_t id) const { return buffers + static_cast<size_t>(id) * bufferSize; }
+    void recycle(uint16_t id);
+    static const uint16_t BUFFER_GROUP = 0;
+
+private:
+    int ringFd = -1;
+    int enterFd = -1;        // registered ring index, or ringFd
+    unsigned enterFlags = 0;
+    void* sqRing = nullptr;
+    size_t sqRingSize = 0;
+    void* cqRing = nullptr;  // sqRing when the kernel maps both at once
+    size_t cqRingSize = 0;
+    struct io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned sqeTail = 0;    // entries handed out, not all submitted yet
+    unsigned submitted = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    struct io_uring_cqe* cqes = nullptr;
+    struct io_uring_buf_ring* bufferRing = nullptr;
+    size_t bufferRingSize = 0;
+    unsigned bufferMask = 0;
+    char* buffers = nullptr;
+    size_t bufferSize = 0;
+    size_t buffersSize = 0;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "int_cache.h"
+#include "content_hash.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static bool readWholeFile(const std::string& path, std::string& data) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    data = buffer.str();
+    return true;
+}
+
+// Write via a temp file + rename so concurrent workers never see partial files
+static bool writeWholeFile(const std::string& path, const std::string& data) {
+    std::string tmp = path + ".tmp" + std::to_string(getpid()) + "_" +
+                      std::to_string(reinterpret_cast<uintptr_t>(&data));
+    {
+        std::ofstream f(tmp, std::ios::binary);
+        if (!f.is_open()) return false;
+        f << data;
+        if (!f.good()) return false;
+    }
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+int runIntShell(const std::string& body, std::string& output) {
+    if (body.empty()) return 0;
+    std::string script = "{\n" + body + "\n} 2>&1";
+    FILE* pipe = popen(script.c_str(), "r");
+    if (!pipe) return -1;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), pipe)) > 0) {
+        output.append(buf, n);
+    }
+    int status = pclose(pipe);
+    if (status > 0 && WIFEXITED(status)) return WEXITSTATUS(status);
+    return status;
+}
+
+IntCache::IntCache(const std::string& cacheDir) : dir(cacheDir), hitCount(0), missCount(0) {}
+
+bool IntCache::ensureDirs() {
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/objects").c_str(), 0755);
+    mkdir((dir + "/actions").c_str(), 0755);
+    struct stat st;
+    return stat((dir + "/actions").c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+std::string IntCache::objectPath(const std::string& hash) const {
+    return dir + "/objects/" + hash;
+}
+
+std::string IntCache::putObject(const std::string& data) {
+    std::string hash = sha256Hex(data);
+    std::string path = objectPath(hash);
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        writeWholeFile(path, data);
+    }
+    return hash;
+}
+
+std::string IntCache::key(const std::string& body, const IntCacheSpec& spec) const {
+    Sha256 h;
+    h.update("intcache-v1\n");
+    h.update("body " + std::to_string(body.size()) + "\n");
+    h.update(body);
+
+    char cwd[1024];
+    if (getcwd(cwd, sizeof(cwd)) != nullptr) {
+        h.update(std::string("\ncwd ") + cwd);
+    }
+    for (auto& in : spec.inputs) {
+        std::string digest = sha256File(in);
+        h.update("\nin " + in + " " + (digest.empty() ? "missing" : digest));
+    }
+    for (auto& name : spec.env) {
+        const char* val = getenv(name.c_str());
+        h.update("\nenv " + name + (val ? std::string("=") + val : std::string(" unset")));
+    }
+    for (auto& out : spec.outputs) {
+        h.update("\nout " + out);
+    }
+    return h.hexDigest();
+}
+
+bool IntCache::replay(const std::string& key, std::string& output) {
+    std::string action;
+    if (!readWholeFile(dir + "/actions/" + key, action)) {
+        missCount++;
+        return false;
+    }
+
+    // Verify every object exists before touching the working tree
+    std::string stdoutHash;
+    std::vector<std::pair<std::string, std::string>> outputs;  // path, hash
+    std::vector<mode_t> modes;
+    std::stringstream lines(action);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::stringstream ls(line);
+        std::string kind;
+        ls >> kind;
+        if (kind == "stdout") {
+            ls >> stdoutHash;
+        } else if (kind == "output") {
+            unsigned int mode = 0644;
+            std::string hash, path;
+            ls >> std::oct >> mode >> hash;
+            std::getline(ls, path);
+            if (!path.empty() && path[0] == ' ') path.erase(0, 1);
+            outputs.push_back({path, hash});
+            modes.push_back(static_cast<mode_t>(mode));
+        }
+    }
+
+    std::string captured;
+    if (stdoutHash.empty() || !readWholeFile(objectPath(stdoutHash), captured)) {
+        missCount++;
+        return false;
+    }
+    std::vector<std::string> contents(outputs.size());
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (!readWholeFile(objectPath(outputs[i].second), contents[i])) {
+            missCount++;
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const std::string& path = outputs[i].first;
+        // Leave identical outputs untouched so their mtime stays stable
+        if (sha256File(path) != outputs[i].second) {
+            writeWholeFile(path, contents[i]);
+        }
+        chmod(path.c_str(), modes[i]);
+    }
+    output = captured;
+    hitCount++;
+    return true;
+}
+
+void IntCache::store(const std::string& key, const IntCacheSpec& spec, const std::string& output) {
+    if (!ensureDirs()) return;
+
+    std::string action = "stdout " + putObject(output) + "\n";
+    for (auto& out : spec.outputs) {
+        std::string data;
+        struct stat st;
+        if (stat(out.c_str(), &st) != 0 || !readWholeFile(out, data)) {
+            return;  // a declared output is missing - not a cacheable result
+        }
+        char mode[8];
+        snprintf(mode, sizeof(mode), "%o", static_cast<unsigned int>(st.st_mode & 07777));
+        action += std::string("output ") + mode + " " + putObject(data) + " " + out + "\n";
+    }
+    writeWholeFile(dir + "/actions/" + key, action);
+}
+
+int IntCache::run(const std::string& body, const IntCacheSpec& spec, std::string& output) {
+    std::string k = key(body, spec);
+    if (replay(k, output)) {
+        return 0;
+    }
+    int status = runIntShell(body, output);
+    if (status == 0) {
+        store(k, spec, output);
+    }
+    return status;
+}
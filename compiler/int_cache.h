@@ -0,0 +1,53 @@
+#ifndef INT_CACHE_H
+#define INT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+// Declared cache inputs/outputs of an INT command (.intcnf section keys)
+//   cache = on
+//   inputs = gen.py, schema.json
+//   outputs = gen/schema.h
+//   env = CC, CFLAGS
+struct IntCacheSpec {
+    bool enabled = false;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::vector<std::string> env;
+};
+
+// Content-addressed result cache for INT shell commands.
+// Layout: <dir>/objects/<sha256> holds captured stdout and output files,
+//         <dir>/actions/<key> lists the objects produced for one key.
+class IntCache {
+private:
+    std::string dir;
+    std::atomic<size_t> hitCount;
+    std::atomic<size_t> missCount;
+
+    std::string objectPath(const std::string& hash) const;
+    std::string putObject(const std::string& data);
+    bool ensureDirs();
+
+public:
+    explicit IntCache(const std::string& cacheDir = ".intcache");
+
+    // Key over command body, declared input file contents and environment
+    std::string key(const std::string& body, const IntCacheSpec& spec) const;
+    // On a hit, restore declared outputs and return the captured stdout
+    bool replay(const std::string& key, std::string& output);
+    void store(const std::string& key, const IntCacheSpec& spec, const std::string& output);
+
+    // Run body through the cache; returns the shell exit status
+    int run(const std::string& body, const IntCacheSpec& spec, std::string& output);
+
+    size_t hits() const { return hitCount; }
+    size_t misses() const { return missCount; }
+    const std::string& directory() const { return dir; }
+};
+
+// Run a shell command body, capturing stdout and stderr together
+int runIntShell(const std::string& body, std::string& output);
+
+#endif
@@ -1,5 +1,10 @@
 #include "interpreter.h"
 #include "ui_bridge.h"
+#include "gnel_native.h"
+#include "shell_session.h"
+#include "file_watcher.h"
+#include "gws_server.h"
+#include "gws_packages.h"
 #include <iostream>
 #include <fstream>
 #include <cmath>
@@ -12,24 +17,16 @@
 #include <chrono>
 #include <thread>
 #include <ctime>
-
-// Static variables for GeneiaUI script generation
-static std::string geneiaUIScript = "";
-static std::string geneiaUITitle = "Geneia Application";
-static std::string geneiaUITheme = "default";
-static std::string geneiaUIColor = "#3498db";
-static int geneiaUIElementY = 20;
-static int geneiaUIButtonCount = 0;
-static int geneiaUILabelCount = 0;
-
-// OpenGSL - Open Public Geneia Styling Library
-static std::string openGSLScript = "";
-static std::string openGSLTitle = "OpenGSL Canvas";
-static int openGSLWidth = 800;
-static int openGSLHeight = 600;
-static std::string openGSLBackground = "#FFFFFF";
-static std::string openGSLCurrentColor = "#3498db";
-static int openGSLShapeCount = 0;
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <iomanip>
+#include <glob.h>
+#include <sys/resource.h>
 
 // OpenGSL Named Shapes storage
 struct OpenGSLShape {
@@ -40,19 +37,6 @@ struct OpenGSLShape {
     int w, h, d;           // width, height, depth
     std::string color;     // color
 };
-static std::map<std::string, OpenGSLShape> openGSLShapes;
-static std::string openGSLCurrentShapeName = "";
-
-// G_Web.Kit - Web Module for generating websites (Geneia Web Kit)
-static std::string webHTML = "";
-static std::string webCSS = "";
-static std::string webJS = "";
-static std::string webTitle = "Geneia Website";
-static std::string webBgColor = "#ffffff";
-static std::string webTextColor = "#333333";
-static std::string webAccentColor = "#3498db";
-static std::string webFont = "Arial, sans-serif";
-static int webElementCount = 0;
 
 // G_Web.Kit Named Elements storage (like OpenGSL shapes)
 struct WebElement {
@@ -64,26 +48,21 @@ struct WebElement {
     std::string text;      // text content
     std::string link;      // link URL
 };
-static std::map<std::string, WebElement> webElements;
-static std::string webCurrentElementName = "";
 
-// OpenGWS - Open Public Geneia Web Server Services Kit
-// Package manager (like npm) + Web server (like node)
-// CLI: gwsl-get install <package>
-// Server: .GWS.serve (port)
-static std::vector<std::string> gwsInstalledPackages;
-static std::string gwsRegistry = "https://gwsl.geneia.dev/packages";
-static int gwsPort = 8080;
-static std::vector<std::pair<std::string, std::string>> gwsRoutes;
-static std::string gwsCurrentRoute = "/";
+// The variables and functions a script had at .GWS.serve, which its
+// handlers start from
+struct GWSPrelude {
+    std::map<std::string, Value> variables;
+    std::map<std::string, std::shared_ptr<ASTNode>> functions;
+};
 
-// OpenW2G - Open Public Web to Geneia Kit
-// Converts HTML/Web to Geneia code
-static std::string w2gInputHTML = "";
-static std::string w2gOutputGeneia = "";
+// A .GWS.handler block, what GWSRoute::handler points to
+struct GWSScript {
+    std::shared_ptr<ASTNode> body;
+    std::shared_ptr<GWSPrelude> prelude;
+};
 
-// G_Render - Universal Rendering Module
-// Render same UI to web, desktop, terminal, or other platforms
+// G_Render element
 struct RenderElement {
     std::string type;      // view, text, btn, img, nav, card, grid, list
     std::string id;        // element id
@@ -94,32 +73,252 @@ struct RenderElement {
     std::string bg;        // background
     std::vector<std::string> children; // child element ids
 };
-static std::map<std::string, RenderElement> renderElements;
-static std::string renderTarget = "web";  // web, desktop, term, json
-static std::string renderTitle = "Geneia App";
-static std::string renderTheme = "dark";
-static std::string renderAccent = "#00d4ff";
-static std::string renderBg = "#0a0a1a";
-static std::string renderText = "#f0f0f0";
-static std::string renderOutput = "";
 
-// OpenGNEL - Open Geneia Element LanScript
-// Command line scripting in Geneia syntax
-static std::string gnelScript = "";
-static std::string gnelWorkDir = ".";
-static std::vector<std::string> gnelHistory;
-static std::map<std::string, std::string> gnelAliases;
-static std::map<std::string, std::string> gnelEnvVars;
+// Module state, one set per Interpreter: OpenGWS handlers (.GWS.handler)
+// run on the server's worker threads, each with an interpreter of its own,
+// and INT runs Geneia bodies on scheduler threads for the interpreter that
+// loaded them, so none of it may be static or tied to a thread.
+struct ModuleState {
+    // Where scripts print: std::cout, or the response while a handler runs
+    std::ostream* scriptOut = &std::cout;
+
+    // GeneiaUI script generation
+    std::string geneiaUIScript = "";
+    std::string geneiaUITitle = "Geneia Application";
+    std::string geneiaUITheme = "default";
+    std::string geneiaUIColor = "#3498db";
+    int geneiaUIElementY = 20;
+    int geneiaUIButtonCount = 0;
+    int geneiaUILabelCount = 0;
+
+    // OpenGSL - Open Public Geneia Styling Library
+    std::string openGSLScript = "";
+    std::string openGSLTitle = "OpenGSL Canvas";
+    int openGSLWidth = 800;
+    int openGSLHeight = 600;
+    std::string openGSLBackground = "#FFFFFF";
+    std::string openGSLCurrentColor = "#3498db";
+    int openGSLShapeCount = 0;
+    // Named shapes
+    std::map<std::string, OpenGSLShape> openGSLShapes;
+    std::string openGSLCurrentShapeName = "";
+
+    // G_Web.Kit - Web Module for generating websites (Geneia Web Kit)
+    std::string webHTML = "";
+    std::string webCSS = "";
+    std::string webJS = "";
+    std::string webTitle = "Geneia Website";
+    std::string webBgColor = "#ffffff";
+    std::string webTextColor = "#333333";
+    std::string webAccentColor = "#3498db";
+    std::string webFont = "Arial, sans-serif";
+    int webElementCount = 0;
+    // Named elements (like OpenGSL shapes)
+    std::map<std::string, WebElement> webElements;
+    std::string webCurrentElementName = "";
+
+    // OpenGWS - Open Public Geneia Web Server Services Kit
+    // Package manager (like npm) + Web server (like node)
+    // CLI: geneia --gwsl-get install <package>
+    // Server: .GWS.serve (port)
+    std::string gwsRegistry = getenv("GWSL_REGISTRY") ? getenv("GWSL_REGISTRY") : "https://gwsl.geneia.dev/packages";
+    int gwsPort = 8080;
+    std::vector<GWSRoute> gwsRoutes;
+    std::string gwsCurrentRoute = "/";
+    int gwsCurrentMethod = GWS_GET;
+    std::vector<GWSMount> gwsMounts;
+    GWSEngine gwsEngine = GWS_ENGINE_EPOLL;
+    bool gwsRerunning = false;  // collecting routes for .GWS.serve --watch
+    std::shared_ptr<GWSPrelude> gwsPrelude;  // filled in by .GWS.serve
+
+    // OpenW2G - Open Public Web to Geneia Kit
+    // Converts HTML/Web to Geneia code
+    std::string w2gInputHTML = "";
+    std::string w2gOutputGeneia = "";
+
+    // G_Render - Universal Rendering Module
+    // Render same UI to web, desktop, terminal, or other platforms
+    std::map<std::string, RenderElement> renderElements;
+    std::string renderTarget = "web";  // web, desktop, term, json
+    std::string renderTitle = "Geneia App";
+    std::string renderTheme = "dark";
+    std::string renderAccent = "#00d4ff";
+    std::string renderBg = "#0a0a1a";
+    std::string renderText = "#f0f0f0";
+    std::string renderOutput = "";
+
+    // OpenGNEL - Open Geneia Element LanScript
+    // Command line scripting in Geneia syntax
+    std::string gnelScript = "";
+    std::string gnelWorkDir = ".";
+    std::vector<std::string> gnelHistory;
+    std::map<std::string, std::string> gnelAliases;
+    std::map<std::string, std::string> gnelEnvVars;
+    ShellSession gnelShell;  // .GNEL.run -b
+};
+
+extern std::string g_scriptPath;
+
+// Run the script again, quietly, in an interpreter of its own, for the
+// routes and mounts it defines now; they replace ours unless it fails to
+// parse or run
+bool Interpreter::gwsRerun(std::string& error) {
+    std::ifstream file(g_scriptPath);
+    if (!file.is_open()) {
+        error = "cannot open " + g_scriptPath;
+        return false;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    std::ostringstream discarded;
+    Interpreter rerun;
+    rerun.state->scriptOut = &discarded;
+    rerun.state->gwsRerunning = true;
+    try {
+        Lexer lexer(source.str());
+        auto tokens = lexer.tokenize();
+        Parser parser(tokens);
+        auto ast = parser.parse();
+        rerun.execute(ast);
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+    state->gwsRoutes = std::move(rerun.state->gwsRoutes);
+    state->gwsMounts = std::move(rerun.state->gwsMounts);
+    if (rerun.state->gwsPort != state->gwsPort) {
+        *state->scriptOut << "[OpenGWS] Port change to " << rerun.state->gwsPort << " needs a restart; staying on "
+                          << state->gwsPort << std::endl;
+    }
+    return true;
+}
+
+// %XX escapes decoded, and with plus '+' as a space (query strings)
+static std::string gwsUnescape(const char* s, size_t n, bool plus) {
+    std::string out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == '%' && i + 2 < n && isxdigit(static_cast<unsigned char>(s[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(s[i + 2]))) {
+            out += static_cast<char>(std::stoi(std::string(s + i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += plus && s[i] == '+' ? ' ' : s[i];
+        }
+    }
+    return out;
+}
+
+// Runs .GWS.handler blocks for one server worker, on its thread: an
+// interpreter that is reused for every request but goes back to the
+// script's variables and functions before each one, so nothing a handler
+// sets reaches the next client. The request is bound as variables
+// (request.method/path/query/body, param.<name>, query.<name> and
+// header.<name>, lower case with '-' as '_'). What the block prints is
+// the body; it may set response.status and response.type.
+class GWSScriptHandler : public GWSHandler {
+public:
+    bool handle(const void* handler, const GWSRequest& request, GWSReply& reply) override;
+
+private:
+    Interpreter interpreter;
+    std::ostringstream output;
+
+    void bind(const std::string& name, std::string value) {
+        interpreter.variables[name] = std::move(value);
+    }
+};
+
+bool GWSScriptHandler::handle(const void* handler, const GWSRequest& request, GWSReply& reply) {
+    auto* script = static_cast<const GWSScript*>(handler);
+    // After a --watch reload the prelude is the new script's
+    const GWSPrelude* prelude = script->prelude.get();
+    interpreter.variables = prelude ? prelude->variables : std::map<std::string, Value>();
+    interpreter.functions = prelude ? prelude->functions : std::map<std::string, std::shared_ptr<ASTNode>>();
+
+    bind("request.method", std::string(request.methodName, request.methodNameSize));
+    bind("request.path", gwsUnescape(request.path, request.pathSize, false));
+    bind("request.query", std::string(request.query, request.querySize));
+    bind("request.body", std::string(request.body, request.bodySize));
+    for (int i = 0; i < request.match->paramCount; i++) {
+        const GWSMatch::Param& p = request.match->params[i];
+        if (p.nameSize == 0) continue;  // an unnamed '*'
+        bind("param." + std::string(p.name, p.nameSize), gwsUnescape(p.value, p.valueSize, false));
+    }
+    const char* q = request.query;
+    const char* qEnd = q + request.querySize;
+    while (q < qEnd) {
+        const char* amp = static_cast<const char*>(memchr(q, '&', qEnd - q));
+        if (!amp) amp = qEnd;
+        const char* eq = static_cast<const char*>(memchr(q, '=', amp - q));
+        if (amp > q) {
+            const char* nameEnd = eq ? eq : amp;
+            bind("query." + gwsUnescape(q, nameEnd - q, true), eq ? gwsUnescape(eq + 1, amp - eq - 1, true) : "");
+        }
+        q = amp + 1;
+    }
+    const char* line = request.headers;
+    const char* end = line + request.headersSize;
+    while (line < end) {
+        const char* next = static_cast<const char*>(memchr(line, '\r', end - line));
+        if (!next) next = end;
+        const char* colon = static_cast<const char*>(memchr(line, ':', next - line));
+        if (colon) {
+            std::string name = "header.";
+            for (const char* c = line; c < colon; c++)
+                name += *c == '-' ? '_' : static_cast<char>(tolower(static_cast<unsigned char>(*c)));
+            const char* value = colon + 1;
+            while (value < next && (*value == ' ' || *value == '\t')) value++;
+            bind(name, std::string(value, next - value));
+        }
+        line = next + 2;
+    }
+
+    output.str("");
+    output.clear();
+    std::ostream* out = interpreter.state->scriptOut;
+    interpreter.state->scriptOut = &output;
+    bool ok = true;
+    try {
+        for (auto& stmt : script->body->children) {
+            if (interpreter.shouldExit) break;
+            interpreter.executeNode(stmt);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[OpenGWS] Handler failed on " << std::string(request.path, request.pathSize) << ": "
+                  << e.what() << std::endl;
+        ok = false;
+    }
+    interpreter.state->scriptOut = out;
+    interpreter.shouldExit = false;
+    reply.body = output.str();
+
+    auto status = interpreter.variables.find("response.status");
+    if (status != interpreter.variables.end()) {
+        if (std::holds_alternative<int>(status->second)) reply.status = std::get<int>(status->second);
+        interpreter.variables.erase(status);
+    }
+    auto type = interpreter.variables.find("response.type");
+    if (type != interpreter.variables.end()) {
+        if (std::holds_alternative<std::string>(type->second)) reply.type = std::get<std::string>(type->second);
+        interpreter.variables.erase(type);
+    }
+    return ok;
+}
+
+Interpreter::Interpreter() : state(new ModuleState), shouldExit(false), exitCode(0) {}
+
+Interpreter::~Interpreter() = default;
 
 void Interpreter::execute(std::shared_ptr<ASTNode> ast) {
     // Reset UI state
-    geneiaUIScript = "";
-    geneiaUITitle = "Geneia Application";
-    geneiaUITheme = "default";
-    geneiaUIColor = "#3498db";
-    geneiaUIElementY = 20;
-    geneiaUIButtonCount = 0;
-    geneiaUILabelCount = 0;
+    state->geneiaUIScript = "";
+    state->geneiaUITitle = "Geneia Application";
+    state->geneiaUITheme = "default";
+    state->geneiaUIColor = "#3498db";
+    state->geneiaUIElementY = 20;
+    state->geneiaUIButtonCount = 0;
+    state->geneiaUILabelCount = 0;
     
     for (auto& child : ast->children) {
         if (shouldExit) break;
@@ -189,29 +388,60 @@ Value Interpreter::evaluateExpression(std::shared_ptr<ASTNode> node) {
     }
 }
 
+// Evaluate call arguments to strings ((n) numbers become their digits)
+static std::vector<std::string> gnelArgs(const std::vector<Value>& values) {
+    std::vector<std::string> args;
+    for (auto& v : values) {
+        if (std::holds_alternative<std::string>(v)) args.push_back(std::get<std::string>(v));
+        else if (std::holds_alternative<int>(v)) args.push_back(std::to_string(std::get<int>(v)));
+    }
+    return args;
+}
+
+// Build a coreutils-style argv for a GNEL native builtin. Operands from
+// position firstFile on are glob-expanded the way the shell used to do it.
+static std::vector<std::string> gnelArgv(const std::string& tool, const std::vector<std::string>& args, size_t firstFile) {
+    std::vector<std::string> argv = {tool};
+    size_t operand = 0;
+    for (auto& a : args) {
+        bool isFlag = a.size() > 1 && a[0] == '-';
+        if (!isFlag && operand++ >= firstFile && a.find_first_of("*?[") != std::string::npos) {
+            glob_t g;
+            if (glob(a.c_str(), 0, nullptr, &g) == 0) {
+                for (size_t i = 0; i < g.gl_pathc; i++) argv.push_back(g.gl_pathv[i]);
+                globfree(&g);
+                continue;
+            }
+            globfree(&g);
+        }
+        argv.push_back(a);
+    }
+    return argv;
+}
+
 void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
     if (node->value == "p" || node->value == "peat") {
         for (auto& arg : node->children) {
             Value val = evaluateExpression(arg);
             if (std::holds_alternative<int>(val)) {
-                std::cout << std::get<int>(val);
+                *state->scriptOut << std::get<int>(val);
             } else if (std::holds_alternative<double>(val)) {
-                std::cout << std::get<double>(val);
+                *state->scriptOut << std::get<double>(val);
             } else if (std::holds_alternative<std::string>(val)) {
-                std::cout << std::get<std::string>(val);
+                *state->scriptOut << std::get<std::string>(val);
             }
         }
-        std::cout << std::endl;
+        *state->scriptOut << std::endl;
     } else if (node->value == "tip") {
         // Running tips - displayed with special formatting
-        std::cout << "[TIP] ";
+        *state->scriptOut << "[TIP] ";
         for (auto& arg : node->children) {
             Value val = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(val)) {
-                std::cout << std::get<std::string>(val);
+                *state->scriptOut << std::get<std::string>(val);
             }
         }
-        std::cout << std::endl;
+        *state->scriptOut << std::endl;
     } else if (node->value == "str") {
         // str(U+XXXX) - Unicode string function - just output the character
         if (!node->children.empty()) {
@@ -240,9 +470,9 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
                             utf8Char += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
                             utf8Char += static_cast<char>(0x80 | (codePoint & 0x3F));
                         }
-                        std::cout << utf8Char << std::endl;
+                        *state->scriptOut << utf8Char << std::endl;
                     } catch (...) {
-                        std::cout << "?" << std::endl;
+                        *state->scriptOut << "?" << std::endl;
                     }
                 }
             }
@@ -253,7 +483,7 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value count = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(str) && std::holds_alternative<int>(count)) {
                 std::string result = strRepeat(std::get<std::string>(str), std::get<int>(count));
-                std::cout << result << std::endl;
+                *state->scriptOut << result << std::endl;
             }
         }
     }
@@ -263,17 +493,17 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (!node->children.empty()) {
             Value title = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(title)) {
-                std::cout << "[UI] Created window: " << std::get<std::string>(title) << std::endl;
+                *state->scriptOut << "[UI] Created window: " << std::get<std::string>(title) << std::endl;
             }
         } else {
-            std::cout << "[UI] Created window" << std::endl;
+            *state->scriptOut << "[UI] Created window" << std::endl;
         }
     } else if (node->value == ".UI.button" || node->value == ".ui.button" ||
                node->value == "UI.button" || node->value == "ui.button") {
         if (!node->children.empty()) {
             Value text = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(text)) {
-                std::cout << "[UI] Created button: " << std::get<std::string>(text) << std::endl;
+                *state->scriptOut << "[UI] Created button: " << std::get<std::string>(text) << std::endl;
             }
         }
     } else if (node->value == ".UI.label" || node->value == ".ui.label" ||
@@ -281,21 +511,21 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (!node->children.empty()) {
             Value text = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(text)) {
-                std::cout << "[UI] Created label: " << std::get<std::string>(text) << std::endl;
+                *state->scriptOut << "[UI] Created label: " << std::get<std::string>(text) << std::endl;
             }
         }
     } else if (node->value == ".UI.textbox" || node->value == ".ui.textbox" ||
                node->value == "UI.textbox" || node->value == "ui.textbox") {
-        std::cout << "[UI] Created textbox" << std::endl;
+        *state->scriptOut << "[UI] Created textbox" << std::endl;
     } else if (node->value == ".UI.show" || node->value == ".ui.show" ||
                node->value == "UI.show" || node->value == "ui.show") {
-        std::cout << "[UI] Window shown" << std::endl;
+        *state->scriptOut << "[UI] Window shown" << std::endl;
     } else if (node->value == ".UI.message" || node->value == ".ui.message" ||
                node->value == "UI.message" || node->value == "ui.message") {
         if (!node->children.empty()) {
             Value msg = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(msg)) {
-                std::cout << "[UI] Message: " << std::get<std::string>(msg) << std::endl;
+                *state->scriptOut << "[UI] Message: " << std::get<std::string>(msg) << std::endl;
             }
         }
     }
@@ -304,28 +534,28 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (!node->children.empty()) {
             Value title = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(title)) {
-                geneiaUITitle = std::get<std::string>(title);
-                geneiaUIScript += "WINDOW|" + geneiaUITitle + "|800|600\n";
-                std::cout << "[GeneiaUI] Window created: " << geneiaUITitle << std::endl;
+                state->geneiaUITitle = std::get<std::string>(title);
+                state->geneiaUIScript += "WINDOW|" + state->geneiaUITitle + "|800|600\n";
+                *state->scriptOut << "[GeneiaUI] Window created: " << state->geneiaUITitle << std::endl;
             }
         } else {
-            geneiaUIScript += "WINDOW|Geneia Application|800|600\n";
-            std::cout << "[GeneiaUI] Window created" << std::endl;
+            state->geneiaUIScript += "WINDOW|Geneia Application|800|600\n";
+            *state->scriptOut << "[GeneiaUI] Window created" << std::endl;
         }
     } else if (node->value == ".GeneiaUI.panel" || node->value == ".geneiaui.panel") {
-        geneiaUIScript += "PANEL|panel1|20|" + std::to_string(geneiaUIElementY) + "|760|100|LightGray\n";
-        geneiaUIElementY += 110;
-        std::cout << "[GeneiaUI] Panel created" << std::endl;
+        state->geneiaUIScript += "PANEL|panel1|20|" + std::to_string(state->geneiaUIElementY) + "|760|100|LightGray\n";
+        state->geneiaUIElementY += 110;
+        *state->scriptOut << "[GeneiaUI] Panel created" << std::endl;
     } else if (node->value == ".GeneiaUI.button" || node->value == ".geneiaui.button") {
         if (!node->children.empty()) {
             Value text = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(text)) {
                 std::string btnText = std::get<std::string>(text);
-                std::string btnName = "btn" + std::to_string(++geneiaUIButtonCount);
-                int btnX = 20 + ((geneiaUIButtonCount - 1) % 4) * 190;
-                geneiaUIScript += "BUTTON|" + btnName + "|" + btnText + "|" + std::to_string(btnX) + "|" + std::to_string(geneiaUIElementY) + "|180|40\n";
-                if (geneiaUIButtonCount % 4 == 0) geneiaUIElementY += 50;
-                std::cout << "[GeneiaUI] Button: " << btnText << std::endl;
+                std::string btnName = "btn" + std::to_string(++state->geneiaUIButtonCount);
+                int btnX = 20 + ((state->geneiaUIButtonCount - 1) % 4) * 190;
+                state->geneiaUIScript += "BUTTON|" + btnName + "|" + btnText + "|" + std::to_string(btnX) + "|" + std::to_string(state->geneiaUIElementY) + "|180|40\n";
+                if (state->geneiaUIButtonCount % 4 == 0) state->geneiaUIElementY += 50;
+                *state->scriptOut << "[GeneiaUI] Button: " << btnText << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.label" || node->value == ".geneiaui.label") {
@@ -333,106 +563,106 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value text = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(text)) {
                 std::string lblText = std::get<std::string>(text);
-                std::string lblName = "lbl" + std::to_string(++geneiaUILabelCount);
-                geneiaUIScript += "LABEL|" + lblName + "|" + lblText + "|20|" + std::to_string(geneiaUIElementY) + "|400|30\n";
-                geneiaUIElementY += 35;
-                std::cout << "[GeneiaUI] Label: " << lblText << std::endl;
+                std::string lblName = "lbl" + std::to_string(++state->geneiaUILabelCount);
+                state->geneiaUIScript += "LABEL|" + lblName + "|" + lblText + "|20|" + std::to_string(state->geneiaUIElementY) + "|400|30\n";
+                state->geneiaUIElementY += 35;
+                *state->scriptOut << "[GeneiaUI] Label: " << lblText << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.input" || node->value == ".geneiaui.input") {
-        geneiaUIScript += "TEXTBOX|input1|20|" + std::to_string(geneiaUIElementY) + "|300|25\n";
-        geneiaUIElementY += 35;
-        std::cout << "[GeneiaUI] Input field created" << std::endl;
+        state->geneiaUIScript += "TEXTBOX|input1|20|" + std::to_string(state->geneiaUIElementY) + "|300|25\n";
+        state->geneiaUIElementY += 35;
+        *state->scriptOut << "[GeneiaUI] Input field created" << std::endl;
     } else if (node->value == ".GeneiaUI.text" || node->value == ".geneiaui.text") {
-        geneiaUIScript += "TEXTAREA|text1|20|" + std::to_string(geneiaUIElementY) + "|400|100\n";
-        geneiaUIElementY += 110;
-        std::cout << "[GeneiaUI] Text area created" << std::endl;
+        state->geneiaUIScript += "TEXTAREA|text1|20|" + std::to_string(state->geneiaUIElementY) + "|400|100\n";
+        state->geneiaUIElementY += 110;
+        *state->scriptOut << "[GeneiaUI] Text area created" << std::endl;
     } else if (node->value == ".GeneiaUI.list" || node->value == ".geneiaui.list") {
-        geneiaUIScript += "LISTBOX|list1|20|" + std::to_string(geneiaUIElementY) + "|300|120\n";
-        geneiaUIElementY += 130;
-        std::cout << "[GeneiaUI] List created" << std::endl;
+        state->geneiaUIScript += "LISTBOX|list1|20|" + std::to_string(state->geneiaUIElementY) + "|300|120\n";
+        state->geneiaUIElementY += 130;
+        *state->scriptOut << "[GeneiaUI] List created" << std::endl;
     } else if (node->value == ".GeneiaUI.menu" || node->value == ".geneiaui.menu") {
         if (!node->children.empty()) {
             Value name = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(name)) {
-                geneiaUIScript += "MENU|" + std::get<std::string>(name) + "\n";
-                std::cout << "[GeneiaUI] Menu: " << std::get<std::string>(name) << std::endl;
+                state->geneiaUIScript += "MENU|" + std::get<std::string>(name) + "\n";
+                *state->scriptOut << "[GeneiaUI] Menu: " << std::get<std::string>(name) << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.toolbar" || node->value == ".geneiaui.toolbar") {
-        geneiaUIScript += "TOOLBAR|toolbar1\n";
-        std::cout << "[GeneiaUI] Toolbar created" << std::endl;
+        state->geneiaUIScript += "TOOLBAR|toolbar1\n";
+        *state->scriptOut << "[GeneiaUI] Toolbar created" << std::endl;
     } else if (node->value == ".GeneiaUI.status" || node->value == ".geneiaui.status") {
         if (!node->children.empty()) {
             Value text = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(text)) {
-                geneiaUIScript += "STATUSBAR|" + std::get<std::string>(text) + "\n";
-                std::cout << "[GeneiaUI] Status: " << std::get<std::string>(text) << std::endl;
+                state->geneiaUIScript += "STATUSBAR|" + std::get<std::string>(text) + "\n";
+                *state->scriptOut << "[GeneiaUI] Status: " << std::get<std::string>(text) << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.dialog" || node->value == ".geneiaui.dialog") {
         if (!node->children.empty()) {
             Value msg = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(msg)) {
-                geneiaUIScript += "DIALOG|" + std::get<std::string>(msg) + "\n";
-                std::cout << "[GeneiaUI] Dialog: " << std::get<std::string>(msg) << std::endl;
+                state->geneiaUIScript += "DIALOG|" + std::get<std::string>(msg) + "\n";
+                *state->scriptOut << "[GeneiaUI] Dialog: " << std::get<std::string>(msg) << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.style" || node->value == ".geneiaui.style") {
-        geneiaUIScript += "STYLE|custom\n";
-        std::cout << "[GeneiaUI] Style applied" << std::endl;
+        state->geneiaUIScript += "STYLE|custom\n";
+        *state->scriptOut << "[GeneiaUI] Style applied" << std::endl;
     } else if (node->value == ".GeneiaUI.theme" || node->value == ".geneiaui.theme") {
         if (!node->children.empty()) {
             Value theme = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(theme)) {
-                geneiaUITheme = std::get<std::string>(theme);
-                geneiaUIScript += "THEME|" + geneiaUITheme + "\n";
-                std::cout << "[GeneiaUI] Theme: " << geneiaUITheme << std::endl;
+                state->geneiaUITheme = std::get<std::string>(theme);
+                state->geneiaUIScript += "THEME|" + state->geneiaUITheme + "\n";
+                *state->scriptOut << "[GeneiaUI] Theme: " << state->geneiaUITheme << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.color" || node->value == ".geneiaui.color") {
         if (!node->children.empty()) {
             Value color = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(color)) {
-                geneiaUIColor = std::get<std::string>(color);
-                geneiaUIScript += "COLOR|" + geneiaUIColor + "\n";
-                std::cout << "[GeneiaUI] Color: " << geneiaUIColor << std::endl;
+                state->geneiaUIColor = std::get<std::string>(color);
+                state->geneiaUIScript += "COLOR|" + state->geneiaUIColor + "\n";
+                *state->scriptOut << "[GeneiaUI] Color: " << state->geneiaUIColor << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.font" || node->value == ".geneiaui.font") {
         if (!node->children.empty()) {
             Value font = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(font)) {
-                geneiaUIScript += "FONT|" + std::get<std::string>(font) + "\n";
-                std::cout << "[GeneiaUI] Font: " << std::get<std::string>(font) << std::endl;
+                state->geneiaUIScript += "FONT|" + std::get<std::string>(font) + "\n";
+                *state->scriptOut << "[GeneiaUI] Font: " << std::get<std::string>(font) << std::endl;
             }
         }
     } else if (node->value == ".GeneiaUI.size" || node->value == ".geneiaui.size") {
-        geneiaUIScript += "SIZE|800|600\n";
-        std::cout << "[GeneiaUI] Size set" << std::endl;
+        state->geneiaUIScript += "SIZE|800|600\n";
+        *state->scriptOut << "[GeneiaUI] Size set" << std::endl;
     } else if (node->value == ".GeneiaUI.pos" || node->value == ".geneiaui.pos") {
-        geneiaUIScript += "POSITION|100|100\n";
-        std::cout << "[GeneiaUI] Position set" << std::endl;
+        state->geneiaUIScript += "POSITION|100|100\n";
+        *state->scriptOut << "[GeneiaUI] Position set" << std::endl;
     } else if (node->value == ".GeneiaUI.show" || node->value == ".geneiaui.show") {
-        geneiaUIScript += "SHOW\n";
-        std::cout << "[GeneiaUI] Window shown" << std::endl;
+        state->geneiaUIScript += "SHOW\n";
+        *state->scriptOut << "[GeneiaUI] Window shown" << std::endl;
     } else if (node->value == ".GeneiaUI.hide" || node->value == ".geneiaui.hide") {
-        geneiaUIScript += "HIDE\n";
-        std::cout << "[GeneiaUI] Window hidden" << std::endl;
+        state->geneiaUIScript += "HIDE\n";
+        *state->scriptOut << "[GeneiaUI] Window hidden" << std::endl;
     } else if (node->value == ".GeneiaUI.close" || node->value == ".geneiaui.close") {
-        geneiaUIScript += "CLOSE\n";
-        std::cout << "[GeneiaUI] Window closed" << std::endl;
+        state->geneiaUIScript += "CLOSE\n";
+        *state->scriptOut << "[GeneiaUI] Window closed" << std::endl;
     } else if (node->value == ".GeneiaUI.run" || node->value == ".geneiaui.run") {
         // Write UI script to file
         std::ofstream uiFile("_geneia_generated.ui");
         uiFile << "// Generated by Geneia GeneiaUI Module\n";
-        uiFile << "// Theme: " << geneiaUITheme << "\n";
-        uiFile << "// Color: " << geneiaUIColor << "\n\n";
-        uiFile << geneiaUIScript;
+        uiFile << "// Theme: " << state->geneiaUITheme << "\n";
+        uiFile << "// Color: " << state->geneiaUIColor << "\n\n";
+        uiFile << state->geneiaUIScript;
         uiFile.close();
         
-        std::cout << "[GeneiaUI] UI script saved to _geneia_generated.ui" << std::endl;
-        std::cout << "[GeneiaUI] Launching GUI..." << std::endl;
+        *state->scriptOut << "[GeneiaUI] UI script saved to _geneia_generated.ui" << std::endl;
+        *state->scriptOut << "[GeneiaUI] Launching GUI..." << std::endl;
         
         // Try to launch the GUI - prefer real GTK window
         bool launched = false;
@@ -440,13 +670,13 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (system("which dotnet > /dev/null 2>&1") == 0) {
             // Try GTK UI first (real window with colors)
             if (system("test -f ui/bin/linux/GeneiaUILinux.dll") == 0) {
-                std::cout << "[GeneiaUI] Opening real window..." << std::endl;
+                *state->scriptOut << "[GeneiaUI] Opening real window..." << std::endl;
                 system("dotnet ui/bin/linux/GeneiaUILinux.dll _geneia_generated.ui");
                 launched = true;
             }
             // Fallback to Terminal UI
             else if (system("test -f ui/bin/terminal/GeneiaUITerminal.dll") == 0) {
-                std::cout << "[GeneiaUI] Using Terminal UI..." << std::endl;
+                *state->scriptOut << "[GeneiaUI] Using Terminal UI..." << std::endl;
                 system("dotnet ui/bin/terminal/GeneiaUITerminal.dll _geneia_generated.ui");
                 launched = true;
             }
@@ -454,9 +684,9 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         
         if (!launched) {
             // Fallback: show the generated script
-            std::cout << "\n=== Generated UI Script ===\n" << geneiaUIScript << "==========================\n" << std::endl;
-            std::cout << "[GeneiaUI] No UI runtime found. Build with:\n";
-            std::cout << "  cd ui && dotnet build GeneiaUILinux.csproj -o bin/linux/\n" << std::endl;
+            *state->scriptOut << "\n=== Generated UI Script ===\n" << state->geneiaUIScript << "==========================\n" << std::endl;
+            *state->scriptOut << "[GeneiaUI] No UI runtime found. Build with:\n";
+            *state->scriptOut << "  cd ui && dotnet build GeneiaUILinux.csproj -o bin/linux/\n" << std::endl;
         }
     }
     // ============================================================
@@ -468,25 +698,25 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (!node->children.empty()) {
             Value title = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(title)) {
-                openGSLTitle = std::get<std::string>(title);
+                state->openGSLTitle = std::get<std::string>(title);
             }
         }
         if (node->children.size() >= 3) {
             Value w = evaluateExpression(node->children[1]);
             Value h = evaluateExpression(node->children[2]);
-            if (std::holds_alternative<int>(w)) openGSLWidth = std::get<int>(w);
-            if (std::holds_alternative<int>(h)) openGSLHeight = std::get<int>(h);
+            if (std::holds_alternative<int>(w)) state->openGSLWidth = std::get<int>(w);
+            if (std::holds_alternative<int>(h)) state->openGSLHeight = std::get<int>(h);
         }
-        openGSLScript = "CANVAS|" + openGSLTitle + "|" + std::to_string(openGSLWidth) + "|" + std::to_string(openGSLHeight) + "\n";
-        std::cout << "[OpenGSL] Canvas: " << openGSLTitle << " (" << openGSLWidth << "x" << openGSLHeight << ")" << std::endl;
+        state->openGSLScript = "CANVAS|" + state->openGSLTitle + "|" + std::to_string(state->openGSLWidth) + "|" + std::to_string(state->openGSLHeight) + "\n";
+        *state->scriptOut << "[OpenGSL] Canvas: " << state->openGSLTitle << " (" << state->openGSLWidth << "x" << state->openGSLHeight << ")" << std::endl;
     }
     else if (node->value == ".OpenGSL.bg" || node->value == ".opengsl.bg") {
         if (!node->children.empty()) {
             Value color = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(color)) {
-                openGSLBackground = std::get<std::string>(color);
-                openGSLScript += "BACKGROUND|" + openGSLBackground + "\n";
-                std::cout << "[OpenGSL] Background: " << openGSLBackground << std::endl;
+                state->openGSLBackground = std::get<std::string>(color);
+                state->openGSLScript += "BACKGROUND|" + state->openGSLBackground + "\n";
+                *state->scriptOut << "[OpenGSL] Background: " << state->openGSLBackground << std::endl;
             }
         }
     }
@@ -494,8 +724,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         if (!node->children.empty()) {
             Value color = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(color)) {
-                openGSLCurrentColor = std::get<std::string>(color);
-                std::cout << "[OpenGSL] Color: " << openGSLCurrentColor << std::endl;
+                state->openGSLCurrentColor = std::get<std::string>(color);
+                *state->scriptOut << "[OpenGSL] Color: " << state->openGSLCurrentColor << std::endl;
             }
         }
     }
@@ -512,10 +742,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vw)) w = std::get<int>(vw);
             if (std::holds_alternative<int>(vh)) h = std::get<int>(vh);
         }
-        openGSLScript += "RECT|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "RECT|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(w) + "|" + std::to_string(h) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Rect: " << x << "," << y << " " << w << "x" << h << std::endl;
+                         std::to_string(w) + "|" + std::to_string(h) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Rect: " << x << "," << y << " " << w << "x" << h << std::endl;
     }
     else if (node->value == ".OpenGSL.circle" || node->value == ".opengsl.circle") {
         int x = 0, y = 0, r = 50;
@@ -527,10 +757,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vy)) y = std::get<int>(vy);
             if (std::holds_alternative<int>(vr)) r = std::get<int>(vr);
         }
-        openGSLScript += "CIRCLE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "CIRCLE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(r) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Circle: " << x << "," << y << " r=" << r << std::endl;
+                         std::to_string(r) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Circle: " << x << "," << y << " r=" << r << std::endl;
     }
     else if (node->value == ".OpenGSL.line" || node->value == ".opengsl.line") {
         int x1 = 0, y1 = 0, x2 = 100, y2 = 100;
@@ -544,10 +774,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vx2)) x2 = std::get<int>(vx2);
             if (std::holds_alternative<int>(vy2)) y2 = std::get<int>(vy2);
         }
-        openGSLScript += "LINE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "LINE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x1) + "|" + std::to_string(y1) + "|" +
-                         std::to_string(x2) + "|" + std::to_string(y2) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Line: " << x1 << "," << y1 << " to " << x2 << "," << y2 << std::endl;
+                         std::to_string(x2) + "|" + std::to_string(y2) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Line: " << x1 << "," << y1 << " to " << x2 << "," << y2 << std::endl;
     }
     else if (node->value == ".OpenGSL.ellipse" || node->value == ".opengsl.ellipse") {
         int x = 0, y = 0, rx = 50, ry = 30;
@@ -561,10 +791,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vrx)) rx = std::get<int>(vrx);
             if (std::holds_alternative<int>(vry)) ry = std::get<int>(vry);
         }
-        openGSLScript += "ELLIPSE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "ELLIPSE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(rx) + "|" + std::to_string(ry) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Ellipse: " << x << "," << y << " rx=" << rx << " ry=" << ry << std::endl;
+                         std::to_string(rx) + "|" + std::to_string(ry) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Ellipse: " << x << "," << y << " rx=" << rx << " ry=" << ry << std::endl;
     }
     else if (node->value == ".OpenGSL.text" || node->value == ".opengsl.text") {
         int x = 0, y = 0;
@@ -577,9 +807,9 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vy)) y = std::get<int>(vy);
             if (std::holds_alternative<std::string>(vt)) text = std::get<std::string>(vt);
         }
-        openGSLScript += "TEXT|shape" + std::to_string(++openGSLShapeCount) + "|" + 
-                         std::to_string(x) + "|" + std::to_string(y) + "|" + text + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Text: " << text << " at " << x << "," << y << std::endl;
+        state->openGSLScript += "TEXT|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
+                         std::to_string(x) + "|" + std::to_string(y) + "|" + text + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Text: " << text << " at " << x << "," << y << std::endl;
     }
     // 2.5D Shapes
     else if (node->value == ".OpenGSL.iso" || node->value == ".opengsl.iso") {
@@ -596,11 +826,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vh)) h = std::get<int>(vh);
             if (std::holds_alternative<int>(vd)) d = std::get<int>(vd);
         }
-        openGSLScript += "ISO|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "ISO|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
                          std::to_string(w) + "|" + std::to_string(h) + "|" +
-                         std::to_string(d) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Isometric: " << x << "," << y << " " << w << "x" << h << "x" << d << std::endl;
+                         std::to_string(d) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Isometric: " << x << "," << y << " " << w << "x" << h << "x" << d << std::endl;
     }
     // 3D Shapes
     else if (node->value == ".OpenGSL.cube" || node->value == ".opengsl.cube") {
@@ -615,10 +845,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vz)) z = std::get<int>(vz);
             if (std::holds_alternative<int>(vs)) size = std::get<int>(vs);
         }
-        openGSLScript += "CUBE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "CUBE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(z) + "|" + std::to_string(size) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Cube: " << x << "," << y << "," << z << " size=" << size << std::endl;
+                         std::to_string(z) + "|" + std::to_string(size) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Cube: " << x << "," << y << "," << z << " size=" << size << std::endl;
     }
     else if (node->value == ".OpenGSL.sphere" || node->value == ".opengsl.sphere") {
         int x = 0, y = 0, z = 0, r = 50;
@@ -632,10 +862,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vz)) z = std::get<int>(vz);
             if (std::holds_alternative<int>(vr)) r = std::get<int>(vr);
         }
-        openGSLScript += "SPHERE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "SPHERE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(z) + "|" + std::to_string(r) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Sphere: " << x << "," << y << "," << z << " r=" << r << std::endl;
+                         std::to_string(z) + "|" + std::to_string(r) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Sphere: " << x << "," << y << "," << z << " r=" << r << std::endl;
     }
     else if (node->value == ".OpenGSL.pyramid" || node->value == ".opengsl.pyramid") {
         int x = 0, y = 0, z = 0, base = 100, h = 150;
@@ -651,11 +881,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vb)) base = std::get<int>(vb);
             if (std::holds_alternative<int>(vh)) h = std::get<int>(vh);
         }
-        openGSLScript += "PYRAMID|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "PYRAMID|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
                          std::to_string(z) + "|" + std::to_string(base) + "|" +
-                         std::to_string(h) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Pyramid: " << x << "," << y << "," << z << " base=" << base << " h=" << h << std::endl;
+                         std::to_string(h) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Pyramid: " << x << "," << y << "," << z << " base=" << base << " h=" << h << std::endl;
     }
     else if (node->value == ".OpenGSL.cylinder" || node->value == ".opengsl.cylinder") {
         int x = 0, y = 0, z = 0, r = 50, h = 100;
@@ -671,11 +901,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vr)) r = std::get<int>(vr);
             if (std::holds_alternative<int>(vh)) h = std::get<int>(vh);
         }
-        openGSLScript += "CYLINDER|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "CYLINDER|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
                          std::to_string(z) + "|" + std::to_string(r) + "|" +
-                         std::to_string(h) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Cylinder: " << x << "," << y << "," << z << " r=" << r << " h=" << h << std::endl;
+                         std::to_string(h) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Cylinder: " << x << "," << y << "," << z << " r=" << r << " h=" << h << std::endl;
     }
     // ============================================================
     // NEW SYNTAX: .OpenGSL.shape.3d (x) (y) (z) & shape.n = myApple
@@ -685,7 +915,7 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
     else if (node->value == ".OpenGSL.shape.3d" || node->value == ".opengsl.shape.3d" ||
              node->value == ".OpenGSL.shape.d3" || node->value == ".opengsl.shape.d3") {
         int x = 0, y = 0, z = 0;
-        std::string shapeName = "shape" + std::to_string(++openGSLShapeCount);
+        std::string shapeName = "shape" + std::to_string(++state->openGSLShapeCount);
         
         if (node->children.size() >= 3) {
             Value vx = evaluateExpression(node->children[0]);
@@ -718,18 +948,18 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         shape.name = shapeName;
         shape.x = x; shape.y = y; shape.z = z;
         shape.size = 80;
-        shape.color = openGSLCurrentColor;
+        shape.color = state->openGSLCurrentColor;
         shape.type = "3d";
-        openGSLShapes[shapeName] = shape;
-        openGSLCurrentShapeName = shapeName;
+        state->openGSLShapes[shapeName] = shape;
+        state->openGSLCurrentShapeName = shapeName;
         
-        std::cout << "[OpenGSL] Shape.3d: " << shapeName << " at " << x << "," << y << "," << z << std::endl;
+        *state->scriptOut << "[OpenGSL] Shape.3d: " << shapeName << " at " << x << "," << y << "," << z << std::endl;
     }
     // .OpenGSL.shape.2d (x) (y) & shape.n = name
     else if (node->value == ".OpenGSL.shape.2d" || node->value == ".opengsl.shape.2d" ||
              node->value == ".OpenGSL.shape.d2" || node->value == ".opengsl.shape.d2") {
         int x = 0, y = 0;
-        std::string shapeName = "shape" + std::to_string(++openGSLShapeCount);
+        std::string shapeName = "shape" + std::to_string(++state->openGSLShapeCount);
         
         if (node->children.size() >= 2) {
             Value vx = evaluateExpression(node->children[0]);
@@ -758,19 +988,19 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         shape.name = shapeName;
         shape.x = x; shape.y = y; shape.z = 0;
         shape.size = 80;
-        shape.color = openGSLCurrentColor;
+        shape.color = state->openGSLCurrentColor;
         shape.type = "2d";
-        openGSLShapes[shapeName] = shape;
-        openGSLCurrentShapeName = shapeName;
+        state->openGSLShapes[shapeName] = shape;
+        state->openGSLCurrentShapeName = shapeName;
         
-        std::cout << "[OpenGSL] Shape.2d: " << shapeName << " at " << x << "," << y << std::endl;
+        *state->scriptOut << "[OpenGSL] Shape.2d: " << shapeName << " at " << x << "," << y << std::endl;
     }
     // Dynamic shape usage: .OpenGSL.shape.{shapeName} -u (size) (color)
     // This handles .OpenGSL.shape.myApple, .OpenGSL.shape.myCube, etc.
     else if (node->value.substr(0, 16) == ".OpenGSL.shape." || node->value.substr(0, 16) == ".opengsl.shape.") {
         std::string shapeName = node->value.substr(16); // Get the shape name from path
         int size = 80;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         std::string shapeType = "apple"; // default type
         bool useFlag = false;
         
@@ -792,8 +1022,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         }
         
         // Check if shape exists
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            auto& sh = openGSLShapes[shapeName];
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            auto& sh = state->openGSLShapes[shapeName];
             sh.size = size;
             sh.color = color;
             
@@ -816,29 +1046,29 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             for (auto& c : typeUpper) c = toupper(c);
             
             if (detectedType == "apple" || detectedType == "pizza" || detectedType == "sphere" || detectedType == "cube") {
-                openGSLScript += typeUpper + "|" + shapeName + "|" + 
+                state->openGSLScript += typeUpper + "|" + shapeName + "|" + 
                                  std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                                  std::to_string(sh.z) + "|" + std::to_string(sh.size) + "|" + sh.color + "\n";
             } else if (detectedType == "rect") {
-                openGSLScript += "RECT|" + shapeName + "|" + 
+                state->openGSLScript += "RECT|" + shapeName + "|" + 
                                  std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                                  std::to_string(sh.size) + "|" + std::to_string(sh.size) + "|" + sh.color + "\n";
             } else if (detectedType == "circle") {
-                openGSLScript += "CIRCLE|" + shapeName + "|" + 
+                state->openGSLScript += "CIRCLE|" + shapeName + "|" + 
                                  std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                                  std::to_string(sh.size) + "|" + sh.color + "\n";
             }
             
-            std::cout << "[OpenGSL] Shape." << shapeName << " -u " << detectedType << " size=" << size << " color=" << color << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape." << shapeName << " -u " << detectedType << " size=" << size << " color=" << color << std::endl;
         } else {
-            std::cout << "[OpenGSL] Error: Shape '" << shapeName << "' not defined. Use .OpenGSL.shape.3d first" << std::endl;
+            *state->scriptOut << "[OpenGSL] Error: Shape '" << shapeName << "' not defined. Use .OpenGSL.shape.3d first" << std::endl;
         }
     }
     // Legacy: .OpenGSL.shape.apple (size) - for current shape
     else if (node->value == ".OpenGSL.shape.apple" || node->value == ".opengsl.shape.apple") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int size = 80;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         bool useFlag = false;
         
         // Parse arguments
@@ -857,26 +1087,26 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         }
         
         // Update or use existing shape
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "apple";
-            openGSLShapes[shapeName].size = size;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "apple";
+            state->openGSLShapes[shapeName].size = size;
+            state->openGSLShapes[shapeName].color = color;
             
             // Add to script
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "APPLE|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "APPLE|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.z) + "|" + std::to_string(sh.size) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.apple: " << shapeName << " size=" << size << " color=" << color << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.apple: " << shapeName << " size=" << size << " color=" << color << std::endl;
         } else {
-            std::cout << "[OpenGSL] Error: No shape defined. Use .OpenGSL.shape.d3 first" << std::endl;
+            *state->scriptOut << "[OpenGSL] Error: No shape defined. Use .OpenGSL.shape.d3 first" << std::endl;
         }
     }
     // .OpenGSL.shape.cube -u (size)
     else if (node->value == ".OpenGSL.shape.cube" || node->value == ".opengsl.shape.cube") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int size = 80;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         for (size_t i = 0; i < node->children.size(); i++) {
             Value val = evaluateExpression(node->children[i]);
@@ -888,23 +1118,23 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "cube";
-            openGSLShapes[shapeName].size = size;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "cube";
+            state->openGSLShapes[shapeName].size = size;
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "CUBE|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "CUBE|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.z) + "|" + std::to_string(sh.size) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.cube: " << shapeName << " size=" << size << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.cube: " << shapeName << " size=" << size << std::endl;
         }
     }
     // .OpenGSL.shape.sphere -u (radius)
     else if (node->value == ".OpenGSL.shape.sphere" || node->value == ".opengsl.shape.sphere") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int radius = 50;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         for (size_t i = 0; i < node->children.size(); i++) {
             Value val = evaluateExpression(node->children[i]);
@@ -916,23 +1146,23 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "sphere";
-            openGSLShapes[shapeName].size = radius;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "sphere";
+            state->openGSLShapes[shapeName].size = radius;
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "SPHERE|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "SPHERE|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.z) + "|" + std::to_string(sh.size) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.sphere: " << shapeName << " r=" << radius << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.sphere: " << shapeName << " r=" << radius << std::endl;
         }
     }
     // .OpenGSL.shape.rect -u (w) (h)
     else if (node->value == ".OpenGSL.shape.rect" || node->value == ".opengsl.shape.rect") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int w = 100, h = 80;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         int numIdx = 0;
         for (size_t i = 0; i < node->children.size(); i++) {
@@ -947,24 +1177,24 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "rect";
-            openGSLShapes[shapeName].w = w;
-            openGSLShapes[shapeName].h = h;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "rect";
+            state->openGSLShapes[shapeName].w = w;
+            state->openGSLShapes[shapeName].h = h;
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "RECT|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "RECT|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.w) + "|" + std::to_string(sh.h) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.rect: " << shapeName << " " << w << "x" << h << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.rect: " << shapeName << " " << w << "x" << h << std::endl;
         }
     }
     // .OpenGSL.shape.circle -u (radius)
     else if (node->value == ".OpenGSL.shape.circle" || node->value == ".opengsl.shape.circle") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int r = 50;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         for (size_t i = 0; i < node->children.size(); i++) {
             Value val = evaluateExpression(node->children[i]);
@@ -976,23 +1206,23 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "circle";
-            openGSLShapes[shapeName].size = r;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "circle";
+            state->openGSLShapes[shapeName].size = r;
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "CIRCLE|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "CIRCLE|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.size) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.circle: " << shapeName << " r=" << r << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.circle: " << shapeName << " r=" << r << std::endl;
         }
     }
     // .OpenGSL.shape.cylinder -u (radius) (height) 'color'
     else if (node->value == ".OpenGSL.shape.cylinder" || node->value == ".opengsl.shape.cylinder") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         int radius = 50, height = 20;
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         int numIdx = 0;
         for (size_t i = 0; i < node->children.size(); i++) {
@@ -1007,25 +1237,25 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "cylinder";
-            openGSLShapes[shapeName].size = radius;
-            openGSLShapes[shapeName].h = height;
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "cylinder";
+            state->openGSLShapes[shapeName].size = radius;
+            state->openGSLShapes[shapeName].h = height;
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "CYLINDER|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "CYLINDER|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" +
                              std::to_string(sh.z) + "|" + std::to_string(sh.size) + "|" +
                              std::to_string(sh.h) + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.cylinder: " << shapeName << " r=" << radius << " h=" << height << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.cylinder: " << shapeName << " r=" << radius << " h=" << height << std::endl;
         }
     }
     // .OpenGSL.shape.text -u 'text' 'color'
     else if (node->value == ".OpenGSL.shape.text" || node->value == ".opengsl.shape.text") {
-        std::string shapeName = openGSLCurrentShapeName;
+        std::string shapeName = state->openGSLCurrentShapeName;
         std::string text = "Text";
-        std::string color = openGSLCurrentColor;
+        std::string color = state->openGSLCurrentColor;
         
         for (size_t i = 0; i < node->children.size(); i++) {
             Value val = evaluateExpression(node->children[i]);
@@ -1041,14 +1271,14 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             }
         }
         
-        if (openGSLShapes.find(shapeName) != openGSLShapes.end()) {
-            openGSLShapes[shapeName].type = "text";
-            openGSLShapes[shapeName].color = color;
+        if (state->openGSLShapes.find(shapeName) != state->openGSLShapes.end()) {
+            state->openGSLShapes[shapeName].type = "text";
+            state->openGSLShapes[shapeName].color = color;
             
-            auto& sh = openGSLShapes[shapeName];
-            openGSLScript += "TEXT|" + shapeName + "|" + 
+            auto& sh = state->openGSLShapes[shapeName];
+            state->openGSLScript += "TEXT|" + shapeName + "|" + 
                              std::to_string(sh.x) + "|" + std::to_string(sh.y) + "|" + text + "|" + sh.color + "\n";
-            std::cout << "[OpenGSL] Shape.text: " << shapeName << " '" << text << "'" << std::endl;
+            *state->scriptOut << "[OpenGSL] Shape.text: " << shapeName << " '" << text << "'" << std::endl;
         }
     }
     // Legacy support: .OpenGSL.apple (x) (y) (z) (size)
@@ -1064,10 +1294,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<int>(vz)) z = std::get<int>(vz);
             if (std::holds_alternative<int>(vs)) size = std::get<int>(vs);
         }
-        openGSLScript += "APPLE|shape" + std::to_string(++openGSLShapeCount) + "|" + 
+        state->openGSLScript += "APPLE|shape" + std::to_string(++state->openGSLShapeCount) + "|" + 
                          std::to_string(x) + "|" + std::to_string(y) + "|" +
-                         std::to_string(z) + "|" + std::to_string(size) + "|" + openGSLCurrentColor + "\n";
-        std::cout << "[OpenGSL] Apple: " << x << "," << y << "," << z << " size=" << size << std::endl;
+                         std::to_string(z) + "|" + std::to_string(size) + "|" + state->openGSLCurrentColor + "\n";
+        *state->scriptOut << "[OpenGSL] Apple: " << x << "," << y << "," << z << " size=" << size << std::endl;
     }
     // OpenGSL render/show
     else if (node->value == ".OpenGSL.render" || node->value == ".opengsl.render" ||
@@ -1075,15 +1305,15 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
         // Save script
         std::ofstream uiFile("_opengsl_canvas.ui");
         uiFile << "// OpenGSL - Open Public Geneia Styling Library\n";
-        uiFile << openGSLScript;
+        uiFile << state->openGSLScript;
         uiFile.close();
         
-        std::cout << "[OpenGSL] Rendered to _opengsl_canvas.ui" << std::endl;
+        *state->scriptOut << "[OpenGSL] Rendered to _opengsl_canvas.ui" << std::endl;
         
         // Try to launch GUI
         if (system("which dotnet > /dev/null 2>&1") == 0) {
             if (system("test -f ui/bin/linux/GeneiaUILinux.dll") == 0) {
-                std::cout << "[OpenGSL] Opening window..." << std::endl;
+                *state->scriptOut << "[OpenGSL] Opening window..." << std::endl;
                 system("dotnet ui/bin/linux/GeneiaUILinux.dll _opengsl_canvas.ui");
             }
         }
@@ -1108,18 +1338,18 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
     else if (node->value == ".GWeb.page" || node->value == ".gweb.page" ||
              node->value == ".Web.page" || node->value == ".web.page") {
         // Reset web state
-        webHTML = "";
-        webCSS = "";
-        webJS = "";
-        webElementCount = 0;
+        state->webHTML = "";
+        state->webCSS = "";
+        state->webJS = "";
+        state->webElementCount = 0;
         
         if (!node->children.empty()) {
             Value title = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(title)) {
-                webTitle = std::get<std::string>(title);
+                state->webTitle = std::get<std::string>(title);
             }
         }
-        std::cout << "[G_Web.Kit] Page created: " << webTitle << std::endl;
+        *state->scriptOut << "[G_Web.Kit] Page created: " << state->webTitle << std::endl;
     }
     else if (node->value == ".GWeb.style" || node->value == ".gweb.style" ||
              node->value == ".Web.style" || node->value == ".web.style") {
@@ -1130,28 +1360,28 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<std::string>(prop) && std::holds_alternative<std::string>(val)) {
                 std::string p = std::get<std::string>(prop);
                 std::string v = std::get<std::string>(val);
-                if (p == "bg" || p == "background") webBgColor = v;
-                else if (p == "text") webTextColor = v;
-                else if (p == "accent") webAccentColor = v;
-                else if (p == "font") webFont = v;
-                std::cout << "[G_Web.Kit] Style: " << p << " = " << v << std::endl;
+                if (p == "bg" || p == "background") state->webBgColor = v;
+                else if (p == "text") state->webTextColor = v;
+                else if (p == "accent") state->webAccentColor = v;
+                else if (p == "font") state->webFont = v;
+                *state->scriptOut << "[G_Web.Kit] Style: " << p << " = " << v << std::endl;
             }
         }
     }
     else if (node->value == ".GWeb.nav" || node->value == ".gweb.nav" ||
              node->value == ".Web.nav" || node->value == ".web.nav") {
-        webHTML += "<nav class=\"gn-nav\">\n";
-        webHTML += "  <div class=\"gn-nav-brand\">" + webTitle + "</div>\n";
-        webHTML += "  <div class=\"gn-nav-links\">\n";
+        state->webHTML += "<nav class=\"gn-nav\">\n";
+        state->webHTML += "  <div class=\"gn-nav-brand\">" + state->webTitle + "</div>\n";
+        state->webHTML += "  <div class=\"gn-nav-links\">\n";
         for (auto& arg : node->children) {
             Value v = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(v)) {
                 std::string item = std::get<std::string>(v);
-                webHTML += "    <a href=\"#\">" + item + "</a>\n";
+                state->webHTML += "    <a href=\"#\">" + item + "</a>\n";
             }
         }
-        webHTML += "  </div>\n</nav>\n";
-        std::cout << "[G_Web.Kit] Nav created with " << node->children.size() << " items" << std::endl;
+        state->webHTML += "  </div>\n</nav>\n";
+        *state->scriptOut << "[G_Web.Kit] Nav created with " << node->children.size() << " items" << std::endl;
     }
     else if (node->value == ".GWeb.hero" || node->value == ".gweb.hero" ||
              node->value == ".Web.hero" || node->value == ".web.hero") {
@@ -1165,11 +1395,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) subtitle = std::get<std::string>(v);
         }
-        webHTML += "<section class=\"gn-hero\">\n";
-        webHTML += "  <h1>" + title + "</h1>\n";
-        if (!subtitle.empty()) webHTML += "  <p>" + subtitle + "</p>\n";
-        webHTML += "</section>\n";
-        std::cout << "[G_Web.Kit] Hero: " << title << std::endl;
+        state->webHTML += "<section class=\"gn-hero\">\n";
+        state->webHTML += "  <h1>" + title + "</h1>\n";
+        if (!subtitle.empty()) state->webHTML += "  <p>" + subtitle + "</p>\n";
+        state->webHTML += "</section>\n";
+        *state->scriptOut << "[G_Web.Kit] Hero: " << title << std::endl;
     }
     else if (node->value == ".GWeb.sect" || node->value == ".gweb.sect" ||
              node->value == ".GWeb.section" || node->value == ".gweb.section" ||
@@ -1179,21 +1409,21 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) title = std::get<std::string>(v);
         }
-        webHTML += "<section class=\"gn-section\">\n";
-        webHTML += "  <h2>" + title + "</h2>\n";
-        std::cout << "[G_Web.Kit] Section: " << title << std::endl;
+        state->webHTML += "<section class=\"gn-section\">\n";
+        state->webHTML += "  <h2>" + title + "</h2>\n";
+        *state->scriptOut << "[G_Web.Kit] Section: " << title << std::endl;
     }
     else if (node->value == ".GWeb.endsec" || node->value == ".gweb.endsec" ||
              node->value == ".Web.endsec" || node->value == ".web.endsec") {
-        webHTML += "</section>\n";
+        state->webHTML += "</section>\n";
     }
     else if (node->value == ".GWeb.text" || node->value == ".gweb.text" ||
              node->value == ".Web.text" || node->value == ".web.text") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                webHTML += "  <p>" + std::get<std::string>(v) + "</p>\n";
-                std::cout << "[G_Web.Kit] Text added" << std::endl;
+                state->webHTML += "  <p>" + std::get<std::string>(v) + "</p>\n";
+                *state->scriptOut << "[G_Web.Kit] Text added" << std::endl;
             }
         }
     }
@@ -1210,8 +1440,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<int>(v)) level = std::get<int>(v);
         }
-        webHTML += "  <h" + std::to_string(level) + ">" + text + "</h" + std::to_string(level) + ">\n";
-        std::cout << "[G_Web.Kit] Heading: " << text << std::endl;
+        state->webHTML += "  <h" + std::to_string(level) + ">" + text + "</h" + std::to_string(level) + ">\n";
+        *state->scriptOut << "[G_Web.Kit] Heading: " << text << std::endl;
     }
     else if (node->value == ".GWeb.btn" || node->value == ".gweb.btn" ||
              node->value == ".GWeb.button" || node->value == ".gweb.button" ||
@@ -1226,8 +1456,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) link = std::get<std::string>(v);
         }
-        webHTML += "  <a href=\"" + link + "\" class=\"gn-btn\">" + text + "</a>\n";
-        std::cout << "[G_Web.Kit] Button: " << text << std::endl;
+        state->webHTML += "  <a href=\"" + link + "\" class=\"gn-btn\">" + text + "</a>\n";
+        *state->scriptOut << "[G_Web.Kit] Button: " << text << std::endl;
     }
     else if (node->value == ".GWeb.img" || node->value == ".gweb.img" ||
              node->value == ".GWeb.image" || node->value == ".gweb.image" ||
@@ -1242,8 +1472,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) alt = std::get<std::string>(v);
         }
-        webHTML += "  <img src=\"" + src + "\" alt=\"" + alt + "\" class=\"gn-img\">\n";
-        std::cout << "[G_Web.Kit] Image: " << src << std::endl;
+        state->webHTML += "  <img src=\"" + src + "\" alt=\"" + alt + "\" class=\"gn-img\">\n";
+        *state->scriptOut << "[G_Web.Kit] Image: " << src << std::endl;
     }
     else if (node->value == ".GWeb.card" || node->value == ".gweb.card" ||
              node->value == ".Web.card" || node->value == ".web.card") {
@@ -1257,11 +1487,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) content = std::get<std::string>(v);
         }
-        webHTML += "  <div class=\"gn-card\">\n";
-        webHTML += "    <h3>" + title + "</h3>\n";
-        if (!content.empty()) webHTML += "    <p>" + content + "</p>\n";
-        webHTML += "  </div>\n";
-        std::cout << "[G_Web.Kit] Card: " << title << std::endl;
+        state->webHTML += "  <div class=\"gn-card\">\n";
+        state->webHTML += "    <h3>" + title + "</h3>\n";
+        if (!content.empty()) state->webHTML += "    <p>" + content + "</p>\n";
+        state->webHTML += "  </div>\n";
+        *state->scriptOut << "[G_Web.Kit] Card: " << title << std::endl;
     }
     else if (node->value == ".GWeb.grid" || node->value == ".gweb.grid" ||
              node->value == ".Web.grid" || node->value == ".web.grid") {
@@ -1270,24 +1500,24 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<int>(v)) cols = std::get<int>(v);
         }
-        webHTML += "<div class=\"gn-grid gn-grid-" + std::to_string(cols) + "\">\n";
-        std::cout << "[G_Web.Kit] Grid: " << cols << " columns" << std::endl;
+        state->webHTML += "<div class=\"gn-grid gn-grid-" + std::to_string(cols) + "\">\n";
+        *state->scriptOut << "[G_Web.Kit] Grid: " << cols << " columns" << std::endl;
     }
     else if (node->value == ".GWeb.endgrid" || node->value == ".gweb.endgrid" ||
              node->value == ".Web.endgrid" || node->value == ".web.endgrid") {
-        webHTML += "</div>\n";
+        state->webHTML += "</div>\n";
     }
     else if (node->value == ".GWeb.list" || node->value == ".gweb.list" ||
              node->value == ".Web.list" || node->value == ".web.list") {
-        webHTML += "  <ul class=\"gn-list\">\n";
+        state->webHTML += "  <ul class=\"gn-list\">\n";
         for (auto& arg : node->children) {
             Value v = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(v)) {
-                webHTML += "    <li>" + std::get<std::string>(v) + "</li>\n";
+                state->webHTML += "    <li>" + std::get<std::string>(v) + "</li>\n";
             }
         }
-        webHTML += "  </ul>\n";
-        std::cout << "[G_Web.Kit] List with " << node->children.size() << " items" << std::endl;
+        state->webHTML += "  </ul>\n";
+        *state->scriptOut << "[G_Web.Kit] List with " << node->children.size() << " items" << std::endl;
     }
     else if (node->value == ".GWeb.foot" || node->value == ".gweb.foot" ||
              node->value == ".GWeb.footer" || node->value == ".gweb.footer" ||
@@ -1297,10 +1527,10 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) text = std::get<std::string>(v);
         }
-        webHTML += "<footer class=\"gn-footer\">\n";
-        webHTML += "  <p>" + text + "</p>\n";
-        webHTML += "</footer>\n";
-        std::cout << "[G_Web.Kit] Footer: " << text << std::endl;
+        state->webHTML += "<footer class=\"gn-footer\">\n";
+        state->webHTML += "  <p>" + text + "</p>\n";
+        state->webHTML += "</footer>\n";
+        *state->scriptOut << "[G_Web.Kit] Footer: " << text << std::endl;
     }
     // Additional G_Web.Kit elements
     else if (node->value == ".GWeb.link" || node->value == ".gweb.link") {
@@ -1314,8 +1544,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) href = std::get<std::string>(v);
         }
-        webHTML += "  <a href=\"" + href + "\" class=\"gn-link\">" + text + "</a>\n";
-        std::cout << "[G_Web.Kit] Link: " << text << std::endl;
+        state->webHTML += "  <a href=\"" + href + "\" class=\"gn-link\">" + text + "</a>\n";
+        *state->scriptOut << "[G_Web.Kit] Link: " << text << std::endl;
     }
     else if (node->value == ".GWeb.input" || node->value == ".gweb.input") {
         std::string placeholder = "";
@@ -1328,8 +1558,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) type = std::get<std::string>(v);
         }
-        webHTML += "  <input type=\"" + type + "\" placeholder=\"" + placeholder + "\" class=\"gn-input\">\n";
-        std::cout << "[G_Web.Kit] Input: " << placeholder << std::endl;
+        state->webHTML += "  <input type=\"" + type + "\" placeholder=\"" + placeholder + "\" class=\"gn-input\">\n";
+        *state->scriptOut << "[G_Web.Kit] Input: " << placeholder << std::endl;
     }
     else if (node->value == ".GWeb.form" || node->value == ".gweb.form") {
         std::string action = "#";
@@ -1337,11 +1567,11 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) action = std::get<std::string>(v);
         }
-        webHTML += "<form class=\"gn-form\" action=\"" + action + "\" method=\"post\">\n";
-        std::cout << "[G_Web.Kit] Form started" << std::endl;
+        state->webHTML += "<form class=\"gn-form\" action=\"" + action + "\" method=\"post\">\n";
+        *state->scriptOut << "[G_Web.Kit] Form started" << std::endl;
     }
     else if (node->value == ".GWeb.endform" || node->value == ".gweb.endform") {
-        webHTML += "</form>\n";
+        state->webHTML += "</form>\n";
     }
     else if (node->value == ".GWeb.video" || node->value == ".gweb.video") {
         std::string src = "";
@@ -1349,8 +1579,8 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) src = std::get<std::string>(v);
         }
-        webHTML += "  <video src=\"" + src + "\" controls class=\"gn-video\"></video>\n";
-        std::cout << "[G_Web.Kit] Video: " << src << std::endl;
+        state->webHTML += "  <video src=\"" + src + "\" controls class=\"gn-video\"></video>\n";
+        *state->scriptOut << "[G_Web.Kit] Video: " << src << std::endl;
     }
     else if (node->value == ".GWeb.div" || node->value == ".gweb.div") {
         std::string className = "";
@@ -1358,17 +1588,17 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) className = std::get<std::string>(v);
         }
-        webHTML += "<div class=\"" + className + "\">\n";
-        std::cout << "[G_Web.Kit] Div: " << className << std::endl;
+        state->webHTML += "<div class=\"" + className + "\">\n";
+        *state->scriptOut << "[G_Web.Kit] Div: " << className << std::endl;
     }
     else if (node->value == ".GWeb.enddiv" || node->value == ".gweb.enddiv") {
-        webHTML += "</div>\n";
+        state->webHTML += "</div>\n";
     }
     else if (node->value == ".GWeb.br" || node->value == ".gweb.br") {
-        webHTML += "  <br>\n";
+        state->webHTML += "  <br>\n";
     }
     else if (node->value == ".GWeb.hr" || node->value == ".gweb.hr") {
-        webHTML += "  <hr class=\"gn-hr\">\n";
+        state->webHTML += "  <hr class=\"gn-hr\">\n";
     }
     else if (node->value == ".GWeb.space" || node->value == ".gweb.space") {
         int height = 20;
@@ -1376,28 +1606,28 @@ void Interpreter::executeFunctionCall(std::shared_ptr<ASTNode> node) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<int>(v)) height = std::get<int>(v);
         }
-        webHTML += "  <div style=\"height: " + std::to_string(height) + "px;\"></div>\n";
+        state->webHTML += "  <div style=\"height: " + std::to_string(height) + "px;\"></div>\n";
     }
     else if (node->value == ".GWeb.build" || node->value == ".gweb.build" ||
              node->value == ".Web.build" || node->value == ".web.build") {
         // Generate CSS
-        webCSS = R"(
+        state->webCSS = R"(
 * { margin: 0; padding: 0; box-sizing: border-box; }
-body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color: )" + webTextColor + R"(; line-height: 1.6; }
+body { font-family: )" + state->webFont + R"(; background: )" + state->webBgColor + R"(; color: )" + state->webTextColor + R"(; line-height: 1.6; }
 .gn-nav { display: flex; justify-content: space-between; align-items: center; padding: 1rem 2rem; background: rgba(0,0,0,0.1); }
-.gn-nav-brand { font-size: 1.5rem; font-weight: bold; color: )" + webAccentColor + R"(; }
-.gn-nav-links a { margin-left: 2rem; text-decoration: none; color: )" + webTextColor + R"(; transition: color 0.3s; }
-.gn-nav-links a:hover { color: )" + webAccentColor + R"(; }
-.gn-hero { text-align: center; padding: 5rem 2rem; background: linear-gradient(135deg, )" + webAccentColor + R"(22, )" + webAccentColor + R"(11); }
+.gn-nav-brand { font-size: 1.5rem; font-weight: bold; color: )" + state->webAccentColor + R"(; }
+.gn-nav-links a { margin-left: 2rem; text-decoration: none; color: )" + state->webTextColor + R"(; transition: color 0.3s; }
+.gn-nav-links a:hover { color: )" + state->webAccentColor + R"(; }
+.gn-hero { text-align: center; padding: 5rem 2rem; background: linear-gradient(135deg, )" + state->webAccentColor + R"(22, )" + state->webAccentColor + R"(11); }
 .gn-hero h1 { font-size: 3rem; margin-bottom: 1rem; }
 .gn-hero p { font-size: 1.25rem; opacity: 0.8; }
 .gn-section { padding: 4rem 2rem; max-width: 1200px; margin: 0 auto; }
-.gn-section h2 { font-size: 2rem; margin-bottom: 1.5rem; color: )" + webAccentColor + R"(; }
-.gn-btn { display: inline-block; padding: 0.75rem 1.5rem; background: )" + webAccentColor + R"(; color: white; text-decoration: none; border-radius: 8px; transition: transform 0.2s, box-shadow 0.2s; }
-.gn-btn:hover { transform: translateY(-2px); box-shadow: 0 5px 20px )" + webAccentColor + R"(44; }
+.gn-section h2 { font-size: 2rem; margin-bottom: 1.5rem; color: )" + state->webAccentColor + R"(; }
+.gn-btn { display: inline-block; padding: 0.75rem 1.5rem; background: )" + state->webAccentColor + R"(; color: white; text-decoration: none; border-radius: 8px; transition: transform 0.2s, box-shadow 0.2s; }
+.gn-btn:hover { transform: translateY(-2px); box-shadow: 0 5px 20px )" + state->webAccentColor + R"(44; }
 .gn-img { max-width: 100%; border-radius: 12px; }
 .gn-card { background: rgba(255,255,255,0.05); border: 1px solid rgba(255,255,255,0.1); border-radius: 16px; padding: 1.5rem; margin: 1rem 0; }
-.gn-card h3 { color: )" + webAccentColor + R"(; margin-bottom: 0.5rem; }
+.gn-card h3 { color: )" + state->webAccentColor + R"(; margin-bottom: 0.5rem; }
 .gn-grid { display: grid; gap: 1.5rem; }
 .gn-grid-2 { grid-template-columns: repeat(2, 1fr); }
 .gn-grid-3 { grid-template-columns: repeat(3, 1fr); }
@@ -1405,10 +1635,10 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
 .gn-list { list-style: none; }
 .gn-list li { padding: 0.5rem 0; border-bottom: 1px solid rgba(255,255,255,0.1); }
 .gn-footer { text-align: center; padding: 2rem; background: rgba(0,0,0,0.1); margin-top: 2rem; }
-.gn-link { color: )" + webAccentColor + R"(; text-decoration: none; transition: opacity 0.2s; }
+.gn-link { color: )" + state->webAccentColor + R"(; text-decoration: none; transition: opacity 0.2s; }
 .gn-link:hover { opacity: 0.8; }
 .gn-input { padding: 0.75rem 1rem; border: 1px solid rgba(255,255,255,0.2); border-radius: 8px; background: rgba(255,255,255,0.05); color: inherit; font-size: 1rem; width: 100%; max-width: 400px; }
-.gn-input:focus { outline: none; border-color: )" + webAccentColor + R"(; }
+.gn-input:focus { outline: none; border-color: )" + state->webAccentColor + R"(; }
 .gn-form { display: flex; flex-direction: column; gap: 1rem; }
 .gn-video { max-width: 100%; border-radius: 12px; }
 .gn-hr { border: none; height: 1px; background: rgba(255,255,255,0.1); margin: 2rem 0; }
@@ -1419,10 +1649,10 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
         std::string fullHTML = "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n";
         fullHTML += "  <meta charset=\"UTF-8\">\n";
         fullHTML += "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n";
-        fullHTML += "  <title>" + webTitle + "</title>\n";
-        fullHTML += "  <style>" + webCSS + "</style>\n";
+        fullHTML += "  <title>" + state->webTitle + "</title>\n";
+        fullHTML += "  <style>" + state->webCSS + "</style>\n";
         fullHTML += "</head>\n<body>\n";
-        fullHTML += webHTML;
+        fullHTML += state->webHTML;
         fullHTML += "</body>\n</html>";
         
         // Save to file
@@ -1430,8 +1660,8 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
         htmlFile << fullHTML;
         htmlFile.close();
         
-        std::cout << "[G_Web.Kit] Website built: _geneia_website.html" << std::endl;
-        std::cout << "[G_Web.Kit] Open in browser to view" << std::endl;
+        *state->scriptOut << "[G_Web.Kit] Website built: _geneia_website.html" << std::endl;
+        *state->scriptOut << "[G_Web.Kit] Open in browser to view" << std::endl;
         
         // Try to open in browser
         if (system("which xdg-open > /dev/null 2>&1") == 0) {
@@ -1444,56 +1674,70 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
     // Import: import OpenGWS
     // 
     // Package Manager:
-    //   .GWS.install 'package'    - Install a package
+    //   .GWS.registry 'dir'       - Registry to install from (a directory or file:// mirror)
+    //   .GWS.install 'package'    - Install packages ('name@1.2.0'; none: what gwsl.lock lists)
     //   .GWS.remove 'package'     - Remove a package
-    //   .GWS.list                 - List installed packages
-    //   .GWS.search 'query'       - Search packages
-    //   .GWS.update               - Update packages
+    //   .GWS.pkglist              - List installed packages
+    //   .GWS.search 'query'       - Search package names and descriptions (the registry index)
+    //   .GWS.update               - Rebuild the registry index
     //
     // Web Server:
     //   .GWS.port (8080)          - Set server port
-    //   .GWS.route '/'            - Define a route
+    //   .GWS.route '/'            - Define a route ('METHOD' '/users/:id', '/files/*')
     //   .GWS.page 'title'         - Set page title
     //   .GWS.endroute             - End route definition
-    //   .GWS.serve                - Start the server
+    //   .GWS.static '/assets' 'dir' - Serve a directory (sendfile, Range, If-Modified-Since)
+    //   .GWS.handler '/path' { }  - Run the block per request; what it prints is the page
+    //   .GWS.engine 'uring'       - Event loop: 'epoll' (default) or 'uring' (io_uring, falls back to epoll)
+    //   .GWS.serve ['--watch']    - Start the server (in-process, Ctrl+C stops it);
+    //                               --watch reloads the routes when the script is saved
     // ============================================================
     // Package Manager Functions
-    else if (node->value == ".GWS.install" || node->value == ".gws.install" ||
-             node->value == ".OpenGWS.install" || node->value == ".opengws.install") {
+    else if (node->value == ".GWS.registry" || node->value == ".gws.registry" ||
+             node->value == ".OpenGWS.registry" || node->value == ".opengws.registry") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                std::string pkg = std::get<std::string>(v);
-                gwsInstalledPackages.push_back(pkg);
-                std::cout << "[gwsl-get] Installing " << pkg << "..." << std::endl;
-                std::cout << "[gwsl-get] Package '" << pkg << "' installed" << std::endl;
+                state->gwsRegistry = std::get<std::string>(v);
+                *state->scriptOut << "[gwsl-get] Registry: " << state->gwsRegistry << std::endl;
             }
         }
     }
+    else if (node->value == ".GWS.install" || node->value == ".gws.install" ||
+             node->value == ".OpenGWS.install" || node->value == ".opengws.install") {
+        // Into ./gwsl_modules through the shared store (gws_packages.h)
+        std::vector<std::string> specs;
+        for (auto& arg : node->children) {
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<std::string>(v)) specs.push_back(std::get<std::string>(v));
+        }
+        GWSPackages packages(state->gwsRegistry, GWSPackages::defaultStore());
+        if (!packages.install(specs, *state->scriptOut)) {
+            *state->scriptOut << "[gwsl-get] Install failed: " << packages.error() << std::endl;
+        }
+    }
     else if (node->value == ".GWS.remove" || node->value == ".gws.remove" ||
              node->value == ".OpenGWS.remove" || node->value == ".opengws.remove") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                std::string pkg = std::get<std::string>(v);
-                auto it = std::find(gwsInstalledPackages.begin(), gwsInstalledPackages.end(), pkg);
-                if (it != gwsInstalledPackages.end()) {
-                    gwsInstalledPackages.erase(it);
-                    std::cout << "[gwsl-get] Removed: " << pkg << std::endl;
-                } else {
-                    std::cout << "[gwsl-get] Not found: " << pkg << std::endl;
+                GWSPackages packages(state->gwsRegistry, GWSPackages::defaultStore());
+                if (!packages.remove(std::get<std::string>(v), *state->scriptOut)) {
+                    *state->scriptOut << "[gwsl-get] " << packages.error() << std::endl;
                 }
             }
         }
     }
     else if (node->value == ".GWS.pkglist" || node->value == ".gws.pkglist" ||
              node->value == ".OpenGWS.pkglist" || node->value == ".opengws.pkglist") {
-        std::cout << "[gwsl-get] Installed packages:" << std::endl;
-        if (gwsInstalledPackages.empty()) {
-            std::cout << "  (none)" << std::endl;
+        GWSPackages packages(state->gwsRegistry, GWSPackages::defaultStore());
+        std::vector<GWSLocked> installed = packages.installed();
+        *state->scriptOut << "[gwsl-get] Installed packages:" << std::endl;
+        if (installed.empty()) {
+            *state->scriptOut << "  (none)" << std::endl;
         } else {
-            for (const auto& pkg : gwsInstalledPackages) {
-                std::cout << "  - " << pkg << std::endl;
+            for (const auto& pkg : installed) {
+                *state->scriptOut << "  - " << pkg.name << " " << pkg.version << std::endl;
             }
         }
     }
@@ -1504,16 +1748,17 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) query = std::get<std::string>(v);
         }
-        std::cout << "[gwsl-get] Available packages:" << std::endl;
-        std::cout << "  - express     : Fast web framework" << std::endl;
-        std::cout << "  - flask       : Python web framework" << std::endl;
-        std::cout << "  - fastapi     : Modern API framework" << std::endl;
-        std::cout << "  - http-server : Simple HTTP server" << std::endl;
+        GWSPackages packages(state->gwsRegistry, GWSPackages::defaultStore());
+        if (!packages.search(query, *state->scriptOut)) {
+            *state->scriptOut << "[gwsl-get] Search failed: " << packages.error() << std::endl;
+        }
     }
     else if (node->value == ".GWS.update" || node->value == ".gws.update" ||
              node->value == ".OpenGWS.update" || node->value == ".opengws.update") {
-        std::cout << "[gwsl-get] Updating packages..." << std::endl;
-        std::cout << "[gwsl-get] All packages up to date" << std::endl;
+        GWSPackages packages(state->gwsRegistry, GWSPackages::defaultStore());
+        if (!packages.update(*state->scriptOut)) {
+            *state->scriptOut << "[gwsl-get] Update failed: " << packages.error() << std::endl;
+        }
     }
     // Web Server Functions
     else if (node->value == ".GWS.port" || node->value == ".gws.port" ||
@@ -1521,63 +1766,128 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<int>(v)) {
-                gwsPort = std::get<int>(v);
+                state->gwsPort = std::get<int>(v);
             }
         }
-        std::cout << "[OpenGWS] Port set to: " << gwsPort << std::endl;
+        *state->scriptOut << "[OpenGWS] Port set to: " << state->gwsPort << std::endl;
     }
     else if (node->value == ".GWS.route" || node->value == ".gws.route" ||
              node->value == ".OpenGWS.route" || node->value == ".opengws.route") {
-        // Start a new route
-        gwsCurrentRoute = "/";
+        // Start a new route: .GWS.route ['METHOD'] '/path' - the path may use
+        // :name segments and a final * (gws_router.h); the method defaults to GET
+        state->gwsCurrentRoute = "/";
+        state->gwsCurrentMethod = GWS_GET;
+        std::vector<std::string> operands;
+        for (auto& arg : node->children) {
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<std::string>(v)) operands.push_back(std::get<std::string>(v));
+        }
+        if (operands.size() >= 2) {
+            state->gwsCurrentMethod = gwsMethod(operands[0].data(), operands[0].size());
+            state->gwsCurrentRoute = operands[1];
+        } else if (!operands.empty()) {
+            state->gwsCurrentRoute = operands[0];
+        }
+        // Reset web state for this route
+        state->webHTML = "";
+        state->webCSS = "";
+        state->webJS = "";
+        state->webTitle = "Geneia Server";
+        *state->scriptOut << "[OpenGWS] Route: " << state->gwsCurrentRoute << std::endl;
+    }
+    else if (node->value == ".GWS.handler" || node->value == ".gws.handler" ||
+             node->value == ".OpenGWS.handler" || node->value == ".opengws.handler") {
+        // .GWS.handler ['METHOD'] '/path' { ... } - the block runs per request
+        // on a server worker, its output the response (GWSScriptHandler)
+        std::shared_ptr<ASTNode> body;
+        std::vector<std::string> operands;
+        for (auto& arg : node->children) {
+            if (arg->type == AST_BLOCK) {
+                body = arg;
+                continue;
+            }
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<std::string>(v)) operands.push_back(std::get<std::string>(v));
+        }
+        if (!body || operands.empty()) {
+            *state->scriptOut << "[OpenGWS] Usage: .GWS.handler ['METHOD'] '/path' { ... }" << std::endl;
+        } else {
+            int method = GWS_GET;
+            if (operands.size() >= 2) method = gwsMethod(operands[0].data(), operands[0].size());
+            if (!state->gwsPrelude) state->gwsPrelude = std::make_shared<GWSPrelude>();
+            auto script = std::make_shared<GWSScript>();
+            script->body = body;
+            script->prelude = state->gwsPrelude;
+            state->gwsRoutes.push_back({method, operands.back(), "", script});
+            *state->scriptOut << "[OpenGWS] Handler: " << operands.back() << std::endl;
+        }
+    }
+    else if (node->value == ".GWS.static" || node->value == ".gws.static" ||
+             node->value == ".OpenGWS.static" || node->value == ".opengws.static") {
+        // .GWS.static '/prefix' 'dir' - files below dir are served at /prefix/...
+        std::vector<std::string> operands;
+        for (auto& arg : node->children) {
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<std::string>(v)) operands.push_back(std::get<std::string>(v));
+        }
+        if (operands.size() >= 2) {
+            state->gwsMounts.push_back({operands[0], operands[1]});
+            *state->scriptOut << "[OpenGWS] Static: " << operands[0] << " -> " << operands[1] << std::endl;
+        }
+    }
+    else if (node->value == ".GWS.engine" || node->value == ".gws.engine" ||
+             node->value == ".OpenGWS.engine" || node->value == ".opengws.engine") {
+        // .GWS.engine 'uring' | 'epoll' - the event loop .GWS.serve runs
+        std::string name;
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
-            if (std::holds_alternative<std::string>(v)) {
-                gwsCurrentRoute = std::get<std::string>(v);
-            }
+            if (std::holds_alternative<std::string>(v)) name = std::get<std::string>(v);
+        }
+        if (name == "uring" || name == "io_uring") {
+            state->gwsEngine = GWS_ENGINE_URING;
+            *state->scriptOut << "[OpenGWS] Engine: io_uring" << std::endl;
+        } else if (name == "epoll") {
+            state->gwsEngine = GWS_ENGINE_EPOLL;
+            *state->scriptOut << "[OpenGWS] Engine: epoll" << std::endl;
+        } else {
+            *state->scriptOut << "[OpenGWS] Unknown engine '" << name << "' (epoll, uring)" << std::endl;
         }
-        // Reset web state for this route
-        webHTML = "";
-        webCSS = "";
-        webJS = "";
-        webTitle = "Geneia Server";
-        std::cout << "[OpenGWS] Route: " << gwsCurrentRoute << std::endl;
     }
     else if (node->value == ".GWS.endroute" || node->value == ".gws.endroute" ||
              node->value == ".OpenGWS.endroute" || node->value == ".opengws.endroute") {
         // Build the page for this route
         std::string routeCSS = R"(
 * { margin: 0; padding: 0; box-sizing: border-box; }
-body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color: )" + webTextColor + R"(; line-height: 1.6; }
+body { font-family: )" + state->webFont + R"(; background: )" + state->webBgColor + R"(; color: )" + state->webTextColor + R"(; line-height: 1.6; }
 .gn-nav { display: flex; justify-content: space-between; align-items: center; padding: 1rem 2rem; background: rgba(0,0,0,0.1); }
-.gn-nav-brand { font-size: 1.5rem; font-weight: bold; color: )" + webAccentColor + R"(; }
-.gn-nav-links a { margin-left: 2rem; text-decoration: none; color: )" + webTextColor + R"(; }
-.gn-hero { text-align: center; padding: 5rem 2rem; background: linear-gradient(135deg, )" + webAccentColor + R"(22, )" + webAccentColor + R"(11); }
+.gn-nav-brand { font-size: 1.5rem; font-weight: bold; color: )" + state->webAccentColor + R"(; }
+.gn-nav-links a { margin-left: 2rem; text-decoration: none; color: )" + state->webTextColor + R"(; }
+.gn-hero { text-align: center; padding: 5rem 2rem; background: linear-gradient(135deg, )" + state->webAccentColor + R"(22, )" + state->webAccentColor + R"(11); }
 .gn-hero h1 { font-size: 3rem; margin-bottom: 1rem; }
 .gn-section { padding: 4rem 2rem; max-width: 1200px; margin: 0 auto; }
-.gn-section h2 { font-size: 2rem; margin-bottom: 1.5rem; color: )" + webAccentColor + R"(; }
-.gn-btn { display: inline-block; padding: 0.75rem 1.5rem; background: )" + webAccentColor + R"(; color: white; text-decoration: none; border-radius: 8px; }
+.gn-section h2 { font-size: 2rem; margin-bottom: 1.5rem; color: )" + state->webAccentColor + R"(; }
+.gn-btn { display: inline-block; padding: 0.75rem 1.5rem; background: )" + state->webAccentColor + R"(; color: white; text-decoration: none; border-radius: 8px; }
 .gn-card { background: rgba(255,255,255,0.05); border: 1px solid rgba(255,255,255,0.1); border-radius: 16px; padding: 1.5rem; margin: 1rem 0; }
-.gn-card h3 { color: )" + webAccentColor + R"(; }
+.gn-card h3 { color: )" + state->webAccentColor + R"(; }
 .gn-grid { display: grid; gap: 1.5rem; }
 .gn-grid-3 { grid-template-columns: repeat(3, 1fr); }
 .gn-list { list-style: none; }
 .gn-list li { padding: 0.5rem 0; border-bottom: 1px solid rgba(255,255,255,0.1); }
 .gn-footer { text-align: center; padding: 2rem; background: rgba(0,0,0,0.1); }
 )";
-        std::string fullHTML = "<!DOCTYPE html><html><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width,initial-scale=1.0\"><title>" + webTitle + "</title><style>" + routeCSS + "</style></head><body>" + webHTML + "</body></html>";
-        gwsRoutes.push_back({gwsCurrentRoute, fullHTML});
-        std::cout << "[OpenGWS] Route '" << gwsCurrentRoute << "' ready" << std::endl;
+        std::string fullHTML = "<!DOCTYPE html><html><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width,initial-scale=1.0\"><title>" + state->webTitle + "</title><style>" + routeCSS + "</style></head><body>" + state->webHTML + "</body></html>";
+        state->gwsRoutes.push_back({state->gwsCurrentMethod, state->gwsCurrentRoute, fullHTML});
+        *state->scriptOut << "[OpenGWS] Route '" << state->gwsCurrentRoute << "' ready" << std::endl;
     }
     else if (node->value == ".GWS.page" || node->value == ".gws.page" ||
              node->value == ".OpenGWS.page" || node->value == ".opengws.page") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                webTitle = std::get<std::string>(v);
+                state->webTitle = std::get<std::string>(v);
             }
         }
-        std::cout << "[OpenGWS] Page: " << webTitle << std::endl;
+        *state->scriptOut << "[OpenGWS] Page: " << state->webTitle << std::endl;
     }
     else if (node->value == ".GWS.style" || node->value == ".gws.style" ||
              node->value == ".OpenGWS.style" || node->value == ".opengws.style") {
@@ -1587,23 +1897,23 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             if (std::holds_alternative<std::string>(prop) && std::holds_alternative<std::string>(val)) {
                 std::string p = std::get<std::string>(prop);
                 std::string v = std::get<std::string>(val);
-                if (p == "bg") webBgColor = v;
-                else if (p == "text") webTextColor = v;
-                else if (p == "accent") webAccentColor = v;
-                else if (p == "font") webFont = v;
+                if (p == "bg") state->webBgColor = v;
+                else if (p == "text") state->webTextColor = v;
+                else if (p == "accent") state->webAccentColor = v;
+                else if (p == "font") state->webFont = v;
             }
         }
     }
     else if (node->value == ".GWS.nav" || node->value == ".gws.nav" ||
              node->value == ".OpenGWS.nav" || node->value == ".opengws.nav") {
-        webHTML += "<nav class=\"gn-nav\"><div class=\"gn-nav-brand\">" + webTitle + "</div><div class=\"gn-nav-links\">";
+        state->webHTML += "<nav class=\"gn-nav\"><div class=\"gn-nav-brand\">" + state->webTitle + "</div><div class=\"gn-nav-links\">";
         for (auto& arg : node->children) {
             Value v = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(v)) {
-                webHTML += "<a href=\"#\">" + std::get<std::string>(v) + "</a>";
+                state->webHTML += "<a href=\"#\">" + std::get<std::string>(v) + "</a>";
             }
         }
-        webHTML += "</div></nav>";
+        state->webHTML += "</div></nav>";
     }
     else if (node->value == ".GWS.hero" || node->value == ".gws.hero" ||
              node->value == ".OpenGWS.hero" || node->value == ".opengws.hero") {
@@ -1616,9 +1926,9 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) subtitle = std::get<std::string>(v);
         }
-        webHTML += "<section class=\"gn-hero\"><h1>" + title + "</h1>";
-        if (!subtitle.empty()) webHTML += "<p>" + subtitle + "</p>";
-        webHTML += "</section>";
+        state->webHTML += "<section class=\"gn-hero\"><h1>" + title + "</h1>";
+        if (!subtitle.empty()) state->webHTML += "<p>" + subtitle + "</p>";
+        state->webHTML += "</section>";
     }
     else if (node->value == ".GWS.sect" || node->value == ".gws.sect" ||
              node->value == ".OpenGWS.sect" || node->value == ".opengws.sect") {
@@ -1627,18 +1937,18 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) title = std::get<std::string>(v);
         }
-        webHTML += "<section class=\"gn-section\"><h2>" + title + "</h2>";
+        state->webHTML += "<section class=\"gn-section\"><h2>" + title + "</h2>";
     }
     else if (node->value == ".GWS.endsec" || node->value == ".gws.endsec" ||
              node->value == ".OpenGWS.endsec" || node->value == ".opengws.endsec") {
-        webHTML += "</section>";
+        state->webHTML += "</section>";
     }
     else if (node->value == ".GWS.text" || node->value == ".gws.text" ||
              node->value == ".OpenGWS.text" || node->value == ".opengws.text") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                webHTML += "<p>" + std::get<std::string>(v) + "</p>";
+                state->webHTML += "<p>" + std::get<std::string>(v) + "</p>";
             }
         }
     }
@@ -1653,7 +1963,7 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) link = std::get<std::string>(v);
         }
-        webHTML += "<a href=\"" + link + "\" class=\"gn-btn\">" + text + "</a>";
+        state->webHTML += "<a href=\"" + link + "\" class=\"gn-btn\">" + text + "</a>";
     }
     else if (node->value == ".GWS.card" || node->value == ".gws.card" ||
              node->value == ".OpenGWS.card" || node->value == ".opengws.card") {
@@ -1666,9 +1976,9 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) content = std::get<std::string>(v);
         }
-        webHTML += "<div class=\"gn-card\"><h3>" + title + "</h3>";
-        if (!content.empty()) webHTML += "<p>" + content + "</p>";
-        webHTML += "</div>";
+        state->webHTML += "<div class=\"gn-card\"><h3>" + title + "</h3>";
+        if (!content.empty()) state->webHTML += "<p>" + content + "</p>";
+        state->webHTML += "</div>";
     }
     else if (node->value == ".GWS.grid" || node->value == ".gws.grid" ||
              node->value == ".OpenGWS.grid" || node->value == ".opengws.grid") {
@@ -1677,22 +1987,22 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<int>(v)) cols = std::get<int>(v);
         }
-        webHTML += "<div class=\"gn-grid gn-grid-" + std::to_string(cols) + "\">";
+        state->webHTML += "<div class=\"gn-grid gn-grid-" + std::to_string(cols) + "\">";
     }
     else if (node->value == ".GWS.endgrid" || node->value == ".gws.endgrid" ||
              node->value == ".OpenGWS.endgrid" || node->value == ".opengws.endgrid") {
-        webHTML += "</div>";
+        state->webHTML += "</div>";
     }
     else if (node->value == ".GWS.list" || node->value == ".gws.list" ||
              node->value == ".OpenGWS.list" || node->value == ".opengws.list") {
-        webHTML += "<ul class=\"gn-list\">";
+        state->webHTML += "<ul class=\"gn-list\">";
         for (auto& arg : node->children) {
             Value v = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(v)) {
-                webHTML += "<li>" + std::get<std::string>(v) + "</li>";
+                state->webHTML += "<li>" + std::get<std::string>(v) + "</li>";
             }
         }
-        webHTML += "</ul>";
+        state->webHTML += "</ul>";
     }
     else if (node->value == ".GWS.foot" || node->value == ".gws.foot" ||
              node->value == ".OpenGWS.foot" || node->value == ".opengws.foot") {
@@ -1701,71 +2011,118 @@ body { font-family: )" + webFont + R"(; background: )" + webBgColor + R"(; color
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) text = std::get<std::string>(v);
         }
-        webHTML += "<footer class=\"gn-footer\"><p>" + text + "</p></footer>";
+        state->webHTML += "<footer class=\"gn-footer\"><p>" + text + "</p></footer>";
     }
     else if (node->value == ".GWS.serve" || node->value == ".gws.serve" ||
              node->value == ".OpenGWS.serve" || node->value == ".opengws.serve") {
-        // Generate Python server script
-        std::string serverScript = R"(#!/usr/bin/env python3
-import http.server
-import socketserver
-
-PORT = )" + std::to_string(gwsPort) + R"(
-
-ROUTES = {
-)";
-        for (auto& route : gwsRoutes) {
-            // Escape quotes in HTML
-            std::string escapedHTML = route.second;
-            size_t pos = 0;
-            while ((pos = escapedHTML.find("\"", pos)) != std::string::npos) {
-                escapedHTML.replace(pos, 1, "\\\"");
-                pos += 2;
-            }
-            pos = 0;
-            while ((pos = escapedHTML.find("\n", pos)) != std::string::npos) {
-                escapedHTML.replace(pos, 1, "\\n");
-                pos += 2;
-            }
-            serverScript += "    \"" + route.first + "\": \"" + escapedHTML + "\",\n";
-        }
-        serverScript += R"(}
-
-class GeneiaHandler(http.server.SimpleHTTPRequestHandler):
-    def do_GET(self):
-        path = self.path.split('?')[0]
-        if path in ROUTES:
-            self.send_response(200)
-            self.send_header('Content-type', 'text/html; charset=utf-8')
-            self.end_headers()
-            self.wfile.write(ROUTES[path].encode('utf-8'))
-        else:
-            self.send_response(404)
-            self.send_header('Content-type', 'text/html')
-            self.end_headers()
-            self.wfile.write(b'<h1>404 - Not Found</h1><p>Route not defined in OpenGWS</p>')
-
-with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
-    print(f"\n[OpenGWS] Server running at http://localhost:{PORT}")
-    print("[OpenGWS] Press Ctrl+C to stop\n")
-    print("Routes:")
-    for route in ROUTES:
-        print(f"  - http://localhost:{PORT}{route}")
-    print()
-    httpd.serve_forever()
-)";
-        // Save server script
-        std::ofstream serverFile("_geneia_server.py");
-        serverFile << serverScript;
-        serverFile.close();
-        
-        std::cout << "\n[OpenGWS] ========================================" << std::endl;
-        std::cout << "[OpenGWS] Server script saved to _geneia_server.py" << std::endl;
-        std::cout << "[OpenGWS] Starting server on port " << gwsPort << "..." << std::endl;
-        std::cout << "[OpenGWS] ========================================\n" << std::endl;
-        
-        // Run the server
-        system("python3 _geneia_server.py");
+        // Served in-process; every route is a prepared response (gws_server.cpp)
+        bool watch = false;
+        for (auto& child : node->children) {
+            Value v = evaluateExpression(child);
+            if (std::holds_alternative<std::string>(v) && std::get<std::string>(v) == "--watch") watch = true;
+        }
+        if (state->gwsPrelude) {
+            // Handlers see the script as it is now; nothing reads this
+            // until the routes are published
+            state->gwsPrelude->variables = variables;
+            state->gwsPrelude->functions = functions;
+            state->gwsPrelude = nullptr;
+        }
+        if (state->gwsRerunning) {
+            // Re-run by --watch for its routes: the serving copy carries on
+            shouldExit = true;
+            return;
+        }
+        GWSServer server(state->gwsPort);
+        server.handlers([] { return std::unique_ptr<GWSHandler>(new GWSScriptHandler()); });
+        std::vector<std::pair<int, std::string>> listed;
+        auto stage = [this, &server, &listed]() {
+            listed.clear();
+            for (auto& route : state->gwsRoutes) {
+                if (!server.route(route)) {
+                    *state->scriptOut << "[OpenGWS] Skipping route '" << route.path << "': " << server.error() << std::endl;
+                    continue;
+                }
+                std::pair<int, std::string> entry(route.method, route.path);
+                if (std::find(listed.begin(), listed.end(), entry) == listed.end()) listed.push_back(entry);
+            }
+            for (auto& mount : state->gwsMounts) {
+                if (!server.mount(mount.prefix, mount.dir)) {
+                    *state->scriptOut << "[OpenGWS] Skipping static '" << mount.prefix << "': " << server.error() << std::endl;
+                    continue;
+                }
+                std::string prefix = mount.prefix;
+                if (prefix.empty() || prefix.back() != '/') prefix += '/';
+                listed.push_back({GWS_GET, prefix + "*  (" + mount.dir + ")"});
+            }
+        };
+        stage();
+        *state->scriptOut << "\n[OpenGWS] ========================================" << std::endl;
+        *state->scriptOut << "[OpenGWS] Starting server on port " << state->gwsPort << "..." << std::endl;
+        *state->scriptOut << "[OpenGWS] ========================================\n" << std::endl;
+        state->scriptOut->flush();
+        if (!server.start(0, state->gwsEngine)) {
+            *state->scriptOut << "[OpenGWS] Cannot start server: " << server.error() << std::endl;
+        } else {
+            if (state->gwsEngine == GWS_ENGINE_URING && server.engine() != GWS_ENGINE_URING)
+                *state->scriptOut << "[OpenGWS] " << server.error() << "; using epoll" << std::endl;
+            struct rusage before, after;
+            getrusage(RUSAGE_SELF, &before);
+            *state->scriptOut << "[OpenGWS] Server running at http://localhost:" << server.port()
+                      << (server.engine() == GWS_ENGINE_URING ? " (io_uring)" : " (epoll)") << std::endl;
+            *state->scriptOut << "[OpenGWS] Press Ctrl+C to stop\n" << std::endl;
+            *state->scriptOut << "Routes:" << std::endl;
+            for (auto& entry : listed) {
+                *state->scriptOut << "  - " << (entry.first == GWS_GET ? "" : std::string(gwsMethodName(entry.first)) + " ")
+                          << "http://localhost:" << server.port() << entry.second << std::endl;
+            }
+            *state->scriptOut << std::endl;
+            FileWatcher watcher;
+            std::string dir = ".", watched = g_scriptPath;
+            size_t slash = g_scriptPath.rfind('/');
+            if (slash != std::string::npos) dir = slash == 0 ? "/" : g_scriptPath.substr(0, slash);
+            else watched = "./" + g_scriptPath;
+            if (watch && (g_scriptPath.empty() || !watcher.add(dir, false))) {
+                *state->scriptOut << "[OpenGWS] Cannot watch the script; serving without --watch" << std::endl;
+                watch = false;
+            }
+            if (watch) *state->scriptOut << "[OpenGWS] Watching " << g_scriptPath << " for changes\n" << std::endl;
+            // The directory is watched, so a save that replaces the file is seen
+            while (watch && server.wait(watcher.fd())) {
+                std::vector<std::string> changed;
+                if (!watcher.wait(50, changed)) {
+                    watch = false;  // back to waiting for Ctrl+C alone
+                    break;
+                }
+                if (std::find(changed.begin(), changed.end(), watched) == changed.end()) continue;
+                auto started = std::chrono::steady_clock::now();
+                std::string error;
+                if (!gwsRerun(error)) {
+                    *state->scriptOut << "[OpenGWS] Reload failed: " << error << "; still serving the previous routes" << std::endl;
+                    continue;
+                }
+                server.reset();
+                stage();
+                server.publish();
+                auto took = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                *state->scriptOut << "[OpenGWS] Reloaded " << g_scriptPath << ": " << listed.size() << " routes ("
+                          << took.count() << "ms)" << std::endl;
+            }
+            if (!watch) server.wait();
+            server.stop();
+            getrusage(RUSAGE_SELF, &after);
+            *state->scriptOut << "[OpenGWS] Server stopped after " << server.served() << " requests";
+            if (server.served() > 0) {
+                // User plus system time of the whole process, workers included
+                double cpu = (after.ru_utime.tv_sec - before.ru_utime.tv_sec + after.ru_stime.tv_sec -
+                              before.ru_stime.tv_sec) * 1e6 +
+                             (after.ru_utime.tv_usec - before.ru_utime.tv_usec + after.ru_stime.tv_usec -
+                              before.ru_stime.tv_usec);
+                *state->scriptOut << " (" << std::fixed << std::setprecision(2) << cpu / server.served()
+                          << "us CPU each)" << std::defaultfloat;
+            }
+            *state->scriptOut << std::endl;
+        }
     }
     // ============================================================
     // OpenW2G - Open Public Web to Geneia Kit
@@ -1786,27 +2143,27 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
                 if (file.is_open()) {
                     std::stringstream buffer;
                     buffer << file.rdbuf();
-                    w2gInputHTML = buffer.str();
+                    state->w2gInputHTML = buffer.str();
                     file.close();
-                    std::cout << "[OpenW2G] Parsed: " << filename << std::endl;
+                    *state->scriptOut << "[OpenW2G] Parsed: " << filename << std::endl;
                 } else {
-                    std::cout << "[OpenW2G] Error: Cannot open " << filename << std::endl;
+                    *state->scriptOut << "[OpenW2G] Error: Cannot open " << filename << std::endl;
                 }
             }
         }
     }
     else if (node->value == ".W2G.convert" || node->value == ".w2g.convert" ||
              node->value == ".OpenW2G.convert" || node->value == ".openw2g.convert") {
-        std::string html = w2gInputHTML;
+        std::string html = state->w2gInputHTML;
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) html = std::get<std::string>(v);
         }
         
-        w2gOutputGeneia = "! Generated by OpenW2G !\n\nimport G_Web.Kit\n\n";
-        w2gOutputGeneia += ".GWeb.page 'Converted Page'\n";
-        w2gOutputGeneia += ".GWeb.style 'bg' '#ffffff'\n";
-        w2gOutputGeneia += ".GWeb.style 'text' '#333333'\n\n";
+        state->w2gOutputGeneia = "! Generated by OpenW2G !\n\nimport G_Web.Kit\n\n";
+        state->w2gOutputGeneia += ".GWeb.page 'Converted Page'\n";
+        state->w2gOutputGeneia += ".GWeb.style 'bg' '#ffffff'\n";
+        state->w2gOutputGeneia += ".GWeb.style 'text' '#333333'\n\n";
         
         // Simple HTML to Geneia conversion
         size_t pos = 0;
@@ -1830,24 +2187,24 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             }
             
             if (tagName == "h1" || tagName == "h2" || tagName == "h3") {
-                w2gOutputGeneia += ".GWeb.head '" + content + "'\n";
+                state->w2gOutputGeneia += ".GWeb.head '" + content + "'\n";
             } else if (tagName == "p") {
-                w2gOutputGeneia += ".GWeb.text '" + content + "'\n";
+                state->w2gOutputGeneia += ".GWeb.text '" + content + "'\n";
             } else if (tagName == "button" || tagName == "a") {
-                w2gOutputGeneia += ".GWeb.btn '" + content + "' '#'\n";
+                state->w2gOutputGeneia += ".GWeb.btn '" + content + "' '#'\n";
             } else if (tagName == "nav") {
-                w2gOutputGeneia += ".GWeb.nav 'Home' 'About'\n";
+                state->w2gOutputGeneia += ".GWeb.nav 'Home' 'About'\n";
             } else if (tagName == "section") {
-                w2gOutputGeneia += ".GWeb.sect 'Section'\n";
+                state->w2gOutputGeneia += ".GWeb.sect 'Section'\n";
             } else if (tagName == "footer") {
-                w2gOutputGeneia += ".GWeb.foot '" + content + "'\n";
+                state->w2gOutputGeneia += ".GWeb.foot '" + content + "'\n";
             }
             
             pos = end + 1;
         }
         
-        w2gOutputGeneia += "\n.GWeb.build\nexit (0)\n";
-        std::cout << "[OpenW2G] Converted to Geneia code" << std::endl;
+        state->w2gOutputGeneia += "\n.GWeb.build\nexit (0)\n";
+        *state->scriptOut << "[OpenW2G] Converted to Geneia code" << std::endl;
     }
     else if (node->value == ".W2G.save" || node->value == ".w2g.save" ||
              node->value == ".OpenW2G.save" || node->value == ".openw2g.save") {
@@ -1857,13 +2214,13 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             if (std::holds_alternative<std::string>(v)) filename = std::get<std::string>(v);
         }
         std::ofstream file(filename);
-        file << w2gOutputGeneia;
+        file << state->w2gOutputGeneia;
         file.close();
-        std::cout << "[OpenW2G] Saved to: " << filename << std::endl;
+        *state->scriptOut << "[OpenW2G] Saved to: " << filename << std::endl;
     }
     else if (node->value == ".W2G.view" || node->value == ".w2g.view" ||
              node->value == ".OpenW2G.view" || node->value == ".openw2g.view") {
-        std::cout << "[OpenW2G] Generated code:\n" << w2gOutputGeneia << std::endl;
+        *state->scriptOut << "[OpenW2G] Generated code:\n" << state->w2gOutputGeneia << std::endl;
     }
     // ============================================================
     // G_Render - Universal Rendering Module
@@ -1889,37 +2246,37 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                renderTarget = std::get<std::string>(v);
+                state->renderTarget = std::get<std::string>(v);
             }
         }
-        std::cout << "[G_Render] Target: " << renderTarget << std::endl;
+        *state->scriptOut << "[G_Render] Target: " << state->renderTarget << std::endl;
     }
     else if (node->value == ".GR.title" || node->value == ".gr.title" ||
              node->value == ".GRender.title" || node->value == ".grender.title") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                renderTitle = std::get<std::string>(v);
+                state->renderTitle = std::get<std::string>(v);
             }
         }
-        std::cout << "[G_Render] Title: " << renderTitle << std::endl;
+        *state->scriptOut << "[G_Render] Title: " << state->renderTitle << std::endl;
     }
     else if (node->value == ".GR.theme" || node->value == ".gr.theme" ||
              node->value == ".GRender.theme" || node->value == ".grender.theme") {
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
-                renderTheme = std::get<std::string>(v);
-                if (renderTheme == "dark") {
-                    renderBg = "#0a0a1a";
-                    renderText = "#f0f0f0";
-                } else if (renderTheme == "light") {
-                    renderBg = "#ffffff";
-                    renderText = "#333333";
+                state->renderTheme = std::get<std::string>(v);
+                if (state->renderTheme == "dark") {
+                    state->renderBg = "#0a0a1a";
+                    state->renderText = "#f0f0f0";
+                } else if (state->renderTheme == "light") {
+                    state->renderBg = "#ffffff";
+                    state->renderText = "#333333";
                 }
             }
         }
-        std::cout << "[G_Render] Theme: " << renderTheme << std::endl;
+        *state->scriptOut << "[G_Render] Theme: " << state->renderTheme << std::endl;
     }
     else if (node->value == ".GR.style" || node->value == ".gr.style" ||
              node->value == ".GRender.style" || node->value == ".grender.style") {
@@ -1929,21 +2286,21 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             if (std::holds_alternative<std::string>(prop) && std::holds_alternative<std::string>(val)) {
                 std::string p = std::get<std::string>(prop);
                 std::string v = std::get<std::string>(val);
-                if (p == "accent") renderAccent = v;
-                else if (p == "bg") renderBg = v;
-                else if (p == "text") renderText = v;
+                if (p == "accent") state->renderAccent = v;
+                else if (p == "bg") state->renderBg = v;
+                else if (p == "text") state->renderText = v;
             }
         }
     }
     else if (node->value == ".GR.view" || node->value == ".gr.view" ||
              node->value == ".GRender.view" || node->value == ".grender.view") {
-        renderOutput = "";
+        state->renderOutput = "";
         std::string viewId = "main";
         if (!node->children.empty()) {
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) viewId = std::get<std::string>(v);
         }
-        std::cout << "[G_Render] View: " << viewId << std::endl;
+        *state->scriptOut << "[G_Render] View: " << viewId << std::endl;
     }
     else if (node->value == ".GR.text" || node->value == ".gr.text" ||
              node->value == ".GRender.text" || node->value == ".grender.text") {
@@ -1951,14 +2308,14 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
                 std::string text = std::get<std::string>(v);
-                if (renderTarget == "web") {
-                    renderOutput += "<p class=\"gr-text\">" + text + "</p>\n";
-                } else if (renderTarget == "term") {
-                    renderOutput += text + "\n";
-                } else if (renderTarget == "json") {
-                    renderOutput += "{\"type\":\"text\",\"content\":\"" + text + "\"},\n";
-                } else if (renderTarget == "desktop") {
-                    renderOutput += "LABEL|lbl|" + text + "|20|auto|400|30\n";
+                if (state->renderTarget == "web") {
+                    state->renderOutput += "<p class=\"gr-text\">" + text + "</p>\n";
+                } else if (state->renderTarget == "term") {
+                    state->renderOutput += text + "\n";
+                } else if (state->renderTarget == "json") {
+                    state->renderOutput += "{\"type\":\"text\",\"content\":\"" + text + "\"},\n";
+                } else if (state->renderTarget == "desktop") {
+                    state->renderOutput += "LABEL|lbl|" + text + "|20|auto|400|30\n";
                 }
             }
         }
@@ -1974,50 +2331,50 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) action = std::get<std::string>(v);
         }
-        if (renderTarget == "web") {
-            renderOutput += "<button class=\"gr-btn\" onclick=\"" + action + "\">" + text + "</button>\n";
-        } else if (renderTarget == "term") {
-            renderOutput += "[" + text + "]\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"button\",\"text\":\"" + text + "\",\"action\":\"" + action + "\"},\n";
-        } else if (renderTarget == "desktop") {
-            renderOutput += "BUTTON|btn|" + text + "|20|auto|150|40\n";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<button class=\"gr-btn\" onclick=\"" + action + "\">" + text + "</button>\n";
+        } else if (state->renderTarget == "term") {
+            state->renderOutput += "[" + text + "]\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"button\",\"text\":\"" + text + "\",\"action\":\"" + action + "\"},\n";
+        } else if (state->renderTarget == "desktop") {
+            state->renderOutput += "BUTTON|btn|" + text + "|20|auto|150|40\n";
         }
     }
     else if (node->value == ".GR.nav" || node->value == ".gr.nav" ||
              node->value == ".GRender.nav" || node->value == ".grender.nav") {
-        if (renderTarget == "web") {
-            renderOutput += "<nav class=\"gr-nav\"><div class=\"gr-brand\">" + renderTitle + "</div><div class=\"gr-links\">";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<nav class=\"gr-nav\"><div class=\"gr-brand\">" + state->renderTitle + "</div><div class=\"gr-links\">";
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    renderOutput += "<a href=\"#\">" + std::get<std::string>(v) + "</a>";
+                    state->renderOutput += "<a href=\"#\">" + std::get<std::string>(v) + "</a>";
                 }
             }
-            renderOutput += "</div></nav>\n";
-        } else if (renderTarget == "term") {
-            renderOutput += "=== " + renderTitle + " ===\n";
+            state->renderOutput += "</div></nav>\n";
+        } else if (state->renderTarget == "term") {
+            state->renderOutput += "=== " + state->renderTitle + " ===\n";
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    renderOutput += "| " + std::get<std::string>(v) + " ";
+                    state->renderOutput += "| " + std::get<std::string>(v) + " ";
                 }
             }
-            renderOutput += "|\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"nav\",\"brand\":\"" + renderTitle + "\",\"items\":[";
+            state->renderOutput += "|\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"nav\",\"brand\":\"" + state->renderTitle + "\",\"items\":[";
             bool first = true;
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    if (!first) renderOutput += ",";
-                    renderOutput += "\"" + std::get<std::string>(v) + "\"";
+                    if (!first) state->renderOutput += ",";
+                    state->renderOutput += "\"" + std::get<std::string>(v) + "\"";
                     first = false;
                 }
             }
-            renderOutput += "]},\n";
-        } else if (renderTarget == "desktop") {
-            renderOutput += "MENU|" + renderTitle + "\n";
+            state->renderOutput += "]},\n";
+        } else if (state->renderTarget == "desktop") {
+            state->renderOutput += "MENU|" + state->renderTitle + "\n";
         }
     }
     else if (node->value == ".GR.hero" || node->value == ".gr.hero" ||
@@ -2031,18 +2388,18 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) subtitle = std::get<std::string>(v);
         }
-        if (renderTarget == "web") {
-            renderOutput += "<section class=\"gr-hero\"><h1>" + title + "</h1>";
-            if (!subtitle.empty()) renderOutput += "<p>" + subtitle + "</p>";
-            renderOutput += "</section>\n";
-        } else if (renderTarget == "term") {
-            renderOutput += "\n*** " + title + " ***\n";
-            if (!subtitle.empty()) renderOutput += subtitle + "\n";
-            renderOutput += "\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"hero\",\"title\":\"" + title + "\",\"subtitle\":\"" + subtitle + "\"},\n";
-        } else if (renderTarget == "desktop") {
-            renderOutput += "LABEL|hero|" + title + "|center|20|800|50\n";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<section class=\"gr-hero\"><h1>" + title + "</h1>";
+            if (!subtitle.empty()) state->renderOutput += "<p>" + subtitle + "</p>";
+            state->renderOutput += "</section>\n";
+        } else if (state->renderTarget == "term") {
+            state->renderOutput += "\n*** " + title + " ***\n";
+            if (!subtitle.empty()) state->renderOutput += subtitle + "\n";
+            state->renderOutput += "\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"hero\",\"title\":\"" + title + "\",\"subtitle\":\"" + subtitle + "\"},\n";
+        } else if (state->renderTarget == "desktop") {
+            state->renderOutput += "LABEL|hero|" + title + "|center|20|800|50\n";
         }
     }
     else if (node->value == ".GR.card" || node->value == ".gr.card" ||
@@ -2056,53 +2413,53 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             Value v = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(v)) content = std::get<std::string>(v);
         }
-        if (renderTarget == "web") {
-            renderOutput += "<div class=\"gr-card\"><h3>" + title + "</h3>";
-            if (!content.empty()) renderOutput += "<p>" + content + "</p>";
-            renderOutput += "</div>\n";
-        } else if (renderTarget == "term") {
-            renderOutput += "+-- " + title + " --+\n";
-            if (!content.empty()) renderOutput += "| " + content + "\n";
-            renderOutput += "+---------------+\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"card\",\"title\":\"" + title + "\",\"content\":\"" + content + "\"},\n";
-        } else if (renderTarget == "desktop") {
-            renderOutput += "PANEL|card|20|auto|300|100\n";
-            renderOutput += "LABEL|cardtitle|" + title + "|25|5|290|25\n";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<div class=\"gr-card\"><h3>" + title + "</h3>";
+            if (!content.empty()) state->renderOutput += "<p>" + content + "</p>";
+            state->renderOutput += "</div>\n";
+        } else if (state->renderTarget == "term") {
+            state->renderOutput += "+-- " + title + " --+\n";
+            if (!content.empty()) state->renderOutput += "| " + content + "\n";
+            state->renderOutput += "+---------------+\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"card\",\"title\":\"" + title + "\",\"content\":\"" + content + "\"},\n";
+        } else if (state->renderTarget == "desktop") {
+            state->renderOutput += "PANEL|card|20|auto|300|100\n";
+            state->renderOutput += "LABEL|cardtitle|" + title + "|25|5|290|25\n";
         }
     }
     else if (node->value == ".GR.list" || node->value == ".gr.list" ||
              node->value == ".GRender.list" || node->value == ".grender.list") {
-        if (renderTarget == "web") {
-            renderOutput += "<ul class=\"gr-list\">";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<ul class=\"gr-list\">";
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    renderOutput += "<li>" + std::get<std::string>(v) + "</li>";
+                    state->renderOutput += "<li>" + std::get<std::string>(v) + "</li>";
                 }
             }
-            renderOutput += "</ul>\n";
-        } else if (renderTarget == "term") {
+            state->renderOutput += "</ul>\n";
+        } else if (state->renderTarget == "term") {
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    renderOutput += "  * " + std::get<std::string>(v) + "\n";
+                    state->renderOutput += "  * " + std::get<std::string>(v) + "\n";
                 }
             }
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"list\",\"items\":[";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"list\",\"items\":[";
             bool first = true;
             for (auto& arg : node->children) {
                 Value v = evaluateExpression(arg);
                 if (std::holds_alternative<std::string>(v)) {
-                    if (!first) renderOutput += ",";
-                    renderOutput += "\"" + std::get<std::string>(v) + "\"";
+                    if (!first) state->renderOutput += ",";
+                    state->renderOutput += "\"" + std::get<std::string>(v) + "\"";
                     first = false;
                 }
             }
-            renderOutput += "]},\n";
-        } else if (renderTarget == "desktop") {
-            renderOutput += "LISTBOX|list|20|auto|300|100\n";
+            state->renderOutput += "]},\n";
+        } else if (state->renderTarget == "desktop") {
+            state->renderOutput += "LISTBOX|list|20|auto|300|100\n";
         }
     }
     else if (node->value == ".GR.grid" || node->value == ".gr.grid" ||
@@ -2112,41 +2469,41 @@ with socketserver.TCPServer(("", PORT), GeneiaHandler) as httpd:
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<int>(v)) cols = std::get<int>(v);
         }
-        if (renderTarget == "web") {
-            renderOutput += "<div class=\"gr-grid gr-grid-" + std::to_string(cols) + "\">\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "{\"type\":\"grid\",\"cols\":" + std::to_string(cols) + ",\"children\":[\n";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "<div class=\"gr-grid gr-grid-" + std::to_string(cols) + "\">\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "{\"type\":\"grid\",\"cols\":" + std::to_string(cols) + ",\"children\":[\n";
         }
     }
     else if (node->value == ".GR.endgrid" || node->value == ".gr.endgrid" ||
              node->value == ".GRender.endgrid" || node->value == ".grender.endgrid") {
-        if (renderTarget == "web") {
-            renderOutput += "</div>\n";
-        } else if (renderTarget == "json") {
-            renderOutput += "]},\n";
+        if (state->renderTarget == "web") {
+            state->renderOutput += "</div>\n";
+        } else if (state->renderTarget == "json") {
+            state->renderOutput += "]},\n";
         }
     }
     else if (node->value == ".GR.endview" || node->value == ".gr.endview" ||
              node->value == ".GRender.endview" || node->value == ".grender.endview") {
-        std::cout << "[G_Render] View complete" << std::endl;
+        *state->scriptOut << "[G_Render] View complete" << std::endl;
     }
     else if (node->value == ".GR.render" || node->value == ".gr.render" ||
              node->value == ".GRender.render" || node->value == ".grender.render") {
-        std::cout << "[G_Render] Rendering to " << renderTarget << "..." << std::endl;
+        *state->scriptOut << "[G_Render] Rendering to " << state->renderTarget << "..." << std::endl;
         
-        if (renderTarget == "web") {
+        if (state->renderTarget == "web") {
             std::string css = R"(
 * { margin: 0; padding: 0; box-sizing: border-box; }
-body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; color: )" + renderText + R"(; }
+body { font-family: system-ui, sans-serif; background: )" + state->renderBg + R"(; color: )" + state->renderText + R"(; }
 .gr-nav { display: flex; justify-content: space-between; padding: 1rem 2rem; background: rgba(0,0,0,0.2); }
-.gr-brand { font-size: 1.5rem; font-weight: bold; color: )" + renderAccent + R"(; }
-.gr-links a { margin-left: 2rem; color: )" + renderText + R"(; text-decoration: none; }
-.gr-hero { text-align: center; padding: 4rem 2rem; background: linear-gradient(135deg, )" + renderAccent + R"(22, )" + renderAccent + R"(11); }
+.gr-brand { font-size: 1.5rem; font-weight: bold; color: )" + state->renderAccent + R"(; }
+.gr-links a { margin-left: 2rem; color: )" + state->renderText + R"(; text-decoration: none; }
+.gr-hero { text-align: center; padding: 4rem 2rem; background: linear-gradient(135deg, )" + state->renderAccent + R"(22, )" + state->renderAccent + R"(11); }
 .gr-hero h1 { font-size: 3rem; margin-bottom: 1rem; }
 .gr-text { margin: 1rem 2rem; }
-.gr-btn { padding: 0.75rem 1.5rem; background: )" + renderAccent + R"(; color: white; border: none; border-radius: 8px; cursor: pointer; margin: 0.5rem; }
+.gr-btn { padding: 0.75rem 1.5rem; background: )" + state->renderAccent + R"(; color: white; border: none; border-radius: 8px; cursor: pointer; margin: 0.5rem; }
 .gr-card { background: rgba(255,255,255,0.05); border: 1px solid rgba(255,255,255,0.1); border-radius: 12px; padding: 1.5rem; margin: 1rem; }
-.gr-card h3 { color: )" + renderAccent + R"(; margin-bottom: 0.5rem; }
+.gr-card h3 { color: )" + state->renderAccent + R"(; margin-bottom: 0.5rem; }
 .gr-grid { display: grid; gap: 1rem; padding: 1rem; }
 .gr-grid-2 { grid-template-columns: repeat(2, 1fr); }
 .gr-grid-3 { grid-template-columns: repeat(3, 1fr); }
@@ -2154,30 +2511,30 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
 .gr-list { list-style: none; margin: 1rem 2rem; }
 .gr-list li { padding: 0.5rem 0; border-bottom: 1px solid rgba(255,255,255,0.1); }
 )";
-            std::string html = "<!DOCTYPE html><html><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width,initial-scale=1.0\"><title>" + renderTitle + "</title><style>" + css + "</style></head><body>\n" + renderOutput + "</body></html>";
+            std::string html = "<!DOCTYPE html><html><head><meta charset=\"UTF-8\"><meta name=\"viewport\" content=\"width=device-width,initial-scale=1.0\"><title>" + state->renderTitle + "</title><style>" + css + "</style></head><body>\n" + state->renderOutput + "</body></html>";
             
             std::ofstream file("_grender_output.html");
             file << html;
             file.close();
-            std::cout << "[G_Render] Output: _grender_output.html" << std::endl;
+            *state->scriptOut << "[G_Render] Output: _grender_output.html" << std::endl;
             
             if (system("which xdg-open > /dev/null 2>&1") == 0) {
                 system("xdg-open _grender_output.html 2>/dev/null &");
             }
-        } else if (renderTarget == "term") {
-            std::cout << "\n" << renderOutput << std::endl;
-        } else if (renderTarget == "json") {
-            std::string json = "{\"app\":\"" + renderTitle + "\",\"theme\":\"" + renderTheme + "\",\"elements\":[\n" + renderOutput + "]}\n";
+        } else if (state->renderTarget == "term") {
+            *state->scriptOut << "\n" << state->renderOutput << std::endl;
+        } else if (state->renderTarget == "json") {
+            std::string json = "{\"app\":\"" + state->renderTitle + "\",\"theme\":\"" + state->renderTheme + "\",\"elements\":[\n" + state->renderOutput + "]}\n";
             std::ofstream file("_grender_output.json");
             file << json;
             file.close();
-            std::cout << "[G_Render] Output: _grender_output.json" << std::endl;
-        } else if (renderTarget == "desktop") {
-            std::string ui = "WINDOW|" + renderTitle + "|800|600\n" + renderOutput + "SHOW\n";
+            *state->scriptOut << "[G_Render] Output: _grender_output.json" << std::endl;
+        } else if (state->renderTarget == "desktop") {
+            std::string ui = "WINDOW|" + state->renderTitle + "|800|600\n" + state->renderOutput + "SHOW\n";
             std::ofstream file("_grender_output.ui");
             file << ui;
             file.close();
-            std::cout << "[G_Render] Output: _grender_output.ui" << std::endl;
+            *state->scriptOut << "[G_Render] Output: _grender_output.ui" << std::endl;
             
             if (system("which dotnet > /dev/null 2>&1") == 0) {
                 if (system("test -f ui/bin/linux/GeneiaUILinux.dll") == 0) {
@@ -2191,6 +2548,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
     // Command line scripting in Geneia syntax
     // Import: import OpenGNEL
     // Syntax: .GNEL.run 'command'      - Run shell command
+    //         .GNEL.run -b 'cmd'...    - Run in a persistent shell (one round-trip per batch)
     //         .GNEL.cd 'path'          - Change directory
     //         .GNEL.pwd                - Print working directory
     //         .GNEL.ls                 - List files
@@ -2199,31 +2557,66 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
     //         .GNEL.echo 'text'        - Print text
     //         .GNEL.mkdir 'dir'        - Create directory
     //         .GNEL.rm 'file'          - Remove file
-    //         .GNEL.cp 'src' 'dst'     - Copy file
-    //         .GNEL.mv 'src' 'dst'     - Move file
+    //         .GNEL.cp 'src' 'dst'     - Copy file or directory tree
+    //         .GNEL.mv 'src' 'dst'     - Move file (copies across filesystems)
     //         .GNEL.env 'VAR' 'value'  - Set environment variable
     //         .GNEL.getenv 'VAR'       - Get environment variable
     //         .GNEL.alias 'name' 'cmd' - Create alias
     //         .GNEL.hist               - Show command history
-    //         .GNEL.pipe 'cmd1' 'cmd2' - Pipe commands
-    //         .GNEL.script 'file'      - Run script file
+    //         .GNEL.pipe 'cmd1' 'cmd2' - Pipe commands (in-process for builtins)
+    //         .GNEL.script 'file'      - Run script file (.gn runs in-process)
     //         .GNEL.save 'file'        - Save script to file
+    //         .GNEL.grep 'pat' 'file'  - Search lines (-i -v -n -c -l -F -E -r)
+    //         .GNEL.find 'name' 'path' - Find files by name (-s sorted, sets find.count/find.N)
+    //         .GNEL.wc 'file'          - Count lines/words/bytes (-l -w -c -m, sets lines/words/bytes;
+    //                                    -m counts UTF-8 characters only in a UTF-8 locale)
+    //         .GNEL.head 'file' (n)    - First n lines
+    //         .GNEL.tail 'file' (n)    - Last n lines (-f follows appends)
+    //         .GNEL.sort 'in' 'out'    - Sort lines, larger than RAM too (-n -r -u -s -t -k -S)
+    //         .GNEL.count 'f' (n) 'sep' - Count field n values, most frequent first ((top) limits)
+    //         .GNEL.hash 'algo' 'path' - sha256/xxh64 digests, sha256sum format (-t tree, -c verify)
+    //         .GNEL.watch 'path' (ms) { } - Run the block per debounced burst of changes (-r, -n, sets watch.count/watch.N)
+    // grep/find/wc/head/tail/cat/cp/mv/sort/count/hash run natively (gnel_native.cpp), not via sh
     // ============================================================
     else if (node->value == ".GNEL.run" || node->value == ".gnel.run" ||
              node->value == ".OpenGNEL.run" || node->value == ".opengnel.run") {
-        if (!node->children.empty()) {
-            Value v = evaluateExpression(node->children[0]);
+        std::vector<Value> values;
+        for (auto& arg : node->children) values.push_back(evaluateExpression(arg));
+        if (!values.empty() && std::holds_alternative<std::string>(values[0]) &&
+            std::get<std::string>(values[0]) == "-b") {
+            // .GNEL.run -b 'cmd'...  - run in the persistent shell, all in one batch
+            std::vector<std::string> batch;
+            for (auto& cmd : gnelArgs(std::vector<Value>(values.begin() + 1, values.end()))) {
+                if (state->gnelAliases.find(cmd) != state->gnelAliases.end()) cmd = state->gnelAliases[cmd];
+                state->gnelHistory.push_back(cmd);
+                batch.push_back(cmd);
+            }
+            std::vector<int> statuses;
+            state->scriptOut->flush();
+            if (!state->gnelShell.run(batch, statuses, "[GNEL] $ ")) {
+                *state->scriptOut << "[GNEL] Error: Cannot start shell" << std::endl;
+            }
+            for (size_t i = 0; i < statuses.size(); i++) {
+                if (statuses[i] < 0) {
+                    *state->scriptOut << "[GNEL] Not run (shell exited): " << batch[i] << std::endl;
+                } else if (statuses[i] != 0) {
+                    *state->scriptOut << "[GNEL] Command exited with code: " << statuses[i] << " (" << batch[i] << ")" << std::endl;
+                }
+            }
+        }
+        else if (!values.empty()) {
+            Value v = values[0];
             if (std::holds_alternative<std::string>(v)) {
                 std::string cmd = std::get<std::string>(v);
                 // Check for alias
-                if (gnelAliases.find(cmd) != gnelAliases.end()) {
-                    cmd = gnelAliases[cmd];
+                if (state->gnelAliases.find(cmd) != state->gnelAliases.end()) {
+                    cmd = state->gnelAliases[cmd];
                 }
-                gnelHistory.push_back(cmd);
-                std::cout << "[GNEL] $ " << cmd << std::endl;
+                state->gnelHistory.push_back(cmd);
+                *state->scriptOut << "[GNEL] $ " << cmd << std::endl;
                 int result = system(cmd.c_str());
                 if (result != 0) {
-                    std::cout << "[GNEL] Command exited with code: " << result << std::endl;
+                    *state->scriptOut << "[GNEL] Command exited with code: " << result << std::endl;
                 }
             }
         }
@@ -2235,10 +2628,11 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(v)) {
                 std::string path = std::get<std::string>(v);
                 if (chdir(path.c_str()) == 0) {
-                    gnelWorkDir = path;
-                    std::cout << "[GNEL] Changed to: " << path << std::endl;
+                    state->gnelWorkDir = path;
+                    state->gnelShell.prelude("cd " + ShellSession::quote(path));
+                    *state->scriptOut << "[GNEL] Changed to: " << path << std::endl;
                 } else {
-                    std::cout << "[GNEL] Error: Cannot change to " << path << std::endl;
+                    *state->scriptOut << "[GNEL] Error: Cannot change to " << path << std::endl;
                 }
             }
         }
@@ -2247,7 +2641,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
              node->value == ".OpenGNEL.pwd" || node->value == ".opengnel.pwd") {
         char cwd[1024];
         if (getcwd(cwd, sizeof(cwd)) != nullptr) {
-            std::cout << cwd << std::endl;
+            *state->scriptOut << cwd << std::endl;
         }
     }
     else if (node->value == ".GNEL.ls" || node->value == ".gnel.ls" ||
@@ -2268,12 +2662,10 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
                 std::string file = std::get<std::string>(v);
-                std::ifstream f(file);
-                if (f.is_open()) {
-                    std::cout << f.rdbuf() << std::endl;
-                    f.close();
+                if (access(file.c_str(), R_OK) == 0) {
+                    GNELNative::cat({"cat", file}, nullptr, *state->scriptOut);
                 } else {
-                    std::cout << "[GNEL] Error: Cannot read " << file << std::endl;
+                    *state->scriptOut << "[GNEL] Error: Cannot read " << file << std::endl;
                 }
             }
         }
@@ -2283,12 +2675,12 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
         for (auto& arg : node->children) {
             Value v = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(v)) {
-                std::cout << std::get<std::string>(v) << " ";
+                *state->scriptOut << std::get<std::string>(v) << " ";
             } else if (std::holds_alternative<int>(v)) {
-                std::cout << std::get<int>(v) << " ";
+                *state->scriptOut << std::get<int>(v) << " ";
             }
         }
-        std::cout << std::endl;
+        *state->scriptOut << std::endl;
     }
     else if (node->value == ".GNEL.mkdir" || node->value == ".gnel.mkdir" ||
              node->value == ".OpenGNEL.mkdir" || node->value == ".opengnel.mkdir") {
@@ -2298,7 +2690,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::string dir = std::get<std::string>(v);
                 std::string cmd = "mkdir -p " + dir;
                 if (system(cmd.c_str()) == 0) {
-                    std::cout << "[GNEL] Created: " << dir << std::endl;
+                    *state->scriptOut << "[GNEL] Created: " << dir << std::endl;
                 }
             }
         }
@@ -2310,9 +2702,9 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(v)) {
                 std::string file = std::get<std::string>(v);
                 if (remove(file.c_str()) == 0) {
-                    std::cout << "[GNEL] Removed: " << file << std::endl;
+                    *state->scriptOut << "[GNEL] Removed: " << file << std::endl;
                 } else {
-                    std::cout << "[GNEL] Error: Cannot remove " << file << std::endl;
+                    *state->scriptOut << "[GNEL] Error: Cannot remove " << file << std::endl;
                 }
             }
         }
@@ -2323,9 +2715,8 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value src = evaluateExpression(node->children[0]);
             Value dst = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(src) && std::holds_alternative<std::string>(dst)) {
-                std::string cmd = "cp " + std::get<std::string>(src) + " " + std::get<std::string>(dst);
-                if (system(cmd.c_str()) == 0) {
-                    std::cout << "[GNEL] Copied: " << std::get<std::string>(src) << " -> " << std::get<std::string>(dst) << std::endl;
+                if (GNELNative::cp({"cp", "-r", std::get<std::string>(src), std::get<std::string>(dst)}) == 0) {
+                    *state->scriptOut << "[GNEL] Copied: " << std::get<std::string>(src) << " -> " << std::get<std::string>(dst) << std::endl;
                 }
             }
         }
@@ -2336,9 +2727,8 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value src = evaluateExpression(node->children[0]);
             Value dst = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(src) && std::holds_alternative<std::string>(dst)) {
-                std::string cmd = "mv " + std::get<std::string>(src) + " " + std::get<std::string>(dst);
-                if (system(cmd.c_str()) == 0) {
-                    std::cout << "[GNEL] Moved: " << std::get<std::string>(src) << " -> " << std::get<std::string>(dst) << std::endl;
+                if (GNELNative::mv({"mv", std::get<std::string>(src), std::get<std::string>(dst)}) == 0) {
+                    *state->scriptOut << "[GNEL] Moved: " << std::get<std::string>(src) << " -> " << std::get<std::string>(dst) << std::endl;
                 }
             }
         }
@@ -2351,9 +2741,10 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(name) && std::holds_alternative<std::string>(val)) {
                 std::string n = std::get<std::string>(name);
                 std::string v = std::get<std::string>(val);
-                gnelEnvVars[n] = v;
+                state->gnelEnvVars[n] = v;
                 setenv(n.c_str(), v.c_str(), 1);
-                std::cout << "[GNEL] Set " << n << "=" << v << std::endl;
+                state->gnelShell.prelude("export " + n + "=" + ShellSession::quote(v));
+                *state->scriptOut << "[GNEL] Set " << n << "=" << v << std::endl;
             }
         }
     }
@@ -2365,11 +2756,11 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::string name = std::get<std::string>(v);
                 char* val = getenv(name.c_str());
                 if (val != nullptr) {
-                    std::cout << name << "=" << val << std::endl;
-                } else if (gnelEnvVars.find(name) != gnelEnvVars.end()) {
-                    std::cout << name << "=" << gnelEnvVars[name] << std::endl;
+                    *state->scriptOut << name << "=" << val << std::endl;
+                } else if (state->gnelEnvVars.find(name) != state->gnelEnvVars.end()) {
+                    *state->scriptOut << name << "=" << state->gnelEnvVars[name] << std::endl;
                 } else {
-                    std::cout << name << " is not set" << std::endl;
+                    *state->scriptOut << name << " is not set" << std::endl;
                 }
             }
         }
@@ -2382,39 +2773,44 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(name) && std::holds_alternative<std::string>(cmd)) {
                 std::string n = std::get<std::string>(name);
                 std::string c = std::get<std::string>(cmd);
-                gnelAliases[n] = c;
-                std::cout << "[GNEL] Alias: " << n << " = " << c << std::endl;
+                state->gnelAliases[n] = c;
+                *state->scriptOut << "[GNEL] Alias: " << n << " = " << c << std::endl;
             }
         } else if (node->children.empty()) {
             // Show all aliases
-            std::cout << "[GNEL] Aliases:" << std::endl;
-            for (auto& a : gnelAliases) {
-                std::cout << "  " << a.first << " = " << a.second << std::endl;
+            *state->scriptOut << "[GNEL] Aliases:" << std::endl;
+            for (auto& a : state->gnelAliases) {
+                *state->scriptOut << "  " << a.first << " = " << a.second << std::endl;
             }
         }
     }
     else if (node->value == ".GNEL.hist" || node->value == ".gnel.hist" ||
              node->value == ".OpenGNEL.hist" || node->value == ".opengnel.hist") {
-        std::cout << "[GNEL] Command History:" << std::endl;
+        *state->scriptOut << "[GNEL] Command History:" << std::endl;
         int i = 1;
-        for (auto& cmd : gnelHistory) {
-            std::cout << "  " << i++ << ": " << cmd << std::endl;
+        for (auto& cmd : state->gnelHistory) {
+            *state->scriptOut << "  " << i++ << ": " << cmd << std::endl;
         }
     }
     else if (node->value == ".GNEL.pipe" || node->value == ".gnel.pipe" ||
              node->value == ".OpenGNEL.pipe" || node->value == ".opengnel.pipe") {
         if (node->children.size() >= 2) {
             std::string pipeline = "";
+            std::vector<std::string> stages;
             for (size_t i = 0; i < node->children.size(); i++) {
                 Value v = evaluateExpression(node->children[i]);
                 if (std::holds_alternative<std::string>(v)) {
                     if (i > 0) pipeline += " | ";
                     pipeline += std::get<std::string>(v);
+                    stages.push_back(std::get<std::string>(v));
                 }
             }
-            gnelHistory.push_back(pipeline);
-            std::cout << "[GNEL] $ " << pipeline << std::endl;
-            system(pipeline.c_str());
+            state->gnelHistory.push_back(pipeline);
+            *state->scriptOut << "[GNEL] $ " << pipeline << std::endl;
+            int status = 0;
+            if (!GNELNative::pipe(stages, *state->scriptOut, status)) {
+                system(pipeline.c_str());
+            }
         }
     }
     else if (node->value == ".GNEL.script" || node->value == ".gnel.script" ||
@@ -2423,9 +2819,26 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value v = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(v)) {
                 std::string file = std::get<std::string>(v);
-                std::string cmd = "bash " + file;
-                std::cout << "[GNEL] Running script: " << file << std::endl;
-                system(cmd.c_str());
+                *state->scriptOut << "[GNEL] Running script: " << file << std::endl;
+                if (file.size() > 3 && file.compare(file.size() - 3, 3, ".gn") == 0) {
+                    // Geneia scripts run in this interpreter
+                    std::ifstream f(file);
+                    if (f.is_open()) {
+                        std::stringstream buffer;
+                        buffer << f.rdbuf();
+                        Lexer lexer(buffer.str());
+                        Parser parser(lexer.tokenize());
+                        auto ast = parser.parse();
+                        for (auto& child : ast->children) {
+                            if (shouldExit) break;
+                            executeNode(child);
+                        }
+                    } else {
+                        *state->scriptOut << "[GNEL] Error: Cannot read " << file << std::endl;
+                    }
+                } else {
+                    GNELNative::spawn({"bash", file});
+                }
             }
         }
     }
@@ -2438,11 +2851,11 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::ofstream f(file);
                 f << "#!/bin/bash\n";
                 f << "# Generated by OpenGNEL\n\n";
-                for (auto& cmd : gnelHistory) {
+                for (auto& cmd : state->gnelHistory) {
                     f << cmd << "\n";
                 }
                 f.close();
-                std::cout << "[GNEL] Script saved to: " << file << std::endl;
+                *state->scriptOut << "[GNEL] Script saved to: " << file << std::endl;
             }
         }
     }
@@ -2454,74 +2867,224 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::string file = std::get<std::string>(v);
                 std::ofstream f(file, std::ios::app);
                 f.close();
-                std::cout << "[GNEL] Created: " << file << std::endl;
+                *state->scriptOut << "[GNEL] Created: " << file << std::endl;
             }
         }
     }
     else if (node->value == ".GNEL.grep" || node->value == ".gnel.grep" ||
              node->value == ".OpenGNEL.grep" || node->value == ".opengnel.grep") {
+        // .GNEL.grep [-invclFEr] 'pattern' 'file|dir'...
         if (node->children.size() >= 2) {
-            Value pattern = evaluateExpression(node->children[0]);
-            Value file = evaluateExpression(node->children[1]);
-            if (std::holds_alternative<std::string>(pattern) && std::holds_alternative<std::string>(file)) {
-                std::string cmd = "grep '" + std::get<std::string>(pattern) + "' " + std::get<std::string>(file);
-                system(cmd.c_str());
-            }
+            std::vector<Value> values;
+            for (auto& arg : node->children) values.push_back(evaluateExpression(arg));
+            GNELNative::grep(gnelArgv("grep", gnelArgs(values), 1), nullptr, *state->scriptOut);
         }
     }
     else if (node->value == ".GNEL.find" || node->value == ".gnel.find" ||
              node->value == ".OpenGNEL.find" || node->value == ".opengnel.find") {
+        // .GNEL.find [-s] 'name' 'path' - -s prints in sorted order
+        // Results are also stored as find.count and find.0 .. find.<count-1>
         std::string path = ".";
         std::string name = "*";
-        if (!node->children.empty()) {
-            Value v = evaluateExpression(node->children[0]);
-            if (std::holds_alternative<std::string>(v)) name = std::get<std::string>(v);
+        bool sorted = false;
+        std::vector<std::string> operands;
+        for (auto& arg : node->children) {
+            Value v = evaluateExpression(arg);
+            if (!std::holds_alternative<std::string>(v)) continue;
+            std::string s = std::get<std::string>(v);
+            if (s == "-s") sorted = true;
+            else operands.push_back(s);
         }
-        if (node->children.size() >= 2) {
-            Value v = evaluateExpression(node->children[1]);
-            if (std::holds_alternative<std::string>(v)) path = std::get<std::string>(v);
+        if (!operands.empty()) name = operands[0];
+        if (operands.size() >= 2) path = operands[1];
+
+        std::vector<std::string> argv = {"find", path, "-name", name};
+        if (sorted) argv.insert(argv.begin() + 1, "-s");
+        std::vector<std::string> found;
+        GNELNative::find(argv, *state->scriptOut, &found);
+
+        // Drop entries left over from a previous, larger result
+        auto prev = variables.find("find.count");
+        if (prev != variables.end() && std::holds_alternative<int>(prev->second)) {
+            for (int i = static_cast<int>(found.size()); i < std::get<int>(prev->second); i++) {
+                variables.erase("find." + std::to_string(i));
+            }
+        }
+        variables["find.count"] = static_cast<int>(found.size());
+        for (size_t i = 0; i < found.size(); i++) {
+            variables["find." + std::to_string(i)] = found[i];
         }
-        std::string cmd = "find " + path + " -name '" + name + "'";
-        system(cmd.c_str());
     }
     else if (node->value == ".GNEL.wc" || node->value == ".gnel.wc" ||
              node->value == ".OpenGNEL.wc" || node->value == ".opengnel.wc") {
+        // .GNEL.wc [-lwcm] 'file'...  (totals also go to {lines} {words} {bytes})
         if (!node->children.empty()) {
-            Value v = evaluateExpression(node->children[0]);
-            if (std::holds_alternative<std::string>(v)) {
-                std::string cmd = "wc " + std::get<std::string>(v);
-                system(cmd.c_str());
+            std::vector<Value> values;
+            for (auto& arg : node->children) values.push_back(evaluateExpression(arg));
+            GNELCounts totals;
+            GNELNative::wc(gnelArgv("wc", gnelArgs(values), 0), nullptr, *state->scriptOut, &totals);
+            auto count = [](size_t n) -> Value {
+                if (n <= static_cast<size_t>(INT_MAX)) return static_cast<int>(n);
+                return static_cast<double>(n);
+            };
+            variables["lines"] = count(totals.lines);
+            variables["words"] = count(totals.words);
+            variables["bytes"] = count(totals.bytes);
+        }
+    }
+    else if (node->value == ".GNEL.sort" || node->value == ".gnel.sort" ||
+             node->value == ".OpenGNEL.sort" || node->value == ".opengnel.sort") {
+        // .GNEL.sort [-n -r -u -s -t, -k2,3 -S1G] 'in' ['out']
+        std::vector<Value> values;
+        for (auto& arg : node->children) values.push_back(evaluateExpression(arg));
+        std::vector<std::string> argv = {"sort"};
+        std::vector<std::string> operands;
+        for (auto& a : gnelArgs(values)) {
+            if (a.size() > 1 && a[0] == '-') argv.push_back(a);
+            else operands.push_back(a);
+        }
+        if (!operands.empty()) {
+            if (operands.size() >= 2) {
+                argv.push_back("-o");
+                argv.push_back(operands[1]);
+            }
+            argv.push_back(operands[0]);
+            if (GNELNative::sort(argv, nullptr, *state->scriptOut) == 0 && operands.size() >= 2) {
+                *state->scriptOut << "[GNEL] Sorted: " << operands[0] << " -> " << operands[1] << std::endl;
+            }
+        }
+    }
+    else if (node->value == ".GNEL.count" || node->value == ".gnel.count" ||
+             node->value == ".OpenGNEL.count" || node->value == ".opengnel.count") {
+        // .GNEL.count 'file' [(field) ['sep'] [(top)]] - occurrences, most frequent first
+        std::vector<std::string> texts;
+        std::vector<int> numbers;
+        for (auto& arg : node->children) {
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<std::string>(v)) texts.push_back(std::get<std::string>(v));
+            else if (std::holds_alternative<int>(v)) numbers.push_back(std::get<int>(v));
+        }
+        if (!texts.empty()) {
+            std::vector<std::string> argv = {"count"};
+            if (numbers.size() >= 1) argv.insert(argv.end(), {"-f", std::to_string(numbers[0])});
+            if (texts.size() >= 2) argv.insert(argv.end(), {"-d", texts[1]});
+            if (numbers.size() >= 2) argv.insert(argv.end(), {"-n", std::to_string(numbers[1])});
+            argv.push_back(texts[0]);
+            GNELNative::count(argv, nullptr, *state->scriptOut);
+        }
+    }
+    else if (node->value == ".GNEL.hash" || node->value == ".gnel.hash" ||
+             node->value == ".OpenGNEL.hash" || node->value == ".opengnel.hash") {
+        // .GNEL.hash [-t] [-c] 'sha256|xxh64' 'path'... - -c checks a manifest
+        std::vector<Value> values;
+        for (auto& arg : node->children) values.push_back(evaluateExpression(arg));
+        std::vector<std::string> flags, operands;
+        for (auto& a : gnelArgs(values)) {
+            if (a.size() > 1 && a[0] == '-') flags.push_back(a);
+            else operands.push_back(a);
+        }
+        if (operands.size() >= 2) {
+            std::vector<std::string> argv = {"hash", "-a", operands[0]};
+            argv.insert(argv.end(), flags.begin(), flags.end());
+            // Glob-expand the paths; the algorithm name is not a file
+            std::vector<std::string> paths = gnelArgv("hash", std::vector<std::string>(operands.begin() + 1, operands.end()), 0);
+            argv.insert(argv.end(), paths.begin() + 1, paths.end());
+            GNELNative::hash(argv, nullptr, *state->scriptOut);
+        }
+    }
+    else if (node->value == ".GNEL.watch" || node->value == ".gnel.watch" ||
+             node->value == ".OpenGNEL.watch" || node->value == ".opengnel.watch") {
+        // .GNEL.watch [-r] [-n (batches)] 'path'... (debounceMs) { ... }
+        // Each settled burst of changes sets watch.count and watch.0 .. watch.<count-1>
+        // and runs the block; without a block the changed paths are printed
+        std::shared_ptr<ASTNode> body;
+        std::vector<std::string> paths;
+        bool recursive = false;
+        bool limitNext = false;
+        int debounceMs = 100;
+        int batches = 0;  // 0 = until the script exits
+        for (auto& arg : node->children) {
+            if (arg->type == AST_BLOCK) {
+                body = arg;
+                continue;
+            }
+            Value v = evaluateExpression(arg);
+            if (std::holds_alternative<int>(v)) {
+                if (limitNext) batches = std::get<int>(v);
+                else debounceMs = std::get<int>(v);
+                limitNext = false;
+            } else if (std::holds_alternative<std::string>(v)) {
+                std::string s = std::get<std::string>(v);
+                if (s == "-r") recursive = true;
+                else if (s == "-n") limitNext = true;
+                else paths.push_back(s);
+            }
+        }
+        if (paths.empty()) paths.push_back(".");
+        if (debounceMs < 0) debounceMs = 0;
+
+        FileWatcher watcher;
+        bool watching = false;
+        for (auto& path : paths) {
+            if (watcher.add(path, recursive)) {
+                watching = true;
+            } else {
+                *state->scriptOut << "[GNEL] watch: " << path << ": " << strerror(errno) << std::endl;
             }
         }
-    }
-    else if (node->value == ".GNEL.head" || node->value == ".gnel.head" ||
-             node->value == ".OpenGNEL.head" || node->value == ".opengnel.head") {
-        if (!node->children.empty()) {
-            Value v = evaluateExpression(node->children[0]);
-            int lines = 10;
-            if (node->children.size() >= 2) {
-                Value n = evaluateExpression(node->children[1]);
-                if (std::holds_alternative<int>(n)) lines = std::get<int>(n);
+        if (watching) {
+            *state->scriptOut << "[GNEL] Watching: ";
+            for (size_t i = 0; i < paths.size(); i++) *state->scriptOut << (i ? " " : "") << paths[i];
+            *state->scriptOut << (recursive ? " (recursive)" : "") << std::endl;
+        }
+
+        std::vector<std::string> changed;
+        for (int n = 0; watching && !shouldExit && (batches <= 0 || n < batches); n++) {
+            if (!watcher.wait(debounceMs, changed)) break;
+            auto prev = variables.find("watch.count");
+            if (prev != variables.end() && std::holds_alternative<int>(prev->second)) {
+                for (int i = static_cast<int>(changed.size()); i < std::get<int>(prev->second); i++) {
+                    variables.erase("watch." + std::to_string(i));
+                }
             }
-            if (std::holds_alternative<std::string>(v)) {
-                std::string cmd = "head -n " + std::to_string(lines) + " " + std::get<std::string>(v);
-                system(cmd.c_str());
+            variables["watch.count"] = static_cast<int>(changed.size());
+            for (size_t i = 0; i < changed.size(); i++) {
+                variables["watch." + std::to_string(i)] = changed[i];
+            }
+            if (!body) {
+                for (auto& path : changed) *state->scriptOut << "[GNEL] Changed: " << path << std::endl;
+                continue;
+            }
+            for (auto& stmt : body->children) {
+                if (shouldExit) break;
+                executeNode(stmt);
             }
         }
     }
-    else if (node->value == ".GNEL.tail" || node->value == ".gnel.tail" ||
+    else if (node->value == ".GNEL.head" || node->value == ".gnel.head" ||
+             node->value == ".OpenGNEL.head" || node->value == ".opengnel.head" ||
+             node->value == ".GNEL.tail" || node->value == ".gnel.tail" ||
              node->value == ".OpenGNEL.tail" || node->value == ".opengnel.tail") {
+        // .GNEL.head 'file' (lines) / .GNEL.tail 'file' (lines) [-f]
         if (!node->children.empty()) {
-            Value v = evaluateExpression(node->children[0]);
+            bool head = node->value.find("head") != std::string::npos;
+            std::vector<std::string> files;
+            std::vector<std::string> flags;
             int lines = 10;
-            if (node->children.size() >= 2) {
-                Value n = evaluateExpression(node->children[1]);
-                if (std::holds_alternative<int>(n)) lines = std::get<int>(n);
-            }
-            if (std::holds_alternative<std::string>(v)) {
-                std::string cmd = "tail -n " + std::to_string(lines) + " " + std::get<std::string>(v);
-                system(cmd.c_str());
+            for (auto& arg : node->children) {
+                Value v = evaluateExpression(arg);
+                if (std::holds_alternative<int>(v)) lines = std::get<int>(v);
+                else if (std::holds_alternative<std::string>(v)) {
+                    std::string s = std::get<std::string>(v);
+                    if (s.size() > 1 && s[0] == '-') flags.push_back(s);
+                    else files.push_back(s);
+                }
             }
+            std::vector<std::string> argv = gnelArgv(head ? "head" : "tail", files, 0);
+            argv.insert(argv.begin() + 1, {"-n", std::to_string(lines)});
+            argv.insert(argv.begin() + 1, flags.begin(), flags.end());
+            if (head) GNELNative::head(argv, nullptr, *state->scriptOut);
+            else GNELNative::tail(argv, nullptr, *state->scriptOut);
         }
     }
     // Math Functions - .Module.function syntax with actual calculations
@@ -2533,7 +3096,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
             double result = std::sqrt(num);
-            std::cout << result << std::endl;
+            *state->scriptOut << result << std::endl;
             // Store result if there's a target variable
             if (node->children.size() >= 2) {
                 variables[node->children[1]->value] = result;
@@ -2549,7 +3112,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             else if (std::holds_alternative<double>(base)) b = std::get<double>(base);
             if (std::holds_alternative<int>(exp)) e = std::get<int>(exp);
             else if (std::holds_alternative<double>(exp)) e = std::get<double>(exp);
-            std::cout << std::pow(b, e) << std::endl;
+            *state->scriptOut << std::pow(b, e) << std::endl;
         }
     } else if (node->value == ".Math.sin" || node->value == ".math.sin" ||
                node->value == "Math.sin" || node->value == "math.sin") {
@@ -2558,7 +3121,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::sin(num) << std::endl;
+            *state->scriptOut << std::sin(num) << std::endl;
         }
     } else if (node->value == ".Math.cos" || node->value == ".math.cos" ||
                node->value == "Math.cos" || node->value == "math.cos") {
@@ -2567,14 +3130,14 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::cos(num) << std::endl;
+            *state->scriptOut << std::cos(num) << std::endl;
         }
     } else if (node->value == ".Math.abs" || node->value == ".math.abs" ||
                node->value == "Math.abs" || node->value == "math.abs") {
         if (!node->children.empty()) {
             Value val = evaluateExpression(node->children[0]);
-            if (std::holds_alternative<int>(val)) std::cout << std::abs(std::get<int>(val)) << std::endl;
-            else if (std::holds_alternative<double>(val)) std::cout << std::abs(std::get<double>(val)) << std::endl;
+            if (std::holds_alternative<int>(val)) *state->scriptOut << std::abs(std::get<int>(val)) << std::endl;
+            else if (std::holds_alternative<double>(val)) *state->scriptOut << std::abs(std::get<double>(val)) << std::endl;
         }
     } else if (node->value == ".Math.floor" || node->value == ".math.floor" ||
                node->value == "Math.floor" || node->value == "math.floor") {
@@ -2583,7 +3146,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::floor(num) << std::endl;
+            *state->scriptOut << std::floor(num) << std::endl;
         }
     } else if (node->value == ".Math.ceil" || node->value == ".math.ceil" ||
                node->value == "Math.ceil" || node->value == "math.ceil") {
@@ -2592,7 +3155,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::ceil(num) << std::endl;
+            *state->scriptOut << std::ceil(num) << std::endl;
         }
     } else if (node->value == ".Math.round" || node->value == ".math.round" ||
                node->value == "Math.round" || node->value == "math.round") {
@@ -2601,7 +3164,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::round(num) << std::endl;
+            *state->scriptOut << std::round(num) << std::endl;
         }
     } else if (node->value == ".Math.rand" || node->value == ".math.rand" ||
                node->value == "Math.rand" || node->value == "math.rand") {
@@ -2609,29 +3172,29 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value val = evaluateExpression(node->children[0]);
             int max = 100;
             if (std::holds_alternative<int>(val)) max = std::get<int>(val);
-            std::cout << (rand() % max) << std::endl;
+            *state->scriptOut << (rand() % max) << std::endl;
         } else {
-            std::cout << (rand() % 100) << std::endl;
+            *state->scriptOut << (rand() % 100) << std::endl;
         }
     } else if (node->value == ".Math.pi" || node->value == ".math.pi" ||
                node->value == "Math.pi" || node->value == "math.pi") {
-        std::cout << 3.14159265359 << std::endl;
+        *state->scriptOut << 3.14159265359 << std::endl;
     }
     // Graphics Functions
     else if (node->value == ".Graphics.draw" || node->value == ".gfx.draw" ||
              node->value == "Graphics.draw" || node->value == "gfx.draw") {
-        std::cout << "[GFX] Draw called" << std::endl;
+        *state->scriptOut << "[GFX] Draw called" << std::endl;
     } else if (node->value == ".Graphics.circle" || node->value == ".gfx.circle" ||
                node->value == "Graphics.circle" || node->value == "gfx.circle") {
         if (node->children.size() >= 3) {
-            std::cout << "[GFX] Circle at (" << node->children[0]->value << "," << node->children[1]->value << ") r=" << node->children[2]->value << std::endl;
+            *state->scriptOut << "[GFX] Circle at (" << node->children[0]->value << "," << node->children[1]->value << ") r=" << node->children[2]->value << std::endl;
         }
     } else if (node->value == ".Graphics.rect" || node->value == ".gfx.rect" ||
                node->value == "Graphics.rect" || node->value == "gfx.rect") {
-        std::cout << "[GFX] Rectangle drawn" << std::endl;
+        *state->scriptOut << "[GFX] Rectangle drawn" << std::endl;
     } else if (node->value == ".Graphics.line" || node->value == ".gfx.line" ||
                node->value == "Graphics.line" || node->value == "gfx.line") {
-        std::cout << "[GFX] Line drawn" << std::endl;
+        *state->scriptOut << "[GFX] Line drawn" << std::endl;
     }
     // File Functions
     else if (node->value == ".File.read" || node->value == ".file.read" ||
@@ -2639,7 +3202,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
         if (!node->children.empty()) {
             Value path = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(path)) {
-                std::cout << "[FILE] Reading: " << std::get<std::string>(path) << std::endl;
+                *state->scriptOut << "[FILE] Reading: " << std::get<std::string>(path) << std::endl;
             }
         }
     } else if (node->value == ".File.write" || node->value == ".file.write" ||
@@ -2648,7 +3211,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value path = evaluateExpression(node->children[0]);
             Value content = evaluateExpression(node->children[1]);
             if (std::holds_alternative<std::string>(path)) {
-                std::cout << "[FILE] Writing to: " << std::get<std::string>(path) << std::endl;
+                *state->scriptOut << "[FILE] Writing to: " << std::get<std::string>(path) << std::endl;
             }
         }
     }
@@ -2658,21 +3221,21 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
         if (!node->children.empty()) {
             Value url = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(url)) {
-                std::cout << "[NET] HTTP request to: " << std::get<std::string>(url) << std::endl;
+                *state->scriptOut << "[NET] HTTP request to: " << std::get<std::string>(url) << std::endl;
             }
         }
     } else if (node->value == ".Network.connect" || node->value == ".net.connect" ||
                node->value == "Network.connect" || node->value == "net.connect") {
-        std::cout << "[NET] Connection established" << std::endl;
+        *state->scriptOut << "[NET] Connection established" << std::endl;
     }
     // Console Functions
     else if (node->value == ".Console.clear" || node->value == ".console.clear" ||
              node->value == "Console.clear" || node->value == "console.clear") {
-        std::cout << "\033[2J\033[H"; // ANSI clear screen
+        *state->scriptOut << "\033[2J\033[H"; // ANSI clear screen
     } else if (node->value == ".Console.color" || node->value == ".console.color" ||
                node->value == "Console.color" || node->value == "console.color") {
         // Set console color (simplified)
-        std::cout << "[CONSOLE] Color changed" << std::endl;
+        *state->scriptOut << "[CONSOLE] Color changed" << std::endl;
     }
     // String Functions
     else if (node->value == ".String.upper" || node->value == ".string.upper" ||
@@ -2682,7 +3245,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 for (auto& c : s) c = std::toupper(c);
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     } else if (node->value == ".String.lower" || node->value == ".string.lower" ||
@@ -2692,7 +3255,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 for (auto& c : s) c = std::tolower(c);
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     } else if (node->value == ".String.len" || node->value == ".string.len" ||
@@ -2700,7 +3263,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
         if (!node->children.empty()) {
             Value val = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(val)) {
-                std::cout << std::get<std::string>(val).length() << std::endl;
+                *state->scriptOut << std::get<std::string>(val).length() << std::endl;
             }
         }
     }
@@ -2714,9 +3277,9 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 size_t start = s.find_first_not_of(" \t\n\r");
                 size_t end = s.find_last_not_of(" \t\n\r");
                 if (start != std::string::npos) {
-                    std::cout << s.substr(start, end - start + 1) << std::endl;
+                    *state->scriptOut << s.substr(start, end - start + 1) << std::endl;
                 } else {
-                    std::cout << "" << std::endl;
+                    *state->scriptOut << "" << std::endl;
                 }
             }
         }
@@ -2727,7 +3290,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 std::reverse(s.begin(), s.end());
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     } else if (node->value == ".String.sub" || node->value == ".string.sub" ||
@@ -2741,7 +3304,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 int start = std::holds_alternative<int>(startVal) ? std::get<int>(startVal) : 0;
                 int len = std::holds_alternative<int>(lenVal) ? std::get<int>(lenVal) : s.length();
                 if (start >= 0 && start < (int)s.length()) {
-                    std::cout << s.substr(start, len) << std::endl;
+                    *state->scriptOut << s.substr(start, len) << std::endl;
                 }
             }
         }
@@ -2755,7 +3318,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 int count = std::holds_alternative<int>(countVal) ? std::get<int>(countVal) : 1;
                 std::string result;
                 for (int i = 0; i < count; i++) result += s;
-                std::cout << result << std::endl;
+                *state->scriptOut << result << std::endl;
             }
         }
     } else if (node->value == ".String.has" || node->value == ".string.has" ||
@@ -2766,7 +3329,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val) && std::holds_alternative<std::string>(searchVal)) {
                 std::string s = std::get<std::string>(val);
                 std::string search = std::get<std::string>(searchVal);
-                std::cout << (s.find(search) != std::string::npos ? "true" : "false") << std::endl;
+                *state->scriptOut << (s.find(search) != std::string::npos ? "true" : "false") << std::endl;
             }
         }
     } else if (node->value == ".String.idx" || node->value == ".string.idx" ||
@@ -2778,7 +3341,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::string s = std::get<std::string>(val);
                 std::string search = std::get<std::string>(searchVal);
                 size_t pos = s.find(search);
-                std::cout << (pos != std::string::npos ? (int)pos : -1) << std::endl;
+                *state->scriptOut << (pos != std::string::npos ? (int)pos : -1) << std::endl;
             }
         }
     } else if (node->value == ".String.split" || node->value == ".string.split" ||
@@ -2790,16 +3353,16 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 std::string s = std::get<std::string>(val);
                 std::string delim = std::get<std::string>(delimVal);
                 size_t pos = 0;
-                std::cout << "[";
+                *state->scriptOut << "[";
                 bool first = true;
                 while ((pos = s.find(delim)) != std::string::npos) {
-                    if (!first) std::cout << ", ";
-                    std::cout << "'" << s.substr(0, pos) << "'";
+                    if (!first) *state->scriptOut << ", ";
+                    *state->scriptOut << "'" << s.substr(0, pos) << "'";
                     s.erase(0, pos + delim.length());
                     first = false;
                 }
-                if (!first) std::cout << ", ";
-                std::cout << "'" << s << "']" << std::endl;
+                if (!first) *state->scriptOut << ", ";
+                *state->scriptOut << "'" << s << "']" << std::endl;
             }
         }
     }
@@ -2808,66 +3371,66 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
              node->value == "Time.now" || node->value == "time.now") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
-        std::cout << std::ctime(&time);
+        *state->scriptOut << std::ctime(&time);
     } else if (node->value == ".Time.unix" || node->value == ".time.unix" ||
                node->value == "Time.unix" || node->value == "time.unix") {
         auto now = std::chrono::system_clock::now();
         auto epoch = now.time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(epoch);
-        std::cout << seconds.count() << std::endl;
+        *state->scriptOut << seconds.count() << std::endl;
     } else if (node->value == ".Time.ms" || node->value == ".time.ms" ||
                node->value == "Time.ms" || node->value == "time.ms") {
         auto now = std::chrono::system_clock::now();
         auto epoch = now.time_since_epoch();
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(epoch);
-        std::cout << ms.count() << std::endl;
+        *state->scriptOut << ms.count() << std::endl;
     } else if (node->value == ".Time.year" || node->value == ".time.year" ||
                node->value == "Time.year" || node->value == "time.year") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << (tm.tm_year + 1900) << std::endl;
+        *state->scriptOut << (tm.tm_year + 1900) << std::endl;
     } else if (node->value == ".Time.month" || node->value == ".time.month" ||
                node->value == "Time.month" || node->value == "time.month") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << (tm.tm_mon + 1) << std::endl;
+        *state->scriptOut << (tm.tm_mon + 1) << std::endl;
     } else if (node->value == ".Time.day" || node->value == ".time.day" ||
                node->value == "Time.day" || node->value == "time.day") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_mday << std::endl;
+        *state->scriptOut << tm.tm_mday << std::endl;
     } else if (node->value == ".Time.hour" || node->value == ".time.hour" ||
                node->value == "Time.hour" || node->value == "time.hour") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_hour << std::endl;
+        *state->scriptOut << tm.tm_hour << std::endl;
     } else if (node->value == ".Time.min" || node->value == ".time.min" ||
                node->value == "Time.min" || node->value == "time.min") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_min << std::endl;
+        *state->scriptOut << tm.tm_min << std::endl;
     } else if (node->value == ".Time.sec" || node->value == ".time.sec" ||
                node->value == "Time.sec" || node->value == "time.sec") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_sec << std::endl;
+        *state->scriptOut << tm.tm_sec << std::endl;
     }
     // Array Functions
     else if (node->value == ".Array.new" || node->value == ".array.new" ||
              node->value == "Array.new" || node->value == "array.new") {
-        std::cout << "[]" << std::endl;
+        *state->scriptOut << "[]" << std::endl;
     } else if (node->value == ".Array.len" || node->value == ".array.len" ||
                node->value == "Array.len" || node->value == "array.len") {
         if (!node->children.empty()) {
-            std::cout << node->children.size() << std::endl;
+            *state->scriptOut << node->children.size() << std::endl;
         } else {
-            std::cout << "0" << std::endl;
+            *state->scriptOut << "0" << std::endl;
         }
     } else if (node->value == ".Array.join" || node->value == ".array.join" ||
                node->value == "Array.join" || node->value == "array.join") {
@@ -2882,33 +3445,33 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 else if (std::holds_alternative<int>(v)) result += std::to_string(std::get<int>(v));
                 else if (std::holds_alternative<double>(v)) result += std::to_string(std::get<double>(v));
             }
-            std::cout << result << std::endl;
+            *state->scriptOut << result << std::endl;
         }
     }
     // System Functions
     else if (node->value == ".Sys.os" || node->value == ".sys.os" ||
              node->value == "Sys.os" || node->value == "sys.os") {
         #ifdef _WIN32
-        std::cout << "windows" << std::endl;
+        *state->scriptOut << "windows" << std::endl;
         #elif __APPLE__
-        std::cout << "macos" << std::endl;
+        *state->scriptOut << "macos" << std::endl;
         #elif __linux__
-        std::cout << "linux" << std::endl;
+        *state->scriptOut << "linux" << std::endl;
         #else
-        std::cout << "unknown" << std::endl;
+        *state->scriptOut << "unknown" << std::endl;
         #endif
     } else if (node->value == ".Sys.arch" || node->value == ".sys.arch" ||
                node->value == "Sys.arch" || node->value == "sys.arch") {
         #if defined(__x86_64__) || defined(_M_X64)
-        std::cout << "x64" << std::endl;
+        *state->scriptOut << "x64" << std::endl;
         #elif defined(__i386) || defined(_M_IX86)
-        std::cout << "x86" << std::endl;
+        *state->scriptOut << "x86" << std::endl;
         #elif defined(__aarch64__) || defined(_M_ARM64)
-        std::cout << "arm64" << std::endl;
+        *state->scriptOut << "arm64" << std::endl;
         #elif defined(__arm__) || defined(_M_ARM)
-        std::cout << "arm" << std::endl;
+        *state->scriptOut << "arm" << std::endl;
         #else
-        std::cout << "unknown" << std::endl;
+        *state->scriptOut << "unknown" << std::endl;
         #endif
     } else if (node->value == ".Sys.env" || node->value == ".sys.env" ||
                node->value == "Sys.env" || node->value == "sys.env") {
@@ -2916,7 +3479,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value val = evaluateExpression(node->children[0]);
             if (std::holds_alternative<std::string>(val)) {
                 const char* env = std::getenv(std::get<std::string>(val).c_str());
-                std::cout << (env ? env : "") << std::endl;
+                *state->scriptOut << (env ? env : "") << std::endl;
             }
         }
     } else if (node->value == ".Sys.exit" || node->value == ".sys.exit" ||
@@ -2944,7 +3507,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::tan(num) << std::endl;
+            *state->scriptOut << std::tan(num) << std::endl;
         }
     } else if (node->value == ".Math.log" || node->value == ".math.log" ||
                node->value == "Math.log" || node->value == "math.log") {
@@ -2953,7 +3516,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::log(num) << std::endl;
+            *state->scriptOut << std::log(num) << std::endl;
         }
     } else if (node->value == ".Math.log10" || node->value == ".math.log10" ||
                node->value == "Math.log10" || node->value == "math.log10") {
@@ -2962,7 +3525,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::log10(num) << std::endl;
+            *state->scriptOut << std::log10(num) << std::endl;
         }
     } else if (node->value == ".Math.exp" || node->value == ".math.exp" ||
                node->value == "Math.exp" || node->value == "math.exp") {
@@ -2971,7 +3534,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double num = 0;
             if (std::holds_alternative<int>(val)) num = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) num = std::get<double>(val);
-            std::cout << std::exp(num) << std::endl;
+            *state->scriptOut << std::exp(num) << std::endl;
         }
     } else if (node->value == ".Math.min" || node->value == ".math.min" ||
                node->value == "Math.min" || node->value == "math.min") {
@@ -2983,7 +3546,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             else if (std::holds_alternative<double>(a)) va = std::get<double>(a);
             if (std::holds_alternative<int>(b)) vb = std::get<int>(b);
             else if (std::holds_alternative<double>(b)) vb = std::get<double>(b);
-            std::cout << std::min(va, vb) << std::endl;
+            *state->scriptOut << std::min(va, vb) << std::endl;
         }
     } else if (node->value == ".Math.max" || node->value == ".math.max" ||
                node->value == "Math.max" || node->value == "math.max") {
@@ -2995,7 +3558,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             else if (std::holds_alternative<double>(a)) va = std::get<double>(a);
             if (std::holds_alternative<int>(b)) vb = std::get<int>(b);
             else if (std::holds_alternative<double>(b)) vb = std::get<double>(b);
-            std::cout << std::max(va, vb) << std::endl;
+            *state->scriptOut << std::max(va, vb) << std::endl;
         }
     } else if (node->value == ".Math.mod" || node->value == ".math.mod" ||
                node->value == "Math.mod" || node->value == "math.mod") {
@@ -3005,11 +3568,11 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             int va = 0, vb = 1;
             if (std::holds_alternative<int>(a)) va = std::get<int>(a);
             if (std::holds_alternative<int>(b)) vb = std::get<int>(b);
-            std::cout << (vb != 0 ? va % vb : 0) << std::endl;
+            *state->scriptOut << (vb != 0 ? va % vb : 0) << std::endl;
         }
     } else if (node->value == ".Math.e" || node->value == ".math.e" ||
                node->value == "Math.e" || node->value == "math.e") {
-        std::cout << 2.71828182846 << std::endl;
+        *state->scriptOut << 2.71828182846 << std::endl;
     }
     else if (functions.find(node->value) != functions.end()) {
         auto func = functions[node->value];
@@ -3068,19 +3631,19 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             Value val = evaluateExpression(node->children[0]);
             int ms = 0;
             if (std::holds_alternative<int>(val)) ms = std::get<int>(val);
-            std::cout << "[WAIT] " << ms << "ms" << std::endl;
+            *state->scriptOut << "[WAIT] " << ms << "ms" << std::endl;
         }
     }
     // msg - message output
     else if (node->value == "msg") {
-        std::cout << "[MSG] ";
+        *state->scriptOut << "[MSG] ";
         for (auto& arg : node->children) {
             Value val = evaluateExpression(arg);
             if (std::holds_alternative<std::string>(val)) {
-                std::cout << std::get<std::string>(val);
+                *state->scriptOut << std::get<std::string>(val);
             }
         }
-        std::cout << std::endl;
+        *state->scriptOut << std::endl;
     }
     // gmath - built-in auto math function: gmath (a) + (b), gmath (a) - (b), etc.
     else if (node->value == "gmath") {
@@ -3103,7 +3666,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             else if (op == "%") result = (b != 0) ? fmod(a, b) : 0;
             else if (op == "^") result = std::pow(a, b);
             
-            std::cout << result << std::endl;
+            *state->scriptOut << result << std::endl;
             
             // Store result if there's a target variable
             if (node->children.size() >= 4) {
@@ -3130,7 +3693,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             else if (op == "ceil") result = std::ceil(a);
             else if (op == "round") result = std::round(a);
             
-            std::cout << result << std::endl;
+            *state->scriptOut << result << std::endl;
         }
     }
     // Unit conversion: gmath -C (value) 'from' 'to'
@@ -3368,11 +3931,11 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 result = value * freqToHz[fromUnit] / freqToHz[toUnit];
             }
             else {
-                std::cout << "Unknown conversion: " << fromUnit << " to " << toUnit << std::endl;
+                *state->scriptOut << "Unknown conversion: " << fromUnit << " to " << toUnit << std::endl;
                 return;
             }
             
-            std::cout << result << std::endl;
+            *state->scriptOut << result << std::endl;
         }
     }
     // Inner string functions (no . prefix)
@@ -3382,7 +3945,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 for (auto& c : s) c = std::toupper(c);
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     }
@@ -3392,7 +3955,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 for (auto& c : s) c = std::tolower(c);
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     }
@@ -3404,7 +3967,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
                 size_t start = s.find_first_not_of(" \t\n\r");
                 size_t end = s.find_last_not_of(" \t\n\r");
                 if (start != std::string::npos) {
-                    std::cout << s.substr(start, end - start + 1) << std::endl;
+                    *state->scriptOut << s.substr(start, end - start + 1) << std::endl;
                 }
             }
         }
@@ -3415,7 +3978,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             if (std::holds_alternative<std::string>(val)) {
                 std::string s = std::get<std::string>(val);
                 std::reverse(s.begin(), s.end());
-                std::cout << s << std::endl;
+                *state->scriptOut << s << std::endl;
             }
         }
     }
@@ -3423,59 +3986,59 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
     else if (node->value == "time.now" || node->value == "now") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
-        std::cout << std::ctime(&time);
+        *state->scriptOut << std::ctime(&time);
     }
     else if (node->value == "time.unix" || node->value == "unix") {
         auto now = std::chrono::system_clock::now();
         auto epoch = now.time_since_epoch();
         auto seconds = std::chrono::duration_cast<std::chrono::seconds>(epoch);
-        std::cout << seconds.count() << std::endl;
+        *state->scriptOut << seconds.count() << std::endl;
     }
     else if (node->value == "time.year" || node->value == "year") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << (tm.tm_year + 1900) << std::endl;
+        *state->scriptOut << (tm.tm_year + 1900) << std::endl;
     }
     else if (node->value == "time.month" || node->value == "month") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << (tm.tm_mon + 1) << std::endl;
+        *state->scriptOut << (tm.tm_mon + 1) << std::endl;
     }
     else if (node->value == "time.day" || node->value == "day") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_mday << std::endl;
+        *state->scriptOut << tm.tm_mday << std::endl;
     }
     else if (node->value == "time.hour" || node->value == "hour") {
         auto now = std::chrono::system_clock::now();
         auto time = std::chrono::system_clock::to_time_t(now);
         auto tm = *std::localtime(&time);
-        std::cout << tm.tm_hour << std::endl;
+        *state->scriptOut << tm.tm_hour << std::endl;
     }
     // Inner system functions
     else if (node->value == "sys.os" || node->value == "os") {
         #ifdef _WIN32
-        std::cout << "windows" << std::endl;
+        *state->scriptOut << "windows" << std::endl;
         #elif __APPLE__
-        std::cout << "macos" << std::endl;
+        *state->scriptOut << "macos" << std::endl;
         #elif __linux__
-        std::cout << "linux" << std::endl;
+        *state->scriptOut << "linux" << std::endl;
         #else
-        std::cout << "unknown" << std::endl;
+        *state->scriptOut << "unknown" << std::endl;
         #endif
     }
     else if (node->value == "sys.arch" || node->value == "arch") {
         #if defined(__x86_64__) || defined(_M_X64)
-        std::cout << "x64" << std::endl;
+        *state->scriptOut << "x64" << std::endl;
         #elif defined(__i386) || defined(_M_IX86)
-        std::cout << "x86" << std::endl;
+        *state->scriptOut << "x86" << std::endl;
         #elif defined(__aarch64__) || defined(_M_ARM64)
-        std::cout << "arm64" << std::endl;
+        *state->scriptOut << "arm64" << std::endl;
         #else
-        std::cout << "unknown" << std::endl;
+        *state->scriptOut << "unknown" << std::endl;
         #endif
     }
     else if (node->value == "sleep") {
@@ -3493,7 +4056,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::sqrt(a) << std::endl;
+            *state->scriptOut << std::sqrt(a) << std::endl;
         }
     }
     else if (node->value == "abs") {
@@ -3502,7 +4065,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::abs(a) << std::endl;
+            *state->scriptOut << std::abs(a) << std::endl;
         }
     }
     else if (node->value == "sin") {
@@ -3511,7 +4074,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::sin(a) << std::endl;
+            *state->scriptOut << std::sin(a) << std::endl;
         }
     }
     else if (node->value == "cos") {
@@ -3520,7 +4083,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::cos(a) << std::endl;
+            *state->scriptOut << std::cos(a) << std::endl;
         }
     }
     else if (node->value == "tan") {
@@ -3529,7 +4092,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::tan(a) << std::endl;
+            *state->scriptOut << std::tan(a) << std::endl;
         }
     }
     else if (node->value == "floor") {
@@ -3538,7 +4101,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::floor(a) << std::endl;
+            *state->scriptOut << std::floor(a) << std::endl;
         }
     }
     else if (node->value == "ceil") {
@@ -3547,7 +4110,7 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::ceil(a) << std::endl;
+            *state->scriptOut << std::ceil(a) << std::endl;
         }
     }
     else if (node->value == "round") {
@@ -3556,14 +4119,14 @@ body { font-family: system-ui, sans-serif; background: )" + renderBg + R"(; colo
             double a = 0;
             if (std::holds_alternative<int>(val)) a = std::get<int>(val);
             else if (std::holds_alternative<double>(val)) a = std::get<double>(val);
-            std::cout << std::round(a) << std::endl;
+            *state->scriptOut << std::round(a) << std::endl;
         }
     }
     else if (node->value == "pi" || node->value == "gmath.pi") {
-        std::cout << 3.14159265358979323846 << std::endl;
+        *state->scriptOut << 3.14159265358979323846 << std::endl;
     }
     else if (node->value == "e" || node->value == "gmath.e") {
-        std::cout << 2.71828182845904523536 << std::endl;
+        *state->scriptOut << 2.71828182845904523536 << std::endl;
     }
 }
 
@@ -3637,7 +4200,7 @@ void Interpreter::executeLoop(std::shared_ptr<ASTNode> node) {
     for (int i = 0; i < count && !shouldExit; i++) {
         if (hasMessage) {
             // For repeat: print the message
-            std::cout << node->children[0]->value << std::endl;
+            *state->scriptOut << node->children[0]->value << std::endl;
             // Execute remaining children
             for (size_t j = 1; j < node->children.size(); j++) {
                 if (shouldExit) break;
@@ -3680,7 +4243,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
     std::string moduleName = node->value;
     
     if (importedModules.find(moduleName) != importedModules.end()) {
-        std::cout << "[INFO] Module '" << moduleName << "' already imported" << std::endl;
+        *state->scriptOut << "[INFO] Module '" << moduleName << "' already imported" << std::endl;
         return;
     }
     
@@ -3711,7 +4274,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
     }
     
     importedModules[moduleName] = true;
-    std::cout << "[INFO] Imported module: " << moduleName << std::endl;
+    *state->scriptOut << "[INFO] Imported module: " << moduleName << std::endl;
     
     // Load module functionality based on module name
     if (moduleName == "UI" || moduleName == "UI Library") {
@@ -3790,7 +4353,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["gweb.list"] = std::string("function");
         variables["gweb.foot"] = std::string("function");
         variables["gweb.build"] = std::string("function");
-        std::cout << "[INFO] G_Web.Kit loaded - use .GWeb.* functions" << std::endl;
+        *state->scriptOut << "[INFO] G_Web.Kit loaded - use .GWeb.* functions" << std::endl;
     } else if (moduleName == "OpenGSL") {
         // OpenGSL - Open Public Geneia Styling Library
         variables["opengsl.version"] = std::string("1.0.0");
@@ -3807,7 +4370,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["opengsl.pyramid"] = std::string("function");
         variables["opengsl.cylinder"] = std::string("function");
         variables["opengsl.render"] = std::string("function");
-        std::cout << "[INFO] OpenGSL loaded - use .OpenGSL.* functions" << std::endl;
+        *state->scriptOut << "[INFO] OpenGSL loaded - use .OpenGSL.* functions" << std::endl;
     } else if (moduleName == "OpenGWS" || moduleName == "GWS") {
         // OpenGWS - Open Public Geneia Web Server Services Kit
         // Package Manager + Web Server
@@ -3834,7 +4397,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["gws.foot"] = std::string("function");
         variables["gws.endroute"] = std::string("function");
         variables["gws.serve"] = std::string("function");
-        std::cout << "[INFO] OpenGWS loaded - Package Manager + Web Server" << std::endl;
+        *state->scriptOut << "[INFO] OpenGWS loaded - Package Manager + Web Server" << std::endl;
     } else if (moduleName == "OpenW2G" || moduleName == "W2G") {
         // OpenW2G - Open Public Web to Geneia Kit
         variables["w2g.version"] = std::string("1.0.0");
@@ -3842,7 +4405,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["w2g.convert"] = std::string("function");
         variables["w2g.save"] = std::string("function");
         variables["w2g.view"] = std::string("function");
-        std::cout << "[INFO] OpenW2G loaded - Web to Geneia converter" << std::endl;
+        *state->scriptOut << "[INFO] OpenW2G loaded - Web to Geneia converter" << std::endl;
     } else if (moduleName == "G_Render" || moduleName == "GRender" || moduleName == "GR") {
         // G_Render - Universal Rendering Module
         variables["gr.version"] = std::string("1.0.0");
@@ -3860,7 +4423,7 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["gr.list"] = std::string("function");
         variables["gr.endview"] = std::string("function");
         variables["gr.render"] = std::string("function");
-        std::cout << "[INFO] G_Render loaded - Universal renderer (web/desktop/term/json)" << std::endl;
+        *state->scriptOut << "[INFO] G_Render loaded - Universal renderer (web/desktop/term/json)" << std::endl;
     } else if (moduleName == "OpenGNEL" || moduleName == "GNEL") {
         // OpenGNEL - Open Geneia Element LanScript
         variables["gnel.version"] = std::string("1.0.0");
@@ -3887,15 +4450,15 @@ void Interpreter::executeImport(std::shared_ptr<ASTNode> node) {
         variables["gnel.wc"] = std::string("function");
         variables["gnel.head"] = std::string("function");
         variables["gnel.tail"] = std::string("function");
-        std::cout << "[INFO] OpenGNEL loaded - Command line scripting" << std::endl;
+        *state->scriptOut << "[INFO] OpenGNEL loaded - Command line scripting" << std::endl;
     } else {
-        std::cout << "[WARNING] Unknown module: " << moduleName << std::endl;
+        *state->scriptOut << "[WARNING] Unknown module: " << moduleName << std::endl;
     }
 }
 
 void Interpreter::executeExport(std::shared_ptr<ASTNode> node) {
     std::string exportName = node->value;
-    std::cout << "[INFO] Exported: " << exportName << std::endl;
+    *state->scriptOut << "[INFO] Exported: " << exportName << std::endl;
     
     // Store exported variables/functions for module system
     if (variables.find(exportName) != variables.end()) {
@@ -3919,7 +4482,7 @@ bool Interpreter::loadGeneiaModule(const std::string& filename) {
         fullPath = filename + ".gne";
     }
     
-    std::cout << "[INFO] Loading Geneia module: " << fullPath << std::endl;
+    *state->scriptOut << "[INFO] Loading Geneia module: " << fullPath << std::endl;
     
     // In a real implementation, we would:
     // 1. Read the .gns/.gne file
@@ -3938,6 +4501,87 @@ bool Interpreter::loadGeneiaModule(const std::string& filename) {
 // .intpkf - INT Package files (compiled/packaged commands)
 // ============================================================
 
+typedef std::map<std::string, std::vector<std::string>> IntCommandMeta;
+
+// Parse an INT section key line such as: after = a, b  or  cache = on
+// Only these keys count, and a blank must come before the '=', so shell
+// assignments like after=x or env=prod make stay in the body
+static bool parseIntMeta(const std::string& line, IntCommandMeta& meta) {
+    static const char* keys[] = {"after", "cache", "inputs", "outputs", "env", "lang"};
+    for (const char* key : keys) {
+        size_t len = strlen(key);
+        if (line.compare(0, len, key) != 0) continue;
+        if (len == line.size() || (line[len] != ' ' && line[len] != '\t')) return false;
+        size_t eq = line.find_first_not_of(" \t", len);
+        if (eq == std::string::npos || line[eq] != '=') return false;
+        
+        std::vector<std::string>& values = meta[key];
+        values.clear();
+        std::stringstream ss(line.substr(eq + 1));
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t start = item.find_first_not_of(" \t");
+            if (start == std::string::npos) continue;
+            size_t end = item.find_last_not_of(" \t\r");
+            values.push_back(item.substr(start, end - start + 1));
+        }
+        return true;
+    }
+    return false;
+}
+
+// Compile an INT section body once. Bodies are shell unless they say
+// 'lang = geneia', or every line is a .Module.call, peat or var statement
+// (none of which a shell would run) and the whole body parses. Geneia bodies
+// become an AST_BLOCK (source kept in value), shell bodies an AST_STRING for
+// the process runner.
+static std::shared_ptr<ASTNode> compileIntBody(const std::string& body, const IntCommandMeta& meta) {
+    std::string lang;
+    auto it = meta.find("lang");
+    if (it != meta.end() && !it->second.empty()) lang = it->second[0];
+    
+    auto shellBody = std::make_shared<ASTNode>();
+    shellBody->type = AST_STRING;
+    shellBody->value = body;
+    if (lang == "shell" || body.empty()) return shellBody;
+    
+    Lexer lexer(body);
+    std::vector<Token> tokens = lexer.tokenize();
+    if (lang != "geneia") {
+        int lastLine = 0;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            const Token& t = tokens[i];
+            if (t.type == TOKEN_EOF || t.line == lastLine) continue;
+            lastLine = t.line;
+            bool moduleCall = t.type == TOKEN_OPERATOR && t.value == "." && i + 1 < tokens.size() &&
+                              tokens[i + 1].type == TOKEN_IDENTIFIER && tokens[i + 1].line == t.line;
+            bool statement = t.type == TOKEN_KEYWORD && (t.value == "peat" || t.value == "var");
+            if (!moduleCall && !statement) return shellBody;
+        }
+    }
+    
+    // Unless the body says it is Geneia, failing to parse just means shell
+    Parser parser(tokens, lang != "geneia");
+    auto block = parser.parse();
+    if (parser.failed()) return shellBody;
+    block->type = AST_BLOCK;
+    block->value = body;
+    return block;
+}
+
+static IntCacheSpec intCacheSpec(const IntCommandMeta& meta) {
+    IntCacheSpec spec;
+    auto it = meta.find("cache");
+    if (it != meta.end() && !it->second.empty()) {
+        const std::string& v = it->second[0];
+        spec.enabled = (v == "on" || v == "yes" || v == "true" || v == "1");
+    }
+    if ((it = meta.find("inputs")) != meta.end()) spec.inputs = it->second;
+    if ((it = meta.find("outputs")) != meta.end()) spec.outputs = it->second;
+    if ((it = meta.find("env")) != meta.end()) spec.env = it->second;
+    return spec;
+}
+
 void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
     std::string subCmd = node->value;
     
@@ -3948,9 +4592,9 @@ void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<std::string>(filename)) {
                 std::string file = std::get<std::string>(filename);
                 if (loadIntConfig(file)) {
-                    std::cout << "[INT] Loaded config: " << file << std::endl;
+                    *state->scriptOut << "[INT] Loaded config: " << file << std::endl;
                 } else {
-                    std::cout << "[INT] Failed to load: " << file << std::endl;
+                    *state->scriptOut << "[INT] Failed to load: " << file << std::endl;
                 }
             }
         }
@@ -3970,22 +4614,28 @@ void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
                 }
                 
                 if (packIntConfig(configFile, outputFile)) {
-                    std::cout << "[INT] Packaged: " << configFile << " -> " << outputFile << std::endl;
+                    *state->scriptOut << "[INT] Packaged: " << configFile << " -> " << outputFile << std::endl;
                 } else {
-                    std::cout << "[INT] Failed to package: " << configFile << std::endl;
+                    *state->scriptOut << "[INT] Failed to package: " << configFile << std::endl;
                 }
             }
         }
     } else if (subCmd == "run") {
         // int run 'file.intpkf' - Run packaged commands
+        // int run 'file.intpkf' (N) - Run with at most N parallel workers
         if (!node->children.empty()) {
             Value filename = evaluateExpression(node->children[0]);
+            int jobs = 0;
+            if (node->children.size() >= 2) {
+                Value j = evaluateExpression(node->children[1]);
+                if (std::holds_alternative<int>(j)) jobs = std::get<int>(j);
+            }
             if (std::holds_alternative<std::string>(filename)) {
                 std::string file = std::get<std::string>(filename);
-                if (runIntPackage(file)) {
-                    std::cout << "[INT] Executed package: " << file << std::endl;
+                if (runIntPackage(file, jobs)) {
+                    *state->scriptOut << "[INT] Executed package: " << file << std::endl;
                 } else {
-                    std::cout << "[INT] Failed to run: " << file << std::endl;
+                    *state->scriptOut << "[INT] Failed to run: " << file << std::endl;
                 }
             }
         }
@@ -3997,7 +4647,7 @@ void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
                 std::string name = std::get<std::string>(cmdName);
                 // Store command body
                 intCommands[name] = node->children[1];
-                std::cout << "[INT] Defined command: " << name << std::endl;
+                *state->scriptOut << "[INT] Defined command: " << name << std::endl;
             }
         }
     } else if (subCmd == "exec") {
@@ -4007,9 +4657,23 @@ void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
             if (std::holds_alternative<std::string>(cmdName)) {
                 std::string name = std::get<std::string>(cmdName);
                 if (intCommands.find(name) != intCommands.end()) {
-                    std::cout << "[INT] Executing: " << name << std::endl;
+                    *state->scriptOut << "[INT] Executing: " << name << std::endl;
                     auto cmdBody = intCommands[name];
-                    if (cmdBody->type == AST_BLOCK) {
+                    IntCacheSpec spec = intCacheSpec(intCommandMeta[name]);
+                    if (cmdBody->type == AST_STRING) {
+                        // Shell body loaded from .intcnf
+                        if (spec.enabled) {
+                            std::string output;
+                            int status = intCache.run(cmdBody->value, spec, output);
+                            *state->scriptOut << output << std::flush;
+                            if (status != 0) {
+                                *state->scriptOut << "[INT] Command exited with code: " << status << std::endl;
+                            }
+                        } else {
+                            *state->scriptOut << std::flush;
+                            system(cmdBody->value.c_str());
+                        }
+                    } else if (cmdBody->type == AST_BLOCK) {
                         for (auto& stmt : cmdBody->children) {
                             executeNode(stmt);
                         }
@@ -4017,28 +4681,33 @@ void Interpreter::executeIntCmd(std::shared_ptr<ASTNode> node) {
                         executeNode(cmdBody);
                     }
                 } else {
-                    std::cout << "[INT] Command not found: " << name << std::endl;
+                    *state->scriptOut << "[INT] Command not found: " << name << std::endl;
                 }
             }
         }
     } else if (subCmd == "list") {
         // int list - List available commands
-        std::cout << "[INT] Available commands:" << std::endl;
+        *state->scriptOut << "[INT] Available commands:" << std::endl;
         for (auto& cmd : intCommands) {
-            std::cout << "  - " << cmd.first << std::endl;
+            *state->scriptOut << "  - " << cmd.first;
+            if (intCacheSpec(intCommandMeta[cmd.first]).enabled) *state->scriptOut << " (cached)";
+            *state->scriptOut << std::endl;
         }
         if (intCommands.empty()) {
-            std::cout << "  (none defined)" << std::endl;
+            *state->scriptOut << "  (none defined)" << std::endl;
         }
+        *state->scriptOut << "[INT] Cache: " << intCache.hits() << " hits, " << intCache.misses()
+                  << " misses (" << intCache.directory() << ")" << std::endl;
     } else {
-        std::cout << "[INT] Unknown subcommand: " << subCmd << std::endl;
-        std::cout << "[INT] Usage:" << std::endl;
-        std::cout << "  int load 'file.intcnf'  - Load config file" << std::endl;
-        std::cout << "  int pack 'file.intcnf'  - Package to .intpkf" << std::endl;
-        std::cout << "  int run 'file.intpkf'   - Run packaged commands" << std::endl;
-        std::cout << "  int cmd 'name' { ... }  - Define a command" << std::endl;
-        std::cout << "  int exec 'name'         - Execute a command" << std::endl;
-        std::cout << "  int list                - List commands" << std::endl;
+        *state->scriptOut << "[INT] Unknown subcommand: " << subCmd << std::endl;
+        *state->scriptOut << "[INT] Usage:" << std::endl;
+        *state->scriptOut << "  int load 'file.intcnf'  - Load config file" << std::endl;
+        *state->scriptOut << "  int pack 'file.intcnf'  - Package to .intpkf" << std::endl;
+        *state->scriptOut << "  int run 'file.intpkf'   - Run packaged commands" << std::endl;
+        *state->scriptOut << "  int run 'file' (N)      - Run with N parallel workers" << std::endl;
+        *state->scriptOut << "  int cmd 'name' { ... }  - Define a command" << std::endl;
+        *state->scriptOut << "  int exec 'name'         - Execute a command" << std::endl;
+        *state->scriptOut << "  int list                - List commands" << std::endl;
     }
 }
 
@@ -4071,16 +4740,16 @@ bool Interpreter::loadIntConfig(const std::string& filename) {
         if (line[0] == '[' && line.back() == ']') {
             // Save previous command if any
             if (!currentCmd.empty() && !cmdBody.empty()) {
-                // Create a simple AST node for the command
-                auto cmdNode = std::make_shared<ASTNode>();
-                cmdNode->type = AST_BLOCK;
-                cmdNode->value = cmdBody;
-                intCommands[currentCmd] = cmdNode;
+                intCommands[currentCmd] = compileIntBody(cmdBody, intCommandMeta[currentCmd]);
             }
             
             currentCmd = line.substr(1, line.length() - 2);
             cmdBody = "";
             inCommand = true;
+            intCommandMeta.erase(currentCmd);
+        } else if (inCommand && cmdBody.empty() && parseIntMeta(line, intCommandMeta[currentCmd])) {
+            // after = a, b / cache = on / inputs = ... - section keys
+            continue;
         } else if (inCommand) {
             // Add to command body
             if (!cmdBody.empty()) cmdBody += "\n";
@@ -4090,10 +4759,7 @@ bool Interpreter::loadIntConfig(const std::string& filename) {
     
     // Save last command
     if (!currentCmd.empty() && !cmdBody.empty()) {
-        auto cmdNode = std::make_shared<ASTNode>();
-        cmdNode->type = AST_BLOCK;
-        cmdNode->value = cmdBody;
-        intCommands[currentCmd] = cmdNode;
+        intCommands[currentCmd] = compileIntBody(cmdBody, intCommandMeta[currentCmd]);
     }
     
     file.close();
@@ -4120,6 +4786,18 @@ bool Interpreter::packIntConfig(const std::string& configFile, const std::string
     // Write each command
     for (auto& cmd : intCommands) {
         out << "[" << cmd.first << "]\n";
+        auto meta = intCommandMeta.find(cmd.first);
+        if (meta != intCommandMeta.end()) {
+            for (auto& key : meta->second) {
+                if (key.second.empty()) continue;
+                out << key.first << " = ";
+                for (size_t i = 0; i < key.second.size(); i++) {
+                    if (i > 0) out << ", ";
+                    out << key.second[i];
+                }
+                out << "\n";
+            }
+        }
         if (cmd.second) {
             out << cmd.second->value << "\n";
         }
@@ -4127,11 +4805,154 @@ bool Interpreter::packIntConfig(const std::string& configFile, const std::string
     }
     
     out.close();
-    std::cout << "[INT] Package created: " << outputFile << std::endl;
+    *state->scriptOut << "[INT] Package created: " << outputFile << std::endl;
     return true;
 }
 
-bool Interpreter::runIntPackage(const std::string& filename) {
+// One command read from an .intpkf package
+struct IntPackageCommand {
+    std::string name;
+    std::string body;
+    IntCommandMeta meta;
+    std::shared_ptr<ASTNode> compiled;  // set for Geneia bodies
+    std::vector<std::string> after;
+    std::vector<size_t> dependents;
+    int pending = 0;       // unfinished dependencies
+    int priority = 0;      // length of the longest chain this command starts
+};
+
+// Run package commands as a DAG on a bounded worker pool.
+// Ready commands on the critical path go first; output of each command is
+// captured and printed as one block when it finishes, like make -j -O.
+static bool scheduleIntCommands(std::vector<IntPackageCommand>& cmds, int jobs, IntCache& cache, std::ostream& out,
+                                const std::function<int(std::shared_ptr<ASTNode>, std::string&)>& runBlock) {
+    std::map<std::string, size_t> index;
+    for (size_t i = 0; i < cmds.size(); i++) {
+        index[cmds[i].name] = i;
+    }
+    for (size_t i = 0; i < cmds.size(); i++) {
+        for (auto& dep : cmds[i].after) {
+            auto it = index.find(dep);
+            if (it == index.end()) {
+                out << "[INT] *** No command '" << dep << "', needed by '" << cmds[i].name << "'. Stop." << std::endl;
+                return false;
+            }
+            cmds[it->second].dependents.push_back(i);
+            cmds[i].pending++;
+        }
+    }
+    
+    // Kahn's algorithm gives a topological order and finds cycles
+    std::vector<int> indegree(cmds.size());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < cmds.size(); i++) {
+        indegree[i] = cmds[i].pending;
+        if (indegree[i] == 0) order.push_back(i);
+    }
+    for (size_t k = 0; k < order.size(); k++) {
+        for (size_t d : cmds[order[k]].dependents) {
+            if (--indegree[d] == 0) order.push_back(d);
+        }
+    }
+    if (order.size() != cmds.size()) {
+        out << "[INT] *** Dependency cycle between:";
+        for (size_t i = 0; i < cmds.size(); i++) {
+            if (indegree[i] > 0) out << " " << cmds[i].name;
+        }
+        out << ". Stop." << std::endl;
+        return false;
+    }
+    
+    // Critical path: longest chain of dependents, computed in reverse order
+    for (size_t k = order.size(); k-- > 0;) {
+        auto& cmd = cmds[order[k]];
+        cmd.priority = 1;
+        for (size_t d : cmd.dependents) {
+            cmd.priority = std::max(cmd.priority, cmds[d].priority + 1);
+        }
+    }
+    
+    if (jobs <= 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<int>(jobs, cmds.size());
+    
+    auto later = [&cmds](size_t a, size_t b) {
+        if (cmds[a].priority != cmds[b].priority) return cmds[a].priority < cmds[b].priority;
+        return a > b;  // file order breaks ties
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> ready(later);
+    for (size_t i = 0; i < cmds.size(); i++) {
+        if (cmds[i].pending == 0) ready.push(i);
+    }
+    
+    std::mutex mtx;
+    std::mutex geneiaMtx;  // Geneia bodies share the interpreter
+    std::condition_variable cv;
+    size_t started = 0, finished = 0;
+    int running = 0;
+    bool failed = false;
+    
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&]() { return !ready.empty() || failed || finished == cmds.size() || (running == 0 && ready.empty()); });
+            if (failed || ready.empty()) break;
+            
+            size_t id = ready.top();
+            ready.pop();
+            running++;
+            size_t seq = ++started;
+            out << "[INT] [" << seq << "/" << cmds.size() << "] " << cmds[id].name << std::endl;
+            
+            std::string output;
+            int status = 0;
+            lock.unlock();
+            if (cmds[id].compiled) {
+                // Geneia bodies run in-process one at a time; shell jobs keep running meanwhile
+                std::lock_guard<std::mutex> geneia(geneiaMtx);
+                status = runBlock(cmds[id].compiled, output);
+            } else {
+                IntCacheSpec spec = intCacheSpec(cmds[id].meta);
+                status = spec.enabled ? cache.run(cmds[id].body, spec, output)
+                                      : runIntShell(cmds[id].body, output);
+            }
+            lock.lock();
+            running--;
+            finished++;
+            out << output;
+            if (!output.empty() && output.back() != '\n') out << std::endl;
+            if (status != 0) {
+                out << "[INT] *** [" << cmds[id].name << "] Error " << status << std::endl;
+                if (!failed && running > 0) {
+                    out << "[INT] *** Waiting for unfinished commands...." << std::endl;
+                }
+                failed = true;
+            } else {
+                for (size_t d : cmds[id].dependents) {
+                    if (--cmds[d].pending == 0) ready.push(d);
+                }
+            }
+            cv.notify_all();
+        }
+        cv.notify_all();
+    };
+    
+    std::vector<std::thread> pool;
+    for (int i = 0; i < jobs; i++) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    
+    if (failed) {
+        out << "[INT] " << finished << "/" << cmds.size() << " commands finished before stopping" << std::endl;
+        return false;
+    }
+    out << "[INT] " << finished << " commands finished (" << jobs << " workers)" << std::endl;
+    return true;
+}
+
+bool Interpreter::runIntPackage(const std::string& filename, int jobs) {
     std::ifstream file(filename, std::ios::binary);
     if (!file.is_open()) {
         // Try with .intpkf extension
@@ -4147,41 +4968,106 @@ bool Interpreter::runIntPackage(const std::string& filename) {
     // Read and verify header
     std::getline(file, line);
     if (line != "INTPKF") {
-        std::cout << "[INT] Invalid package format" << std::endl;
+        *state->scriptOut << "[INT] Invalid package format" << std::endl;
         return false;
     }
     
     // Read version
     std::getline(file, line);
-    std::cout << "[INT] Package version: " << line << std::endl;
+    *state->scriptOut << "[INT] Package version: " << line << std::endl;
     
     // Read command count
     std::getline(file, line);
     int cmdCount = std::stoi(line);
-    std::cout << "[INT] Commands in package: " << cmdCount << std::endl;
+    *state->scriptOut << "[INT] Commands in package: " << cmdCount << std::endl;
     
-    // Read and execute commands
-    std::string currentCmd = "";
-    std::string cmdBody = "";
+    // Read commands
+    std::vector<IntPackageCommand> cmds;
+    IntPackageCommand current;
+    bool hasDeps = false;
     
     while (std::getline(file, line)) {
+        if (line.empty() && current.name.empty()) continue;
         if (line[0] == '[' && line != "[/]") {
-            currentCmd = line.substr(1, line.length() - 2);
-            cmdBody = "";
+            current = IntPackageCommand();
+            current.name = line.substr(1, line.length() - 2);
         } else if (line == "[/]") {
-            // Execute the command body
-            if (!cmdBody.empty()) {
-                std::cout << "[INT] Running: " << currentCmd << std::endl;
-                // Execute shell command
-                system(cmdBody.c_str());
+            if (!current.name.empty()) {
+                cmds.push_back(current);
             }
-            currentCmd = "";
+            current = IntPackageCommand();
+        } else if (current.body.empty() && parseIntMeta(line, current.meta)) {
+            current.after = current.meta["after"];
+            hasDeps = hasDeps || !current.after.empty();
         } else {
-            if (!cmdBody.empty()) cmdBody += "\n";
-            cmdBody += line;
+            if (!current.body.empty()) current.body += "\n";
+            current.body += line;
         }
     }
-    
     file.close();
-    return true;
+    
+    // Compile Geneia bodies once; they are also registered for int exec
+    for (auto& cmd : cmds) {
+        auto body = compileIntBody(cmd.body, cmd.meta);
+        if (body->type == AST_BLOCK) {
+            cmd.compiled = body;
+            intCommands[cmd.name] = body;
+            intCommandMeta[cmd.name] = cmd.meta;
+        }
+    }
+    // A Geneia body's output is captured like a shell body's; exit N or an
+    // error is its status and does not end the script running the package
+    auto runBlock = [this](std::shared_ptr<ASTNode> block, std::string& output) {
+        std::ostringstream captured;
+        std::ostream* out = state->scriptOut;
+        state->scriptOut = &captured;
+        int code = exitCode;
+        int status = 0;
+        try {
+            for (auto& stmt : block->children) {
+                if (shouldExit) break;
+                executeNode(stmt);
+            }
+            if (shouldExit) status = exitCode;
+        } catch (const std::exception& e) {
+            captured << "[INT] " << e.what() << std::endl;
+            status = 1;
+        }
+        state->scriptOut = out;
+        shouldExit = false;
+        exitCode = code;
+        output = captured.str();
+        return status;
+    };
+    
+    // Packages without ordering keep the original serial behaviour
+    if (!hasDeps && jobs <= 0) {
+        for (auto& cmd : cmds) {
+            if (!cmd.body.empty()) {
+                *state->scriptOut << "[INT] Running: " << cmd.name << std::endl;
+                IntCacheSpec spec = intCacheSpec(cmd.meta);
+                if (cmd.compiled) {
+                    std::string output;
+                    int status = runBlock(cmd.compiled, output);
+                    *state->scriptOut << output << std::flush;
+                    if (status != 0) {
+                        *state->scriptOut << "[INT] Command exited with code: " << status << std::endl;
+                    }
+                } else if (spec.enabled) {
+                    std::string output;
+                    int status = intCache.run(cmd.body, spec, output);
+                    *state->scriptOut << output << std::flush;
+                    if (status != 0) {
+                        *state->scriptOut << "[INT] Command exited with code: " << status << std::endl;
+                    }
+                } else {
+                    // Execute shell command
+                    system(cmd.body.c_str());
+                }
+            }
+        }
+        return true;
+    }
+    
+    return scheduleIntCommands(cmds, jobs, intCache, *state->scriptOut, runBlock);
 }
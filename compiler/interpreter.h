@@ -2,24 +2,34 @@
 #define INTERPRETER_H
 
 #include "parser.h"
+#include "int_cache.h"
 #include <map>
+#include <memory>
 #include <string>
 #include <variant>
 
 using Value = std::variant<int, double, std::string>;
 
+struct ModuleState;  // what the built-in modules (OpenGWS, OpenGNEL, ...) keep
+
 class Interpreter {
+    friend class GWSScriptHandler;  // runs .GWS.handler blocks per request
+
 private:
     std::map<std::string, Value> variables;
     std::map<std::string, std::shared_ptr<ASTNode>> functions;
     std::map<std::string, bool> importedModules;
     std::map<std::string, std::map<std::string, Value>> exportedModules;
     std::map<std::string, std::shared_ptr<ASTNode>> intCommands;  // INT Inc. custom commands
+    std::map<std::string, std::map<std::string, std::vector<std::string>>> intCommandMeta;  // INT section keys (after, cache, ...)
+    IntCache intCache;  // INT content-addressed result cache
+    std::unique_ptr<ModuleState> state;
     bool shouldExit;
     int exitCode;
     
 public:
-    Interpreter() : shouldExit(false), exitCode(0) {}
+    Interpreter();
+    ~Interpreter();
     void execute(std::shared_ptr<ASTNode> ast);
     
 private:
@@ -36,8 +46,9 @@ private:
     bool loadGeneiaModule(const std::string& filename);
     bool loadIntConfig(const std::string& filename);
     bool packIntConfig(const std::string& configFile, const std::string& outputFile);
-    bool runIntPackage(const std::string& filename);
+    bool runIntPackage(const std::string& filename, int jobs = 0);
     std::string strRepeat(const std::string& str, int count);
+    bool gwsRerun(std::string& error);
 };
 
 #endif
@@ -143,11 +143,12 @@ Token Lexer::nextToken() {
     if (c == '"') return readString();
     if (c == '\'') return readString();
     if (c == '{' && pos + 1 < source.length() && !isspace(source[pos + 1])) {
-        // Check if it's a string literal {text}
+        // Check if it's a string literal {text} (dotted names like {find.count} too)
         size_t tempPos = pos + 1;
         bool isStringLiteral = false;
         while (tempPos < source.length() && source[tempPos] != '}' && source[tempPos] != '\n') {
-            if (!isalnum(source[tempPos]) && source[tempPos] != ' ' && source[tempPos] != '_') {
+            if (!isalnum(source[tempPos]) && source[tempPos] != ' ' && source[tempPos] != '_' &&
+                source[tempPos] != '.') {
                 break;
             }
             tempPos++;
@@ -5,9 +5,13 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "gws_bench.h"
+#include "gws_packages.h"
 
 // Global flag for check mode
 bool g_checkMode = false;
+// The script being run, for .GWS.serve --watch to re-read
+std::string g_scriptPath;
 
 std::string readFile(const std::string& filename) {
     std::ifstream file(filename);
@@ -49,9 +53,18 @@ int main(int argc, char* argv[]) {
         std::cout << "Geneia Programming Language v1.0" << std::endl;
         std::cout << "Usage: geneia <filename.gn>" << std::endl;
         std::cout << "       geneia --check <filename.gn>  (syntax check only, JSON output)" << std::endl;
+        std::cout << "       geneia --bench-http [options] <url>  (HTTP load generator)" << std::endl;
+        std::cout << "       geneia --gwsl-get install|remove|list [package...]  (package manager)" << std::endl;
         return 1;
     }
     
+    if (strcmp(argv[1], "--bench-http") == 0) {
+        return gwsBenchMain(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "--gwsl-get") == 0) {
+        return gwslGetMain(argc - 2, argv + 2);
+    }
+    
     bool checkOnly = false;
     std::string filename;
     
@@ -75,6 +88,7 @@ int main(int argc, char* argv[]) {
     }
     
     try {
+        g_scriptPath = filename;
         std::string source = readFile(filename);
         
         Lexer lexer(source);
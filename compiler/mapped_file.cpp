@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile() : fd(-1), mapping(nullptr), length(0), isRegular(false) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if (mapping) munmap(mapping, length);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    mapping = nullptr;
+    length = 0;
+    isRegular = false;
+    buffer.clear();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        close();
+        errno = EISDIR;
+        return false;
+    }
+
+    isRegular = S_ISREG(st.st_mode);
+    if (isRegular && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            mapping = p;
+            length = st.st_size;
+            return true;
+        }
+    }
+
+    // Streams (and files mmap refuses, e.g. on some procfs entries)
+    char chunk[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        buffer.append(chunk, n);
+    }
+    if (n < 0) {
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+    length = buffer.size();
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+// Read-only view of a whole file. Regular files are mmap'ed; pipes, ttys
+// and other streams are read into memory instead, so callers always get
+// one contiguous buffer.
+class MappedFile {
+private:
+    int fd;
+    void* mapping;
+    size_t length;
+    bool isRegular;
+    std::string buffer;
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false with errno set (EISDIR for directories)
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return mapping ? static_cast<const char*>(mapping) : buffer.data(); }
+    size_t size() const { return length; }
+    bool regular() const { return isRegular; }
+    int descriptor() const { return fd; }
+};
+
+#endif
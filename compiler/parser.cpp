@@ -5,7 +5,7 @@
 // External flag from main.cpp
 extern bool g_checkMode;
 
-Parser::Parser(const std::vector<Token>& toks) : tokens(toks), pos(0) {}
+Parser::Parser(const std::vector<Token>& toks, bool quiet) : tokens(toks), pos(0), hadError(false), quiet(quiet) {}
 
 Token Parser::peek() {
     if (pos >= tokens.size()) return tokens.back();
@@ -32,6 +32,8 @@ std::shared_ptr<ASTNode> Parser::parse() {
                 program->children.push_back(stmt);
             }
         } catch (const std::exception& e) {
+            hadError = true;
+            if (quiet) break;
             if (g_checkMode) {
                 // Re-throw in check mode so main can output JSON
                 throw;
@@ -39,6 +41,8 @@ std::shared_ptr<ASTNode> Parser::parse() {
             std::cerr << "Parse error: " << e.what() << std::endl;
             break;
         } catch (...) {
+            hadError = true;
+            if (quiet) break;
             if (g_checkMode) {
                 throw std::runtime_error("Unknown parse error");
             }
@@ -672,11 +676,23 @@ std::shared_ptr<ASTNode> Parser::parseStatement() {
                             }
                         }
                     }
+                } else if (match(TOKEN_LBRACE)) {
+                    // Trailing block body, e.g. .GNEL.watch 'src' { ... }
+                    advance(); // consume {
+                    auto bodyNode = std::make_shared<ASTNode>();
+                    bodyNode->type = AST_BLOCK;
+                    while (!match(TOKEN_RBRACE) && !match(TOKEN_EOF)) {
+                        auto stmt = parseStatement();
+                        if (stmt) bodyNode->children.push_back(stmt);
+                    }
+                    if (match(TOKEN_RBRACE)) advance(); // consume }
+                    node->children.push_back(bodyNode);
+                    break;
                 } else {
                     break;
                 }
             }
-            
+
             return node;
         }
     }
@@ -1143,6 +1159,7 @@ std::shared_ptr<ASTNode> Parser::parseIntCmd() {
     // int load 'file.intcnf'     - Load config file
     // int pack 'file.intcnf'     - Package config to .intpkf
     // int run 'file.intpkf'      - Run packaged commands
+    // int run 'file.intpkf' (4)  - Run with 4 parallel workers
     // int cmd 'name' { ... }     - Define a command
     // int exec 'name'            - Execute a command
     // int list                   - List available commands
@@ -1170,6 +1187,16 @@ std::shared_ptr<ASTNode> Parser::parseIntCmd() {
             argNode->type = AST_IDENTIFIER;
             argNode->value = advance().value;
             node->children.push_back(argNode);
+        } else if (match(TOKEN_LPAREN)) {
+            // int run 'file.intpkf' (4) - worker count
+            advance(); // consume (
+            if (match(TOKEN_NUMBER)) {
+                auto argNode = std::make_shared<ASTNode>();
+                argNode->type = AST_NUMBER;
+                argNode->value = advance().value;
+                node->children.push_back(argNode);
+            }
+            if (match(TOKEN_RPAREN)) advance(); // consume )
         } else if (match(TOKEN_LBRACE)) {
             advance(); // consume {
             // Parse command body
@@ -34,10 +34,14 @@ class Parser {
 private:
     std::vector<Token> tokens;
     size_t pos;
+    bool hadError;
+    bool quiet;
     
 public:
-    Parser(const std::vector<Token>& toks);
+    // A quiet parser only records failure: no message, no rethrow in --check
+    Parser(const std::vector<Token>& toks, bool quiet = false);
     std::shared_ptr<ASTNode> parse();
+    bool failed() const { return hadError; }
     
 private:
     Token peek();
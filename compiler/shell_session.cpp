@@ -0,0 +1,155 @@
+#include "shell_session.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+std::string ShellSession::quote(const std::string& s) {
+    std::string quoted = "'";
+    for (char c : s) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+// Move fd out of the range the shell's fds 0-4 get set up in
+static int highFd(int fd) {
+    int moved = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+    close(fd);
+    return moved;
+}
+
+ShellSession::ShellSession() : pid(-1), commandFd(-1), statusFd(-1) {}
+
+ShellSession::~ShellSession() {
+    if (running()) stop();
+}
+
+bool ShellSession::start() {
+    int commands[2], status[2];
+    if (pipe2(commands, O_CLOEXEC) != 0) return false;
+    if (pipe2(status, O_CLOEXEC) != 0) {
+        close(commands[0]);
+        close(commands[1]);
+        return false;
+    }
+    for (int* fd : {&commands[0], &commands[1], &status[0], &status[1]}) *fd = highFd(*fd);
+
+    // Commands arrive on fd 0; the real stdin is parked on fd 4 and handed
+    // back to each command, so a command that reads stdin cannot swallow
+    // the rest of the batch
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, 4);
+    posix_spawn_file_actions_adddup2(&actions, commands[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, status[1], 3);
+    char* argv[] = {const_cast<char*>("sh"), nullptr};
+    int err = posix_spawn(&pid, "/bin/sh", &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(commands[0]);
+    close(status[1]);
+    if (err != 0) {
+        pid = -1;
+        close(commands[1]);
+        close(status[0]);
+        return false;
+    }
+    commandFd = commands[1];
+    statusFd = status[0];
+    return true;
+}
+
+int ShellSession::stop() {
+    close(commandFd);
+    close(statusFd);
+    commandFd = statusFd = -1;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    pid = -1;
+    pending.clear();
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    return 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+}
+
+void ShellSession::prelude(const std::string& command) {
+    if (running()) pending += "command eval " + quote(command) + " 3>&- 4>&-\n";
+}
+
+bool ShellSession::run(const std::vector<std::string>& commands, std::vector<int>& statuses,
+                       const std::string& announce) {
+    statuses.clear();
+    if (commands.empty()) return true;
+    if (!running() && !start()) return false;
+
+    // 'command eval' keeps a syntax error from ending the shell; the
+    // braces run in the shell itself, so cd and variables stick
+    std::string script;
+    script.swap(pending);
+    for (auto& cmd : commands) {
+        if (!announce.empty()) script += "printf '%s\\n' " + quote(announce + cmd) + "\n";
+        script += "{ command eval " + quote(cmd) + "\n} <&4 3>&- 4>&-\n";
+        script += "printf '%d\\n' \"$?\" >&3\n";
+    }
+
+    sigset_t pipeSignal, saved;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &saved);
+
+    // Write the batch while collecting statuses; a big batch can fill
+    // the status pipe before the whole script has been written
+    size_t written = 0;
+    bool broken = false, ended = false;
+    std::string line;
+    while (statuses.size() < commands.size() && !ended) {
+        struct pollfd fds[2] = {{statusFd, POLLIN, 0}, {commandFd, POLLOUT, 0}};
+        bool writing = written < script.size() && !broken;
+        if (poll(fds, writing ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (writing && (fds[1].revents & (POLLOUT | POLLERR))) {
+            ssize_t n = write(commandFd, script.data() + written, script.size() - written);
+            if (n > 0) written += n;
+            else if (n < 0 && errno != EINTR && errno != EAGAIN) broken = true;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            char buf[512];
+            ssize_t n = read(statusFd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                ended = true;
+                break;
+            }
+            for (ssize_t i = 0; i < n; i++) {
+                if (buf[i] != '\n') {
+                    line += buf[i];
+                    continue;
+                }
+                statuses.push_back(atoi(line.c_str()));
+                line.clear();
+            }
+        }
+    }
+
+    if (broken) {
+        struct timespec none = {0, 0};
+        sigtimedwait(&pipeSignal, nullptr, &none);  // drop the SIGPIPE we raised
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+
+    if (statuses.size() < commands.size()) {
+        // The shell is gone: the command it was running gets its exit code
+        statuses.push_back(stop());
+        statuses.resize(commands.size(), -1);
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SHELL_SESSION_H
+#define SHELL_SESSION_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// A long-lived /bin/sh coprocess for '.GNEL.run -b'. Commands are written
+// to the shell's stdin; after each one the shell reports its exit status
+// as a line on a separate status pipe (fd 3 on its side), so output still
+// goes straight to the terminal and cd/export persist between commands.
+// A whole batch is written at once and costs a single round-trip.
+class ShellSession {
+public:
+    ShellSession();
+    ~ShellSession();
+
+    ShellSession(const ShellSession&) = delete;
+    ShellSession& operator=(const ShellSession&) = delete;
+
+    // Run commands in order. statuses[i] is the exit code of commands[i],
+    // or -1 if it never ran because an earlier command ended the shell
+    // (exit, a fatal error); the next batch then starts a fresh shell.
+    // If announce is set, the shell prints it followed by each command
+    // before running it, so the lines stay in order with the output.
+    // Returns false if the shell could not be started at all.
+    bool run(const std::vector<std::string>& commands, std::vector<int>& statuses,
+             const std::string& announce = "");
+
+    // Queue a command for the start of the next batch without reporting
+    // its status; keeps the shell in step with .GNEL.cd and .GNEL.env
+    void prelude(const std::string& command);
+
+    bool running() const { return pid > 0; }
+
+    // s single-quoted for sh
+    static std::string quote(const std::string& s);
+
+private:
+    pid_t pid;
+    int commandFd;  // shell's stdin
+    int statusFd;   // one "<status>\n" line per command
+    std::string pending;
+
+    bool start();
+    int stop();  // close the pipes and reap; returns the shell's exit code
+};
+
+#endif
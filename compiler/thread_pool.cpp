@@ -0,0 +1,123 @@
+#include "thread_pool.h"
+#include <chrono>
+#include <csignal>
+#include <pthread.h>
+
+// Which pool and queue the current thread works for (none for outside threads)
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+ThreadPool::ThreadPool(unsigned threads) : queued(0), nextQueue(0), stopping(false) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    // Workers never take SIGINT, so it reaches the thread waiting for it
+    // (tail -f, a server's wait) instead of killing the process
+    sigset_t interrupt, saved;
+    sigemptyset(&interrupt);
+    sigaddset(&interrupt, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &interrupt, &saved);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, nullptr);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Group& group, std::function<void()> task) {
+    group.pending++;
+    // Workers keep their own tasks local; outside threads spread round-robin
+    size_t q = (currentPool == this) ? currentQueue : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[q]->lock);
+        queues[q]->tasks.push_back(Task{std::move(task), &group});
+    }
+    queued++;
+    {
+        std::lock_guard<std::mutex> lock(sleepLock);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::take(size_t home, Task& task) {
+    if (queued == 0) return false;
+    {
+        Queue& own = *queues[home];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(home + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(Task& task) {
+    try {
+        task.fn();
+    } catch (...) {
+        // A failing task must not take the worker down with it
+    }
+    Group* group = task.group;
+    task.fn = nullptr;
+    if (--group->pending == 0) {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        finished.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+    for (;;) {
+        Task task;
+        if (take(index, task)) {
+            runTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepLock);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::wait(Group& group) {
+    size_t home = (currentPool == this) ? currentQueue : 0;
+    while (group.pending > 0) {
+        Task task;
+        if (take(home, task)) {
+            runTask(task);
+            continue;
+        }
+        // Wake up now and then in case new work arrived that we could help with
+        std::unique_lock<std::mutex> lock(sleepLock);
+        finished.wait_for(lock, std::chrono::milliseconds(1), [&] { return group.pending == 0; });
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool shared by the GNEL builtins.
+// Every worker owns a deque: it pushes and pops its own tasks at the back
+// and steals from the front of the others when it runs dry, so recursive
+// work (directory walks) stays local while idle workers balance the load.
+class ThreadPool {
+public:
+    // A batch of tasks that can be waited for independently of other users
+    class Group {
+        friend class ThreadPool;
+        std::atomic<size_t> pending{0};
+    };
+
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Group& group, std::function<void()> task);
+    // Block until every task of the group (including tasks they submitted)
+    // has run. The caller runs queued work meanwhile, so tasks may wait too.
+    void wait(Group& group);
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Process-wide pool sized to the hardware threads
+    static ThreadPool& shared();
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        Group* group = nullptr;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> nextQueue;
+    bool stopping;
+
+    bool take(size_t home, Task& task);
+    void runTask(Task& task);
+    void workerLoop(size_t index);
+};
+
+#endif